@@ -26,6 +26,9 @@ build_ui() {
     echo "📱 Building Svelte UI..."
     
     check_npm
+
+    # The UI imports defaults generated from config_schema.json
+    python3 scripts/generate_config.py
     
     cd svelte-ui
     
@@ -69,6 +72,34 @@ upload_firmware() {
     echo "✅ Firmware upload complete!"
 }
 
+# Function to update a running lamp over Wi-Fi; join its access point first
+ota_upload() {
+    local host="${1:-4.3.2.1}"
+    echo "📡 Updating the lamp at ${host} over Wi-Fi..."
+
+    pio run -e esp32
+    pio run -e esp32 -t buildfs
+
+    # Filesystem first: the firmware update restarts the lamp
+    for image in littlefs firmware; do
+        local file=".pio/build/esp32/${image}.bin"
+        local target="${image/littlefs/filesystem}"
+        local hash
+        hash=$(sha256sum "$file" | cut -c1-64)
+        echo "   ${target}: $(wc -c < "$file") bytes"
+        curl --fail --show-error --data-binary "@${file}" \
+            -H "Content-Type: application/octet-stream" -H "X-Sha256: ${hash}" \
+            "http://${host}/ota/${target}"
+        echo ""
+        if [ "$image" = "littlefs" ]; then
+            echo "   Waiting for the restart..."
+            sleep 8
+        fi
+    done
+
+    echo "✅ OTA update complete!"
+}
+
 # Function to show file system contents
 show_data_files() {
     echo "📋 Files in data/ directory:"
@@ -99,6 +130,9 @@ case "${1:-all}" in
     "upload")
         upload_firmware
         ;;
+    "ota")
+        ota_upload "$2"
+        ;;
     "all")
         build_ui
         show_data_files
@@ -129,6 +163,7 @@ case "${1:-all}" in
         echo "  ui        - Build only the Svelte UI and compress for ESP32"
         echo "  firmware  - Build only the ESP32 firmware"  
         echo "  upload    - Upload firmware to ESP32"
+        echo "  ota [ip]  - Build and send firmware and UI files to a running lamp over Wi-Fi"
         echo "  all       - Build both UI and firmware (default)"
         echo "  dev       - Start development server for UI"
         echo "  clean     - Clean all build artifacts"
@@ -17,7 +17,7 @@ void stopActiveAlarm();
 
 void checkAlarmStates(uint16_t durationMinutes);
 
-bool getAlarmColor(unsigned long currentMillis, RGB& color, uint16_t durationMinutes);
+bool getAlarmColor(RGB& color, uint16_t durationMinutes);
 
 /**
  * @brief Returns the time in milliseconds until the next active alarm event.
@@ -0,0 +1,36 @@
+#ifndef CAPTIVE_DNS_H
+#define CAPTIVE_DNS_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#define DNS_LATENCY_BUCKETS 8
+
+struct DnsStats {
+    uint32_t queries;        // answered since boot
+    uint32_t dropped;        // malformed or non-query packets
+    uint32_t queriesPerSec;  // over the last full second
+    uint32_t p50LatencyUs;   // select() wake-up to reply sent, upper bucket bound
+    uint32_t p90LatencyUs;
+    uint32_t p99LatencyUs;
+    uint32_t p50WaitUs;      // part of the latency spent queued behind earlier packets of the batch
+    uint32_t p99WaitUs;
+    uint32_t maxBatch;       // most packets drained in one wake-up, dropped ones included
+    bool running;
+};
+
+/**
+ * @brief Starts the wildcard DNS responder task answering every A query with ip.
+ * Replaces DNSServer: all queued queries are drained per wake-up and answered
+ * in a static packet buffer without heap allocation.
+ */
+void startCaptiveDns(const IPAddress& ip);
+
+/**
+ * @brief Stops the responder; the task closes its socket and exits.
+ */
+void stopCaptiveDns();
+
+DnsStats getDnsStats();
+
+#endif // CAPTIVE_DNS_H
@@ -0,0 +1,32 @@
+#ifndef CAPTIVE_PORTAL_H
+#define CAPTIVE_PORTAL_H
+
+#include <ESPAsyncWebServer.h>
+
+// Connectivity probes fired by client OSes when they join the AP
+enum CaptiveProbe {
+    PROBE_WINDOWS_CONNECTTEST,
+    PROBE_WPAD,
+    PROBE_ANDROID,
+    PROBE_MICROSOFT_REDIRECT,
+    PROBE_APPLE,
+    PROBE_FIREFOX_CANONICAL,
+    PROBE_FIREFOX_SUCCESS,
+    PROBE_WINDOWS_NCSI,
+    PROBE_FAVICON,
+    PROBE_CATCH_ALL, // anything not served by a route, redirected to the portal
+    PROBE_COUNT
+};
+
+/**
+ * @brief Registers the probe dispatcher and the catch-all redirect on the server.
+ * Must be called before the application routes are added.
+ * @param server The web server to attach to.
+ * @param localIP The AP address all probes are redirected to.
+ */
+void setUpCaptivePortal(AsyncWebServer& server, const IPAddress& localIP);
+
+const char* getCaptiveProbeName(CaptiveProbe probe);
+uint32_t getCaptiveProbeCount(CaptiveProbe probe);
+
+#endif // CAPTIVE_PORTAL_H
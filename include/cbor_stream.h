@@ -0,0 +1,303 @@
+#ifndef CBOR_STREAM_H
+#define CBOR_STREAM_H
+
+#include <Arduino.h>
+#include "key_hash.h"
+
+// Allocation-free CBOR (RFC 8949) reading and writing for application/cbor bodies.
+// CborReader mirrors the JsonCursor interface so the same decoders can run on either.
+// Only definite-length items are supported, which is what every common encoder emits.
+
+#define CBOR_MAX_DEPTH 8
+
+enum CborMajor : uint8_t {
+    CBOR_UINT = 0,
+    CBOR_NEGINT = 1,
+    CBOR_BYTES = 2,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_TAG = 6,
+    CBOR_SIMPLE = 7
+};
+
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_NULL 0xF6
+
+class CborReader {
+public:
+    CborReader(const uint8_t* data, size_t len) : _p(data), _end(data + len) {
+    }
+
+    bool atEnd() const {
+        return _p == _end;
+    }
+
+    bool readMap(size_t& count) {
+        return readContainer(CBOR_MAP, count);
+    }
+
+    bool readArray(size_t& count) {
+        return readContainer(CBOR_ARRAY, count);
+    }
+
+    // Text string returned as a raw slice into the input
+    bool readText(const char*& text, size_t& len) {
+        uint8_t major;
+        uint64_t value;
+        if(!readHead(major, value) || major != CBOR_TEXT || value > (uint64_t)(_end - _p)) {
+            return false;
+        }
+        text = (const char*)_p;
+        len = value;
+        _p += len;
+        return true;
+    }
+
+    bool readKey(const char*& key, size_t& len) {
+        return readText(key, len);
+    }
+
+    // Integer value; fails on other types and on magnitudes beyond 31 bits
+    bool readInt(long& out) {
+        uint8_t major;
+        uint64_t value;
+        if(!readHead(major, value) || (major != CBOR_UINT && major != CBOR_NEGINT) || value > 0x7FFFFFFF) {
+            return false;
+        }
+        out = major == CBOR_UINT ? (long)value : -1 - (long)value;
+        return true;
+    }
+
+    bool readBool(bool& out) {
+        if(_p >= _end || (*_p != CBOR_FALSE && *_p != CBOR_TRUE)) {
+            return false;
+        }
+        out = *_p++ == CBOR_TRUE;
+        return true;
+    }
+
+    // Integer value within [min, max]
+    bool readRanged(long min, long max, long& out) {
+        return readInt(out) && out >= min && out <= max;
+    }
+
+    // Copies a text value into dst; non-strings yield an empty string, like JsonCursor::readString
+    bool readString(char* dst, size_t size, bool& isString) {
+        isString = false;
+        dst[0] = '\0';
+        if(peekMajor() != CBOR_TEXT) {
+            return skipValue(0);
+        }
+        const char* text;
+        size_t len;
+        if(!readText(text, len)) {
+            return false;
+        }
+        isString = true;
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, text, n);
+        dst[n] = '\0';
+        return true;
+    }
+
+    bool skipValue(int depth) {
+        if(depth > CBOR_MAX_DEPTH) {
+            return false;
+        }
+        uint8_t major;
+        uint64_t value;
+        if(!readHead(major, value)) {
+            return false;
+        }
+        switch(major) {
+        case CBOR_BYTES:
+        case CBOR_TEXT:
+            if(value > (uint64_t)(_end - _p)) {
+                return false;
+            }
+            _p += value;
+            return true;
+        case CBOR_MAP:
+            value *= 2;
+            // fall through
+        case CBOR_ARRAY:
+            for(uint64_t i = 0; i < value; i++) {
+                if(!skipValue(depth + 1)) {
+                    return false;
+                }
+            }
+            return true;
+        case CBOR_TAG:
+            return skipValue(depth + 1);
+        default:
+            return true; // integers, simple values and floats live entirely in the head
+        }
+    }
+
+private:
+    const uint8_t* _p;
+    const uint8_t* _end;
+
+    uint8_t peekMajor() const {
+        return _p < _end ? *_p >> 5 : 0xFF;
+    }
+
+    bool readHead(uint8_t& major, uint64_t& value) {
+        if(_p >= _end) {
+            return false;
+        }
+        major = *_p >> 5;
+        uint8_t info = *_p++ & 0x1F;
+        if(info < 24) {
+            value = info;
+            return true;
+        }
+        if(info > 27) {
+            return false; // reserved, or an indefinite length
+        }
+        size_t width = (size_t)1 << (info - 24);
+        if((size_t)(_end - _p) < width) {
+            return false;
+        }
+        value = 0;
+        for(size_t i = 0; i < width; i++) {
+            value = (value << 8) | *_p++;
+        }
+        return true;
+    }
+
+    bool readContainer(uint8_t expected, size_t& count) {
+        uint8_t major;
+        uint64_t value;
+        // Every item takes at least one byte, which bounds count by the remaining input
+        if(!readHead(major, value) || major != expected || value > (uint64_t)(_end - _p)) {
+            return false;
+        }
+        count = value;
+        return true;
+    }
+};
+
+// Iterates the text-keyed members of the map at the cursor, calling onMember(key, len) for each.
+// onMember must consume the value.
+template<typename F>
+inline bool forEachMember(CborReader& cur, F onMember) {
+    size_t count;
+    if(!cur.readMap(count)) {
+        return false;
+    }
+    for(size_t i = 0; i < count; i++) {
+        const char* key;
+        size_t len;
+        if(!cur.readKey(key, len) || !onMember(key, len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Iterates the elements of the array at the cursor, calling onElement() for each.
+// onElement must consume the value.
+template<typename F>
+inline bool forEachElement(CborReader& cur, F onElement) {
+    size_t count;
+    if(!cur.readArray(count)) {
+        return false;
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(!onElement()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends CBOR items to a fixed buffer; finish() reports overflow as 0
+class CborWriter {
+public:
+    CborWriter(uint8_t* buf, size_t size) : _buf(buf), _size(size), _pos(0), _overflow(false) {
+    }
+
+    void map(size_t count) {
+        head(CBOR_MAP, count);
+    }
+
+    void array(size_t count) {
+        head(CBOR_ARRAY, count);
+    }
+
+    void uint(uint32_t value) {
+        head(CBOR_UINT, value);
+    }
+
+    void integer(int32_t value) {
+        if(value < 0) {
+            head(CBOR_NEGINT, (uint32_t)(-1 - (int64_t)value));
+        } else {
+            head(CBOR_UINT, value);
+        }
+    }
+
+    void boolean(bool value) {
+        put(value ? CBOR_TRUE : CBOR_FALSE);
+    }
+
+    void null() {
+        put(CBOR_NULL);
+    }
+
+    void text(const char* value) {
+        text(value, strlen(value));
+    }
+
+    void text(const char* value, size_t len) {
+        head(CBOR_TEXT, len);
+        for(size_t i = 0; i < len; i++) {
+            put(value[i]);
+        }
+    }
+
+    // Returns the length, or 0 if the buffer was too small
+    size_t finish() const {
+        return _overflow ? 0 : _pos;
+    }
+
+private:
+    uint8_t* _buf;
+    size_t _size;
+    size_t _pos;
+    bool _overflow;
+
+    void put(uint8_t b) {
+        if(_pos < _size) {
+            _buf[_pos++] = b;
+        } else {
+            _overflow = true;
+        }
+    }
+
+    // Shortest head for the value, as required for deterministic encoding
+    void head(uint8_t major, uint32_t value) {
+        major <<= 5;
+        if(value < 24) {
+            put(major | value);
+        } else if(value <= 0xFF) {
+            put(major | 24);
+            put(value);
+        } else if(value <= 0xFFFF) {
+            put(major | 25);
+            put(value >> 8);
+            put(value);
+        } else {
+            put(major | 26);
+            put(value >> 24);
+            put(value >> 16);
+            put(value >> 8);
+            put(value);
+        }
+    }
+};
+
+#endif // CBOR_STREAM_H
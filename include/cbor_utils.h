@@ -0,0 +1,25 @@
+#ifndef CBOR_UTILS_H
+#define CBOR_UTILS_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// application/cbor counterparts of the json_utils documents, same keys and values.
+// FullConfig is generated from the schema, see encodeFullConfigCbor in config_schema.h.
+
+#define SYSTEM_CONFIG_CBOR_MAX 160 // two full SSIDs plus masked passwords
+#define WIFI_STATUS_CBOR_MAX 256
+
+/**
+ * @brief Writes the /get_system_config document with masked passwords.
+ * @return The length written, or 0 if buf is too small.
+ */
+size_t createSystemConfigCbor(const SystemSettings& systemSettings, uint8_t* buf, size_t size);
+
+/**
+ * @brief Writes the /get_status document.
+ * @return The length written, or 0 if buf is too small.
+ */
+size_t createWiFiStatusCbor(const WiFiStatus& status, uint8_t* buf, size_t size);
+
+#endif // CBOR_UTILS_H
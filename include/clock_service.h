@@ -0,0 +1,97 @@
+#ifndef CLOCK_SERVICE_H
+#define CLOCK_SERVICE_H
+
+#include <Arduino.h>
+#include <sys/time.h>
+#include "types.h" // For TimeSource
+
+// Keeps wall time close to NTP between syncs. Every sync, from NTP or from a browser,
+// records the offset between true time and the free-running esp_timer; a least squares fit over the recent pairs gives
+// the crystal's drift in ppm, which is persisted and slewed into the system clock
+// with adjtime() as it accumulates. The uncertainty of the fit yields an error bound
+// that grows with the time since the last sync.
+
+#define CLOCK_SYNC_HISTORY 8                  // sync pairs kept for the fit
+#define CLOCK_NTP_UNCERTAINTY_US 50000        // assumed error of one NTP sync over Wi-Fi
+#define CLOCK_CLIENT_MAX_UNCERTAINTY_US 500000 // browser times with a worse round trip are refused
+#define CLOCK_CLIENT_MAX_AGE_MS 10000          // oldest /time_probe reply /set_time accepts
+#define CLOCK_CORRECT_INTERVAL_MS (60 * 1000) // how often accumulated drift is slewed in
+#define CLOCK_DEFAULT_PPM_UNCERTAINTY 50.0f   // crystal tolerance before anything was measured
+#define CLOCK_STORED_PPM_UNCERTAINTY 5.0f     // least trusted uncertainty of an estimate from earlier boots
+#define CLOCK_SYNCED_MAX_ERROR_MS (60 * 1000) // alarms work on minutes
+#define CLOCK_SAVE_MIN_CHANGE_PPM 0.5f        // smaller changes of the estimate are not written to flash
+
+struct ClockStatus {
+    bool isSet;        // synced at least once since boot
+    TimeSource source; // of the last sync
+    uint32_t syncUncertaintyMs; // of the last sync
+    float driftPpm;    // positive when the local clock runs slow, compensated continuously
+    float uncertaintyPpm;
+    uint8_t samples; // sync pairs of this boot in the fit
+    uint32_t sinceSyncS;
+    uint32_t errorBoundMs; // valid if isSet
+    bool hasResidual;
+    int32_t lastResidualMs; // NTP minus the compensated clock at the last sync
+};
+
+/**
+ * @brief Loads the drift estimate of earlier boots; call from setup().
+ */
+void initClockService();
+
+/**
+ * @brief Takes in new syncs and slews the accumulated drift correction; call from loop().
+ */
+void clockServiceLoop();
+
+/**
+ * @brief Records an NTP sync; called from the SNTP task with the time just set.
+ */
+void noteTimeSync(const struct timeval* tv);
+
+/**
+ * @brief Sets the clock from a browser; called from the web task. The clock is set by the loop task
+ * at the next clockServiceLoop() as esp_timer + offsetUs, so the delay until then does not matter.
+ * @param offsetUs True epoch time minus esp_timer_get_time(), both in microseconds.
+ * @param uncertaintyUs Half the round trip of the exchange.
+ * @return False if the clock is already known to be more accurate than that, or uncertaintyUs
+ * exceeds CLOCK_CLIENT_MAX_UNCERTAINTY_US.
+ */
+bool noteClientTime(int64_t offsetUs, uint32_t uncertaintyUs);
+
+/**
+ * @brief Switches the local time zone to a fixed UTC offset, applied by the loop task.
+ * @param tzOffsetMin As Date.getTimezoneOffset() reports it: UTC minus local time in minutes.
+ */
+void setClockTimeZone(int16_t tzOffsetMin);
+
+/**
+ * @brief Syncs taken in by clockServiceLoop since boot; a change means a new residual.
+ */
+uint32_t getClockSyncCount();
+
+/**
+ * @brief How far the compensated clock was off at the last sync.
+ * @return False until two syncs were seen.
+ */
+bool getLastSyncResidualMs(int32_t& residualMs);
+
+/**
+ * @brief True while the clock was set and its error bound is below CLOCK_SYNCED_MAX_ERROR_MS.
+ */
+bool isClockSynced();
+
+ClockStatus getClockStatus();
+
+inline const char* timeSourceName(TimeSource source) {
+    switch(source) {
+    case TIME_SOURCE_NTP:
+        return "ntp";
+    case TIME_SOURCE_BROWSER:
+        return "browser";
+    default:
+        return "none";
+    }
+}
+
+#endif // CLOCK_SERVICE_H
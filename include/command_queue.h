@@ -0,0 +1,42 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// Hands state changes from the web task to the loop task. HTTP handlers enqueue a
+// typed command and answer at once with its id; flash writes and Wi-Fi restarts
+// then run on the loop task, and the outcome can be polled with /command?id=N.
+
+#define COMMAND_QUEUE_LENGTH 4 // pending commands; enqueueing beyond this fails
+#define COMMAND_HISTORY 8      // recent commands whose state can still be queried
+
+enum CommandState : uint8_t {
+    COMMAND_UNKNOWN = 0, // never issued or dropped from the history
+    COMMAND_QUEUED,
+    COMMAND_RUNNING,
+    COMMAND_DONE
+};
+
+/**
+ * @brief Creates the queue. executor runs each command on the loop task.
+ */
+void initCommandQueue(GenericStateUpdateCallback executor);
+
+/**
+ * @brief Copies payload into a new command without blocking. Safe from any task.
+ * @param size Size of the payload; must match the type's payload struct.
+ * @return The command id, or 0 if the queue is full.
+ */
+uint32_t enqueueCommand(StateChangeType type, const void* payload, size_t size);
+
+/**
+ * @brief Runs at most one pending command; call from the loop task.
+ * @return True if a command was run.
+ */
+bool processCommands();
+
+CommandState getCommandState(uint32_t id);
+const char* commandStateName(CommandState state);
+
+#endif // COMMAND_QUEUE_H
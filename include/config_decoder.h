@@ -0,0 +1,27 @@
+#ifndef CONFIG_DECODER_H
+#define CONFIG_DECODER_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// FullConfig codecs are generated from config_schema.json, see config_schema.h
+
+/**
+ * @brief Decodes a /set_system_config body in a single pass without building a DOM.
+ * Masked or empty passwords leave the stored password unchanged.
+ * @param fields Receives the SystemSettingsField bit mask of replaced members.
+ * @return True if the document was well-formed, false otherwise.
+ */
+bool decodeSystemConfigJson(const char* json, size_t len, SystemSettings& settings, uint8_t& fields);
+
+/**
+ * @brief Decodes an application/cbor /set_system_config body with the same rules.
+ */
+bool decodeSystemConfigCbor(const uint8_t* data, size_t len, SystemSettings& settings, uint8_t& fields);
+
+/**
+ * @brief Copies the members set in fields from src into dst.
+ */
+void mergeSystemSettings(SystemSettings& dst, const SystemSettings& src, uint8_t fields);
+
+#endif // CONFIG_DECODER_H
@@ -0,0 +1,126 @@
+// Generated by scripts/generate_config.py from config_schema.json. Do not edit.
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <Arduino.h>
+
+#define CONFIG_SCHEMA_VERSION 1
+#define MAX_ALARMS 10
+
+struct RGB {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+struct Alarm {
+    uint8_t day; // 1-7 (Monday-Sunday), 0 = not set
+    uint8_t hour;
+    uint8_t minute;
+    bool active;
+};
+
+// Packed so the layout is exactly the field list on every toolchain. Scalar
+// members are read and written by value; references to them may be misaligned.
+struct FullConfig {
+    RGB color;
+    uint8_t brightnessMode;
+    uint8_t colorMode; // 0=Cool White, 1=Neutral White, 2=Warm White, 3=Custom
+    uint8_t animationMode; // 0=Static, 1=Breathing
+    Alarm alarms[MAX_ALARMS];
+    uint16_t goodNightDuration; // in minutes
+    uint16_t alarmDuration; // in minutes
+    uint16_t animationSpeed;
+    bool lampGroup; // sync alarms with other lamps on the network
+} __attribute__((packed));
+
+// Bit flags describing which parts of FullConfig a partial update touched
+enum ConfigField : uint8_t {
+    CONFIG_FIELD_COLOR = 1 << 0, // color, colorMode
+    CONFIG_FIELD_ANIMATION = 1 << 1, // animationMode, animationSpeed
+    CONFIG_FIELD_ALARMS = 1 << 2, // alarms
+    CONFIG_FIELD_DURATIONS = 1 << 3, // goodNightDuration, alarmDuration
+    CONFIG_FIELD_LAMP_GROUP = 1 << 4 // lampGroup
+};
+
+// Members a patch set, so it can be merged onto a newer config than the one it was decoded
+// against. Nested values and array elements have bit i set for their member i.
+struct FullConfigPatchMask {
+    uint32_t color;
+    bool colorMode;
+    bool animationMode;
+    uint32_t alarms[MAX_ALARMS];
+    bool goodNightDuration;
+    bool alarmDuration;
+    bool animationSpeed;
+    bool lampGroup;
+};
+
+// Worst-case encoded sizes; the JSON size includes the terminator
+#define FULL_CONFIG_JSON_MAX 691
+#define FULL_CONFIG_CBOR_MAX 442
+#define FULL_CONFIG_STORAGE_MAX 75
+
+/**
+ * @brief Returns a FullConfig with every field at its schema default.
+ */
+FullConfig defaultFullConfig();
+
+/**
+ * @brief Checks every field against the ranges declared in the schema.
+ */
+bool isValidFullConfig(const FullConfig& config);
+
+/**
+ * @brief Writes the /get_config document into buf.
+ * @return The length written, or 0 if buf is smaller than FULL_CONFIG_JSON_MAX requires.
+ */
+size_t encodeFullConfigJson(const FullConfig& config, char* buf, size_t size);
+
+/**
+ * @brief Decodes a /set_config body in a single pass without building a DOM.
+ * Absent fields take their defaults, absent arrays keep their current elements.
+ * @return False, leaving config untouched, on malformed JSON, a mistyped or out of range value.
+ */
+bool decodeFullConfigJson(const char* json, size_t len, FullConfig& config);
+
+/**
+ * @brief Applies a sparse /patch_config body; only keys present are touched.
+ * A single alarms element is addressed as {"alarm":{"index":2,...}}.
+ * @param changedFields Receives the ConfigField bit mask of touched groups.
+ * @param mask Receives the members the body set.
+ * @return False, leaving config untouched, if any value is invalid or a key cannot be patched.
+ */
+bool decodeFullConfigPatchJson(const char* json, size_t len, FullConfig& config, uint8_t& changedFields,
+                               FullConfigPatchMask& mask);
+
+/**
+ * @brief Copies the members set in mask from src into dst.
+ */
+void mergeFullConfigPatch(FullConfig& dst, const FullConfig& src, const FullConfigPatchMask& mask);
+
+/**
+ * @brief Writes the /get_config document as CBOR, with the same keys as the JSON one.
+ * @return The length written, or 0 if buf is too small; FULL_CONFIG_CBOR_MAX always suffices.
+ */
+size_t encodeFullConfigCbor(const FullConfig& config, uint8_t* buf, size_t size);
+
+/**
+ * @brief Decodes an application/cbor /set_config body with the rules of decodeFullConfigJson.
+ */
+bool decodeFullConfigCbor(const uint8_t* data, size_t len, FullConfig& config);
+
+/**
+ * @brief Serializes config for flash as versioned id/length/value records.
+ * @return The length written, or 0 if size < FULL_CONFIG_STORAGE_MAX.
+ */
+size_t encodeFullConfigStorage(const FullConfig& config, uint8_t* buf, size_t size);
+
+/**
+ * @brief Reads records written by any schema version. Unknown ids are skipped,
+ * missing or out of range values take their defaults.
+ * @return False if the data is not a config record set.
+ */
+bool decodeFullConfigStorage(const uint8_t* data, size_t len, FullConfig& config);
+
+#endif // CONFIG_SCHEMA_H
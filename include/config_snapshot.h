@@ -0,0 +1,72 @@
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// RCU-style sharing of FullConfig between the loop and the web task. Writers copy
+// the current snapshot into a free slot, modify the copy and publish it with one
+// atomic index store. Readers pin whatever is current and never take a lock.
+
+#define CONFIG_SNAPSHOT_SLOTS 3 // current, one pinned by the web task, one being written
+
+/**
+ * @brief Pins the current snapshot for the lifetime of the object.
+ * Keep readers short lived; a writer waits while every spare slot is pinned.
+ */
+class ConfigReader {
+public:
+    ConfigReader();
+    ~ConfigReader();
+
+    const FullConfig& operator*() const {
+        return *_config;
+    }
+
+    const FullConfig* operator->() const {
+        return _config;
+    }
+
+    // Incremented by every publication
+    uint32_t generation() const {
+        return _generation;
+    }
+
+private:
+    ConfigReader(const ConfigReader&) = delete;
+    ConfigReader& operator=(const ConfigReader&) = delete;
+
+    uint8_t _slot;
+    const FullConfig* _config;
+    uint32_t _generation;
+};
+
+// Modifies the copy that is about to be published. Runs with the writer lock held, must not block.
+typedef void (*ConfigUpdater)(FullConfig& config, const void* context);
+
+/**
+ * @brief Publishes the current snapshot as modified by updater. Safe from any task.
+ * @return The generation of the new snapshot.
+ */
+uint32_t updateConfig(ConfigUpdater updater, const void* context);
+
+/**
+ * @brief Publishes config as the new snapshot, replacing every field.
+ * @return The generation of the new snapshot.
+ */
+uint32_t publishConfig(const FullConfig& config);
+
+// SystemSettings are written rarely and always read whole, so they are copied under a
+// spinlock instead. The loop task owns them and publishes each change.
+
+/**
+ * @brief Makes settings the copy returned by readSystemSettings(). Safe from any task.
+ */
+void publishSystemSettings(const SystemSettings& settings);
+
+/**
+ * @brief Returns the last published settings. Safe from any task.
+ */
+SystemSettings readSystemSettings();
+
+#endif // CONFIG_SNAPSHOT_H
@@ -1,12 +1,108 @@
 #ifndef DEBUG_UTILS_H
 #define DEBUG_UTILS_H
 
-#include <Arduino.h> // For String
+#include <Arduino.h> // For Print
+
+// Compile-time log level, override with -DLOG_LEVEL=... in build_flags.
+// Calls above the level compile to nothing.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_MAX_ARGS 6
+
+enum LogArgType : uint8_t {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_FLOAT,
+    LOG_ARG_STR // must point to a string literal, only the pointer is recorded
+};
+
+struct LogArg {
+    uintptr_t bits; // 32 bits on the ESP32
+    LogArgType type;
+};
+
+// Narrower integers and bool promote to int
+inline LogArg logArg(int v) {
+    return {(uintptr_t)v, LOG_ARG_INT};
+}
+inline LogArg logArg(long v) {
+    return {(uintptr_t)v, LOG_ARG_INT};
+}
+inline LogArg logArg(unsigned int v) {
+    return {(uintptr_t)v, LOG_ARG_UINT};
+}
+inline LogArg logArg(unsigned long v) {
+    return {(uintptr_t)v, LOG_ARG_UINT};
+}
+inline LogArg logArg(double v) {
+    float f = (float)v;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return {bits, LOG_ARG_FLOAT};
+}
+inline LogArg logArg(const char* v) {
+    return {(uintptr_t)v, LOG_ARG_STR};
+}
+
+/**
+ * @brief Appends a binary record to the lock-free log ring. Never allocates or blocks;
+ * the record is dropped if the ring is full.
+ * @param fmt printf-style format, must be a string literal (stored by pointer).
+ */
+void logWrite(uint8_t level, const char* fmt, const LogArg* args, uint8_t argc);
+
+// Never called; gives the LOG_* macros printf format checking, which templates cannot have
+inline void logFormatCheck(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char*, ...) {
+}
+
+template<typename... Args>
+inline void logRecord(uint8_t level, const char* fmt, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    const LogArg packed[] = {logArg(args)..., LogArg{0, LOG_ARG_INT}};
+    logWrite(level, fmt, packed, sizeof...(Args));
+}
+
+#define LOG_AT(level, fmt, ...)                                                                                        \
+    do {                                                                                                               \
+        if(false) {                                                                                                    \
+            logFormatCheck(fmt, ##__VA_ARGS__);                                                                        \
+        }                                                                                                              \
+        if(LOG_LEVEL >= level) {                                                                                       \
+            logRecord(level, fmt, ##__VA_ARGS__);                                                                      \
+        }                                                                                                              \
+    } while(0)
+
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+
+/**
+ * @brief Starts the low-priority task that drains the log ring to Serial.
+ * Records written before this call are kept until the task runs.
+ */
+void initLogger();
+
+/**
+ * @brief Prints the most recent drained records, oldest first, one per line.
+ */
+void printLogHistory(Print& out);
+
+uint32_t getDroppedLogCount();
 
 /**
- * @brief Prints a message to the serial port if DEBUG is enabled.
- * @param text The text to print.
+ * @brief Logs a static message at info level through the ring.
+ * Only the pointer is recorded, so the "" concatenation rejects anything but a string literal.
  */
-void serialPrint(const String& text);
+#define serialPrint(text) LOG_I("%s", "" text)
 
 #endif // DEBUG_UTILS_H
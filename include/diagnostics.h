@@ -0,0 +1,50 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Arduino.h>
+
+// Heap and stack watermarks sampled on the loop task. Headroom is checked every
+// DIAG_CHECK_INTERVAL_MS; every DIAG_SAMPLE_INTERVAL_MS a sample is kept in a
+// fixed ring so slow leaks and fragmentation show up in /get_memory_stats.
+
+#define DIAG_CHECK_INTERVAL_MS (10 * 1000)
+#define DIAG_SAMPLE_INTERVAL_MS (5 * 60 * 1000)
+#define DIAG_HISTORY 96  // 8 hours at 5 minute samples
+#define DIAG_MAX_TASKS 8 // see monitoredTasks in diagnostics.cpp
+
+// Warning limits, override with -D... in build_flags
+#ifndef DIAG_MIN_FREE_HEAP
+#define DIAG_MIN_FREE_HEAP (24 * 1024)
+#endif
+#ifndef DIAG_MIN_LARGEST_BLOCK
+#define DIAG_MIN_LARGEST_BLOCK (10 * 1024)
+#endif
+#ifndef DIAG_MIN_STACK_HEADROOM
+#define DIAG_MIN_STACK_HEADROOM 512 // bytes never touched by a task
+#endif
+
+#define DIAG_TASK_ABSENT 0xFFFF // stack headroom of a task that is not running
+
+struct MemorySample {
+    uint32_t uptimeS;
+    uint32_t freeHeap;
+    uint32_t largestFreeBlock;
+    uint32_t minFreeHeap; // lowest free heap since boot
+    uint16_t stackHeadroom[DIAG_MAX_TASKS];
+};
+
+/**
+ * @brief Checks headroom and records samples; call from loop().
+ * Flashes the warning color whenever a check finds a limit crossed.
+ */
+void checkDiagnostics();
+
+MemorySample getLatestMemorySample();
+
+/**
+ * @brief Writes limits, task names and the sample history, oldest first, as JSON.
+ * Streams row by row so the response needs no document buffer while heap is short.
+ */
+void printMemoryStatsJson(Print& out);
+
+#endif // DIAGNOSTICS_H
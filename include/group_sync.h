@@ -0,0 +1,117 @@
+#ifndef GROUP_SYNC_H
+#define GROUP_SYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared timebase of a lamp group. Every lamp beacons its group time once a
+// second; the lamp with the best clock (synced before unsynced, then the lowest
+// node id) among those heard recently leads, and the others steer an offset on
+// top of their own clock towards the leader's beacons. Wi-Fi only ever delays a
+// beacon, so the highest of the recent samples is the one that waited least.
+// Plain C++, fed with beacons and times, so several nodes can be simulated on a host.
+
+#define GROUP_MAX_PEERS 8
+#define GROUP_BEACON_INTERVAL_MS 1000
+#define GROUP_PEER_TIMEOUT_MS 3500 // about three missed beacons and a peer drops out of the election
+#define GROUP_FILTER_SAMPLES 8     // leader beacons the delay filter looks back on
+#define GROUP_STEP_MS 500          // larger errors are stepped, smaller ones slewed in
+#define GROUP_SLEW_DIVISOR 4       // share of the error taken per beacon
+#define GROUP_LOCK_MS 15           // below one LED frame
+#define GROUP_LEADER_SLEW_MS 1     // per beacon, a leader returns its offset to its own clock
+#define GROUP_BEACON_SIZE 16
+
+struct GroupBeacon {
+    uint32_t nodeId;
+    bool clockSynced; // the sender's own clock was set by NTP or a browser
+    bool leader;
+    int64_t groupMs; // group time when sent, ms since the epoch
+};
+
+size_t encodeGroupBeacon(const GroupBeacon& beacon, uint8_t* buf, size_t size);
+bool decodeGroupBeacon(const uint8_t* data, size_t len, GroupBeacon& beacon);
+
+class GroupSync {
+public:
+    explicit GroupSync(uint32_t nodeId);
+
+    // Alone again, keeps the offset
+    void reset();
+
+    // The own clock was stepped; the next leader beacon sets the offset anew
+    void onClockStep();
+
+    void setClockSynced(bool synced) {
+        _clockSynced = synced;
+    }
+
+    /**
+     * @brief Takes a beacon of another lamp.
+     * @param localMs Own clock when the beacon arrived, ms since the epoch.
+     * @param nowMs Monotonic time for the peer timeouts.
+     */
+    void onBeacon(const GroupBeacon& beacon, int64_t localMs, uint32_t nowMs);
+
+    /**
+     * @brief Expires silent peers and slews a leader's offset; call once per beacon interval.
+     */
+    void tick(uint32_t nowMs);
+
+    GroupBeacon makeBeacon(int64_t localMs) const;
+
+    uint32_t nodeId() const {
+        return _nodeId;
+    }
+    uint32_t leaderId() const {
+        return _leaderId;
+    }
+    bool isLeader() const {
+        return _leaderId == _nodeId;
+    }
+    // A leader is its own reference; a follower once its error stays within GROUP_LOCK_MS
+    bool isLocked() const {
+        return isLeader() || (_filterCount > 1 && _lastErrorMs <= GROUP_LOCK_MS && _lastErrorMs >= -GROUP_LOCK_MS);
+    }
+    int64_t offsetMs() const {
+        return _offsetMs;
+    }
+    int32_t lastErrorMs() const {
+        return _lastErrorMs;
+    }
+    uint8_t peerCount() const {
+        return _peerCount;
+    }
+    uint32_t elections() const {
+        return _elections;
+    }
+    uint32_t steps() const {
+        return _steps;
+    }
+
+private:
+    struct Peer {
+        uint32_t nodeId;
+        bool clockSynced;
+        uint32_t heardMs;
+    };
+
+    uint32_t _nodeId;
+    bool _clockSynced;
+    Peer _peers[GROUP_MAX_PEERS];
+    uint8_t _peerCount;
+    uint32_t _leaderId;
+    int64_t _offsetMs; // group time minus own clock
+    int64_t _filter[GROUP_FILTER_SAMPLES];
+    uint8_t _filterCount;
+    uint8_t _filterNext;
+    int32_t _lastErrorMs;
+    uint32_t _elections;
+    uint32_t _steps;
+
+    void notePeer(const GroupBeacon& beacon, uint32_t nowMs);
+    void expirePeers(uint32_t nowMs);
+    void elect();
+    void clearFilter();
+};
+
+#endif // GROUP_SYNC_H
@@ -0,0 +1,375 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+#include "key_hash.h"
+
+// Allocation-free JSON reading and writing shared by the generated config
+// codecs (config_schema.cpp) and the hand-written decoders (config_decoder.cpp).
+// cbor_stream.h offers the same reader interface for CBOR bodies.
+
+#define JSON_MAX_DEPTH 8
+
+// Forward-only reader over the raw body. Every read returns false on malformed input.
+class JsonCursor {
+public:
+    JsonCursor(const char* json, size_t len) : _p(json), _end(json + len) {
+    }
+
+    bool atEnd() {
+        skipWhitespace();
+        return _p == _end;
+    }
+
+    char peek() {
+        skipWhitespace();
+        return _p < _end ? *_p : '\0';
+    }
+
+    bool consume(char c) {
+        if(peek() != c) {
+            return false;
+        }
+        _p++;
+        return true;
+    }
+
+    // Key of the next member, returned as a raw slice into the input
+    bool readKey(const char*& key, size_t& len) {
+        if(peek() != '"') {
+            return false;
+        }
+        key = _p + 1;
+        if(!skipString()) {
+            return false;
+        }
+        len = _p - 1 - key;
+        return consume(':');
+    }
+
+    // Between members: true with more=false on '}' or ']', true with more=true on ','
+    bool next(char close, bool& more) {
+        if(consume(',')) {
+            more = true;
+            return true;
+        }
+        more = false;
+        return consume(close);
+    }
+
+    // Integer value in JSON integer syntax. Fails on leading zeros and on magnitudes beyond 9 digits,
+    // and, like CborReader, on any fraction or exponent, even one with an integral value such as 1.0 or 1e3.
+    bool readInt(long& out) {
+        bool negative = consume('-');
+        if(_p >= _end || *_p < '0' || *_p > '9') {
+            return false;
+        }
+        long value = 0;
+        if(*_p == '0') {
+            _p++;
+        } else {
+            int digits = 0;
+            while(_p < _end && *_p >= '0' && *_p <= '9') {
+                value = value * 10 + (*_p - '0');
+                _p++;
+                if(++digits > 9) {
+                    return false;
+                }
+            }
+        }
+        if(_p < _end && (*_p == '.' || *_p == 'e' || *_p == 'E' || (*_p >= '0' && *_p <= '9'))) {
+            return false;
+        }
+        out = negative ? -value : value;
+        return true;
+    }
+
+    bool readBool(bool& out) {
+        if(matchLiteral("true")) {
+            out = true;
+            return true;
+        }
+        if(matchLiteral("false")) {
+            out = false;
+            return true;
+        }
+        return false;
+    }
+
+    // Integer value within [min, max]
+    bool readRanged(long min, long max, long& out) {
+        return readInt(out) && out >= min && out <= max;
+    }
+
+    // Unescapes a string value into dst; non-strings yield an empty string.
+    // Sets isString so callers can tell "" from a missing/mistyped value.
+    bool readString(char* dst, size_t size, bool& isString) {
+        isString = false;
+        dst[0] = '\0';
+        if(peek() != '"') {
+            return skipValue(0);
+        }
+        isString = true;
+        _p++;
+        size_t n = 0;
+        while(_p < _end && *_p != '"') {
+            char c = *_p++;
+            if(c == '\\') {
+                if(_p >= _end) {
+                    return false;
+                }
+                char e = *_p++;
+                switch(e) {
+                case 'b':
+                    c = '\b';
+                    break;
+                case 'f':
+                    c = '\f';
+                    break;
+                case 'n':
+                    c = '\n';
+                    break;
+                case 'r':
+                    c = '\r';
+                    break;
+                case 't':
+                    c = '\t';
+                    break;
+                case 'u': {
+                    uint32_t code;
+                    if(!readHex4(code)) {
+                        return false;
+                    }
+                    // Encode BMP code points as UTF-8, surrogate pairs are not combined
+                    char utf8[3];
+                    size_t count = 0;
+                    if(code < 0x80) {
+                        utf8[count++] = code;
+                    } else if(code < 0x800) {
+                        utf8[count++] = 0xC0 | (code >> 6);
+                        utf8[count++] = 0x80 | (code & 0x3F);
+                    } else {
+                        utf8[count++] = 0xE0 | (code >> 12);
+                        utf8[count++] = 0x80 | ((code >> 6) & 0x3F);
+                        utf8[count++] = 0x80 | (code & 0x3F);
+                    }
+                    for(size_t i = 0; i < count; i++) {
+                        if(n + 1 < size) {
+                            dst[n++] = utf8[i];
+                        }
+                    }
+                    continue;
+                }
+                default:
+                    c = e; // \" \\ \/
+                    break;
+                }
+            }
+            if(n + 1 < size) {
+                dst[n++] = c;
+            }
+        }
+        dst[n] = '\0';
+        if(_p >= _end) {
+            return false;
+        }
+        _p++;
+        return true;
+    }
+
+    bool skipValue(int depth) {
+        if(depth > JSON_MAX_DEPTH) {
+            return false;
+        }
+        char c = peek();
+        if(c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            _p++;
+            if(consume(close)) {
+                return true;
+            }
+            bool more = true;
+            while(more) {
+                if(c == '{') {
+                    const char* key;
+                    size_t len;
+                    if(!readKey(key, len)) {
+                        return false;
+                    }
+                }
+                if(!skipValue(depth + 1) || !next(close, more)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if(c == '"') {
+            return skipString();
+        }
+        if(matchLiteral("true") || matchLiteral("false") || matchLiteral("null")) {
+            return true;
+        }
+        if(c == '-' || (c >= '0' && c <= '9')) {
+            while(_p < _end && (*_p == '-' || *_p == '+' || *_p == '.' || *_p == 'e' || *_p == 'E'
+                                || (*_p >= '0' && *_p <= '9'))) {
+                _p++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    const char* _p;
+    const char* _end;
+
+    // Moves past the string starting at the current quote, escapes are not decoded
+    bool skipString() {
+        _p++;
+        while(_p < _end && *_p != '"') {
+            if(*_p == '\\') {
+                _p++;
+            }
+            _p++;
+        }
+        if(_p >= _end) {
+            return false;
+        }
+        _p++;
+        return true;
+    }
+
+    void skipWhitespace() {
+        while(_p < _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t')) {
+            _p++;
+        }
+    }
+
+    bool matchLiteral(const char* literal) {
+        skipWhitespace();
+        size_t len = strlen(literal);
+        if((size_t)(_end - _p) < len || memcmp(_p, literal, len) != 0) {
+            return false;
+        }
+        _p += len;
+        return true;
+    }
+
+    bool readHex4(uint32_t& code) {
+        if(_end - _p < 4) {
+            return false;
+        }
+        code = 0;
+        for(int i = 0; i < 4; i++) {
+            char h = *_p++;
+            code <<= 4;
+            if(h >= '0' && h <= '9') {
+                code |= h - '0';
+            } else if(h >= 'a' && h <= 'f') {
+                code |= h - 'a' + 10;
+            } else if(h >= 'A' && h <= 'F') {
+                code |= h - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Iterates the members of the object at the cursor, calling onMember(key, len) for each.
+// onMember must consume the value.
+template<typename F>
+inline bool forEachMember(JsonCursor& cur, F onMember) {
+    if(!cur.consume('{')) {
+        return false;
+    }
+    if(cur.consume('}')) {
+        return true;
+    }
+    bool more = true;
+    while(more) {
+        const char* key;
+        size_t len;
+        if(!cur.readKey(key, len) || !onMember(key, len) || !cur.next('}', more)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Iterates the elements of the array at the cursor, calling onElement() for each.
+// onElement must consume the value.
+template<typename F>
+inline bool forEachElement(JsonCursor& cur, F onElement) {
+    if(!cur.consume('[')) {
+        return false;
+    }
+    if(cur.consume(']')) {
+        return true;
+    }
+    bool more = true;
+    while(more) {
+        if(!onElement() || !cur.next(']', more)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends JSON text to a fixed buffer; finish() reports overflow as 0
+class JsonWriter {
+public:
+    JsonWriter(char* buf, size_t size) : _buf(buf), _size(size), _pos(0), _overflow(size == 0) {
+    }
+
+    void raw(const char* text) {
+        while(*text) {
+            put(*text++);
+        }
+    }
+
+    void uint(uint32_t value) {
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        } while(value > 0);
+        while(n > 0) {
+            put(digits[--n]);
+        }
+    }
+
+    void boolean(bool value) {
+        raw(value ? "true" : "false");
+    }
+
+    // Nul-terminates and returns the length, or 0 if the buffer was too small
+    size_t finish() {
+        if(_overflow || _pos >= _size) {
+            if(_size > 0) {
+                _buf[0] = '\0';
+            }
+            return 0;
+        }
+        _buf[_pos] = '\0';
+        return _pos;
+    }
+
+private:
+    char* _buf;
+    size_t _size;
+    size_t _pos;
+    bool _overflow;
+
+    void put(char c) {
+        if(_pos + 1 < _size) {
+            _buf[_pos++] = c;
+        } else {
+            _overflow = true;
+        }
+    }
+};
+
+#endif // JSON_STREAM_H
@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include "types.h" // For RGB and Alarm structs, and MAX_ALARMS
+#include "command_queue.h"
 
 const char* const PASSWORD_MASK = "******";
 
@@ -26,9 +27,106 @@ String createConfigJson(const FullConfig& config);
  */
 bool parseConfigJson(const String& jsonString, FullConfig& config);
 
+/**
+ * @brief Applies a sparse JSON document to an existing configuration.
+ *
+ * Only keys present in the document are touched; every value is range checked
+ * and nothing is written unless the whole patch is valid. A single alarm is
+ * addressed as {"alarm":{"index":2,"hour":7}}.
+ *
+ * @param jsonString The JSON patch to apply.
+ * @param config The configuration to update in place.
+ * @param changedFields Receives the ConfigField bit mask of touched sections.
+ * @param mask Receives the members the patch set, for mergeFullConfigPatch().
+ * @return True if the patch was valid and applied, false otherwise.
+ */
+bool parseConfigPatchJson(const String& jsonString, FullConfig& config, uint8_t& changedFields,
+                          FullConfigPatchMask& mask);
+
 String createSystemConfigJson(const SystemSettings& systemSettings);
-bool parseSystemConfigJson(const String& jsonString, SystemSettings& systemSettings);
+void writeSystemConfigJson(JsonObject obj, const SystemSettings& systemSettings); // passwords masked
+bool parseSystemConfigJson(const String& jsonString, SystemSettings& systemSettings, uint8_t& fields);
 
 String createWiFiStatusJson(const WiFiStatus& status);
+void writeWiFiStatusJson(JsonObject obj, const WiFiStatus& status);
+
+/**
+ * @brief Creates a JSON object mapping each captive portal probe type to its hit count.
+ */
+String createProbeStatsJson();
+
+/**
+ * @brief Creates a JSON document with web admission counters and heap headroom.
+ */
+String createAdmissionStatsJson();
+
+/**
+ * @brief Creates a JSON document with captive DNS throughput and latency percentiles.
+ */
+String createDnsStatsJson();
+
+/**
+ * @brief Creates the /get_stall_report document: loop stalls of this boot and the
+ * record left by the previous one, if any.
+ */
+String createStallReportJson();
+
+/**
+ * @brief Creates the /get_radio_stats document: scheduler state, sync interval,
+ * radio-on seconds per uptime day and the link power controller's choices.
+ */
+String createRadioStatsJson();
+
+/**
+ * @brief Creates the /get_wifi_networks document from the scan cache, strongest network first.
+ */
+String createWifiScanJson();
+
+/**
+ * @brief Creates the /get_ota_status document: progress of the current or last upload
+ * and whether this boot still runs a new image on probation.
+ */
+String createOtaStatusJson();
+
+/**
+ * @brief Creates the /get_realtime_stats document: DDP packet counters and packet-to-pixel latency.
+ * @param reset Starts the counters over after reading them.
+ */
+String createRealtimeStatsJson(bool reset);
+
+/**
+ * @brief Creates the /get_lamp_group document: node and leader ids, lock state, offset and beacon counters.
+ */
+String createLampGroupJson();
+
+/**
+ * @brief Creates the /time_probe reply {"t1":ms,"t2":ms}, lamp times on the esp_timer scale.
+ */
+String createTimeProbeJson(double t1, double t2);
+
+/**
+ * @brief Reads {"t0","t1","t2","t3"[,"tzOffset"]} from a /set_time body.
+ */
+bool parseTimeSyncJson(const String& jsonString, TimeSyncRequest& request);
+
+/**
+ * @brief Creates the /set_time reply: whether the clock was set and the accuracy of the exchange.
+ */
+String createTimeSyncResultJson(bool applied, double offsetMs, double accuracyMs);
+
+/**
+ * @brief Creates the trace status document: {"enabled":bool,"events":N,"capacity":N}.
+ */
+String createTraceStatusJson();
+
+/**
+ * @brief Reads {"enabled":bool} from a /set_trace body.
+ */
+bool parseTraceControlJson(const String& jsonString, bool& enabled);
+
+/**
+ * @brief Creates the /command document: {"commandId":N,"state":"queued|running|done|unknown"}.
+ */
+String createCommandStatusJson(uint32_t id, CommandState state);
 
 #endif // JSON_UTILS_H
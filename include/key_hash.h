@@ -0,0 +1,25 @@
+#ifndef KEY_HASH_H
+#define KEY_HASH_H
+
+#include <Arduino.h>
+
+// FNV-1a; constexpr so `case keyHash("name"):` labels fold at compile time.
+// Dispatching with a switch doubles as the perfect hash check: two known keys
+// with the same hash would be a duplicate case label and fail to compile.
+constexpr uint32_t keyHash(const char* s, uint32_t h = 2166136261u) {
+    return *s ? keyHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+inline uint32_t keyHashN(const char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    for(size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)s[i]) * 16777619u;
+    }
+    return h;
+}
+
+inline bool isKey(const char* key, size_t len, const char* expected) {
+    return strlen(expected) == len && memcmp(key, expected, len) == 0;
+}
+
+#endif // KEY_HASH_H
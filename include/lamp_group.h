@@ -0,0 +1,58 @@
+#ifndef LAMP_GROUP_H
+#define LAMP_GROUP_H
+
+#include <Arduino.h>
+
+// Lamps on the same network that have the lamp group enabled share one timebase
+// (GroupSync) so their sunrises start and ramp together. A task beacons over UDP
+// multicast while the station link is up. The radio scheduler keeps a window open from
+// LAMP_GROUP_LEAD_MS before an alarm until its sunrise ends, so the lamps are locked
+// when it starts. Alarms read groupTimeMs() instead of the plain clock.
+
+#define LAMP_GROUP_ADDRESS "239.255.76.77" // site-local multicast, never routed
+#define LAMP_GROUP_PORT 4077
+#define LAMP_GROUP_LEAD_MS (2 * 60 * 1000L)
+
+struct LampGroupStats {
+    bool enabled;
+    bool running; // beacon task up, needs the station link
+    uint32_t nodeId;
+    uint32_t leaderId;
+    bool leader;
+    bool locked; // within GROUP_LOCK_MS of the leader
+    uint8_t peers;
+    int32_t offsetMs;    // group time minus own clock
+    int32_t lastErrorMs; // against the leader's last beacon, after the delay filter
+    uint32_t elections;
+    uint32_t steps; // offset jumps instead of slews
+    uint32_t sent;
+    uint32_t received;
+    uint32_t dropped; // not a beacon of this protocol version
+};
+
+/**
+ * @brief Turns group mode on or off; the task follows on the next lampGroupLoop().
+ */
+void setLampGroupEnabled(bool enabled);
+
+/**
+ * @brief Starts the beacon task while enabled and the station is connected, stops it otherwise;
+ * call from wifiLoop().
+ */
+void lampGroupLoop();
+
+/**
+ * @brief True while group mode wants the radio on: a sunrise is running or due within LAMP_GROUP_LEAD_MS.
+ */
+bool lampGroupWantsRadio();
+
+bool isLampGroupRunning();
+
+/**
+ * @brief The own clock plus the group offset, ms since the epoch; safe from any task.
+ */
+int64_t groupTimeMs();
+
+LampGroupStats getLampGroupStats();
+
+#endif // LAMP_GROUP_H
@@ -18,4 +18,15 @@ void setBrightnessLevel(uint8_t level);
  * Temporarily set color and brightness for a given time (ms), then restore
  * previous state.
  */
-void stay(uint8_t r, uint8_t g, uint8_t b, uint8_t level, unsigned long timeMs);
\ No newline at end of file
+void stay(uint8_t r, uint8_t g, uint8_t b, uint8_t level, unsigned long timeMs);
+
+/**
+ * Shows a realtime frame right away, bypassing the effects until ledEndRealtime().
+ * rgb holds pixels * 3 bytes; LEDs beyond it are switched off. The brightness still applies.
+ */
+void ledShowRealtime(const uint8_t* rgb, uint16_t pixels);
+
+/**
+ * Hands the LEDs back to the effects, which redraw on the next ledUpdate().
+ */
+void ledEndRealtime();
@@ -0,0 +1,32 @@
+#ifndef LINK_POWER_H
+#define LINK_POWER_H
+
+#include <Arduino.h>
+
+// Applies TxPowerController to the radio: samples the weaker of the STA link and
+// the AP clients every LINK_POWER_INTERVAL_MS, sets esp_wifi_set_max_tx_power()
+// accordingly and turns modem sleep on while the radio is STA only and no lamp group beacons.
+
+#define LINK_POWER_INTERVAL_MS 2000
+// Rough datasheet figures for the savings estimate
+#define TX_CURRENT_MA_PER_DB 10 // transmit current around the top of the power range
+#define MODEM_SLEEP_SAVED_MA 70 // average of an idle connected STA, awake versus DTIM modem sleep
+
+struct LinkPowerStats {
+    bool linked;       // a STA link or AP client was measured
+    int8_t txPowerDbm; // in effect
+    int8_t rssiDbm;    // smoothed weakest link, valid if linked
+    uint8_t apClients;
+    bool modemSleep;
+    uint16_t txSavedMa;    // less current while transmitting than at full power
+    uint16_t sleepSavedMa; // average saving of modem sleep
+};
+
+/**
+ * @brief Samples link quality and adjusts power and sleep; call from loop().
+ */
+void linkPowerLoop();
+
+LinkPowerStats getLinkPowerStats();
+
+#endif // LINK_POWER_H
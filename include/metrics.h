@@ -0,0 +1,108 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "types.h" // For Route
+
+// Statically allocated counters, gauges and fixed-bucket histograms, exported at
+// /metrics in the Prometheus text format. Metrics are registered here at compile
+// time; a counter increment is a single relaxed atomic add.
+
+// X(id, name, help)
+#define METRIC_COUNTERS(X)                                                                                             \
+    X(METRIC_FLASH_WRITES, "lamp_flash_writes_total", "Config and system settings records written to NVS")             \
+    X(METRIC_STA_RECONNECTS, "lamp_sta_reconnect_attempts_total", "Station reconnect attempts")                        \
+    X(METRIC_NTP_SYNCS, "lamp_ntp_syncs_total", "Completed NTP time synchronizations")                                 \
+    X(METRIC_ALARM_FIRES, "lamp_alarm_fires_total", "Alarms that started their sunrise")                               \
+    X(METRIC_ENCODER_EVENTS, "lamp_encoder_events_total", "Rotary encoder rotations and clicks")                       \
+    X(METRIC_COMMANDS_RUN, "lamp_commands_run_total", "Web commands run by the loop task")                             \
+    X(METRIC_COMMANDS_REJECTED, "lamp_commands_rejected_total", "Web commands rejected because the queue was full")    \
+    X(METRIC_LOOP_STALLS, "lamp_loop_stalls_total", "Loop phases that overran the stall budget")                       \
+    X(METRIC_STA_FAST_FALLBACKS, "lamp_sta_fast_connect_fallbacks_total", "Cached access points that did not answer") \
+    X(METRIC_RADIO_ON_SECONDS, "lamp_radio_on_seconds_total", "Time the Wi-Fi radio was on")                           \
+    X(METRIC_RADIO_SYNC_WINDOWS, "lamp_radio_sync_windows_total", "STA-only windows opened for an NTP sync")           \
+    X(METRIC_STA_CONNECTS, "lamp_sta_connects_total", "Station connections that got an IP")                            \
+    X(METRIC_STA_AUTH_FAILURES, "lamp_sta_auth_failures_total", "Station disconnects for rejected credentials")        \
+    X(METRIC_STA_AP_LOST, "lamp_sta_ap_lost_total", "Station disconnects for an access point that went away")          \
+    X(METRIC_REALTIME_FRAMES, "lamp_realtime_frames_total", "DDP frames shown")                                        \
+    X(METRIC_GROUP_ELECTIONS, "lamp_group_leader_changes_total", "Lamp group leader changes seen by this lamp")
+
+// X(id, name, help)
+#define METRIC_GAUGES(X)                                                                                               \
+    X(METRIC_FREE_HEAP, "lamp_heap_free_bytes", "Free 8-bit capable heap")                                             \
+    X(METRIC_LARGEST_FREE_BLOCK, "lamp_heap_largest_free_block_bytes", "Largest contiguous free heap block")           \
+    X(METRIC_MIN_FREE_HEAP, "lamp_heap_min_free_bytes", "Lowest free heap since boot")                                 \
+    X(METRIC_BRIGHTNESS_LEVEL, "lamp_brightness_level", "Brightness level 0-7 set with the encoder")                   \
+    X(METRIC_LAMP_STATE, "lamp_state", "LampState of the main loop")                                                   \
+    X(METRIC_RADIO_SYNC_INTERVAL, "lamp_radio_sync_interval_seconds", "Current time between NTP sync windows")         \
+    X(METRIC_STA_BACKOFF, "lamp_sta_reconnect_backoff_seconds", "Wait before the next station reconnect attempt")      \
+    X(METRIC_TX_POWER, "lamp_wifi_tx_power_dbm", "Maximum Wi-Fi transmit power set by the link controller")            \
+    X(METRIC_OTA_PROGRESS, "lamp_ota_progress_percent", "Share of the current or last OTA image written")              \
+    X(METRIC_OTA_RATE, "lamp_ota_write_kbytes_per_second", "Flash write throughput of the current or last OTA upload") \
+    X(METRIC_GROUP_ERROR, "lamp_group_phase_error_ms", "Group time error of this lamp against the leader")
+
+// Upper bounds in microseconds, exported in seconds; every histogram has METRIC_HISTOGRAM_BUCKETS
+#define METRIC_HISTOGRAM_BUCKETS 8
+#define METRIC_BUCKETS_FAST {100, 500, 1000, 5000, 10000, 50000, 100000, 500000}
+#define METRIC_BUCKETS_SLOW {100000, 250000, 500000, 1000000, 2000000, 5000000, 10000000, 30000000}
+
+// X(id, name, help, bounds)
+#define METRIC_HISTOGRAMS(X)                                                                                           \
+    X(METRIC_HTTP_HANDLER_TIME, "lamp_http_handler_seconds", "Time spent in route handlers", METRIC_BUCKETS_FAST)      \
+    X(METRIC_LOOP_TIME, "lamp_loop_seconds", "Duration of one loop() pass", METRIC_BUCKETS_FAST)                       \
+    X(METRIC_STA_CONNECT_FAST_TIME, "lamp_sta_connect_fast_seconds", "Station start to IP via the cached AP",          \
+      METRIC_BUCKETS_SLOW)                                                                                             \
+    X(METRIC_STA_CONNECT_FULL_TIME, "lamp_sta_connect_full_seconds", "Station start to IP with scan and DHCP",         \
+      METRIC_BUCKETS_SLOW)
+
+#define METRIC_MAX_ROUTES 32 // routes labelled in lamp_http_requests_total
+
+#define METRIC_ID(id, ...) id,
+enum MetricCounter { METRIC_COUNTERS(METRIC_ID) METRIC_COUNTER_COUNT };
+enum MetricGauge { METRIC_GAUGES(METRIC_ID) METRIC_GAUGE_COUNT };
+enum MetricHistogram { METRIC_HISTOGRAMS(METRIC_ID) METRIC_HISTOGRAM_COUNT };
+#undef METRIC_ID
+
+struct HistogramValues {
+    std::atomic<uint32_t> buckets[METRIC_HISTOGRAM_BUCKETS + 1]; // last one is +Inf
+    std::atomic<uint64_t> sumUs;
+};
+
+extern std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+extern std::atomic<int32_t> metricGauges[METRIC_GAUGE_COUNT];
+extern HistogramValues metricHistograms[METRIC_HISTOGRAM_COUNT];
+extern std::atomic<uint32_t> httpRequestCounts[METRIC_MAX_ROUTES];
+
+inline void countMetric(MetricCounter counter) {
+    metricCounters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void addMetric(MetricCounter counter, uint32_t amount) {
+    metricCounters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+inline void setMetric(MetricGauge gauge, int32_t value) {
+    metricGauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+void observeMetric(MetricHistogram histogram, uint32_t valueUs);
+
+inline void countHttpRequest(size_t route) {
+    if(route < METRIC_MAX_ROUTES) {
+        httpRequestCounts[route].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Sets the route table whose uris label lamp_http_requests_total; route
+ * indexes passed to countHttpRequest refer to it. routes must outlive the exporter.
+ */
+void setMetricRoutes(const Route* routes, size_t count);
+
+/**
+ * @brief Writes every metric in the Prometheus text exposition format 0.0.4.
+ */
+void printMetrics(Print& out);
+
+#endif // METRICS_H
@@ -0,0 +1,64 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <ESPAsyncWebServer.h>
+
+// Over-the-air updates through the lamp's web server. The request body is streamed
+// chunk by chunk into the inactive app partition or the LittleFS partition while a
+// SHA-256 is computed on the side; nothing larger than one chunk is held in RAM.
+//
+// Firmware goes to the partition that is not running, so a mismatching hash or a
+// dropped upload leaves the running image untouched. A new image boots on probation:
+// the bootloader rolls back unless it passes the self check.
+//
+// The filesystem has no such second copy: an image fills the LittleFS partition,
+// which is larger than an app slot, so there is nowhere to stage it. The partition
+// is overwritten as the body arrives and the hash is only known at the end. A
+// mismatch or a dropped upload therefore leaves LittleFS corrupt. The web pages are
+// then missing, and / serves the recovery page built into the firmware to upload
+// the filesystem again.
+//
+//   curl --data-binary @firmware.bin -H "X-Sha256: $(sha256sum firmware.bin | cut -c1-64)" \
+//        http://4.3.2.1/ota/firmware
+
+#define OTA_SELF_CHECK_MS (60 * 1000) // a new image must run this long without a loop stall
+#define OTA_RESTART_DELAY_MS 1000     // lets the response go out before the restart
+
+enum OtaTarget : uint8_t { OTA_TARGET_FIRMWARE, OTA_TARGET_FILESYSTEM };
+enum OtaState : uint8_t { OTA_IDLE, OTA_RECEIVING, OTA_DONE, OTA_FAILED };
+
+struct OtaStatus {
+    OtaState state;
+    OtaTarget target;
+    uint32_t written;
+    uint32_t total;
+    uint32_t rateKBps;  // of the current or last upload
+    const char* error;  // static string, nullptr unless failed
+    bool pendingVerify; // this boot runs a new image that is not confirmed yet
+};
+
+/**
+ * @brief Checks whether this boot runs a new image on probation; call from setup().
+ */
+void initOtaUpdate();
+
+/**
+ * @brief Registers POST /ota/firmware and POST /ota/filesystem.
+ */
+void setUpOtaRoutes(AsyncWebServer& server);
+
+/**
+ * @brief Confirms or rolls back a new image and restarts after an update; call from loop().
+ */
+void otaLoop();
+
+/**
+ * @brief Sends the upload form built into the firmware; for / while the pages on LittleFS are missing.
+ */
+void sendOtaRecoveryPage(AsyncWebServerRequest* request);
+
+OtaStatus getOtaStatus();
+const char* otaStateName(OtaState state);
+const char* otaTargetName(OtaTarget target);
+
+#endif // OTA_UPDATE_H
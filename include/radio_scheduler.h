@@ -0,0 +1,50 @@
+#ifndef RADIO_SCHEDULER_H
+#define RADIO_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Keeps the radio off except for short STA-only windows that sync the clock over
+// NTP, and for user sessions (AP + STA) started with a long click. The time between
+// windows doubles while syncs find the drift compensated clock close to NTP and halves
+// when they find it off, so most lamps end up syncing about once a day.
+// With the lamp group enabled a window also stays open around every sunrise.
+
+#define RADIO_SYNC_WINDOW_MS (30 * 1000) // a window closes after this even without a sync
+#ifndef RADIO_SYNC_INTERVAL_MIN_MS
+#define RADIO_SYNC_INTERVAL_MIN_MS (15 * 60 * 1000UL) // also the retry delay after a failed window
+#endif
+#ifndef RADIO_SYNC_INTERVAL_MAX_MS
+#define RADIO_SYNC_INTERVAL_MAX_MS (24 * 60 * 60 * 1000UL)
+#endif
+#define RADIO_DRIFT_TARGET_MS 250 // correction a sync may apply before the interval shrinks
+#define RADIO_DAY_HISTORY 7       // completed uptime days of radio-on time kept
+
+enum RadioMode : uint8_t { RADIO_OFF, RADIO_SYNC_WINDOW, RADIO_SESSION };
+
+struct RadioStats {
+    RadioMode mode;
+    uint32_t syncIntervalS;
+    uint32_t nextWindowInS; // 0 while the radio is on
+    bool hasCorrection;
+    int32_t lastCorrectionMs; // NTP minus the compensated clock at the last sync
+    uint32_t windows;
+    uint32_t syncedWindows;
+    uint32_t onTodayS; // radio-on time in the current uptime day
+    uint8_t days;      // valid entries in onDayS
+    uint32_t onDayS[RADIO_DAY_HISTORY]; // completed days, most recent first
+};
+
+/**
+ * @brief Schedules the first sync window right away. Call once the WiFi controller is set up.
+ */
+void initRadioScheduler();
+
+/**
+ * @brief Opens and closes sync windows and accounts radio-on time; call from loop().
+ */
+void radioSchedulerLoop();
+
+RadioStats getRadioStats();
+const char* radioModeName(RadioMode mode);
+
+#endif // RADIO_SCHEDULER_H
@@ -0,0 +1,53 @@
+#ifndef REALTIME_UDP_H
+#define REALTIME_UDP_H
+
+#include <Arduino.h>
+
+// Realtime pixel streaming with DDP (Distributed Display Protocol, UDP port 4048) as
+// sent by xLights, LedFx and similar tools. A listener task parses packets into a
+// frame buffer; the loop task shows pushed frames ahead of the effects and hands
+// the LEDs back once packets stop. Nothing of it is stored.
+
+#define DDP_PORT 4048
+#define REALTIME_MAX_PIXELS 64
+#define REALTIME_TIMEOUT_MS 2500 // without packets for this long the lamp returns to its own state
+#define REALTIME_LATENCY_BUCKETS 8
+
+struct RealtimeStats {
+    bool running; // listener task up
+    bool active;  // frames currently override the effects
+    uint32_t packets;
+    uint32_t frames;     // pushed frames shown
+    uint32_t dropped;    // malformed, duplicate or late packets
+    uint32_t lost;       // sequence numbers skipped
+    uint32_t superseded; // frames replaced by a newer one before the loop showed them
+    uint32_t timeouts;
+    uint32_t p50LatencyUs; // packet received to pixels out, upper bucket bound
+    uint32_t p99LatencyUs;
+    uint32_t maxLatencyUs;
+};
+
+/**
+ * @brief Starts the DDP listener task; a no-op while it runs.
+ */
+void startRealtime();
+
+/**
+ * @brief Stops the listener; the task closes its socket and exits. Returns the LEDs.
+ */
+void stopRealtime();
+
+/**
+ * @brief Shows pushed frames and ends realtime mode after REALTIME_TIMEOUT_MS; call
+ * from loop() right before ledUpdate().
+ */
+void realtimeLoop();
+
+bool isRealtimeActive();
+
+/**
+ * @param reset Clears counters and latency histogram after reading, e.g. between benchmark runs.
+ */
+RealtimeStats getRealtimeStats(bool reset);
+
+#endif // REALTIME_UDP_H
@@ -0,0 +1,108 @@
+#ifndef RECONNECT_POLICY_H
+#define RECONNECT_POLICY_H
+
+#include <stdint.h>
+
+// When to try the station connection again after it dropped or failed. Delays grow
+// exponentially per consecutive failure with jitter, capped per kind of failure, and
+// attempts never stop for good. Plain C++ without Arduino or IDF headers: time and
+// randomness come in from the caller, so event sequences can be replayed on a host.
+
+#define RECONNECT_ATTEMPT_TIMEOUT_MS (20 * 1000) // an attempt without any outcome counts as failed
+
+// Backoff per class, override with -D... in build_flags
+#ifndef RECONNECT_TRANSIENT_BASE_MS
+#define RECONNECT_TRANSIENT_BASE_MS 1000
+#endif
+#ifndef RECONNECT_TRANSIENT_CAP_MS
+#define RECONNECT_TRANSIENT_CAP_MS (2 * 60 * 1000UL)
+#endif
+#ifndef RECONNECT_AP_GONE_BASE_MS
+#define RECONNECT_AP_GONE_BASE_MS 5000
+#endif
+#ifndef RECONNECT_AP_GONE_CAP_MS
+#define RECONNECT_AP_GONE_CAP_MS (10 * 60 * 1000UL)
+#endif
+#ifndef RECONNECT_AUTH_BASE_MS
+#define RECONNECT_AUTH_BASE_MS 30000
+#endif
+#ifndef RECONNECT_AUTH_CAP_MS
+#define RECONNECT_AUTH_CAP_MS (60 * 60 * 1000UL)
+#endif
+
+enum DisconnectClass : uint8_t {
+    DISCONNECT_IGNORED = 0, // our own disconnect, not a failure
+    DISCONNECT_TRANSIENT,   // link hiccup, retry soon
+    DISCONNECT_AP_GONE,     // access point not answering, e.g. a rebooting router
+    DISCONNECT_AUTH,        // rejected credentials, retry rarely
+    DISCONNECT_CLASS_COUNT
+};
+
+/**
+ * @brief Maps a wifi_err_reason_t code as found in WiFiEventInfo_t to its class.
+ */
+DisconnectClass classifyDisconnect(uint16_t reason);
+const char* disconnectClassName(DisconnectClass cls);
+
+class ReconnectPolicy {
+public:
+    typedef uint32_t (*RandomFn)(); // uniform 32 bit values, esp_random() on the device
+
+    explicit ReconnectPolicy(RandomFn random);
+
+    // Forgets failures, e.g. when a new connect is started by other means
+    void reset();
+
+    // The station got an IP
+    void onConnected();
+
+    /**
+     * @brief Records a failure and schedules the next attempt.
+     * @return Delay until that attempt in ms, or 0 if the reason is ignored.
+     */
+    uint32_t onDisconnect(uint16_t reason, uint32_t nowMs);
+
+    /**
+     * @brief Call periodically. True once when the scheduled attempt is due; the
+     * caller then reconnects. Times out attempts that never reported back.
+     */
+    bool shouldAttempt(uint32_t nowMs);
+
+    uint32_t failures() const {
+        return _failures;
+    }
+    DisconnectClass lastClass() const {
+        return _lastClass;
+    }
+    uint32_t attempts() const {
+        return _attempts;
+    }
+    uint32_t successes() const {
+        return _successes;
+    }
+    uint32_t disconnects(DisconnectClass cls) const {
+        return _disconnects[cls];
+    }
+    bool isWaiting() const {
+        return _state == STATE_WAITING;
+    }
+    // 0 unless waiting
+    uint32_t nextAttemptInMs(uint32_t nowMs) const;
+
+private:
+    enum State : uint8_t { STATE_IDLE, STATE_WAITING, STATE_ATTEMPTING };
+
+    RandomFn _random;
+    State _state;
+    DisconnectClass _lastClass;
+    uint32_t _failures;
+    uint32_t _since;   // start of the wait or of the attempt
+    uint32_t _delayMs; // length of the current wait
+    uint32_t _attempts;
+    uint32_t _successes;
+    uint32_t _disconnects[DISCONNECT_CLASS_COUNT];
+
+    uint32_t schedule(uint32_t nowMs);
+};
+
+#endif // RECONNECT_POLICY_H
@@ -15,15 +15,33 @@ void handleAppJS(AsyncWebServerRequest* request, const String& body);
 void handleAppCSS(AsyncWebServerRequest* request, const String& body);
 void handleGetConfig(AsyncWebServerRequest* request, const String& body);
 void handleSetConfig(AsyncWebServerRequest* request, const String& body);
+void handlePatchConfig(AsyncWebServerRequest* request, const String& body);
 void handleGetSystemConfig(AsyncWebServerRequest* request, const String& body);
 void handleSetSystemConfig(AsyncWebServerRequest* request, const String& body);
 void handleGetStatus(AsyncWebServerRequest* request, const String& body);
+void handleGetState(AsyncWebServerRequest* request, const String& body);
+void handleGetProbeStats(AsyncWebServerRequest* request, const String& body);
+void handleGetAdmissionStats(AsyncWebServerRequest* request, const String& body);
+void handleGetDnsStats(AsyncWebServerRequest* request, const String& body);
+void handleGetMemoryStats(AsyncWebServerRequest* request, const String& body);
+void handleTimeProbe(AsyncWebServerRequest* request, const String& body);
+void handleSetTime(AsyncWebServerRequest* request, const String& body);
+void handleGetRadioStats(AsyncWebServerRequest* request, const String& body);
+void handleGetWifiNetworks(AsyncWebServerRequest* request, const String& body);
+void handleGetOtaStatus(AsyncWebServerRequest* request, const String& body);
+void handleGetRealtimeStats(AsyncWebServerRequest* request, const String& body);
+void handleGetLampGroup(AsyncWebServerRequest* request, const String& body);
+void handleGetTrace(AsyncWebServerRequest* request, const String& body);
+void handleGetTraceStatus(AsyncWebServerRequest* request, const String& body);
+void handleSetTrace(AsyncWebServerRequest* request, const String& body);
+void handleGetStallReport(AsyncWebServerRequest* request, const String& body);
+void handleGetMetrics(AsyncWebServerRequest* request, const String& body);
+void handleGetCommand(AsyncWebServerRequest* request, const String& body);
+void handleGetLogs(AsyncWebServerRequest* request, const String& body);
 
-// Initialization function to set up global state for handlers and return routes
-std::vector<Route> initRouteHandlers(const FullConfig* config, const SystemSettings* systemSettings,
-                                     const WiFiTestTracker* wifiTracker, GenericStateUpdateCallback stateCallback);
-
-// Let main register a callback which gets invoked when a new config is set via /set_config
-void setOnStateChangedCallback(GenericStateUpdateCallback cb);
+// Initialization function to set up global state for handlers and return routes.
+// FullConfig and SystemSettings are read from the copies published with config_snapshot.h;
+// changes are handed to the loop task through command_queue.h.
+std::vector<Route> initRouteHandlers(const WiFiTestTracker* wifiTracker, const LampState* lampState);
 
 #endif // ROUTE_HANDLERS_H
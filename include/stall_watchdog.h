@@ -0,0 +1,76 @@
+#ifndef STALL_WATCHDOG_H
+#define STALL_WATCHDOG_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Software stall detector for loop(). Each phase of the loop marks its entry in a
+// shared slot; a high priority monitor task flags a phase that runs past
+// STALL_BUDGET_MS and records it in RTC memory. Only a phase still stuck after
+// STALL_RESET_MS is left to the hardware task watchdog, which then resets the chip.
+// The record survives that reset and is reported at boot and at /get_stall_report.
+
+// Override with -D... in build_flags
+#ifndef STALL_BUDGET_MS
+#define STALL_BUDGET_MS 1000
+#endif
+#ifndef STALL_RESET_MS
+#define STALL_RESET_MS 20000
+#endif
+#define STALL_WDT_TIMEOUT_S 5 // task watchdog timeout once the monitor stops feeding it
+
+enum LoopPhase : uint8_t {
+    LOOP_PHASE_IDLE = 0, // between loop() passes
+    LOOP_PHASE_COMMANDS,
+    LOOP_PHASE_SYNC_CONFIG,
+    LOOP_PHASE_LED,
+    LOOP_PHASE_CLOCK,
+    LOOP_PHASE_WIFI,
+    LOOP_PHASE_ROTARY,
+    LOOP_PHASE_ALARMS,
+    LOOP_PHASE_LAMP_STATE,
+    LOOP_PHASE_GOOD_NIGHT,
+    LOOP_PHASE_SAVE,
+    LOOP_PHASE_DIAGNOSTICS,
+    LOOP_PHASE_COUNT
+};
+
+// Phase in the top 8 bits, millis() of its entry in the low 24 bits
+#define LOOP_PHASE_STAMP_MASK 0x00FFFFFFu
+extern std::atomic<uint32_t> loopPhaseSlot;
+
+/**
+ * @brief Marks the start of phase, which also ends the previous one. One atomic store.
+ */
+inline void enterLoopPhase(LoopPhase phase) {
+    loopPhaseSlot.store(((uint32_t)phase << 24) | (millis() & LOOP_PHASE_STAMP_MASK), std::memory_order_relaxed);
+}
+
+const char* loopPhaseName(uint8_t phase);
+
+struct StallReport {
+    // Stall record left by the previous boot, valid if hasPrevious
+    bool hasPrevious;
+    bool previousEscalated; // the monitor stopped feeding the task watchdog
+    uint8_t previousPhase;
+    uint32_t previousDurationMs;
+    uint32_t previousUptimeS; // uptime when that stall began
+    uint32_t previousStalls;  // budget overruns during that boot
+    const char* resetReason;  // why the current boot started
+    // Since this boot
+    uint32_t stalls;
+    uint8_t lastPhase;
+    uint32_t lastDurationMs;
+    uint32_t budgetMs;
+    uint32_t resetAfterMs;
+};
+
+/**
+ * @brief Reports and clears the record of the previous boot, hooks up the task
+ * watchdog and starts the monitor task. Call at the end of setup().
+ */
+void initStallWatchdog();
+
+StallReport getStallReport();
+
+#endif // STALL_WATCHDOG_H
@@ -65,6 +65,20 @@ bool resetSystemSettings();
  */
 bool ensureSystemSettingsExistsAndResetIfNot();
 
+/**
+ * @brief Saves or loads the access point hint used for fast station reconnects.
+ * @return True on success; loadStaCache zeroes cache when nothing is stored.
+ */
+bool saveStaCache(const StaCache& cache);
+bool loadStaCache(StaCache& cache);
+
+/**
+ * @brief Saves or loads the clock drift estimate.
+ * @return True on success; loadClockDrift leaves drift untouched when nothing is stored.
+ */
+bool saveClockDrift(const ClockDrift& drift);
+bool loadClockDrift(ClockDrift& drift);
+
 /**
  * @brief Initializes the FullConfig object in EEPROM if it doesn't exist.
  * @param force If true, forces re-initialization even if config exists.
@@ -0,0 +1,97 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Timeline recorder for chasing jitter. Begin/end, complete and instant events are written
+// as 8 byte records into a ring per core, overwriting the oldest, and served at
+// /trace as Chrome Trace Event JSON (opens in Perfetto or chrome://tracing).
+// Recording is off by default and switched at runtime with /set_trace.
+
+#define TRACE_RING_SIZE 512   // events per core, power of two
+#define TRACE_LOOP_MIN_US 500 // shorter loop passes would flood the ring
+#define TRACE_MAX_DURATION_US 0xFFFF
+
+// Each event id gets its own track in the viewer; names in trace.cpp
+enum TraceId : uint8_t {
+    TRACE_LOOP = 0,     // complete, only passes of at least TRACE_LOOP_MIN_US
+    TRACE_LED_RENDER,   // complete, only calls that pushed a frame
+    TRACE_HTTP_HANDLER, // arg: route index
+    TRACE_DNS_QUERY,
+    TRACE_NVS_WRITE,
+    TRACE_WIFI_EVENT, // instant, arg: arduino_event_id_t
+    TRACE_COMMAND,    // arg: StateChangeType
+    TRACE_ID_COUNT
+};
+
+enum TracePhase : uint8_t {
+    TRACE_BEGIN = 'B',
+    TRACE_END = 'E',
+    TRACE_INSTANT = 'i',
+    TRACE_COMPLETE = 'X' // arg holds the duration in us, capped at TRACE_MAX_DURATION_US
+};
+
+extern std::atomic<bool> traceEnabled;
+
+/**
+ * @brief Appends one event to the ring of the calling core. Safe from tasks and ISRs:
+ * a slot is claimed with one atomic add, no lock is taken.
+ */
+void traceWrite(TraceId id, TracePhase phase, uint16_t arg, uint32_t timestampUs);
+
+// A relaxed load and a not-taken branch while tracing is off
+inline void traceBegin(TraceId id, uint16_t arg = 0) {
+    if(traceEnabled.load(std::memory_order_relaxed)) {
+        traceWrite(id, TRACE_BEGIN, arg, micros());
+    }
+}
+
+inline void traceEnd(TraceId id, uint16_t arg = 0) {
+    if(traceEnabled.load(std::memory_order_relaxed)) {
+        traceWrite(id, TRACE_END, arg, micros());
+    }
+}
+
+inline void traceInstant(TraceId id, uint16_t arg = 0) {
+    if(traceEnabled.load(std::memory_order_relaxed)) {
+        traceWrite(id, TRACE_INSTANT, arg, micros());
+    }
+}
+
+// One record for a span that started at startUs (a micros() value) and ends now
+inline void traceComplete(TraceId id, uint32_t startUs) {
+    if(traceEnabled.load(std::memory_order_relaxed)) {
+        uint32_t duration = micros() - startUs;
+        traceWrite(id, TRACE_COMPLETE, duration < TRACE_MAX_DURATION_US ? duration : TRACE_MAX_DURATION_US, startUs);
+    }
+}
+
+/**
+ * @brief Starts or stops recording. Starting clears the rings.
+ */
+void setTraceEnabled(bool enabled);
+
+/**
+ * @brief Events currently held across all cores.
+ */
+uint32_t getTraceEventCount();
+
+/**
+ * @brief Pauses recording and fixes the events a dump will contain.
+ * @return Length of the Chrome Trace Event JSON document, or 0 if a dump is already running.
+ */
+size_t beginTraceDump();
+
+/**
+ * @brief Fills buf with up to maxLen bytes of the document starting at index.
+ * Every event takes a fixed width, so any range can be produced without keeping state.
+ */
+size_t readTraceDump(uint8_t* buf, size_t maxLen, size_t index);
+
+/**
+ * @brief Ends the dump and resumes recording if it was on.
+ */
+void endTraceDump();
+
+#endif // TRACE_H
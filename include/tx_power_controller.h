@@ -0,0 +1,58 @@
+#ifndef TX_POWER_CONTROLLER_H
+#define TX_POWER_CONTROLLER_H
+
+#include <stdint.h>
+
+// Picks the lowest transmit power that still leaves the peers margin. We only see how
+// strong the peers arrive here; assuming a symmetric path, a peer hears us at that
+// RSSI shifted by the difference between our power and theirs. Steps down are slow
+// and need room to spare several samples in a row, steps up happen at once and as
+// far as needed. Plain C++, fed with RSSI samples, so traces can be replayed on a host.
+
+#define TX_POWER_MIN_DBM 2
+#define TX_POWER_MAX_DBM 20
+#define TX_POWER_STEP_DBM 2
+#define LINK_RSSI_FLOOR_DBM -72 // below this the rates drop quickly
+#define LINK_MARGIN_DB 8        // kept above the floor for fading and bodies in the way
+#define LINK_HYSTERESIS_DB 2    // extra room a step down needs
+#define LINK_PEER_TX_DBM 20     // assumed, most peers send less, so estimates err low
+#define LINK_STEP_DOWN_SAMPLES 5
+
+class TxPowerController {
+public:
+    TxPowerController();
+
+    // Full power and no history, e.g. when there is no link to measure
+    void reset();
+
+    /**
+     * @brief Takes one sample of the weakest link and adjusts the power.
+     * @param sampleDbm How strong that peer arrives here.
+     * @return Transmit power to use in dBm.
+     */
+    int8_t update(int8_t sampleDbm);
+
+    int8_t powerDbm() const {
+        return _powerDbm;
+    }
+    // Smoothed RSSI of the weakest link, meaningless before the first update
+    int8_t rssiDbm() const {
+        return _rssiQ2 / 4;
+    }
+
+private:
+    int8_t _powerDbm;
+    int16_t _rssiQ2; // exponential average in quarter dB
+    bool _hasRssi;
+    uint8_t _roomSamples; // consecutive samples with room for a step down
+
+    int16_t peerHearsDbm(int16_t rssiDbm) const;
+};
+
+// Power save is not supported with the AP up; STA only it saves most of the idle current. Not while
+// the lamp group beacons though: the access point holds multicast for sleepers until its next DTIM.
+inline bool modemSleepAllowed(bool staOnly, bool groupBeacons) {
+    return staOnly && !groupBeacons;
+}
+
+#endif // TX_POWER_CONTROLLER_H
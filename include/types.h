@@ -2,6 +2,7 @@
 #define TYPES_H
 
 #include <Arduino.h>
+#include "config_schema.h" // generated RGB, Alarm, MAX_ALARMS and FullConfig
 
 struct RANGE {
     int min;        // The minimum value for the setting.
@@ -12,38 +13,11 @@ struct RANGE {
                     // stored.
 };
 
-struct RGB {
-    byte r;
-    byte g;
-    byte b;
-};
-
 struct CustomColorState {
     RGB color;
     bool active;
 };
 
-struct Alarm {
-    byte day; // 1-7 (Monday-Sunday), 0 = not set
-    byte hour;
-    byte minute;
-    bool active;
-};
-
-#define MAX_ALARMS 10
-
-// New struct to hold the full configuration
-struct FullConfig {
-    RGB color;
-    byte brightnessMode;
-    byte colorMode;     // 0=Cool White, 1=Neutral White, 2=Warm White, 3=Custom
-    byte animationMode; // 0=Static, 1=Breathing
-    Alarm alarms[MAX_ALARMS];
-    uint16_t goodNightDuration; // in minutes
-    uint16_t alarmDuration;     // in minutes
-    uint16_t animationSpeed;
-};
-
 // Network settings used for internal AP and external STA connections
 constexpr size_t SSID_MAX_LEN = 32;
 constexpr size_t PWD_MAX_LEN = 64;
@@ -55,15 +29,37 @@ struct SystemSettings {
     char externalPW[PWD_MAX_LEN + 1];
 };
 
+// Members of SystemSettings a /set_system_config body replaced
+enum SystemSettingsField : uint8_t {
+    SYSTEM_FIELD_INTERNAL_SSID = 1 << 0,
+    SYSTEM_FIELD_INTERNAL_PW = 1 << 1,
+    SYSTEM_FIELD_EXTERNAL_SSID = 1 << 2,
+    SYSTEM_FIELD_EXTERNAL_PW = 1 << 3
+};
+
+// Payload of STATE_CHANGE_SYSTEM_CONFIG
+struct SystemSettingsPatch {
+    SystemSettings settings; // decoded body; only the members in fields are merged
+    uint8_t fields;          // SystemSettingsField bit mask
+};
+
 // Enum to identify the type of state that has changed
 enum StateChangeType {
     STATE_CHANGE_ALARMS,
     STATE_CHANGE_CUSTOM_COLOR,
     STATE_CHANGE_CONFIG,
-    STATE_CHANGE_SYSTEM_CONFIG
+    STATE_CHANGE_SYSTEM_CONFIG,
+    STATE_CHANGE_CONFIG_PATCH
     // Add other state types here as needed
 };
 
+// Payload of STATE_CHANGE_CONFIG_PATCH
+struct ConfigPatch {
+    FullConfig config;        // snapshot with the patch applied; only the members in mask are merged
+    FullConfigPatchMask mask; // members the body set
+    uint8_t changedFields;    // ConfigField bit mask
+};
+
 enum LampState {
     LAMP_STATE_DEFAULT = 0,
     LAMP_STATE_ALARM = 1,
@@ -82,6 +78,9 @@ enum WiFiTestResult {
     WIFI_TEST_IN_PROGRESS
 };
 
+// Where the system clock was last set from
+enum TimeSource : uint8_t { TIME_SOURCE_NONE = 0, TIME_SOURCE_NTP, TIME_SOURCE_BROWSER };
+
 struct WiFiStatus {
     String currentTime;
     WiFiTestResult lastTestResult;
@@ -91,6 +90,22 @@ struct WiFiStatus {
     unsigned long systemTime;
     bool clockSynced;
     bool staConfigValid;
+    long clockErrorMs;     // bound on the clock error, -1 while it was never set
+    int32_t clockDriftPpb; // compensated crystal drift
+    TimeSource timeSource;
+    uint32_t timeAccuracyMs;
+};
+
+// One round of the browser time exchange, all times in milliseconds. t0 and t3 are the
+// browser's send and receive times (epoch), t1 and t2 the lamp's receive and send times
+// from /time_probe (esp_timer, independent of the wall clock).
+struct TimeSyncRequest {
+    double t0;
+    double t1;
+    double t2;
+    double t3;
+    bool hasTzOffset;
+    int16_t tzOffsetMin; // Date.getTimezoneOffset(): minutes to add to local time for UTC
 };
 
 struct WiFiTestTracker {
@@ -102,6 +117,22 @@ struct WiFiTestTracker {
     // milliseconds
     bool clockSynced = false;
     bool staConfigValid = false;
+    TimeSource timeSource = TIME_SOURCE_NONE;
+    uint32_t timeAccuracyMs = 0; // uncertainty of the last clock set, valid with a time source
+};
+
+// Crystal drift estimated by the clock service, kept in NVS across boots
+struct ClockDrift {
+    float ppm; // positive when the local clock runs slow
+    float uncertaintyPpm;
+};
+
+// Access point the station last joined with DHCP, kept in NVS so a start can skip the channel scan
+struct StaCache {
+    uint32_t ssidHash; // keyHash of externalSSID, the entry is ignored once the SSID changes
+    uint8_t bssid[6];
+    uint8_t channel; // 0: nothing cached
+    uint8_t reserved;
 };
 
 // Forward declarations for web server types
@@ -0,0 +1,37 @@
+#ifndef WEB_ADMISSION_H
+#define WEB_ADMISSION_H
+
+#include <ESPAsyncWebServer.h>
+
+struct AdmissionStats {
+    uint32_t admitted;
+    uint32_t rejectedLowHeap;     // largest free block under the threshold
+    uint32_t rejectedBusy;        // concurrent request budget exhausted
+    uint32_t rejectedRateLimited; // client exceeded its request rate
+    uint16_t inFlight;
+    uint16_t peakInFlight;
+    uint32_t freeHeap;
+    uint32_t largestFreeBlock;
+    uint32_t minLargestFreeBlock; // lowest largest-free-block seen at admission
+    uint32_t minFreeHeap;         // lowest free heap since boot
+    uint32_t lowHeapThreshold;
+    uint16_t maxInFlight;
+};
+
+/**
+ * @brief Adds the admission gate as the first handler of the server.
+ * Requests over budget are answered with 503/429 before any other handler
+ * allocates for them. Call before any other handler is registered.
+ */
+void setUpAdmissionControl(AsyncWebServer& server);
+
+/**
+ * @brief Sets the disconnect callback of an admitted request and keeps the admission
+ * release chained behind it. The request holds a single callback, so handlers must use
+ * this instead of request->onDisconnect(); replacing it leaks an in-flight slot.
+ */
+void onAdmittedDisconnect(AsyncWebServerRequest* request, ArDisconnectHandler handler);
+
+AdmissionStats getAdmissionStats();
+
+#endif // WEB_ADMISSION_H
@@ -5,23 +5,26 @@
 #include <functional>
 #include <vector>
 #include "types.h"
-#include <DNSServer.h>
 
 void wifiLoop();
 void startWifi();
 void stopWifi();
-void handleClientRequests();
-void checkWifiStart();
+// Restarts Wi-Fi from wifiLoop() once a response sent now has had time to go out
+void restartWifiSoon();
+void checkWifiRestart();
 void checkWifiStop();
 bool isWiFiActive();
+bool isRadioOn();
+bool startSyncWindow();
+void stopSyncWindow();
 bool isWifiActiveAndNotUsed();
-void setUpDNSServer(DNSServer& dnsServer, const IPAddress& localIP);
 void setUpWebserver(AsyncWebServer& server, const IPAddress& localIP, const std::vector<Route>& routes);
 void WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
 void initWiFiController(const SystemSettings& settings, const std::vector<Route>& routes, WiFiTestTracker& tracker);
 bool isTimeSyncedWithNTP();
 void updateTelemetryWiFiStatus();
 void tryReconnectSta();
+void checkStaConnect();
 void syncTimeWithNTP();
 
 #endif // WIFI_CONTROLLER_H
@@ -0,0 +1,45 @@
+#ifndef WIFI_SCAN_H
+#define WIFI_SCAN_H
+
+#include <Arduino.h>
+
+// Networks around the lamp for the SSID picker of the settings dialog. Requests from
+// the web task only flag a refresh; the loop task starts a non-blocking scan and
+// copies the results, one entry per SSID with the strongest signal, into a fixed
+// cache. Readers always get the cache, also while a refresh runs.
+
+#define WIFI_SCAN_MAX_RESULTS 16
+#define WIFI_SCAN_FRESH_MS (30 * 1000)   // younger results are served without scanning again
+#define WIFI_SCAN_DWELL_MS 120           // per channel, short to keep the AP's clients served
+#define WIFI_SCAN_TIMEOUT_MS (15 * 1000) // a scan that did not finish by then is dropped
+
+struct WifiNetwork {
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t auth; // wifi_auth_mode_t
+};
+
+struct WifiScanResults {
+    bool valid; // a scan has finished since boot
+    bool scanning;
+    uint32_t ageMs; // since the cached scan finished, valid if valid
+    uint8_t count;
+    WifiNetwork networks[WIFI_SCAN_MAX_RESULTS]; // strongest first
+};
+
+/**
+ * @brief Asks the loop task for a new scan unless the cache is fresh or a scan is running.
+ * Safe from any task.
+ */
+void requestWifiScan();
+
+/**
+ * @brief Starts requested scans and collects finished ones; call from loop().
+ */
+void wifiScanLoop();
+
+WifiScanResults getWifiScanResults();
+const char* wifiAuthName(uint8_t auth);
+
+#endif // WIFI_SCAN_H
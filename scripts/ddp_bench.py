@@ -0,0 +1,95 @@
+"""Measures DDP realtime streaming on a lamp: packet-to-pixel latency and the highest frame rate it keeps up with.
+
+Sends single-packet DDP frames at increasing rates and reads the lamp's own counters back
+from /get_realtime_stats after each step. Join the lamp's access point (or its network)
+and long-click it so the Wi-Fi session is up, then:
+
+    python scripts/ddp_bench.py 4.3.2.1
+    python scripts/ddp_bench.py 192.168.1.40 --rates 50,100,200,400 --seconds 5
+
+Latency is measured on the lamp, from reading the packet off its socket to writing the pixels,
+so Wi-Fi airtime is not included; the sent/shown ratio shows what the link and the lamp drop.
+"""
+
+import argparse
+import json
+import socket
+import struct
+import time
+import urllib.request
+
+DDP_PORT = 4048
+DDP_VERSION_1 = 0x40
+DDP_FLAG_PUSH = 0x01
+DDP_TYPE_RGB8 = 0x0B
+DDP_ID_DISPLAY = 1
+KEEP_UP_RATIO = 0.95  # shown/sent a rate needs to count as sustained
+
+
+def ddp_packet(sequence, rgb):
+    header = struct.pack(">BBBBIH", DDP_VERSION_1 | DDP_FLAG_PUSH, sequence, DDP_TYPE_RGB8, DDP_ID_DISPLAY, 0, len(rgb))
+    return header + rgb
+
+
+def get_stats(host, reset):
+    url = "http://%s/get_realtime_stats%s" % (host, "?reset=1" if reset else "")
+    with urllib.request.urlopen(url, timeout=5) as response:
+        return json.load(response)
+
+
+def run_step(sock, host, rate, seconds, pixels):
+    get_stats(host, reset=True)
+    interval = 1.0 / rate
+    count = int(rate * seconds)
+    start = time.perf_counter()
+    for i in range(count):
+        level = (i * 7) & 0xFF
+        sock.sendto(ddp_packet(i % 15 + 1, bytes([level, 255 - level, 64]) * pixels), (host, DDP_PORT))
+        # Busy-wait the last stretch, sleep() alone is too coarse above a few hundred Hz
+        deadline = start + (i + 1) * interval
+        while True:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                break
+            if remaining > 0.002:
+                time.sleep(remaining - 0.001)
+    elapsed = time.perf_counter() - start
+    time.sleep(0.3)  # let the last frames through before reading the counters
+    stats = get_stats(host, reset=False)
+    return count, elapsed, stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="lamp address, 4.3.2.1 on its own access point")
+    parser.add_argument("--rates", default="25,50,100,200,400,800", help="frames per second to try")
+    parser.add_argument("--seconds", type=float, default=3.0, help="length of each step")
+    parser.add_argument("--pixels", type=int, default=1, help="pixels per frame")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sustained = 0
+    columns = ("rate", "sent", "shown", "dropped", "replaced", "p50 us", "p99 us", "max us")
+    print("%8s %8s %8s %8s %8s %10s %10s %10s" % columns)
+    for rate in [int(r) for r in args.rates.split(",")]:
+        sent, elapsed, stats = run_step(sock, args.host, rate, args.seconds, args.pixels)
+        print(
+            "%8d %8d %8d %8d %8d %10d %10d %10d"
+            % (
+                round(sent / elapsed),
+                sent,
+                stats["frames"],
+                stats["dropped"],
+                stats["superseded"],
+                stats["p50LatencyUs"],
+                stats["p99LatencyUs"],
+                stats["maxLatencyUs"],
+            )
+        )
+        if stats["frames"] >= sent * KEEP_UP_RATIO:
+            sustained = rate
+    print("Highest sustained rate: %d frames/s" % sustained)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,968 @@
+"""Generates the FullConfig struct, its codecs and the UI defaults from config_schema.json.
+
+Runs before every PlatformIO build (extra_scripts = pre:...) and can be run by hand:
+
+    python scripts/generate_config.py
+
+Outputs are committed so the UI can be built without PlatformIO. Files are only
+rewritten when their content changes, so unchanged builds stay incremental.
+"""
+
+import json
+import os
+
+try:
+    Import("env")  # noqa: F821 - injected by PlatformIO/SCons
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SCHEMA_PATH = os.path.join(PROJECT_DIR, "config_schema.json")
+HEADER_PATH = os.path.join(PROJECT_DIR, "include", "config_schema.h")
+SOURCE_PATH = os.path.join(PROJECT_DIR, "src", "config_schema.cpp")
+JS_PATH = os.path.join(PROJECT_DIR, "svelte-ui", "src", "lib", "configDefaults.js")
+
+BANNER = "Generated by scripts/generate_config.py from config_schema.json. Do not edit."
+
+# C type, storage width in bytes, largest representable value
+SCALARS = {
+    "u8": ("uint8_t", 1, 0xFF),
+    "u16": ("uint16_t", 2, 0xFFFF),
+    "u32": ("uint32_t", 4, 0xFFFFFFFF),
+    "bool": ("bool", 1, 1),
+}
+
+STORAGE_MAGIC = 0xC5
+
+# A patch naming something it cannot change is an error, not a silent no-op
+PATCH_UNKNOWN_KEY = "return false;"
+
+
+class SchemaError(Exception):
+    pass
+
+
+def is_scalar(field):
+    return field["type"] in SCALARS
+
+
+def json_key(field):
+    """JSON member name; null in the schema keeps the field out of the JSON documents."""
+    return field.get("json", field["name"])
+
+
+def range_conditions(field, expr):
+    """Range checks that are not implied by the C type, to avoid always-true comparisons."""
+    if field["type"] == "bool":
+        return []
+    conditions = []
+    if field["min"] > 0:
+        conditions.append("%s >= %d" % (expr, field["min"]))
+    if field["max"] < SCALARS[field["type"]][2]:
+        conditions.append("%s <= %d" % (expr, field["max"]))
+    return conditions
+
+
+def default_literal(field):
+    if field["type"] == "bool":
+        return "true" if field["default"] else "false"
+    return str(field["default"])
+
+
+def load_schema():
+    with open(SCHEMA_PATH) as f:
+        schema = json.load(f)
+
+    constants = schema.get("constants", {})
+    types = schema["types"]
+    groups = list(schema.get("groups", {}).items())
+    if len(groups) > 8:
+        raise SchemaError("at most 8 groups fit the uint8_t change mask")
+    group_names = [name for name, _ in groups]
+
+    for type_name, type_def in types.items():
+        for member in type_def["fields"]:
+            if not is_scalar(member):
+                raise SchemaError("%s.%s: nested types may only contain scalars" % (type_name, member["name"]))
+            check_scalar("%s.%s" % (type_name, member["name"]), member)
+
+    ids = set()
+    for field in schema["config"]["fields"]:
+        label = field["name"]
+        if field["id"] in ids or not 0 < field["id"] < 256:
+            raise SchemaError("%s: storage ids must be unique and within 1-255" % label)
+        ids.add(field["id"])
+        if field.get("group") is not None and field["group"] not in group_names:
+            raise SchemaError("%s: unknown group %s" % (label, field["group"]))
+        if "count" in field:
+            if field["type"] not in types:
+                raise SchemaError("%s: arrays must hold a schema type" % label)
+            count = field["count"]
+            field["countValue"] = constants[count] if isinstance(count, str) else count
+            if 2 + field["countValue"] * storage_size(types[field["type"]]) > 255:
+                raise SchemaError("%s: array does not fit a storage record" % label)
+        elif is_scalar(field):
+            check_scalar(label, field)
+        elif field["type"] not in types:
+            raise SchemaError("%s: unknown type %s" % (label, field["type"]))
+    return schema
+
+
+def check_scalar(label, field):
+    if field["type"] not in SCALARS:
+        raise SchemaError("%s: unknown scalar type %s" % (label, field["type"]))
+    if field["type"] != "bool":
+        if not 0 <= field["min"] <= field["default"] <= field["max"] <= SCALARS[field["type"]][2]:
+            raise SchemaError("%s: expected 0 <= min <= default <= max within the type" % label)
+
+
+def storage_size(type_def):
+    return sum(SCALARS[m["type"]][1] for m in type_def["fields"])
+
+
+def json_worst_case(schema):
+    """Length of the longest document encodeFullConfigJson can produce, without terminator."""
+
+    def scalar_len(field):
+        return 5 if field["type"] == "bool" else len(str(SCALARS[field["type"]][2]))
+
+    def object_len(members):
+        # {"key":value,...}
+        return 2 + sum(len(json_key(m)) + 3 + scalar_len(m) for m in members) + max(len(members) - 1, 0)
+
+    types = schema["types"]
+    total = 2
+    fields = [f for f in schema["config"]["fields"] if json_key(f) is not None]
+    for field in fields:
+        total += len(json_key(field)) + 3
+        if "count" in field:
+            n = field["countValue"]
+            total += 2 + n * object_len(types[field["type"]]["fields"]) + max(n - 1, 0)
+        elif is_scalar(field):
+            total += scalar_len(field)
+        else:
+            total += object_len(types[field["type"]]["fields"])
+    return total + max(len(fields) - 1, 0)
+
+
+def cbor_head_len(value):
+    return 1 if value < 24 else 2 if value <= 0xFF else 3 if value <= 0xFFFF else 5
+
+
+def cbor_worst_case(schema):
+    """Length of the longest document encodeFullConfigCbor can produce."""
+
+    def scalar_len(field):
+        return 1 if field["type"] == "bool" else cbor_head_len(SCALARS[field["type"]][2])
+
+    def text_len(text):
+        return cbor_head_len(len(text)) + len(text)
+
+    def map_len(members):
+        return cbor_head_len(len(members)) + sum(text_len(m["name"]) + scalar_len(m) for m in members)
+
+    types = schema["types"]
+    fields = [f for f in schema["config"]["fields"] if json_key(f) is not None]
+    total = cbor_head_len(len(fields))
+    for field in fields:
+        total += text_len(json_key(field))
+        if "count" in field:
+            n = field["countValue"]
+            total += cbor_head_len(n) + n * map_len(types[field["type"]]["fields"])
+        elif is_scalar(field):
+            total += scalar_len(field)
+        else:
+            total += map_len(types[field["type"]]["fields"])
+    return total
+
+
+def storage_worst_case(schema):
+    types = schema["types"]
+    total = 2  # magic, version
+    for field in schema["config"]["fields"]:
+        total += 2
+        if "count" in field:
+            total += 2 + field["countValue"] * storage_size(types[field["type"]])
+        elif is_scalar(field):
+            total += SCALARS[field["type"]][1]
+        else:
+            total += storage_size(types[field["type"]])
+    return total
+
+
+def patch_types(schema):
+    return {f["type"] for f in schema["config"]["fields"] if "count" in f and "patch" in f}
+
+
+def patch_mask_fields(schema):
+    """Fields a patch can set: every field with a JSON key, arrays only through their patch key."""
+    return [f for f in schema["config"]["fields"]
+            if ("patch" in f if "count" in f else json_key(f) is not None)]
+
+
+class Code:
+    def __init__(self):
+        self.lines = []
+        self.level = 0
+
+    def line(self, text=""):
+        self.lines.append(("    " * self.level + text) if text else "")
+
+    def open(self, text):
+        self.line(text)
+        self.level += 1
+
+    def close(self, text="}"):
+        self.level -= 1
+        self.line(text)
+
+    def text(self):
+        return "\n".join(self.lines) + "\n"
+
+
+def generate_header(schema):
+    c = Code()
+    config = schema["config"]
+    types = schema["types"]
+    groups = list(schema.get("groups", {}).items())
+
+    c.line("// " + BANNER)
+    c.line("#ifndef CONFIG_SCHEMA_H")
+    c.line("#define CONFIG_SCHEMA_H")
+    c.line()
+    c.line("#include <Arduino.h>")
+    c.line()
+    c.line("#define CONFIG_SCHEMA_VERSION %d" % schema["version"])
+    for name, value in schema.get("constants", {}).items():
+        c.line("#define %s %d" % (name, value))
+    c.line()
+
+    for type_name, type_def in types.items():
+        c.open("struct %s {" % type_name)
+        for member in type_def["fields"]:
+            comment = " // " + member["comment"] if "comment" in member else ""
+            c.line("%s %s;%s" % (SCALARS[member["type"]][0], member["name"], comment))
+        c.close("};")
+        c.line()
+
+    c.line("// Packed so the layout is exactly the field list on every toolchain. Scalar")
+    c.line("// members are read and written by value; references to them may be misaligned.")
+    c.open("struct %s {" % config["name"])
+    for field in config["fields"]:
+        comment = " // " + field["comment"] if "comment" in field else ""
+        if "count" in field:
+            c.line("%s %s[%s];%s" % (field["type"], field["name"], field["count"], comment))
+        elif is_scalar(field):
+            c.line("%s %s;%s" % (SCALARS[field["type"]][0], field["name"], comment))
+        else:
+            c.line("%s %s;%s" % (field["type"], field["name"], comment))
+    c.close("} __attribute__((packed));")
+    c.line()
+
+    c.line("// Bit flags describing which parts of %s a partial update touched" % config["name"])
+    c.open("enum ConfigField : uint8_t {")
+    for bit, (group, enum_name) in enumerate(groups):
+        members = [f["name"] for f in config["fields"] if f.get("group") == group]
+        comma = "," if bit < len(groups) - 1 else ""
+        c.line("%s = 1 << %d%s // %s" % (enum_name, bit, comma, ", ".join(members)))
+    c.close("};")
+    c.line()
+
+    c.line("// Members a patch set, so it can be merged onto a newer config than the one it was decoded")
+    c.line("// against. Nested values and array elements have bit i set for their member i.")
+    c.open("struct %sPatchMask {" % config["name"])
+    for field in patch_mask_fields(schema):
+        if "count" in field:
+            c.line("uint32_t %s[%s];" % (field["name"], field["count"]))
+        elif is_scalar(field):
+            c.line("bool %s;" % field["name"])
+        else:
+            c.line("uint32_t %s;" % field["name"])
+    c.close("};")
+    c.line()
+
+    c.line("// Worst-case encoded sizes; the JSON size includes the terminator")
+    c.line("#define FULL_CONFIG_JSON_MAX %d" % (json_worst_case(schema) + 1))
+    c.line("#define FULL_CONFIG_CBOR_MAX %d" % cbor_worst_case(schema))
+    c.line("#define FULL_CONFIG_STORAGE_MAX %d" % storage_worst_case(schema))
+    c.line()
+
+    name = config["name"]
+    c.line("/**")
+    c.line(" * @brief Returns a %s with every field at its schema default." % name)
+    c.line(" */")
+    c.line("%s defaultFullConfig();" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Checks every field against the ranges declared in the schema.")
+    c.line(" */")
+    c.line("bool isValidFullConfig(const %s& config);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Writes the /get_config document into buf.")
+    c.line(" * @return The length written, or 0 if buf is smaller than FULL_CONFIG_JSON_MAX requires.")
+    c.line(" */")
+    c.line("size_t encodeFullConfigJson(const %s& config, char* buf, size_t size);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Decodes a /set_config body in a single pass without building a DOM.")
+    c.line(" * Absent fields take their defaults, absent arrays keep their current elements.")
+    c.line(" * @return False, leaving config untouched, on malformed JSON, a mistyped or out of range value.")
+    c.line(" */")
+    c.line("bool decodeFullConfigJson(const char* json, size_t len, %s& config);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Applies a sparse /patch_config body; only keys present are touched.")
+    patch_fields = [f for f in config["fields"] if "patch" in f]
+    if patch_fields:
+        c.line(" * A single %s element is addressed as {\"%s\":{\"index\":2,...}}."
+               % (patch_fields[0]["name"], patch_fields[0]["patch"]))
+    c.line(" * @param changedFields Receives the ConfigField bit mask of touched groups.")
+    c.line(" * @param mask Receives the members the body set.")
+    c.line(" * @return False, leaving config untouched, if any value is invalid or a key cannot be patched.")
+    c.line(" */")
+    c.line("bool decodeFullConfigPatchJson(const char* json, size_t len, %s& config, uint8_t& changedFields,"
+           % name)
+    c.line("                               %sPatchMask& mask);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Copies the members set in mask from src into dst.")
+    c.line(" */")
+    c.line("void mergeFullConfigPatch(%s& dst, const %s& src, const %sPatchMask& mask);" % (name, name, name))
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Writes the /get_config document as CBOR, with the same keys as the JSON one.")
+    c.line(" * @return The length written, or 0 if buf is too small; FULL_CONFIG_CBOR_MAX always suffices.")
+    c.line(" */")
+    c.line("size_t encodeFullConfigCbor(const %s& config, uint8_t* buf, size_t size);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Decodes an application/cbor /set_config body with the rules of decodeFullConfigJson.")
+    c.line(" */")
+    c.line("bool decodeFullConfigCbor(const uint8_t* data, size_t len, %s& config);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Serializes config for flash as versioned id/length/value records.")
+    c.line(" * @return The length written, or 0 if size < FULL_CONFIG_STORAGE_MAX.")
+    c.line(" */")
+    c.line("size_t encodeFullConfigStorage(const %s& config, uint8_t* buf, size_t size);" % name)
+    c.line()
+    c.line("/**")
+    c.line(" * @brief Reads records written by any schema version. Unknown ids are skipped,")
+    c.line(" * missing or out of range values take their defaults.")
+    c.line(" * @return False if the data is not a config record set.")
+    c.line(" */")
+    c.line("bool decodeFullConfigStorage(const uint8_t* data, size_t len, %s& config);" % name)
+    c.line()
+    c.line("#endif // CONFIG_SCHEMA_H")
+    return c.text()
+
+
+def emit_case_head(c, key, key_len_var, miss):
+    """Opens the case of key; miss is the statement for another key with the same hash."""
+    c.open('case keyHash("%s"): {' % key)
+    c.open('if(!isKey(key, %s, "%s")) {' % (key_len_var, key))
+    c.line(miss)
+    c.close()
+
+
+def emit_read_scalar(c, field, target):
+    ctype = SCALARS[field["type"]][0]
+    if field["type"] == "bool":
+        c.open("if(!cur.readBool(b)) {")
+        c.line("return false;")
+        c.close()
+        c.line("%s = b;" % target)
+    else:
+        c.open("if(!cur.readRanged(%d, %d, v)) {" % (field["min"], field["max"]))
+        c.line("return false;")
+        c.close()
+        c.line("%s = (%s)v;" % (target, ctype))
+    c.line("return true;")
+
+
+def emit_locals(c, fields):
+    """Declares the scratch values the scalar reads in a switch need."""
+    if any(is_scalar(f) and "count" not in f and f["type"] != "bool" for f in fields):
+        c.line("long v;")
+    if any(is_scalar(f) and "count" not in f and f["type"] == "bool" for f in fields):
+        c.line("bool b;")
+
+
+def generate_source(schema):
+    c = Code()
+    config = schema["config"]
+    name = config["name"]
+    types = schema["types"]
+    groups = schema.get("groups", {})
+    patched = patch_types(schema)
+    merged = {f["type"] for f in patch_mask_fields(schema) if not is_scalar(f)}
+    arrays = {f["type"] for f in config["fields"] if "count" in f}
+
+    c.line("// " + BANNER)
+    c.line('#include "config_schema.h"')
+    c.line('#include "json_stream.h"')
+    c.line('#include "cbor_stream.h"')
+    c.line()
+    c.line("#define CONFIG_STORAGE_MAGIC 0x%02X" % STORAGE_MAGIC)
+    c.line()
+
+    # Storage scalars
+    c.open("static void putScalar(uint8_t*& p, uint32_t value, size_t width) {")
+    c.open("for(size_t i = 0; i < width; i++) {")
+    c.line("*p++ = (uint8_t)(value >> (8 * i));")
+    c.close()
+    c.close()
+    c.line()
+    c.line("// Little-endian; any stored width up to 4 bytes reads back, so scalars may be widened")
+    c.open("static uint32_t getScalar(const uint8_t* p, size_t width) {")
+    c.line("uint32_t value = 0;")
+    c.open("for(size_t i = 0; i < width && i < 4; i++) {")
+    c.line("value |= (uint32_t)p[i] << (8 * i);")
+    c.close()
+    c.line("return value;")
+    c.close()
+    c.line()
+
+    for type_name, type_def in types.items():
+        members = type_def["fields"]
+
+        c.open("static void default%s(%s& value) {" % (type_name, type_name))
+        for m in members:
+            c.line("value.%s = %s;" % (m["name"], default_literal(m)))
+        c.close()
+        c.line()
+
+        c.open("static bool valid%s(const %s& value) {" % (type_name, type_name))
+        conditions = []
+        for m in members:
+            conditions += range_conditions(m, "value." + m["name"])
+        if conditions:
+            c.line("return " + " && ".join(conditions) + ";")
+        else:
+            c.line("(void)value;")
+            c.line("return true;")
+        c.close()
+        c.line()
+
+        c.open("static void write%s(JsonWriter& out, const %s& value) {" % (type_name, type_name))
+        for i, m in enumerate(members):
+            c.line('out.raw("%s\\"%s\\":");' % ("{" if i == 0 else ",", m["name"]))
+            if m["type"] == "bool":
+                c.line("out.boolean(value.%s);" % m["name"])
+            else:
+                c.line("out.uint(value.%s);" % m["name"])
+        c.line('out.raw("}");')
+        c.close()
+        c.line()
+
+        c.open("static void write%sCbor(CborWriter& out, const %s& value) {" % (type_name, type_name))
+        c.line("out.map(%d);" % len(members))
+        for m in members:
+            c.line('out.text("%s");' % m["name"])
+            c.line("out.%s(value.%s);" % ("boolean" if m["type"] == "bool" else "uint", m["name"]))
+        c.close()
+        c.line()
+
+        index = type_name in patched
+        c.line("// Reads the members present in the object at the cursor and marks them in seen.")
+        c.line("// Cursor is a JsonCursor or a CborReader.")
+        c.line("template<typename Cursor>")
+        if index:
+            c.open("static bool read%s(Cursor& cur, %s& value, uint32_t& seen, long& index, int depth) {"
+                   % (type_name, type_name))
+        else:
+            c.open("static bool read%s(Cursor& cur, %s& value, uint32_t& seen, int depth) {"
+                   % (type_name, type_name))
+        c.open("return forEachMember(cur, [&](const char* key, size_t len) -> bool {")
+        emit_locals(c, members)
+        c.line("switch(keyHashN(key, len)) {")
+        for bit, m in enumerate(members):
+            emit_case_head(c, m["name"], "len", "return cur.skipValue(depth + 1);")
+            c.line("seen |= 1u << %d;" % bit)
+            emit_read_scalar(c, m, "value." + m["name"])
+            c.close()
+        if index:
+            emit_case_head(c, "index", "len", "return cur.skipValue(depth + 1);")
+            c.line("return cur.readInt(index);")
+            c.close()
+        c.line("default:")
+        c.line("    return cur.skipValue(depth + 1);")
+        c.line("}")
+        c.close("});")
+        c.close()
+        c.line()
+
+        if type_name in merged:
+            c.open("static void merge%s(%s& target, const %s& value, uint32_t seen) {"
+                   % (type_name, type_name, type_name))
+            for bit, m in enumerate(members):
+                c.open("if(seen & (1u << %d)) {" % bit)
+                c.line("target.%s = value.%s;" % (m["name"], m["name"]))
+                c.close()
+            c.close()
+            c.line()
+
+        if type_name in arrays:
+            c.line("// Elements beyond count are skipped, missing trailing elements keep their current value")
+            c.line("template<typename Cursor>")
+            c.open("static bool read%sArray(Cursor& cur, %s* items, size_t count, int depth) {"
+                   % (type_name, type_name))
+            c.line("size_t i = 0;")
+            c.open("return forEachElement(cur, [&]() -> bool {")
+            c.open("if(i >= count) {")
+            c.line("return cur.skipValue(depth + 1);")
+            c.close()
+            c.line("%s value;" % type_name)
+            c.line("default%s(value);" % type_name)
+            c.line("uint32_t seen = 0;")
+            if index:
+                c.line("long index = -1;")
+                c.open("if(!read%s(cur, value, seen, index, depth + 1)) {" % type_name)
+            else:
+                c.open("if(!read%s(cur, value, seen, depth + 1)) {" % type_name)
+            c.line("return false;")
+            c.close()
+            c.line("items[i++] = value;")
+            c.line("return true;")
+            c.close("});")
+            c.close()
+            c.line()
+
+        c.open("static void put%s(uint8_t*& p, const %s& value) {" % (type_name, type_name))
+        for m in members:
+            c.line("putScalar(p, value.%s, %d);" % (m["name"], SCALARS[m["type"]][1]))
+        c.close()
+        c.line()
+
+        c.line("// Members are stored in declaration order; those beyond a shorter record keep their defaults")
+        c.open("static void get%s(const uint8_t* p, size_t len, %s& value) {" % (type_name, type_name))
+        c.line("default%s(value);" % type_name)
+        c.line("uint32_t v;")
+        offset = 0
+        for m in members:
+            width = SCALARS[m["type"]][1]
+            c.open("if(len >= %d) {" % (offset + width))
+            c.line("v = getScalar(p + %d, %d);" % (offset, width))
+            if m["type"] == "bool":
+                c.line("value.%s = v != 0;" % m["name"])
+            else:
+                conditions = range_conditions(m, "v")
+                if conditions:
+                    c.open("if(%s) {" % " && ".join(conditions))
+                    c.line("value.%s = (%s)v;" % (m["name"], SCALARS[m["type"]][0]))
+                    c.close()
+                else:
+                    c.line("value.%s = (%s)v;" % (m["name"], SCALARS[m["type"]][0]))
+            c.close()
+            offset += width
+        c.close()
+        c.line()
+
+        if type_name in arrays:
+            c.line("// Array records carry their element count and stride ahead of the elements")
+            c.open("static void get%sArray(const uint8_t* p, size_t len, %s* items, size_t count) {"
+                   % (type_name, type_name))
+            c.open("if(len < 2) {")
+            c.line("return;")
+            c.close()
+            c.line("size_t stored = p[0];")
+            c.line("size_t stride = p[1];")
+            c.open("for(size_t i = 0; i < stored && i < count && 2 + (i + 1) * stride <= len; i++) {")
+            c.line("get%s(p + 2 + i * stride, stride, items[i]);" % type_name)
+            c.close()
+            c.close()
+            c.line()
+
+    # defaults
+    c.open("%s defaultFullConfig() {" % name)
+    c.line("%s config;" % name)
+    for f in config["fields"]:
+        if "count" in f:
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.line("default%s(config.%s[i]);" % (f["type"], f["name"]))
+            c.close()
+        elif is_scalar(f):
+            c.line("config.%s = %s;" % (f["name"], default_literal(f)))
+        else:
+            c.line("default%s(config.%s);" % (f["type"], f["name"]))
+    c.line("return config;")
+    c.close()
+    c.line()
+
+    # validation
+    c.open("bool isValidFullConfig(const %s& config) {" % name)
+    for f in config["fields"]:
+        if "count" in f:
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.open("if(!valid%s(config.%s[i])) {" % (f["type"], f["name"]))
+            c.line("return false;")
+            c.close()
+            c.close()
+        elif is_scalar(f):
+            conditions = range_conditions(f, "config." + f["name"])
+            if conditions:
+                c.open("if(!(%s)) {" % " && ".join(conditions))
+                c.line("return false;")
+                c.close()
+        else:
+            c.open("if(!valid%s(config.%s)) {" % (f["type"], f["name"]))
+            c.line("return false;")
+            c.close()
+    c.line("return true;")
+    c.close()
+    c.line()
+
+    json_fields = [f for f in config["fields"] if json_key(f) is not None]
+
+    # JSON encode
+    c.open("size_t encodeFullConfigJson(const %s& config, char* buf, size_t size) {" % name)
+    c.line("JsonWriter out(buf, size);")
+    for i, f in enumerate(json_fields):
+        c.line('out.raw("%s\\"%s\\":");' % ("{" if i == 0 else ",", json_key(f)))
+        if "count" in f:
+            c.line('out.raw("[");')
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.open("if(i > 0) {")
+            c.line('out.raw(",");')
+            c.close()
+            c.line("write%s(out, config.%s[i]);" % (f["type"], f["name"]))
+            c.close()
+            c.line('out.raw("]");')
+        elif f["type"] == "bool":
+            c.line("out.boolean(config.%s);" % f["name"])
+        elif is_scalar(f):
+            c.line("out.uint(config.%s);" % f["name"])
+        else:
+            c.line("write%s(out, config.%s);" % (f["type"], f["name"]))
+    c.line('out.raw("}");')
+    c.line("return out.finish();")
+    c.close()
+    c.line()
+
+    # CBOR encode, same members and keys as the JSON document
+    c.open("size_t encodeFullConfigCbor(const %s& config, uint8_t* buf, size_t size) {" % name)
+    c.line("CborWriter out(buf, size);")
+    c.line("out.map(%d);" % len(json_fields))
+    for f in json_fields:
+        c.line('out.text("%s");' % json_key(f))
+        if "count" in f:
+            c.line("out.array(%s);" % f["count"])
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.line("write%sCbor(out, config.%s[i]);" % (f["type"], f["name"]))
+            c.close()
+        elif f["type"] == "bool":
+            c.line("out.boolean(config.%s);" % f["name"])
+        elif is_scalar(f):
+            c.line("out.uint(config.%s);" % f["name"])
+        else:
+            c.line("write%sCbor(out, config.%s);" % (f["type"], f["name"]))
+    c.line("return out.finish();")
+    c.close()
+    c.line()
+
+    # Full decode, shared by the JSON and CBOR entry points
+    c.line("template<typename Cursor>")
+    c.open("static bool decodeFullConfig(Cursor& cur, %s& config) {" % name)
+    c.line("%s decoded = config;" % name)
+    c.line("// Absent fields take their defaults, absent arrays keep their current elements")
+    for f in json_fields:
+        if "count" in f:
+            continue
+        if is_scalar(f):
+            c.line("decoded.%s = %s;" % (f["name"], default_literal(f)))
+        else:
+            c.line("default%s(decoded.%s);" % (f["type"], f["name"]))
+    c.line()
+    c.open("bool ok = forEachMember(cur, [&](const char* key, size_t keyLen) -> bool {")
+    emit_locals(c, json_fields)
+    c.line("switch(keyHashN(key, keyLen)) {")
+    for f in json_fields:
+        emit_case_head(c, json_key(f), "keyLen", "return cur.skipValue(1);")
+        if "count" in f:
+            c.line("return read%sArray(cur, decoded.%s, %s, 1);" % (f["type"], f["name"], f["count"]))
+        elif is_scalar(f):
+            emit_read_scalar(c, f, "decoded." + f["name"])
+        else:
+            c.line("uint32_t seen = 0;")
+            if f["type"] in patched:
+                c.line("long index = -1;")
+                c.line("return read%s(cur, decoded.%s, seen, index, 1);" % (f["type"], f["name"]))
+            else:
+                c.line("return read%s(cur, decoded.%s, seen, 1);" % (f["type"], f["name"]))
+        c.close()
+    c.line("default:")
+    c.line("    return cur.skipValue(1);")
+    c.line("}")
+    c.close("});")
+    c.open("if(!ok || !cur.atEnd()) {")
+    c.line("return false;")
+    c.close()
+    c.line("config = decoded;")
+    c.line("return true;")
+    c.close()
+    c.line()
+
+    c.open("bool decodeFullConfigJson(const char* json, size_t len, %s& config) {" % name)
+    c.line("JsonCursor cur(json, len);")
+    c.line("return decodeFullConfig(cur, config);")
+    c.close()
+    c.line()
+
+    c.open("bool decodeFullConfigCbor(const uint8_t* data, size_t len, %s& config) {" % name)
+    c.line("CborReader cur(data, len);")
+    c.line("return decodeFullConfig(cur, config);")
+    c.close()
+    c.line()
+
+    # JSON patch decode
+    c.line("bool decodeFullConfigPatchJson(const char* json, size_t len, %s& config, uint8_t& changedFields,"
+           % name)
+    c.open("                               %sPatchMask& mask) {" % name)
+    c.line("// Work on a copy so an invalid value leaves the live config untouched")
+    c.line("%s patched = config;" % name)
+    c.line("uint8_t changed = 0;")
+    c.line("%sPatchMask set = {};" % name)
+    c.line()
+    c.line("JsonCursor cur(json, len);")
+    c.open("bool ok = forEachMember(cur, [&](const char* key, size_t keyLen) -> bool {")
+    emit_locals(c, json_fields)
+    c.line("// Unknown keys, and ones a patch cannot change such as the whole alarms array, fail the body")
+    c.line("switch(keyHashN(key, keyLen)) {")
+    for f in config["fields"]:
+        group = groups.get(f.get("group")) if f.get("group") else None
+        mark = "changed |= %s;" % group if group else None
+        if "count" in f:
+            if "patch" not in f:
+                continue
+            emit_case_head(c, f["patch"], "keyLen", PATCH_UNKNOWN_KEY)
+            c.line("%s value;" % f["type"])
+            c.line("default%s(value);" % f["type"])
+            c.line("uint32_t seen = 0;")
+            c.line("long index = -1;")
+            c.open("if(!read%s(cur, value, seen, index, 1) || index < 0 || index >= %s) {" % (f["type"], f["count"]))
+            c.line("return false;")
+            c.close()
+            c.line("merge%s(patched.%s[index], value, seen);" % (f["type"], f["name"]))
+            c.line("set.%s[index] |= seen;" % f["name"])
+            if mark:
+                c.line(mark)
+            c.line("return true;")
+            c.close()
+            continue
+        if json_key(f) is None:
+            continue
+        emit_case_head(c, json_key(f), "keyLen", PATCH_UNKNOWN_KEY)
+        if is_scalar(f):
+            if mark:
+                c.line(mark)
+            c.line("set.%s = true;" % f["name"])
+            emit_read_scalar(c, f, "patched." + f["name"])
+        else:
+            c.line("%s value = patched.%s;" % (f["type"], f["name"]))
+            c.line("uint32_t seen = 0;")
+            if f["type"] in patched:
+                c.line("long index = -1;")
+                c.open("if(!read%s(cur, value, seen, index, 1)) {" % f["type"])
+            else:
+                c.open("if(!read%s(cur, value, seen, 1)) {" % f["type"])
+            c.line("return false;")
+            c.close()
+            c.line("patched.%s = value;" % f["name"])
+            c.line("set.%s |= seen;" % f["name"])
+            if mark:
+                c.open("if(seen != 0) {")
+                c.line(mark)
+                c.close()
+            c.line("return true;")
+        c.close()
+    c.line("default:")
+    c.line("    " + PATCH_UNKNOWN_KEY)
+    c.line("}")
+    c.close("});")
+    c.open("if(!ok || !cur.atEnd()) {")
+    c.line("return false;")
+    c.close()
+    c.line("config = patched;")
+    c.line("changedFields = changed;")
+    c.line("mask = set;")
+    c.line("return true;")
+    c.close()
+    c.line()
+    # member-wise merge
+    c.open("void mergeFullConfigPatch(%s& dst, const %s& src, const %sPatchMask& mask) {" % (name, name, name))
+    for f in patch_mask_fields(schema):
+        if "count" in f:
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.line("merge%s(dst.%s[i], src.%s[i], mask.%s[i]);" % (f["type"], f["name"], f["name"], f["name"]))
+            c.close()
+        elif is_scalar(f):
+            c.open("if(mask.%s) {" % f["name"])
+            c.line("dst.%s = src.%s;" % (f["name"], f["name"]))
+            c.close()
+        else:
+            c.line("merge%s(dst.%s, src.%s, mask.%s);" % (f["type"], f["name"], f["name"], f["name"]))
+    c.close()
+    c.line()
+
+    # storage encode
+    c.open("size_t encodeFullConfigStorage(const %s& config, uint8_t* buf, size_t size) {" % name)
+    c.open("if(size < FULL_CONFIG_STORAGE_MAX) {")
+    c.line("return 0;")
+    c.close()
+    c.line("uint8_t* p = buf;")
+    c.line("*p++ = CONFIG_STORAGE_MAGIC;")
+    c.line("*p++ = CONFIG_SCHEMA_VERSION;")
+    for f in config["fields"]:
+        if "count" in f:
+            stride = storage_size(types[f["type"]])
+            c.line("*p++ = %d; // %s" % (f["id"], f["name"]))
+            c.line("*p++ = 2 + %s * %d;" % (f["count"], stride))
+            c.line("*p++ = %s;" % f["count"])
+            c.line("*p++ = %d;" % stride)
+            c.open("for(size_t i = 0; i < %s; i++) {" % f["count"])
+            c.line("put%s(p, config.%s[i]);" % (f["type"], f["name"]))
+            c.close()
+        elif is_scalar(f):
+            width = SCALARS[f["type"]][1]
+            c.line("*p++ = %d; // %s" % (f["id"], f["name"]))
+            c.line("*p++ = %d;" % width)
+            c.line("putScalar(p, config.%s, %d);" % (f["name"], width))
+        else:
+            c.line("*p++ = %d; // %s" % (f["id"], f["name"]))
+            c.line("*p++ = %d;" % storage_size(types[f["type"]]))
+            c.line("put%s(p, config.%s);" % (f["type"], f["name"]))
+    c.line("return p - buf;")
+    c.close()
+    c.line()
+
+    # storage decode
+    c.open("bool decodeFullConfigStorage(const uint8_t* data, size_t len, %s& config) {" % name)
+    c.open("if(len < 2 || data[0] != CONFIG_STORAGE_MAGIC) {")
+    c.line("return false;")
+    c.close()
+    c.line("%s decoded = defaultFullConfig();" % name)
+    c.line("const uint8_t* p = data + 2;")
+    c.line("const uint8_t* end = data + len;")
+    c.open("while(end - p >= 2) {")
+    c.line("uint8_t id = p[0];")
+    c.line("size_t size = p[1];")
+    c.line("const uint8_t* value = p + 2;")
+    c.open("if((size_t)(end - value) < size) {")
+    c.line("return false;")
+    c.close()
+    c.line("uint32_t v;")
+    c.line("switch(id) {")
+    for f in config["fields"]:
+        c.open("case %d: // %s" % (f["id"], f["name"]))
+        if "count" in f:
+            c.line("get%sArray(value, size, decoded.%s, %s);" % (f["type"], f["name"], f["count"]))
+        elif is_scalar(f):
+            c.open("if(size >= 1 && size <= 4) {")
+            c.line("v = getScalar(value, size);")
+            if f["type"] == "bool":
+                c.line("decoded.%s = v != 0;" % f["name"])
+            else:
+                conditions = range_conditions(f, "v")
+                if conditions:
+                    c.open("if(%s) {" % " && ".join(conditions))
+                    c.line("decoded.%s = (%s)v;" % (f["name"], SCALARS[f["type"]][0]))
+                    c.close()
+                else:
+                    c.line("decoded.%s = (%s)v;" % (f["name"], SCALARS[f["type"]][0]))
+            c.close()
+        else:
+            c.line("get%s(value, size, decoded.%s);" % (f["type"], f["name"]))
+        c.line("break;")
+        c.level -= 1
+    c.line("default:")
+    c.line("    break; // field removed from the schema")
+    c.line("}")
+    c.line("p = value + size;")
+    c.close()
+    c.open("if(p != end) {")
+    c.line("return false;")
+    c.close()
+    c.line("config = decoded;")
+    c.line("return true;")
+    c.close()
+    return c.text()
+
+
+def js_value(value):
+    return json.dumps(value)
+
+
+def generate_js(schema):
+    config = schema["config"]
+    types = schema["types"]
+    out = ["// " + BANNER, ""]
+    out.append("export const CONFIG_SCHEMA_VERSION = %d;" % schema["version"])
+    for name, value in schema.get("constants", {}).items():
+        out.append("export const %s = %d;" % (name, value))
+    out.append("")
+
+    def member_defaults(type_name):
+        members = types[type_name]["fields"]
+        return "{ " + ", ".join("%s: %s" % (m["name"], js_value(m["default"])) for m in members) + " }"
+
+    def member_ranges(type_name, indent):
+        lines = []
+        for m in types[type_name]["fields"]:
+            if m["type"] != "bool":
+                lines.append("%s%s: { min: %d, max: %d }," % (indent, m["name"], m["min"], m["max"]))
+        return lines
+
+    json_fields = [f for f in config["fields"] if json_key(f) is not None]
+
+    out.append("// Inclusive value ranges enforced by the firmware, keyed like the JSON document")
+    out.append("export const configRanges = {")
+    for f in json_fields:
+        key = json_key(f)
+        if is_scalar(f):
+            if f["type"] != "bool":
+                out.append("  %s: { min: %d, max: %d }," % (key, f["min"], f["max"]))
+        else:
+            out.append("  %s: {" % key)
+            out += member_ranges(f["type"], "    ")
+            out.append("  },")
+    out.append("};")
+    out.append("")
+
+    out.append("// Returns a fresh default config so callers may mutate it")
+    out.append("export function createDefaultConfig() {")
+    out.append("  return {")
+    for f in json_fields:
+        key = json_key(f)
+        if "count" in f:
+            out.append("    %s: Array.from({ length: %s }, () => (%s))," % (
+                key, f["count"], member_defaults(f["type"])))
+        elif is_scalar(f):
+            out.append("    %s: %s," % (key, js_value(f["default"])))
+        else:
+            out.append("    %s: %s," % (key, member_defaults(f["type"])))
+    out.append("  };")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def write_if_changed(path, content):
+    try:
+        with open(path, newline="") as f:
+            if f.read() == content:
+                return
+    except FileNotFoundError:
+        pass
+    with open(path, "w", newline="\n") as f:
+        f.write(content)
+    print("generate_config: wrote %s" % os.path.relpath(path, PROJECT_DIR))
+
+
+def generate():
+    schema = load_schema()
+    write_if_changed(HEADER_PATH, generate_header(schema))
+    write_if_changed(SOURCE_PATH, generate_source(schema))
+    write_if_changed(JS_PATH, generate_js(schema))
+
+
+generate()
@@ -6,9 +6,10 @@
 #include <time.h>              // For time functions
 #include "preferences_utils.h" // For generic get/put functions
 #include "rgb_effects.h"       // For sunrise_fade
-#include "debug_utils.h"       // For serialPrint
+#include "debug_utils.h"       // For LOG_*
+#include "lamp_group.h"        // For groupTimeMs
+#include "metrics.h"
 
-#define MAX_ALARMS 10
 // ...existing code...
 
 // === END OF FILE: TimeInfo struct and getCurrentTimeInfo implementation ===
@@ -47,8 +48,8 @@ static int last_triggered_day_for_alarm[MAX_ALARMS];
 
 static int activeAlarmId = -1; // -1 means no alarm is active. Otherwise, it's
                                // the index in the alarms array.
-static unsigned long alarm_start_millis =
-    0; // Stores the millis() time when the alarm started.
+// Group time (ms since the epoch) the sunrise counts from, the same on every lamp of a group
+static int64_t alarm_start_ms = 0;
 
 // #define WAKEUP_DURATION_MINUTES 2
 
@@ -100,7 +101,7 @@ void setActiveAlarm(int index) {
     }
 
     /* if(activeAlarmId != -1) {
-        serialPrint("Deactivating alarm: " + String(activeAlarmId));
+        LOG_D("Deactivating alarm: %d", activeAlarmId);
         last_triggered_day_for_alarm[activeAlarmId] = -1;
     } */
     activeAlarmId = index;
@@ -108,10 +109,11 @@ void setActiveAlarm(int index) {
     if(activeAlarmId != -1) {
         TimeInfo currentTimeInfo = getCurrentTimeInfo();
         last_triggered_day_for_alarm[activeAlarmId] = currentTimeInfo.day;
-        alarm_start_millis = millis(); // Record the start time of
-                                       // the alarm animation
+        alarm_start_ms = groupTimeMs(); // Record the start time of
+                                        // the alarm animation
+        countMetric(METRIC_ALARM_FIRES);
     }
-    serialPrint("Active alarm set to: " + String(activeAlarmId));
+    LOG_I("Active alarm set to: %d", activeAlarmId);
 }
 
 /**
@@ -124,6 +126,12 @@ void stopActiveAlarm() {
     }
 }
 
+// Wall clock steps must not run the sunrise backwards
+static int64_t alarmElapsedMs() {
+    int64_t elapsed = groupTimeMs() - alarm_start_ms;
+    return elapsed > 0 ? elapsed : 0;
+}
+
 /**
  * @brief Checks alarms against the internal RTC time.
  * This function should be called periodically from the main
@@ -133,67 +141,57 @@ void checkAlarmStates(uint16_t durationMinutes) {
     static unsigned long lastCheck = 0;
     unsigned long currentTime = millis();
 
-    // Only check every 10 seconds
-    if(currentTime - lastCheck < 10000) {
+    // Only check every second, the start is taken from the minute boundary anyway
+    if(currentTime - lastCheck < 1000) {
         return;
     }
     lastCheck = currentTime;
 
-    int runningMs = millis() - alarm_start_millis;
-
     TimeInfo currentTimeInfo = getCurrentTimeInfo();
     // First, check if a currently active alarm needs to be disabled
-    if(activeAlarmId != -1 && runningMs > (unsigned long)durationMinutes * 60 * 1000) {
-        serialPrint("Stopping active alarm after duration here : "
-                    + String(activeAlarmId));
+    if(activeAlarmId != -1 && alarmElapsedMs() > (int64_t)durationMinutes * 60 * 1000) {
+        LOG_I("Stopping active alarm after duration here : %d", activeAlarmId);
         stopActiveAlarm();
     }
 
     // Activate alarm
     for(int i = 0; i < MAX_ALARMS; i++) {
-       /*  if (alarms[i].active) {
-             serialPrint("Alarm[" + String(i) + "] Debug: " +
-                        "CurrDay=" + String(currentTimeInfo.day) +
-                        " vs LastTrig=" + String(last_triggered_day_for_alarm[i]) +
-                        ", AlmDay=" + String(alarms[i].day) +
-                        " vs CurrDoW=" + String(currentTimeInfo.dayOfWeek) +
-                        ", AlmHr=" + String(alarms[i].hour) +
-                        " vs CurrHr=" + String(currentTimeInfo.hour) +
-                        ", AlmMin=" + String(alarms[i].minute) +
-                        " vs CurrMin=" + String(currentTimeInfo.minute));
+        /* if(alarms[i].active) {
+            LOG_D("Alarm[%d]: CurrDay=%d vs LastTrig=%d, AlmDay=%u vs CurrDoW=%d", i, currentTimeInfo.day,
+                  last_triggered_day_for_alarm[i], alarms[i].day, currentTimeInfo.dayOfWeek);
+            LOG_D("Alarm[%d]: AlmHr=%u vs CurrHr=%d, AlmMin=%u vs CurrMin=%d", i, alarms[i].hour,
+                  currentTimeInfo.hour, alarms[i].minute, currentTimeInfo.minute);
         } */
         if(i != activeAlarmId && alarms[i].active
            && currentTimeInfo.day != last_triggered_day_for_alarm[i]
            && alarms[i].day == currentTimeInfo.dayOfWeek
            && alarms[i].hour == currentTimeInfo.hour
            && alarms[i].minute == currentTimeInfo.minute) {
-            serialPrint("Alarm[" + String(i) + "]: day=" + String(alarms[i].day)
-                        + ", hour=" + String(alarms[i].hour) + ", minute="
-                        + String(alarms[i].minute) + ", last_triggered="
-                        + String(last_triggered_day_for_alarm[i]));
+            LOG_I("Alarm[%d]: day=%u, hour=%u, minute=%u, last_triggered=%d", i, alarms[i].day, alarms[i].hour,
+                  alarms[i].minute, last_triggered_day_for_alarm[i]);
 
             setActiveAlarm(i);
+            // Lamps of a group notice the minute up to a second apart, but all start from its boundary
+            alarm_start_ms -= alarm_start_ms % 60000;
             return;
         }
     }
 }
 /**
  * @brief If an alarm is active, calculates the RGB color
- * based on elapsed animation time.
- * @param currentMillis The current time from millis() for
- * high-precision animation.
+ * based on elapsed animation time in group time.
  * @param color A reference to the RGB struct to be filled.
  * @return true if an alarm is active and a color was
  * calculated, false otherwise.
  */
-bool getAlarmColor(unsigned long currentMillis, RGB& color, uint16_t durationMinutes) {
+bool getAlarmColor(RGB& color, uint16_t durationMinutes) {
     if(activeAlarmId == -1) {
         return false;
     }
 
     // Calculate how many milliseconds have passed since the
     // alarm animation started
-    unsigned long elapsed_millis = currentMillis - alarm_start_millis;
+    unsigned long elapsed_millis = alarmElapsedMs();
     const unsigned long wakeup_duration_millis =
         (unsigned long)durationMinutes * 60 * 1000;
 
@@ -226,7 +224,7 @@ byte getAlarmBrightness(uint16_t durationMinutes) {
     if(activeAlarmId == -1) {
         return 0;
     }
-    unsigned long elapsed_millis = millis() - alarm_start_millis;
+    unsigned long elapsed_millis = alarmElapsedMs();
     const unsigned long total_duration_millis =
         (unsigned long)durationMinutes * 60 * 1000;
     const unsigned long brightness_duration_millis =
@@ -235,9 +233,7 @@ byte getAlarmBrightness(uint16_t durationMinutes) {
         return 7; // Maximum brightness after 70% of duration
     }
     float progress = (float)elapsed_millis / brightness_duration_millis;
-    byte brightness = 1 + (byte)(progress * (7 - 1));
-    serialPrint("Alarm brightness calculated: " + String(brightness) + " (progress: " + String(progress) + ")");
-    return brightness;
+    return 1 + (byte)(progress * (7 - 1));
 }
 
 void resetAlarms() {
@@ -247,7 +243,7 @@ void resetAlarms() {
         last_triggered_day_for_alarm[i] = -1;
     }
     activeAlarmId = -1;
-    alarm_start_millis = 0;
+    alarm_start_ms = 0;
 }
 
 /**
@@ -255,8 +251,7 @@ void resetAlarms() {
  * @return TimeInfo struct
  */
 TimeInfo getCurrentTimeInfo() {
-    time_t now;
-    time(&now);
+    time_t now = groupTimeMs() / 1000; // the group's clock, so grouped lamps see the same minute
     struct tm* ptm = localtime(&now);
     TimeInfo info;
     info.hour = ptm->tm_hour;
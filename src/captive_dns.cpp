@@ -0,0 +1,233 @@
+#include "captive_dns.h"
+#include <lwip/sockets.h>
+#include "debug_utils.h"
+#include "trace.h"
+
+#define DNS_PORT 53
+#define DNS_TTL 3600
+#define DNS_HEADER_SIZE 12
+#define DNS_ANSWER_SIZE 16     // name pointer, type, class, ttl, rdlength, ipv4
+#define DNS_PACKET_SIZE 512    // classic UDP DNS limit
+#define DNS_BATCH_MAX 16       // yield after this many packets in one wake-up, answered or not
+#define DNS_SELECT_TIMEOUT_MS 200
+#define DNS_TASK_STACK 3072
+#define DNS_TASK_PRIORITY 2
+
+// Upper bounds of the latency histogram buckets in microseconds, last one catches the rest
+static const uint32_t latencyBucketUs[DNS_LATENCY_BUCKETS] = {50, 100, 200, 500, 1000, 2000, 5000, UINT32_MAX};
+
+static uint8_t packet[DNS_PACKET_SIZE];
+static uint8_t answerIP[4];
+static volatile bool dnsRunning = false;
+static volatile bool dnsTaskAlive = false; // cleared by the task right before it deletes itself
+
+static uint32_t latencyHistogram[DNS_LATENCY_BUCKETS]; // wake-up to reply sent
+static uint32_t waitHistogram[DNS_LATENCY_BUCKETS];    // wake-up to dequeued, behind earlier packets
+static uint32_t queries = 0;
+static uint32_t dropped = 0;
+static uint32_t maxBatch = 0;
+static uint32_t windowQueries = 0;
+static uint32_t queriesPerSec = 0;
+static unsigned long windowStartMs = 0;
+
+static inline uint16_t readU16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static inline void writeU16(uint8_t* p, uint16_t v) {
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+}
+
+/**
+ * Turns the query in packet[0..len) into a reply in place.
+ * @return The reply length, or 0 if the packet should be dropped.
+ */
+static size_t buildReply(size_t len) {
+    if(len < DNS_HEADER_SIZE) {
+        return 0;
+    }
+    uint16_t flags = readU16(&packet[2]);
+    bool isResponse = flags & 0x8000;
+    uint8_t opcode = (flags >> 11) & 0x0F;
+    if(isResponse || opcode != 0 || readU16(&packet[4]) != 1) {
+        return 0;
+    }
+
+    // Walk the QNAME labels of the single question
+    size_t pos = DNS_HEADER_SIZE;
+    while(pos < len && packet[pos] != 0) {
+        if(packet[pos] & 0xC0) {
+            return 0; // compression is not valid in a question
+        }
+        pos += packet[pos] + 1;
+    }
+    pos += 1; // terminating zero label
+    if(pos + 4 > len) {
+        return 0;
+    }
+    uint16_t qtype = readU16(&packet[pos]);
+    uint16_t qclass = readU16(&packet[pos + 2]);
+    pos += 4;
+
+    bool answerA = qclass == 1 && (qtype == 1 || qtype == 255); // IN, A or ANY
+    if(answerA && pos + DNS_ANSWER_SIZE > DNS_PACKET_SIZE) {
+        return 0;
+    }
+    // QR, opcode copied, AA, RD copied, RA, NoError even for non-A types
+    writeU16(&packet[2], 0x8000 | (flags & 0x7900) | 0x0400 | 0x0080);
+    writeU16(&packet[6], answerA ? 1 : 0); // ANCOUNT
+    writeU16(&packet[8], 0);               // NSCOUNT
+    writeU16(&packet[10], 0);              // ARCOUNT, drops any EDNS OPT record
+    if(!answerA) {
+        return pos;
+    }
+
+    uint8_t* answer = &packet[pos];
+    writeU16(&answer[0], 0xC000 | DNS_HEADER_SIZE); // pointer to the question name
+    writeU16(&answer[2], 1);                        // type A
+    writeU16(&answer[4], 1);                        // class IN
+    writeU16(&answer[6], DNS_TTL >> 16);
+    writeU16(&answer[8], DNS_TTL & 0xFFFF);
+    writeU16(&answer[10], 4);
+    memcpy(&answer[12], answerIP, 4);
+    return pos + DNS_ANSWER_SIZE;
+}
+
+static void recordLatency(uint32_t* histogram, uint32_t us) {
+    for(int i = 0; i < DNS_LATENCY_BUCKETS; i++) {
+        if(us <= latencyBucketUs[i]) {
+            histogram[i]++;
+            return;
+        }
+    }
+}
+
+static uint32_t latencyPercentile(const uint32_t* histogram, uint32_t percent) {
+    uint32_t total = 0;
+    for(int i = 0; i < DNS_LATENCY_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if(total == 0) {
+        return 0;
+    }
+    uint32_t rank = (total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(int i = 0; i < DNS_LATENCY_BUCKETS; i++) {
+        seen += histogram[i];
+        if(seen >= rank) {
+            return latencyBucketUs[i];
+        }
+    }
+    return latencyBucketUs[DNS_LATENCY_BUCKETS - 1];
+}
+
+static void dnsTaskMain(void*) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(DNS_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_E("Captive DNS: socket setup failed");
+        if(sock >= 0) {
+            close(sock);
+        }
+        dnsRunning = false;
+        dnsTaskAlive = false;
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    while(dnsRunning) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        struct timeval timeout = {0, DNS_SELECT_TIMEOUT_MS * 1000};
+        if(select(sock + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        // lwIP has no SO_TIMESTAMP, so the wake-up is the earliest time a packet is known to be there;
+        // later packets of the batch wait behind the earlier ones from here
+        unsigned long wakeUs = micros();
+
+        // Drain everything queued before going back to sleep
+        uint32_t batch = 0;
+        while(batch < DNS_BATCH_MAX) {
+            struct sockaddr_in client;
+            socklen_t clientLen = sizeof(client);
+            int len = recvfrom(sock, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr*)&client, &clientLen);
+            if(len <= 0) {
+                break;
+            }
+            batch++; // dropped packets cost a receive as well
+            unsigned long startUs = micros();
+            size_t replyLen = buildReply(len);
+            if(replyLen == 0) {
+                dropped++;
+                continue;
+            }
+            sendto(sock, packet, replyLen, 0, (struct sockaddr*)&client, clientLen);
+            recordLatency(latencyHistogram, micros() - wakeUs);
+            recordLatency(waitHistogram, startUs - wakeUs);
+            traceComplete(TRACE_DNS_QUERY, startUs);
+            queries++;
+            windowQueries++;
+        }
+        if(batch > maxBatch) {
+            maxBatch = batch;
+        }
+
+        unsigned long now = millis();
+        if(now - windowStartMs >= 1000) {
+            queriesPerSec = windowQueries * 1000 / (now - windowStartMs);
+            windowQueries = 0;
+            windowStartMs = now;
+        }
+    }
+
+    close(sock);
+    dnsTaskAlive = false;
+    vTaskDelete(nullptr);
+}
+
+void startCaptiveDns(const IPAddress& ip) {
+    for(int i = 0; i < 4; i++) {
+        answerIP[i] = ip[i];
+    }
+    if(dnsRunning) {
+        return;
+    }
+    // A previous task may still be closing its socket after stopCaptiveDns()
+    while(dnsTaskAlive) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    dnsRunning = true;
+    windowStartMs = millis();
+    dnsTaskAlive = true;
+    if(xTaskCreate(dnsTaskMain, "captive_dns", DNS_TASK_STACK, nullptr, DNS_TASK_PRIORITY, nullptr) != pdPASS) {
+        LOG_E("Captive DNS: task creation failed");
+        dnsRunning = false;
+        dnsTaskAlive = false;
+    }
+}
+
+void stopCaptiveDns() {
+    // The task notices within DNS_SELECT_TIMEOUT_MS, closes the socket and deletes itself
+    dnsRunning = false;
+}
+
+DnsStats getDnsStats() {
+    DnsStats stats;
+    stats.queries = queries;
+    stats.dropped = dropped;
+    stats.queriesPerSec = millis() - windowStartMs > 2000 ? 0 : queriesPerSec;
+    stats.p50LatencyUs = latencyPercentile(latencyHistogram, 50);
+    stats.p90LatencyUs = latencyPercentile(latencyHistogram, 90);
+    stats.p99LatencyUs = latencyPercentile(latencyHistogram, 99);
+    stats.p50WaitUs = latencyPercentile(waitHistogram, 50);
+    stats.p99WaitUs = latencyPercentile(waitHistogram, 99);
+    stats.maxBatch = maxBatch;
+    stats.running = dnsRunning;
+    return stats;
+}
@@ -0,0 +1,177 @@
+#include "captive_portal.h"
+#include <Arduino.h>
+#include "debug_utils.h"
+
+// https://github.com/CDFER/Captive-Portal-ESP32/blob/main/src/main.cpp
+// Pre reading on the fundamentals of captive portals
+// https://textslashplain.com/2022/06/24/captive-portals/
+//
+// WARNING IOS (and maybe macos) WILL NOT POP UP IF IT CONTAINS THE WORD
+// "Success" https://www.esp8266.com/viewtopic.php?f=34&t=4398 SAFARI (IOS)
+// IS STUPID, G-ZIPPED FILES CAN'T END IN .GZ
+// https://github.com/homieiot/homie-esp8266/issues/476 this is fixed by the
+// webserver serve static function. SAFARI (IOS) there is a 128KB limit to
+// the size of the HTML. The HTML can reference external resources/images
+// that bring the total over 128KB SAFARI (IOS) popup browser has some
+// severe limitations (javascript disabled, cookies disabled)
+
+enum ProbeReply {
+    REPLY_PORTAL_REDIRECT, // 302 to the AP address
+    REPLY_LOGOUT_REDIRECT, // 302 to logout.net
+    REPLY_OK,
+    REPLY_NOT_FOUND
+};
+
+struct ProbeEntry {
+    const char* path;
+    uint8_t pathLen;
+    ProbeReply reply;
+};
+
+// Indexed by CaptiveProbe
+static const ProbeEntry probeTable[] = {
+    {"/connecttest.txt", 16, REPLY_LOGOUT_REDIRECT},     // windows 11 captive portal workaround
+    {"/wpad.dat", 9, REPLY_NOT_FOUND},                   // a 404 stops win 10 calling this repeatedly
+    {"/generate_204", 13, REPLY_PORTAL_REDIRECT},        // android captive portal redirect
+    {"/redirect", 9, REPLY_PORTAL_REDIRECT},             // microsoft redirect
+    {"/hotspot-detect.html", 20, REPLY_PORTAL_REDIRECT}, // apple call home
+    {"/canonical.html", 15, REPLY_PORTAL_REDIRECT},      // firefox captive portal call home
+    {"/success.txt", 12, REPLY_OK},                      // firefox captive portal call home
+    {"/ncsi.txt", 9, REPLY_PORTAL_REDIRECT},             // windows call home
+    {"/favicon.ico", 12, REPLY_NOT_FOUND},               // webpage icon
+};
+
+static const char* const probeNames[PROBE_COUNT] = {
+    "windows_connecttest", "wpad", "android", "microsoft_redirect", "apple",
+    "firefox_canonical", "firefox_success", "windows_ncsi", "favicon", "catch_all"};
+
+static_assert(sizeof(probeTable) / sizeof(probeTable[0]) == PROBE_CATCH_ALL, "probeTable must match CaptiveProbe");
+
+// Perfect hash over the probe paths: (len * 7 + path[1] + path[len - 2]) & 15 is
+// collision free for the table above. Re-check the slots when adding a probe.
+#define PROBE_SLOTS 16
+static int8_t probeSlots[PROBE_SLOTS];
+static volatile uint32_t probeCounters[PROBE_COUNT];
+
+// Complete responses, status line to empty body; the portal redirect is filled in once the AP address is known
+#define STATIC_HEADERS "Content-Length: 0\r\nConnection: close\r\n\r\n"
+static char portalRedirect[96];
+static size_t portalRedirectLen = 0;
+static const char logoutRedirect[] = "HTTP/1.1 302 Found\r\nLocation: http://logout.net\r\n" STATIC_HEADERS;
+static const char okReply[] = "HTTP/1.1 200 OK\r\n" STATIC_HEADERS;
+static const char notFoundReply[] = "HTTP/1.1 404 Not Found\r\n" STATIC_HEADERS;
+
+// Writes one of the prebuilt responses as is: no header list, no Strings, nothing formatted per request
+class StaticResponse : public AsyncWebServerResponse {
+public:
+    StaticResponse(int code, const char* raw, size_t len) : _raw(raw), _rawLen(len) {
+        _code = code;
+    }
+
+    bool _sourceValid() const override {
+        return true;
+    }
+
+    void _respond(AsyncWebServerRequest* request) override {
+        _state = RESPONSE_WAIT_ACK;
+        _writtenLength = request->client()->write(_raw, _rawLen);
+        if(_writtenLength == 0) {
+            _state = RESPONSE_FAILED;
+        }
+    }
+
+    size_t _ack(AsyncWebServerRequest*, size_t len, uint32_t) override {
+        _ackedLength += len;
+        if(_state == RESPONSE_WAIT_ACK && _ackedLength >= _writtenLength) {
+            _state = RESPONSE_END;
+        }
+        return 0;
+    }
+
+private:
+    const char* _raw;
+    size_t _rawLen;
+};
+
+static void sendStatic(AsyncWebServerRequest* request, int code, const char* raw, size_t len) {
+    request->send(new StaticResponse(code, raw, len));
+}
+
+static inline uint8_t probeHash(const char* path, size_t len) {
+    return (len * 7 + (uint8_t)path[1] + (uint8_t)path[len - 2]) & (PROBE_SLOTS - 1);
+}
+
+static int findProbe(const String& url) {
+    size_t len = url.length();
+    if(len < 2 || len > 255) {
+        return -1;
+    }
+    const char* path = url.c_str();
+    int8_t index = probeSlots[probeHash(path, len)];
+    if(index < 0 || probeTable[index].pathLen != len || memcmp(probeTable[index].path, path, len) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+class CaptiveProbeHandler : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest* request) override {
+        return findProbe(request->url()) >= 0;
+    }
+
+    void handleRequest(AsyncWebServerRequest* request) override {
+        int index = findProbe(request->url());
+        if(index < 0) {
+            sendStatic(request, 404, notFoundReply, sizeof(notFoundReply) - 1);
+            return;
+        }
+        probeCounters[index]++;
+        switch(probeTable[index].reply) {
+        case REPLY_PORTAL_REDIRECT:
+            sendStatic(request, 302, portalRedirect, portalRedirectLen);
+            break;
+        case REPLY_LOGOUT_REDIRECT:
+            sendStatic(request, 302, logoutRedirect, sizeof(logoutRedirect) - 1);
+            break;
+        case REPLY_OK:
+            sendStatic(request, 200, okReply, sizeof(okReply) - 1);
+            break;
+        case REPLY_NOT_FOUND:
+            sendStatic(request, 404, notFoundReply, sizeof(notFoundReply) - 1);
+            break;
+        }
+    }
+};
+
+void setUpCaptivePortal(AsyncWebServer& server, const IPAddress& localIP) {
+    // Built once so redirects never assemble the URL per request
+    portalRedirectLen = snprintf(portalRedirect, sizeof(portalRedirect),
+                                 "HTTP/1.1 302 Found\r\nLocation: http://%u.%u.%u.%u\r\n" STATIC_HEADERS, localIP[0],
+                                 localIP[1], localIP[2], localIP[3]);
+
+    memset(probeSlots, -1, sizeof(probeSlots));
+    for(int i = 0; i < PROBE_CATCH_ALL; i++) {
+        uint8_t slot = probeHash(probeTable[i].path, probeTable[i].pathLen);
+        if(probeSlots[slot] != -1) {
+            LOG_E("Captive probe hash collision: %s", probeTable[i].path);
+        }
+        probeSlots[slot] = i;
+    }
+
+    server.addHandler(new CaptiveProbeHandler());
+
+    // the catch all
+    server.onNotFound([](AsyncWebServerRequest* request) {
+        probeCounters[PROBE_CATCH_ALL]++;
+        sendStatic(request, 302, portalRedirect, portalRedirectLen);
+    });
+}
+
+const char* getCaptiveProbeName(CaptiveProbe probe) {
+    return probe < PROBE_COUNT ? probeNames[probe] : "unknown";
+}
+
+uint32_t getCaptiveProbeCount(CaptiveProbe probe) {
+    return probe < PROBE_COUNT ? probeCounters[probe] : 0;
+}
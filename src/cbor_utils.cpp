@@ -0,0 +1,60 @@
+#include "cbor_utils.h"
+#include "cbor_stream.h"
+#include "clock_service.h" // for timeSourceName
+#include "json_utils.h"    // for PASSWORD_MASK
+
+size_t createSystemConfigCbor(const SystemSettings& systemSettings, uint8_t* buf, size_t size) {
+    CborWriter out(buf, size);
+    out.map(4);
+    out.text("internalSSID");
+    out.text(systemSettings.internalSSID);
+    out.text("internalPW");
+    out.text(strlen(systemSettings.internalPW) > 0 ? PASSWORD_MASK : "");
+    out.text("externalSSID");
+    out.text(systemSettings.externalSSID);
+    out.text("externalPW");
+    out.text(strlen(systemSettings.externalPW) > 0 ? PASSWORD_MASK : "");
+    return out.finish();
+}
+
+size_t createWiFiStatusCbor(const WiFiStatus& status, uint8_t* buf, size_t size) {
+    CborWriter out(buf, size);
+    out.map(12);
+    out.text("currentTime");
+    if(status.currentTime.length() == 0) {
+        out.null();
+    } else {
+        out.text(status.currentTime.c_str(), status.currentTime.length());
+    }
+    out.text("lastTestResult");
+    out.uint(status.lastTestResult);
+    out.text("timeSinceLastTestMs");
+    out.uint(status.timeSinceLastTestMs);
+    out.text("timeSinceLastSucceededTestMs");
+    out.uint(status.timeSinceLastSucceededTestMs);
+    out.text("lastStaConnectionTime");
+    out.uint(status.lastStaConnectionTime);
+    out.text("systemTime");
+    out.uint(status.systemTime);
+    out.text("clockSynced");
+    out.boolean(status.clockSynced);
+    out.text("staConfigValid");
+    out.boolean(status.staConfigValid);
+    out.text("clockErrorMs");
+    if(status.clockErrorMs < 0) {
+        out.null();
+    } else {
+        out.uint(status.clockErrorMs);
+    }
+    out.text("clockDriftPpb");
+    out.integer(status.clockDriftPpb);
+    out.text("timeSource");
+    if(status.timeSource == TIME_SOURCE_NONE) {
+        out.null();
+    } else {
+        out.text(timeSourceName(status.timeSource));
+    }
+    out.text("timeAccuracyMs");
+    out.uint(status.timeAccuracyMs);
+    return out.finish();
+}
@@ -0,0 +1,290 @@
+#include "clock_service.h"
+#include <esp_timer.h>
+#include <math.h>
+#include <time.h>
+#include "debug_utils.h"
+#include "store.h"
+#include "system_utils.h"
+
+struct SyncPair {
+    int64_t timerUs;  // esp_timer at the sync
+    int64_t offsetUs; // true time minus timerUs
+    uint32_t uncertaintyUs;
+};
+
+struct PendingSync {
+    SyncPair pair;
+    TimeSource source;
+    bool setClock; // SNTP has set the clock itself, a browser time still needs settimeofday()
+};
+
+// Handed over from the SNTP and web tasks; guarded by pendingMux
+static portMUX_TYPE pendingMux = portMUX_INITIALIZER_UNLOCKED;
+static bool hasPending = false;
+static PendingSync pending;
+static bool hasPendingTimeZone = false;
+static int16_t pendingTzOffsetMin = 0;
+
+// Loop task only
+static SyncPair pairs[CLOCK_SYNC_HISTORY];
+static uint8_t pairCount = 0;
+static ClockDrift storedDrift = {0, CLOCK_DEFAULT_PPM_UNCERTAINTY};
+static int64_t appliedCorrectionUs = 0; // slewed in since the last sync
+
+// Written by the loop task, read by the web task; guarded by statusMux
+static portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t syncCount = 0;
+static uint8_t samples = 0;
+static int64_t lastSyncTimerUs = 0;
+static uint32_t lastSyncUncertaintyUs = 0;
+static TimeSource lastSource = TIME_SOURCE_NONE;
+static float driftPpm = 0;
+static float uncertaintyPpm = CLOCK_DEFAULT_PPM_UNCERTAINTY;
+static bool hasResidual = false;
+static int32_t lastResidualMs = 0;
+
+void noteTimeSync(const struct timeval* tv) {
+    int64_t timerUs = esp_timer_get_time();
+    int64_t epochUs = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+    portENTER_CRITICAL(&pendingMux);
+    pending.pair.timerUs = timerUs;
+    pending.pair.offsetUs = epochUs - timerUs;
+    pending.pair.uncertaintyUs = CLOCK_NTP_UNCERTAINTY_US;
+    pending.source = TIME_SOURCE_NTP;
+    pending.setClock = false;
+    hasPending = true;
+    portEXIT_CRITICAL(&pendingMux);
+}
+
+bool noteClientTime(int64_t offsetUs, uint32_t uncertaintyUs) {
+    if(uncertaintyUs > CLOCK_CLIENT_MAX_UNCERTAINTY_US) {
+        return false;
+    }
+    ClockStatus status = getClockStatus();
+    if(status.isSet && (uint64_t)status.errorBoundMs * 1000 <= uncertaintyUs) {
+        return false;
+    }
+    portENTER_CRITICAL(&pendingMux);
+    pending.pair.timerUs = esp_timer_get_time();
+    pending.pair.offsetUs = offsetUs;
+    pending.pair.uncertaintyUs = uncertaintyUs;
+    pending.source = TIME_SOURCE_BROWSER;
+    pending.setClock = true;
+    hasPending = true;
+    portEXIT_CRITICAL(&pendingMux);
+    return true;
+}
+
+// Least squares slope of offset over time. Coordinates are taken relative to the
+// first pair so the sums stay small enough to keep their precision.
+static bool fitDrift(float& ppm, float& uncertainty) {
+    if(pairCount < 2) {
+        return false;
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for(uint8_t i = 0; i < pairCount; i++) {
+        double x = (pairs[i].timerUs - pairs[0].timerUs) / 1e6;
+        double y = (double)(pairs[i].offsetUs - pairs[0].offsetUs);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double n = pairCount;
+    double varX = sxx - sx * sx / n;
+    double spanS = (pairs[pairCount - 1].timerUs - pairs[0].timerUs) / 1e6;
+    if(varX <= 0 || spanS <= 0) {
+        return false;
+    }
+    double slope = (sxy - sx * sy / n) / varX; // us per s = ppm
+
+    // Never more certain than the sync errors at both ends spread over the covered span allow
+    double floorPpm = ((double)pairs[0].uncertaintyUs + pairs[pairCount - 1].uncertaintyUs) / spanS;
+    double stderrPpm = floorPpm;
+    if(pairCount > 2) {
+        double intercept = (sy - slope * sx) / n;
+        double ss = 0;
+        for(uint8_t i = 0; i < pairCount; i++) {
+            double x = (pairs[i].timerUs - pairs[0].timerUs) / 1e6;
+            double r = (pairs[i].offsetUs - pairs[0].offsetUs) - (intercept + slope * x);
+            ss += r * r;
+        }
+        stderrPpm = max(sqrt(ss / (n - 2) / varX), floorPpm);
+    }
+    ppm = slope;
+    uncertainty = stderrPpm;
+    return true;
+}
+
+// Sync pairs of this boot replace the stored estimate once they are more certain
+static void updateEstimate() {
+    float fitPpm, fitUncertainty;
+    float ppm = storedDrift.ppm;
+    float uncertainty = max(storedDrift.uncertaintyPpm, CLOCK_STORED_PPM_UNCERTAINTY);
+    if(fitDrift(fitPpm, fitUncertainty) && fitUncertainty < uncertainty) {
+        ppm = fitPpm;
+        uncertainty = fitUncertainty;
+        if(fabsf(ppm - storedDrift.ppm) >= CLOCK_SAVE_MIN_CHANGE_PPM
+           || uncertainty < storedDrift.uncertaintyPpm / 2) {
+            storedDrift.ppm = ppm;
+            storedDrift.uncertaintyPpm = uncertainty;
+            saveClockDrift(storedDrift);
+        }
+    }
+
+    portENTER_CRITICAL(&statusMux);
+    driftPpm = ppm;
+    uncertaintyPpm = uncertainty;
+    portEXIT_CRITICAL(&statusMux);
+}
+
+static void takeSync(const PendingSync& pendingSync) {
+    const SyncPair& sync = pendingSync.pair;
+    if(pendingSync.setClock) {
+        int64_t epochUs = esp_timer_get_time() + sync.offsetUs;
+        struct timeval tv;
+        tv.tv_sec = epochUs / 1000000;
+        tv.tv_usec = epochUs % 1000000;
+        settimeofday(&tv, nullptr);
+    }
+
+    int32_t residualMs = 0;
+    bool residual = pairCount > 0;
+    if(residual) {
+        // The compensated clock ran from the previous sync at 1 + driftPpm
+        const SyncPair& last = pairs[pairCount - 1];
+        int64_t elapsedUs = sync.timerUs - last.timerUs;
+        int64_t predictedOffsetUs = last.offsetUs + (int64_t)(elapsedUs * (double)driftPpm / 1e6);
+        residualMs = (sync.offsetUs - predictedOffsetUs) / 1000;
+    }
+
+    if(pairCount == CLOCK_SYNC_HISTORY) {
+        memmove(&pairs[0], &pairs[1], sizeof(pairs) - sizeof(pairs[0]));
+        pairCount--;
+    }
+    pairs[pairCount++] = sync;
+    updateEstimate();
+
+    appliedCorrectionUs = 0; // SNTP stepped the clock, which also cancels a running adjtime
+
+    portENTER_CRITICAL(&statusMux);
+    hasResidual = residual;
+    lastResidualMs = residualMs;
+    samples = pairCount;
+    lastSyncTimerUs = sync.timerUs;
+    lastSyncUncertaintyUs = sync.uncertaintyUs;
+    lastSource = pendingSync.source;
+    syncCount++;
+    portEXIT_CRITICAL(&statusMux);
+    LOG_I("Clock set from %s +- %u ms, drift %d ppb +- %u ppb", timeSourceName(pendingSync.source),
+          (unsigned)(sync.uncertaintyUs / 1000), (int)(driftPpm * 1000), (unsigned)(uncertaintyPpm * 1000));
+}
+
+// Slews in the drift accumulated since the last sync that was not applied yet
+static void correctDrift() {
+    if(pairCount == 0 || driftPpm == 0) {
+        return;
+    }
+    int64_t elapsedUs = esp_timer_get_time() - pairs[pairCount - 1].timerUs;
+    int64_t dueUs = (int64_t)(elapsedUs * (double)driftPpm / 1e6);
+    int64_t deltaUs = dueUs - appliedCorrectionUs;
+    if(deltaUs > -1000 && deltaUs < 1000) {
+        return;
+    }
+    struct timeval delta;
+    delta.tv_sec = deltaUs / 1000000;
+    delta.tv_usec = deltaUs % 1000000;
+    if(adjtime(&delta, nullptr) == 0) {
+        appliedCorrectionUs = dueUs;
+    }
+}
+
+void setClockTimeZone(int16_t tzOffsetMin) {
+    portENTER_CRITICAL(&pendingMux);
+    pendingTzOffsetMin = tzOffsetMin;
+    hasPendingTimeZone = true;
+    portEXIT_CRITICAL(&pendingMux);
+}
+
+// POSIX TZ counts hours west of UTC, the same sign as getTimezoneOffset()
+static void applyTimeZone(int16_t tzOffsetMin) {
+    char tz[16];
+    int absMin = tzOffsetMin < 0 ? -tzOffsetMin : tzOffsetMin;
+    snprintf(tz, sizeof(tz), "UTC%c%d:%02d", tzOffsetMin < 0 ? '-' : '+', absMin / 60, absMin % 60);
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+void initClockService() {
+    if(loadClockDrift(storedDrift)) {
+        driftPpm = storedDrift.ppm;
+        uncertaintyPpm = max(storedDrift.uncertaintyPpm, CLOCK_STORED_PPM_UNCERTAINTY);
+        LOG_I("Clock drift from earlier boots: %d ppb", (int)(driftPpm * 1000));
+    } else {
+        storedDrift.ppm = 0;
+        storedDrift.uncertaintyPpm = CLOCK_DEFAULT_PPM_UNCERTAINTY;
+    }
+}
+
+void clockServiceLoop() {
+    static unsigned long lastCorrectionMs = 0;
+    portENTER_CRITICAL(&pendingMux);
+    bool sync = hasPending;
+    PendingSync pair = pending;
+    hasPending = false;
+    bool timeZone = hasPendingTimeZone;
+    int16_t tzOffsetMin = pendingTzOffsetMin;
+    hasPendingTimeZone = false;
+    portEXIT_CRITICAL(&pendingMux);
+
+    if(timeZone) {
+        applyTimeZone(tzOffsetMin);
+    }
+    if(sync) {
+        takeSync(pair);
+    }
+    if(isTimeForAction(&lastCorrectionMs, CLOCK_CORRECT_INTERVAL_MS)) {
+        correctDrift();
+    }
+}
+
+uint32_t getClockSyncCount() {
+    portENTER_CRITICAL(&statusMux);
+    uint32_t count = syncCount;
+    portEXIT_CRITICAL(&statusMux);
+    return count;
+}
+
+bool getLastSyncResidualMs(int32_t& residualMs) {
+    portENTER_CRITICAL(&statusMux);
+    bool valid = hasResidual;
+    residualMs = lastResidualMs;
+    portEXIT_CRITICAL(&statusMux);
+    return valid;
+}
+
+ClockStatus getClockStatus() {
+    ClockStatus status;
+    portENTER_CRITICAL(&statusMux);
+    status.isSet = samples > 0;
+    status.source = lastSource;
+    status.syncUncertaintyMs = lastSyncUncertaintyUs / 1000;
+    status.driftPpm = driftPpm;
+    status.uncertaintyPpm = uncertaintyPpm;
+    status.samples = samples;
+    int64_t lastSyncUs = lastSyncTimerUs;
+    status.hasResidual = hasResidual;
+    status.lastResidualMs = lastResidualMs;
+    portEXIT_CRITICAL(&statusMux);
+
+    status.sinceSyncS = status.isSet ? (esp_timer_get_time() - lastSyncUs) / 1000000 : 0;
+    // Sync error plus what the drift uncertainty allows to build up since
+    uint32_t driftErrorMs = status.uncertaintyPpm * status.sinceSyncS / 1000;
+    status.errorBoundMs = status.syncUncertaintyMs + driftErrorMs;
+    return status;
+}
+
+bool isClockSynced() {
+    ClockStatus status = getClockStatus();
+    return status.isSet && status.errorBoundMs < CLOCK_SYNCED_MAX_ERROR_MS;
+}
@@ -0,0 +1,114 @@
+#include "command_queue.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "debug_utils.h"
+#include "metrics.h"
+#include "trace.h"
+
+union CommandPayload {
+    FullConfig config;
+    ConfigPatch patch;
+    SystemSettingsPatch settings;
+};
+
+struct Command {
+    uint32_t id;
+    StateChangeType type;
+    CommandPayload payload;
+};
+
+struct CommandRecord {
+    uint32_t id;
+    CommandState state;
+};
+
+static QueueHandle_t queue = nullptr;
+static GenericStateUpdateCallback commandExecutor = nullptr;
+
+// History slot of a command is id % COMMAND_HISTORY; guarded by historyMux
+static CommandRecord history[COMMAND_HISTORY];
+static uint32_t nextId = 1;
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void setCommandState(uint32_t id, CommandState state) {
+    portENTER_CRITICAL(&historyMux);
+    CommandRecord& record = history[id % COMMAND_HISTORY];
+    if(record.id == id) {
+        record.state = state;
+    }
+    portEXIT_CRITICAL(&historyMux);
+}
+
+void initCommandQueue(GenericStateUpdateCallback executor) {
+    commandExecutor = executor;
+    if(queue == nullptr) {
+        queue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(Command));
+    }
+}
+
+uint32_t enqueueCommand(StateChangeType type, const void* payload, size_t size) {
+    if(queue == nullptr || size > sizeof(CommandPayload)) {
+        return 0;
+    }
+
+    Command command;
+    command.type = type;
+    memcpy(&command.payload, payload, size);
+
+    // Recorded before sending so the loop task never sees a command without a record
+    portENTER_CRITICAL(&historyMux);
+    command.id = nextId++;
+    if(nextId == 0) {
+        nextId = 1; // 0 reports a full queue
+    }
+    history[command.id % COMMAND_HISTORY] = {command.id, COMMAND_QUEUED};
+    portEXIT_CRITICAL(&historyMux);
+
+    if(xQueueSend(queue, &command, 0) != pdTRUE) {
+        setCommandState(command.id, COMMAND_UNKNOWN);
+        countMetric(METRIC_COMMANDS_REJECTED);
+        LOG_W("Command queue full, rejected command type %d", (int)type);
+        return 0;
+    }
+    return command.id;
+}
+
+bool processCommands() {
+    Command command;
+    if(queue == nullptr || xQueueReceive(queue, &command, 0) != pdTRUE) {
+        return false;
+    }
+
+    unsigned long start = millis();
+    setCommandState(command.id, COMMAND_RUNNING);
+    traceBegin(TRACE_COMMAND, command.type);
+    if(commandExecutor != nullptr) {
+        commandExecutor(command.type, &command.payload);
+    }
+    traceEnd(TRACE_COMMAND, command.type);
+    setCommandState(command.id, COMMAND_DONE);
+    countMetric(METRIC_COMMANDS_RUN);
+    LOG_D("Command %u (type %d) done in %lu ms", (unsigned)command.id, (int)command.type, millis() - start);
+    return true;
+}
+
+CommandState getCommandState(uint32_t id) {
+    portENTER_CRITICAL(&historyMux);
+    const CommandRecord& record = history[id % COMMAND_HISTORY];
+    CommandState state = id != 0 && record.id == id ? record.state : COMMAND_UNKNOWN;
+    portEXIT_CRITICAL(&historyMux);
+    return state;
+}
+
+const char* commandStateName(CommandState state) {
+    switch(state) {
+    case COMMAND_QUEUED:
+        return "queued";
+    case COMMAND_RUNNING:
+        return "running";
+    case COMMAND_DONE:
+        return "done";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,86 @@
+#include "config_decoder.h"
+#include "json_utils.h" // for PASSWORD_MASK
+#include "json_stream.h"
+#include "cbor_stream.h"
+
+// Passwords are only replaced by a non-empty value that is not the mask sent by GET
+template<typename Cursor>
+static bool readPassword(Cursor& cur, char* target, size_t size, uint8_t field, uint8_t& fields) {
+    char value[PWD_MAX_LEN + 1];
+    bool isString;
+    if(!cur.readString(value, sizeof(value), isString)) {
+        return false;
+    }
+    if(strlen(value) > 0 && strcmp(value, PASSWORD_MASK) != 0) {
+        strlcpy(target, value, size);
+        fields |= field;
+    }
+    return true;
+}
+
+// Shared by the JSON and CBOR entry points; Cursor is a JsonCursor or a CborReader
+template<typename Cursor>
+static bool decodeSystemConfig(Cursor& cur, SystemSettings& settings, uint8_t& fields) {
+    SystemSettings decoded = settings;
+    decoded.internalSSID[0] = '\0'; // always replaced, empty when absent
+    uint8_t set = SYSTEM_FIELD_INTERNAL_SSID;
+
+    bool isString;
+    bool ok = forEachMember(cur, [&](const char* key, size_t keyLen) {
+        switch(keyHashN(key, keyLen)) {
+        case keyHash("internalSSID"):
+            return isKey(key, keyLen, "internalSSID")
+                       ? cur.readString(decoded.internalSSID, sizeof(decoded.internalSSID), isString)
+                       : cur.skipValue(1);
+        case keyHash("internalPW"):
+            if(!isKey(key, keyLen, "internalPW")) {
+                return cur.skipValue(1);
+            }
+            return readPassword(cur, decoded.internalPW, sizeof(decoded.internalPW), SYSTEM_FIELD_INTERNAL_PW, set);
+        case keyHash("externalSSID"):
+            if(!isKey(key, keyLen, "externalSSID")) {
+                return cur.skipValue(1);
+            }
+            set |= SYSTEM_FIELD_EXTERNAL_SSID;
+            return cur.readString(decoded.externalSSID, sizeof(decoded.externalSSID), isString);
+        case keyHash("externalPW"):
+            if(!isKey(key, keyLen, "externalPW")) {
+                return cur.skipValue(1);
+            }
+            return readPassword(cur, decoded.externalPW, sizeof(decoded.externalPW), SYSTEM_FIELD_EXTERNAL_PW, set);
+        default:
+            return cur.skipValue(1);
+        }
+    });
+    if(!ok || !cur.atEnd()) {
+        return false;
+    }
+    settings = decoded;
+    fields = set;
+    return true;
+}
+
+bool decodeSystemConfigJson(const char* json, size_t len, SystemSettings& settings, uint8_t& fields) {
+    JsonCursor cur(json, len);
+    return decodeSystemConfig(cur, settings, fields);
+}
+
+bool decodeSystemConfigCbor(const uint8_t* data, size_t len, SystemSettings& settings, uint8_t& fields) {
+    CborReader cur(data, len);
+    return decodeSystemConfig(cur, settings, fields);
+}
+
+void mergeSystemSettings(SystemSettings& dst, const SystemSettings& src, uint8_t fields) {
+    if(fields & SYSTEM_FIELD_INTERNAL_SSID) {
+        memcpy(dst.internalSSID, src.internalSSID, sizeof(dst.internalSSID));
+    }
+    if(fields & SYSTEM_FIELD_INTERNAL_PW) {
+        memcpy(dst.internalPW, src.internalPW, sizeof(dst.internalPW));
+    }
+    if(fields & SYSTEM_FIELD_EXTERNAL_SSID) {
+        memcpy(dst.externalSSID, src.externalSSID, sizeof(dst.externalSSID));
+    }
+    if(fields & SYSTEM_FIELD_EXTERNAL_PW) {
+        memcpy(dst.externalPW, src.externalPW, sizeof(dst.externalPW));
+    }
+}
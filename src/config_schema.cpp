@@ -0,0 +1,809 @@
+// Generated by scripts/generate_config.py from config_schema.json. Do not edit.
+#include "config_schema.h"
+#include "json_stream.h"
+#include "cbor_stream.h"
+
+#define CONFIG_STORAGE_MAGIC 0xC5
+
+static void putScalar(uint8_t*& p, uint32_t value, size_t width) {
+    for(size_t i = 0; i < width; i++) {
+        *p++ = (uint8_t)(value >> (8 * i));
+    }
+}
+
+// Little-endian; any stored width up to 4 bytes reads back, so scalars may be widened
+static uint32_t getScalar(const uint8_t* p, size_t width) {
+    uint32_t value = 0;
+    for(size_t i = 0; i < width && i < 4; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+static void defaultRGB(RGB& value) {
+    value.r = 255;
+    value.g = 255;
+    value.b = 255;
+}
+
+static bool validRGB(const RGB& value) {
+    (void)value;
+    return true;
+}
+
+static void writeRGB(JsonWriter& out, const RGB& value) {
+    out.raw("{\"r\":");
+    out.uint(value.r);
+    out.raw(",\"g\":");
+    out.uint(value.g);
+    out.raw(",\"b\":");
+    out.uint(value.b);
+    out.raw("}");
+}
+
+static void writeRGBCbor(CborWriter& out, const RGB& value) {
+    out.map(3);
+    out.text("r");
+    out.uint(value.r);
+    out.text("g");
+    out.uint(value.g);
+    out.text("b");
+    out.uint(value.b);
+}
+
+// Reads the members present in the object at the cursor and marks them in seen.
+// Cursor is a JsonCursor or a CborReader.
+template<typename Cursor>
+static bool readRGB(Cursor& cur, RGB& value, uint32_t& seen, int depth) {
+    return forEachMember(cur, [&](const char* key, size_t len) -> bool {
+        long v;
+        switch(keyHashN(key, len)) {
+        case keyHash("r"): {
+            if(!isKey(key, len, "r")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 0;
+            if(!cur.readRanged(0, 255, v)) {
+                return false;
+            }
+            value.r = (uint8_t)v;
+            return true;
+        }
+        case keyHash("g"): {
+            if(!isKey(key, len, "g")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 1;
+            if(!cur.readRanged(0, 255, v)) {
+                return false;
+            }
+            value.g = (uint8_t)v;
+            return true;
+        }
+        case keyHash("b"): {
+            if(!isKey(key, len, "b")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 2;
+            if(!cur.readRanged(0, 255, v)) {
+                return false;
+            }
+            value.b = (uint8_t)v;
+            return true;
+        }
+        default:
+            return cur.skipValue(depth + 1);
+        }
+    });
+}
+
+static void mergeRGB(RGB& target, const RGB& value, uint32_t seen) {
+    if(seen & (1u << 0)) {
+        target.r = value.r;
+    }
+    if(seen & (1u << 1)) {
+        target.g = value.g;
+    }
+    if(seen & (1u << 2)) {
+        target.b = value.b;
+    }
+}
+
+static void putRGB(uint8_t*& p, const RGB& value) {
+    putScalar(p, value.r, 1);
+    putScalar(p, value.g, 1);
+    putScalar(p, value.b, 1);
+}
+
+// Members are stored in declaration order; those beyond a shorter record keep their defaults
+static void getRGB(const uint8_t* p, size_t len, RGB& value) {
+    defaultRGB(value);
+    uint32_t v;
+    if(len >= 1) {
+        v = getScalar(p + 0, 1);
+        value.r = (uint8_t)v;
+    }
+    if(len >= 2) {
+        v = getScalar(p + 1, 1);
+        value.g = (uint8_t)v;
+    }
+    if(len >= 3) {
+        v = getScalar(p + 2, 1);
+        value.b = (uint8_t)v;
+    }
+}
+
+static void defaultAlarm(Alarm& value) {
+    value.day = 0;
+    value.hour = 0;
+    value.minute = 0;
+    value.active = false;
+}
+
+static bool validAlarm(const Alarm& value) {
+    return value.day <= 7 && value.hour <= 23 && value.minute <= 59;
+}
+
+static void writeAlarm(JsonWriter& out, const Alarm& value) {
+    out.raw("{\"day\":");
+    out.uint(value.day);
+    out.raw(",\"hour\":");
+    out.uint(value.hour);
+    out.raw(",\"minute\":");
+    out.uint(value.minute);
+    out.raw(",\"active\":");
+    out.boolean(value.active);
+    out.raw("}");
+}
+
+static void writeAlarmCbor(CborWriter& out, const Alarm& value) {
+    out.map(4);
+    out.text("day");
+    out.uint(value.day);
+    out.text("hour");
+    out.uint(value.hour);
+    out.text("minute");
+    out.uint(value.minute);
+    out.text("active");
+    out.boolean(value.active);
+}
+
+// Reads the members present in the object at the cursor and marks them in seen.
+// Cursor is a JsonCursor or a CborReader.
+template<typename Cursor>
+static bool readAlarm(Cursor& cur, Alarm& value, uint32_t& seen, long& index, int depth) {
+    return forEachMember(cur, [&](const char* key, size_t len) -> bool {
+        long v;
+        bool b;
+        switch(keyHashN(key, len)) {
+        case keyHash("day"): {
+            if(!isKey(key, len, "day")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 0;
+            if(!cur.readRanged(0, 7, v)) {
+                return false;
+            }
+            value.day = (uint8_t)v;
+            return true;
+        }
+        case keyHash("hour"): {
+            if(!isKey(key, len, "hour")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 1;
+            if(!cur.readRanged(0, 23, v)) {
+                return false;
+            }
+            value.hour = (uint8_t)v;
+            return true;
+        }
+        case keyHash("minute"): {
+            if(!isKey(key, len, "minute")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 2;
+            if(!cur.readRanged(0, 59, v)) {
+                return false;
+            }
+            value.minute = (uint8_t)v;
+            return true;
+        }
+        case keyHash("active"): {
+            if(!isKey(key, len, "active")) {
+                return cur.skipValue(depth + 1);
+            }
+            seen |= 1u << 3;
+            if(!cur.readBool(b)) {
+                return false;
+            }
+            value.active = b;
+            return true;
+        }
+        case keyHash("index"): {
+            if(!isKey(key, len, "index")) {
+                return cur.skipValue(depth + 1);
+            }
+            return cur.readInt(index);
+        }
+        default:
+            return cur.skipValue(depth + 1);
+        }
+    });
+}
+
+static void mergeAlarm(Alarm& target, const Alarm& value, uint32_t seen) {
+    if(seen & (1u << 0)) {
+        target.day = value.day;
+    }
+    if(seen & (1u << 1)) {
+        target.hour = value.hour;
+    }
+    if(seen & (1u << 2)) {
+        target.minute = value.minute;
+    }
+    if(seen & (1u << 3)) {
+        target.active = value.active;
+    }
+}
+
+// Elements beyond count are skipped, missing trailing elements keep their current value
+template<typename Cursor>
+static bool readAlarmArray(Cursor& cur, Alarm* items, size_t count, int depth) {
+    size_t i = 0;
+    return forEachElement(cur, [&]() -> bool {
+        if(i >= count) {
+            return cur.skipValue(depth + 1);
+        }
+        Alarm value;
+        defaultAlarm(value);
+        uint32_t seen = 0;
+        long index = -1;
+        if(!readAlarm(cur, value, seen, index, depth + 1)) {
+            return false;
+        }
+        items[i++] = value;
+        return true;
+    });
+}
+
+static void putAlarm(uint8_t*& p, const Alarm& value) {
+    putScalar(p, value.day, 1);
+    putScalar(p, value.hour, 1);
+    putScalar(p, value.minute, 1);
+    putScalar(p, value.active, 1);
+}
+
+// Members are stored in declaration order; those beyond a shorter record keep their defaults
+static void getAlarm(const uint8_t* p, size_t len, Alarm& value) {
+    defaultAlarm(value);
+    uint32_t v;
+    if(len >= 1) {
+        v = getScalar(p + 0, 1);
+        if(v <= 7) {
+            value.day = (uint8_t)v;
+        }
+    }
+    if(len >= 2) {
+        v = getScalar(p + 1, 1);
+        if(v <= 23) {
+            value.hour = (uint8_t)v;
+        }
+    }
+    if(len >= 3) {
+        v = getScalar(p + 2, 1);
+        if(v <= 59) {
+            value.minute = (uint8_t)v;
+        }
+    }
+    if(len >= 4) {
+        v = getScalar(p + 3, 1);
+        value.active = v != 0;
+    }
+}
+
+// Array records carry their element count and stride ahead of the elements
+static void getAlarmArray(const uint8_t* p, size_t len, Alarm* items, size_t count) {
+    if(len < 2) {
+        return;
+    }
+    size_t stored = p[0];
+    size_t stride = p[1];
+    for(size_t i = 0; i < stored && i < count && 2 + (i + 1) * stride <= len; i++) {
+        getAlarm(p + 2 + i * stride, stride, items[i]);
+    }
+}
+
+FullConfig defaultFullConfig() {
+    FullConfig config;
+    defaultRGB(config.color);
+    config.brightnessMode = 7;
+    config.colorMode = 1;
+    config.animationMode = 1;
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        defaultAlarm(config.alarms[i]);
+    }
+    config.goodNightDuration = 30;
+    config.alarmDuration = 30;
+    config.animationSpeed = 200;
+    config.lampGroup = false;
+    return config;
+}
+
+bool isValidFullConfig(const FullConfig& config) {
+    if(!validRGB(config.color)) {
+        return false;
+    }
+    if(!(config.brightnessMode <= 7)) {
+        return false;
+    }
+    if(!(config.colorMode <= 3)) {
+        return false;
+    }
+    if(!(config.animationMode <= 1)) {
+        return false;
+    }
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        if(!validAlarm(config.alarms[i])) {
+            return false;
+        }
+    }
+    if(!(config.goodNightDuration >= 1 && config.goodNightDuration <= 1440)) {
+        return false;
+    }
+    if(!(config.alarmDuration >= 1 && config.alarmDuration <= 1440)) {
+        return false;
+    }
+    if(!(config.animationSpeed >= 10 && config.animationSpeed <= 5000)) {
+        return false;
+    }
+    return true;
+}
+
+size_t encodeFullConfigJson(const FullConfig& config, char* buf, size_t size) {
+    JsonWriter out(buf, size);
+    out.raw("{\"override_color\":");
+    writeRGB(out, config.color);
+    out.raw(",\"colorMode\":");
+    out.uint(config.colorMode);
+    out.raw(",\"animationMode\":");
+    out.uint(config.animationMode);
+    out.raw(",\"alarms\":");
+    out.raw("[");
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        if(i > 0) {
+            out.raw(",");
+        }
+        writeAlarm(out, config.alarms[i]);
+    }
+    out.raw("]");
+    out.raw(",\"goodNightDuration\":");
+    out.uint(config.goodNightDuration);
+    out.raw(",\"alarmDuration\":");
+    out.uint(config.alarmDuration);
+    out.raw(",\"animationSpeed\":");
+    out.uint(config.animationSpeed);
+    out.raw(",\"lampGroup\":");
+    out.boolean(config.lampGroup);
+    out.raw("}");
+    return out.finish();
+}
+
+size_t encodeFullConfigCbor(const FullConfig& config, uint8_t* buf, size_t size) {
+    CborWriter out(buf, size);
+    out.map(8);
+    out.text("override_color");
+    writeRGBCbor(out, config.color);
+    out.text("colorMode");
+    out.uint(config.colorMode);
+    out.text("animationMode");
+    out.uint(config.animationMode);
+    out.text("alarms");
+    out.array(MAX_ALARMS);
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        writeAlarmCbor(out, config.alarms[i]);
+    }
+    out.text("goodNightDuration");
+    out.uint(config.goodNightDuration);
+    out.text("alarmDuration");
+    out.uint(config.alarmDuration);
+    out.text("animationSpeed");
+    out.uint(config.animationSpeed);
+    out.text("lampGroup");
+    out.boolean(config.lampGroup);
+    return out.finish();
+}
+
+template<typename Cursor>
+static bool decodeFullConfig(Cursor& cur, FullConfig& config) {
+    FullConfig decoded = config;
+    // Absent fields take their defaults, absent arrays keep their current elements
+    defaultRGB(decoded.color);
+    decoded.colorMode = 1;
+    decoded.animationMode = 1;
+    decoded.goodNightDuration = 30;
+    decoded.alarmDuration = 30;
+    decoded.animationSpeed = 200;
+    decoded.lampGroup = false;
+
+    bool ok = forEachMember(cur, [&](const char* key, size_t keyLen) -> bool {
+        long v;
+        bool b;
+        switch(keyHashN(key, keyLen)) {
+        case keyHash("override_color"): {
+            if(!isKey(key, keyLen, "override_color")) {
+                return cur.skipValue(1);
+            }
+            uint32_t seen = 0;
+            return readRGB(cur, decoded.color, seen, 1);
+        }
+        case keyHash("colorMode"): {
+            if(!isKey(key, keyLen, "colorMode")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readRanged(0, 3, v)) {
+                return false;
+            }
+            decoded.colorMode = (uint8_t)v;
+            return true;
+        }
+        case keyHash("animationMode"): {
+            if(!isKey(key, keyLen, "animationMode")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readRanged(0, 1, v)) {
+                return false;
+            }
+            decoded.animationMode = (uint8_t)v;
+            return true;
+        }
+        case keyHash("alarms"): {
+            if(!isKey(key, keyLen, "alarms")) {
+                return cur.skipValue(1);
+            }
+            return readAlarmArray(cur, decoded.alarms, MAX_ALARMS, 1);
+        }
+        case keyHash("goodNightDuration"): {
+            if(!isKey(key, keyLen, "goodNightDuration")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readRanged(1, 1440, v)) {
+                return false;
+            }
+            decoded.goodNightDuration = (uint16_t)v;
+            return true;
+        }
+        case keyHash("alarmDuration"): {
+            if(!isKey(key, keyLen, "alarmDuration")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readRanged(1, 1440, v)) {
+                return false;
+            }
+            decoded.alarmDuration = (uint16_t)v;
+            return true;
+        }
+        case keyHash("animationSpeed"): {
+            if(!isKey(key, keyLen, "animationSpeed")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readRanged(10, 5000, v)) {
+                return false;
+            }
+            decoded.animationSpeed = (uint16_t)v;
+            return true;
+        }
+        case keyHash("lampGroup"): {
+            if(!isKey(key, keyLen, "lampGroup")) {
+                return cur.skipValue(1);
+            }
+            if(!cur.readBool(b)) {
+                return false;
+            }
+            decoded.lampGroup = b;
+            return true;
+        }
+        default:
+            return cur.skipValue(1);
+        }
+    });
+    if(!ok || !cur.atEnd()) {
+        return false;
+    }
+    config = decoded;
+    return true;
+}
+
+bool decodeFullConfigJson(const char* json, size_t len, FullConfig& config) {
+    JsonCursor cur(json, len);
+    return decodeFullConfig(cur, config);
+}
+
+bool decodeFullConfigCbor(const uint8_t* data, size_t len, FullConfig& config) {
+    CborReader cur(data, len);
+    return decodeFullConfig(cur, config);
+}
+
+bool decodeFullConfigPatchJson(const char* json, size_t len, FullConfig& config, uint8_t& changedFields,
+                               FullConfigPatchMask& mask) {
+    // Work on a copy so an invalid value leaves the live config untouched
+    FullConfig patched = config;
+    uint8_t changed = 0;
+    FullConfigPatchMask set = {};
+
+    JsonCursor cur(json, len);
+    bool ok = forEachMember(cur, [&](const char* key, size_t keyLen) -> bool {
+        long v;
+        bool b;
+        // Unknown keys, and ones a patch cannot change such as the whole alarms array, fail the body
+        switch(keyHashN(key, keyLen)) {
+        case keyHash("override_color"): {
+            if(!isKey(key, keyLen, "override_color")) {
+                return false;
+            }
+            RGB value = patched.color;
+            uint32_t seen = 0;
+            if(!readRGB(cur, value, seen, 1)) {
+                return false;
+            }
+            patched.color = value;
+            set.color |= seen;
+            if(seen != 0) {
+                changed |= CONFIG_FIELD_COLOR;
+            }
+            return true;
+        }
+        case keyHash("colorMode"): {
+            if(!isKey(key, keyLen, "colorMode")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_COLOR;
+            set.colorMode = true;
+            if(!cur.readRanged(0, 3, v)) {
+                return false;
+            }
+            patched.colorMode = (uint8_t)v;
+            return true;
+        }
+        case keyHash("animationMode"): {
+            if(!isKey(key, keyLen, "animationMode")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_ANIMATION;
+            set.animationMode = true;
+            if(!cur.readRanged(0, 1, v)) {
+                return false;
+            }
+            patched.animationMode = (uint8_t)v;
+            return true;
+        }
+        case keyHash("alarm"): {
+            if(!isKey(key, keyLen, "alarm")) {
+                return false;
+            }
+            Alarm value;
+            defaultAlarm(value);
+            uint32_t seen = 0;
+            long index = -1;
+            if(!readAlarm(cur, value, seen, index, 1) || index < 0 || index >= MAX_ALARMS) {
+                return false;
+            }
+            mergeAlarm(patched.alarms[index], value, seen);
+            set.alarms[index] |= seen;
+            changed |= CONFIG_FIELD_ALARMS;
+            return true;
+        }
+        case keyHash("goodNightDuration"): {
+            if(!isKey(key, keyLen, "goodNightDuration")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_DURATIONS;
+            set.goodNightDuration = true;
+            if(!cur.readRanged(1, 1440, v)) {
+                return false;
+            }
+            patched.goodNightDuration = (uint16_t)v;
+            return true;
+        }
+        case keyHash("alarmDuration"): {
+            if(!isKey(key, keyLen, "alarmDuration")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_DURATIONS;
+            set.alarmDuration = true;
+            if(!cur.readRanged(1, 1440, v)) {
+                return false;
+            }
+            patched.alarmDuration = (uint16_t)v;
+            return true;
+        }
+        case keyHash("animationSpeed"): {
+            if(!isKey(key, keyLen, "animationSpeed")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_ANIMATION;
+            set.animationSpeed = true;
+            if(!cur.readRanged(10, 5000, v)) {
+                return false;
+            }
+            patched.animationSpeed = (uint16_t)v;
+            return true;
+        }
+        case keyHash("lampGroup"): {
+            if(!isKey(key, keyLen, "lampGroup")) {
+                return false;
+            }
+            changed |= CONFIG_FIELD_LAMP_GROUP;
+            set.lampGroup = true;
+            if(!cur.readBool(b)) {
+                return false;
+            }
+            patched.lampGroup = b;
+            return true;
+        }
+        default:
+            return false;
+        }
+    });
+    if(!ok || !cur.atEnd()) {
+        return false;
+    }
+    config = patched;
+    changedFields = changed;
+    mask = set;
+    return true;
+}
+
+void mergeFullConfigPatch(FullConfig& dst, const FullConfig& src, const FullConfigPatchMask& mask) {
+    mergeRGB(dst.color, src.color, mask.color);
+    if(mask.colorMode) {
+        dst.colorMode = src.colorMode;
+    }
+    if(mask.animationMode) {
+        dst.animationMode = src.animationMode;
+    }
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        mergeAlarm(dst.alarms[i], src.alarms[i], mask.alarms[i]);
+    }
+    if(mask.goodNightDuration) {
+        dst.goodNightDuration = src.goodNightDuration;
+    }
+    if(mask.alarmDuration) {
+        dst.alarmDuration = src.alarmDuration;
+    }
+    if(mask.animationSpeed) {
+        dst.animationSpeed = src.animationSpeed;
+    }
+    if(mask.lampGroup) {
+        dst.lampGroup = src.lampGroup;
+    }
+}
+
+size_t encodeFullConfigStorage(const FullConfig& config, uint8_t* buf, size_t size) {
+    if(size < FULL_CONFIG_STORAGE_MAX) {
+        return 0;
+    }
+    uint8_t* p = buf;
+    *p++ = CONFIG_STORAGE_MAGIC;
+    *p++ = CONFIG_SCHEMA_VERSION;
+    *p++ = 1; // color
+    *p++ = 3;
+    putRGB(p, config.color);
+    *p++ = 2; // brightnessMode
+    *p++ = 1;
+    putScalar(p, config.brightnessMode, 1);
+    *p++ = 3; // colorMode
+    *p++ = 1;
+    putScalar(p, config.colorMode, 1);
+    *p++ = 4; // animationMode
+    *p++ = 1;
+    putScalar(p, config.animationMode, 1);
+    *p++ = 5; // alarms
+    *p++ = 2 + MAX_ALARMS * 4;
+    *p++ = MAX_ALARMS;
+    *p++ = 4;
+    for(size_t i = 0; i < MAX_ALARMS; i++) {
+        putAlarm(p, config.alarms[i]);
+    }
+    *p++ = 6; // goodNightDuration
+    *p++ = 2;
+    putScalar(p, config.goodNightDuration, 2);
+    *p++ = 7; // alarmDuration
+    *p++ = 2;
+    putScalar(p, config.alarmDuration, 2);
+    *p++ = 8; // animationSpeed
+    *p++ = 2;
+    putScalar(p, config.animationSpeed, 2);
+    *p++ = 9; // lampGroup
+    *p++ = 1;
+    putScalar(p, config.lampGroup, 1);
+    return p - buf;
+}
+
+bool decodeFullConfigStorage(const uint8_t* data, size_t len, FullConfig& config) {
+    if(len < 2 || data[0] != CONFIG_STORAGE_MAGIC) {
+        return false;
+    }
+    FullConfig decoded = defaultFullConfig();
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + len;
+    while(end - p >= 2) {
+        uint8_t id = p[0];
+        size_t size = p[1];
+        const uint8_t* value = p + 2;
+        if((size_t)(end - value) < size) {
+            return false;
+        }
+        uint32_t v;
+        switch(id) {
+        case 1: // color
+            getRGB(value, size, decoded.color);
+            break;
+        case 2: // brightnessMode
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v <= 7) {
+                    decoded.brightnessMode = (uint8_t)v;
+                }
+            }
+            break;
+        case 3: // colorMode
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v <= 3) {
+                    decoded.colorMode = (uint8_t)v;
+                }
+            }
+            break;
+        case 4: // animationMode
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v <= 1) {
+                    decoded.animationMode = (uint8_t)v;
+                }
+            }
+            break;
+        case 5: // alarms
+            getAlarmArray(value, size, decoded.alarms, MAX_ALARMS);
+            break;
+        case 6: // goodNightDuration
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v >= 1 && v <= 1440) {
+                    decoded.goodNightDuration = (uint16_t)v;
+                }
+            }
+            break;
+        case 7: // alarmDuration
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v >= 1 && v <= 1440) {
+                    decoded.alarmDuration = (uint16_t)v;
+                }
+            }
+            break;
+        case 8: // animationSpeed
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                if(v >= 10 && v <= 5000) {
+                    decoded.animationSpeed = (uint16_t)v;
+                }
+            }
+            break;
+        case 9: // lampGroup
+            if(size >= 1 && size <= 4) {
+                v = getScalar(value, size);
+                decoded.lampGroup = v != 0;
+            }
+            break;
+        default:
+            break; // field removed from the schema
+        }
+        p = value + size;
+    }
+    if(p != end) {
+        return false;
+    }
+    config = decoded;
+    return true;
+}
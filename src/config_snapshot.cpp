@@ -0,0 +1,79 @@
+#include "config_snapshot.h"
+#include <atomic>
+
+struct ConfigSlot {
+    FullConfig config;
+    uint32_t generation;
+    std::atomic<uint16_t> readers;
+};
+
+static ConfigSlot slots[CONFIG_SNAPSHOT_SLOTS];
+static std::atomic<uint8_t> currentSlot(0);
+static portMUX_TYPE writerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// All accesses are sequentially consistent: a reader's pin and a writer's check of
+// that pin must not be reordered against the current slot index.
+ConfigReader::ConfigReader() {
+    for(;;) {
+        uint8_t slot = currentSlot.load();
+        slots[slot].readers.fetch_add(1);
+        // Still current after pinning, so no writer can pick the slot until we unpin
+        if(currentSlot.load() == slot) {
+            _slot = slot;
+            break;
+        }
+        slots[slot].readers.fetch_sub(1);
+    }
+    _config = &slots[_slot].config;
+    _generation = slots[_slot].generation;
+}
+
+ConfigReader::~ConfigReader() {
+    slots[_slot].readers.fetch_sub(1);
+}
+
+static void replaceConfig(FullConfig& config, const void* context) {
+    config = *static_cast<const FullConfig*>(context);
+}
+
+uint32_t updateConfig(ConfigUpdater updater, const void* context) {
+    for(;;) {
+        portENTER_CRITICAL(&writerMux);
+        uint8_t current = currentSlot.load();
+        for(uint8_t i = 1; i < CONFIG_SNAPSHOT_SLOTS; i++) {
+            uint8_t next = (current + i) % CONFIG_SNAPSHOT_SLOTS;
+            if(slots[next].readers.load() != 0) {
+                continue;
+            }
+            slots[next].config = slots[current].config;
+            updater(slots[next].config, context);
+            uint32_t generation = slots[current].generation + 1;
+            slots[next].generation = generation;
+            currentSlot.store(next);
+            portEXIT_CRITICAL(&writerMux);
+            return generation;
+        }
+        portEXIT_CRITICAL(&writerMux);
+        delay(1); // every spare slot is pinned, readers only hold them for one response
+    }
+}
+
+uint32_t publishConfig(const FullConfig& config) {
+    return updateConfig(replaceConfig, &config);
+}
+
+static SystemSettings systemSettings;
+static portMUX_TYPE systemSettingsMux = portMUX_INITIALIZER_UNLOCKED;
+
+void publishSystemSettings(const SystemSettings& settings) {
+    portENTER_CRITICAL(&systemSettingsMux);
+    systemSettings = settings;
+    portEXIT_CRITICAL(&systemSettingsMux);
+}
+
+SystemSettings readSystemSettings() {
+    portENTER_CRITICAL(&systemSettingsMux);
+    SystemSettings copy = systemSettings;
+    portEXIT_CRITICAL(&systemSettingsMux);
+    return copy;
+}
@@ -1,14 +1,198 @@
 #include "debug_utils.h"
 #include <Arduino.h> // For Serial.println
+#include <atomic>
+#include <esp_timer.h>
 
 #define DEBUG // Keep this define here for debug_utils.cpp
 
-/**
- * @brief Prints a message to the serial port if DEBUG is enabled.
- * @param text The text to print.
- */
-void serialPrint(const String& text) {
+#define LOG_RING_SIZE 64    // power of two
+#define LOG_HISTORY_SIZE 32 // drained records kept for /logs
+#define LOG_LINE_MAX 160
+#define LOG_DRAIN_INTERVAL_MS 20
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1
+
+struct LogEntry {
+    uint32_t timestampUs;
+    const char* fmt;
+    uint8_t level;
+    uint8_t argc;
+    LogArgType types[LOG_MAX_ARGS];
+    uintptr_t args[LOG_MAX_ARGS];
+};
+
+// Bounded MPMC queue slot (Vyukov): sequence == position means free, position + 1 means filled
+struct LogSlot {
+    std::atomic<uint32_t> sequence;
+    LogEntry entry;
+};
+
+static LogSlot ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> ringHead(0);
+static uint32_t ringTail = 0; // only the drain task consumes
+static std::atomic<uint32_t> droppedRecords(0);
+static bool ringReady = false;
+
+static LogEntry history[LOG_HISTORY_SIZE];
+static uint32_t historyCount = 0;
+static portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char levelChars[] = {'-', 'E', 'W', 'I', 'D'};
+
+static void initRing() {
+    for(uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    ringReady = true;
+}
+
+void logWrite(uint8_t level, const char* fmt, const LogArg* args, uint8_t argc) {
+    if(!ringReady) {
+        initRing(); // first record may come from a static constructor before setup()
+    }
+    uint32_t pos = ringHead.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    for(;;) {
+        slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if(diff == 0) {
+            if(ringHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = ringHead.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogEntry& e = slot->entry;
+    e.timestampUs = (uint32_t)esp_timer_get_time();
+    e.fmt = fmt;
+    e.level = level;
+    e.argc = argc;
+    for(uint8_t i = 0; i < argc; i++) {
+        e.types[i] = args[i].type;
+        e.args[i] = args[i].bits;
+    }
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+static bool logRead(LogEntry& out) {
+    LogSlot* slot = &ring[ringTail & (LOG_RING_SIZE - 1)];
+    if(slot->sequence.load(std::memory_order_acquire) != ringTail + 1) {
+        return false;
+    }
+    out = slot->entry;
+    slot->sequence.store(ringTail + LOG_RING_SIZE, std::memory_order_release);
+    ringTail++;
+    return true;
+}
+
+// Expands the format one conversion at a time since argument types are only known at runtime
+static void formatEntry(const LogEntry& e, char* line, size_t size) {
+    size_t len = snprintf(line, size, "%lu.%03lu [%c] ", (unsigned long)(e.timestampUs / 1000000),
+                          (unsigned long)(e.timestampUs / 1000 % 1000), levelChars[e.level < 5 ? e.level : 0]);
+    const char* p = e.fmt;
+    uint8_t argIndex = 0;
+    while(*p && len < size - 1) {
+        if(*p != '%') {
+            line[len++] = *p++;
+            continue;
+        }
+        if(p[1] == '%') {
+            line[len++] = '%';
+            p += 2;
+            continue;
+        }
+        // Copy one conversion spec, e.g. "%5.2f"
+        char spec[12];
+        size_t specLen = 0;
+        do {
+            spec[specLen++] = *p++;
+        } while(*p && specLen < sizeof(spec) - 2 && !strchr("diuxXcsfgeEp", p[-1]));
+        spec[specLen] = '\0';
+
+        int written = 0;
+        if(argIndex >= e.argc) {
+            written = snprintf(line + len, size - len, "?");
+        } else {
+            uintptr_t bits = e.args[argIndex];
+            switch(e.types[argIndex]) {
+            case LOG_ARG_INT:
+                written = snprintf(line + len, size - len, spec, (int)bits);
+                break;
+            case LOG_ARG_UINT:
+                written = snprintf(line + len, size - len, spec, (unsigned int)bits);
+                break;
+            case LOG_ARG_FLOAT: {
+                uint32_t raw = (uint32_t)bits;
+                float f;
+                memcpy(&f, &raw, sizeof(f));
+                written = snprintf(line + len, size - len, spec, (double)f);
+                break;
+            }
+            case LOG_ARG_STR:
+                written = snprintf(line + len, size - len, spec, (const char*)bits);
+                break;
+            }
+            argIndex++;
+        }
+        if(written > 0) {
+            len += written;
+        }
+    }
+    if(len > size - 1) {
+        len = size - 1;
+    }
+    line[len] = '\0';
+}
+
+static void logTaskMain(void*) {
+    char line[LOG_LINE_MAX];
+    LogEntry e;
+    for(;;) {
+        while(logRead(e)) {
+            formatEntry(e, line, sizeof(line));
 #ifdef DEBUG
-    Serial.println(text);
+            Serial.println(line);
 #endif
-}
\ No newline at end of file
+            portENTER_CRITICAL(&historyMux);
+            history[historyCount % LOG_HISTORY_SIZE] = e;
+            historyCount++;
+            portEXIT_CRITICAL(&historyMux);
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+void initLogger() {
+    if(!ringReady) {
+        initRing();
+    }
+    xTaskCreate(logTaskMain, "logger", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, nullptr);
+}
+
+void printLogHistory(Print& out) {
+    static LogEntry snapshot[LOG_HISTORY_SIZE]; // only the async_tcp task serves /logs
+    portENTER_CRITICAL(&historyMux);
+    uint32_t count = historyCount;
+    memcpy(snapshot, history, sizeof(history));
+    portEXIT_CRITICAL(&historyMux);
+
+    uint32_t first = count > LOG_HISTORY_SIZE ? count - LOG_HISTORY_SIZE : 0;
+    char line[LOG_LINE_MAX];
+    for(uint32_t i = first; i < count; i++) {
+        formatEntry(snapshot[i % LOG_HISTORY_SIZE], line, sizeof(line));
+        out.println(line);
+    }
+    uint32_t dropped = getDroppedLogCount();
+    if(dropped > 0) {
+        out.printf("(%lu records dropped)\n", (unsigned long)dropped);
+    }
+}
+
+uint32_t getDroppedLogCount() {
+    return droppedRecords.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,140 @@
+#include "diagnostics.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "debug_utils.h"
+#include "led.h"
+#include "metrics.h"
+#include "system_utils.h"
+
+// Tasks whose stack headroom is tracked; add new tasks here (at most DIAG_MAX_TASKS)
+static const char* const monitoredTasks[] = {"loopTask", "async_tcp", "wifi", "tiT", "logger", "captive_dns",
+                                             "stall_watch"};
+static const size_t monitoredTaskCount = sizeof(monitoredTasks) / sizeof(monitoredTasks[0]);
+static_assert(monitoredTaskCount <= DIAG_MAX_TASKS, "raise DIAG_MAX_TASKS");
+
+// Written by the loop task, read by the async_tcp task; guarded by samplesMux
+static MemorySample samples[DIAG_HISTORY];
+static uint32_t sampleCount = 0;
+static MemorySample latest;
+static portMUX_TYPE samplesMux = portMUX_INITIALIZER_UNLOCKED;
+
+static MemorySample takeSample() {
+    MemorySample sample;
+    sample.uptimeS = millis() / 1000;
+    sample.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sample.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    for(size_t i = 0; i < DIAG_MAX_TASKS; i++) {
+        sample.stackHeadroom[i] = DIAG_TASK_ABSENT;
+    }
+    for(size_t i = 0; i < monitoredTaskCount; i++) {
+        // Looked up by name each time, tasks like captive_dns come and go.
+        // Stack units are bytes on the ESP32.
+        TaskHandle_t task = xTaskGetHandle(monitoredTasks[i]);
+        if(task != nullptr) {
+            UBaseType_t headroom = uxTaskGetStackHighWaterMark(task);
+            sample.stackHeadroom[i] = headroom < DIAG_TASK_ABSENT ? headroom : DIAG_TASK_ABSENT - 1;
+        }
+    }
+    return sample;
+}
+
+// Logs every crossed limit; true if any was crossed
+static bool checkLimits(const MemorySample& sample) {
+    bool low = false;
+    if(sample.freeHeap < DIAG_MIN_FREE_HEAP) {
+        LOG_W("Low heap: %u bytes free", (unsigned)sample.freeHeap);
+        low = true;
+    }
+    if(sample.largestFreeBlock < DIAG_MIN_LARGEST_BLOCK) {
+        LOG_W("Heap fragmented: largest free block %u bytes", (unsigned)sample.largestFreeBlock);
+        low = true;
+    }
+    for(size_t i = 0; i < monitoredTaskCount; i++) {
+        if(sample.stackHeadroom[i] < DIAG_MIN_STACK_HEADROOM) {
+            LOG_W("Task %s stack headroom %u bytes", monitoredTasks[i], (unsigned)sample.stackHeadroom[i]);
+            low = true;
+        }
+    }
+    return low;
+}
+
+void checkDiagnostics() {
+    static unsigned long lastCheckMs = 0;
+    static unsigned long lastSampleMs = 0;
+    static bool firstSample = true;
+    if(!isTimeForAction(&lastCheckMs, DIAG_CHECK_INTERVAL_MS)) {
+        return;
+    }
+
+    MemorySample sample = takeSample();
+    setMetric(METRIC_FREE_HEAP, sample.freeHeap);
+    setMetric(METRIC_LARGEST_FREE_BLOCK, sample.largestFreeBlock);
+    setMetric(METRIC_MIN_FREE_HEAP, sample.minFreeHeap);
+    bool keep = isTimeForAction(&lastSampleMs, DIAG_SAMPLE_INTERVAL_MS) || firstSample;
+    firstSample = false;
+
+    portENTER_CRITICAL(&samplesMux);
+    latest = sample;
+    if(keep) {
+        samples[sampleCount % DIAG_HISTORY] = sample;
+        sampleCount++;
+    }
+    portEXIT_CRITICAL(&samplesMux);
+
+    if(checkLimits(sample)) {
+        stay(255, 80, 0, 7, 1500); // orange for 1.5 seconds
+    }
+}
+
+MemorySample getLatestMemorySample() {
+    portENTER_CRITICAL(&samplesMux);
+    MemorySample sample = latest;
+    portEXIT_CRITICAL(&samplesMux);
+    return sample;
+}
+
+static void printSample(Print& out, const MemorySample& sample) {
+    out.printf("[%u,%u,%u,%u", (unsigned)sample.uptimeS, (unsigned)sample.freeHeap,
+               (unsigned)sample.largestFreeBlock, (unsigned)sample.minFreeHeap);
+    for(size_t i = 0; i < monitoredTaskCount; i++) {
+        if(sample.stackHeadroom[i] == DIAG_TASK_ABSENT) {
+            out.print(",null");
+        } else {
+            out.printf(",%u", (unsigned)sample.stackHeadroom[i]);
+        }
+    }
+    out.print("]");
+}
+
+void printMemoryStatsJson(Print& out) {
+    out.printf("{\"checkIntervalMs\":%u,\"sampleIntervalMs\":%u,", (unsigned)DIAG_CHECK_INTERVAL_MS,
+               (unsigned)DIAG_SAMPLE_INTERVAL_MS);
+    out.printf("\"limits\":{\"freeHeap\":%u,\"largestFreeBlock\":%u,\"stackHeadroom\":%u},",
+               (unsigned)DIAG_MIN_FREE_HEAP, (unsigned)DIAG_MIN_LARGEST_BLOCK, (unsigned)DIAG_MIN_STACK_HEADROOM);
+    // Row layout of "latest" and "samples"; stack columns are null while a task is not running
+    out.print("\"columns\":[\"uptimeS\",\"freeHeap\",\"largestFreeBlock\",\"minFreeHeap\"");
+    for(size_t i = 0; i < monitoredTaskCount; i++) {
+        out.printf(",\"stack:%s\"", monitoredTasks[i]);
+    }
+    out.print("],\"latest\":");
+    printSample(out, getLatestMemorySample());
+
+    out.print(",\"samples\":[");
+    portENTER_CRITICAL(&samplesMux);
+    uint32_t count = sampleCount;
+    portEXIT_CRITICAL(&samplesMux);
+    uint32_t first = count > DIAG_HISTORY ? count - DIAG_HISTORY : 0;
+    for(uint32_t i = first; i < count; i++) {
+        // Copied one row at a time; a row overwritten meanwhile just shows a newer sample
+        portENTER_CRITICAL(&samplesMux);
+        MemorySample sample = samples[i % DIAG_HISTORY];
+        portEXIT_CRITICAL(&samplesMux);
+        if(i != first) {
+            out.print(",");
+        }
+        printSample(out, sample);
+    }
+    out.print("]}");
+}
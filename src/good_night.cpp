@@ -43,7 +43,8 @@ byte getGoodNightBrightness(byte startBrightness, uint16_t durationMinutes) {
     }
     float progress = (float)elapsed / (float)durationMicros;
     byte result = startBrightness - (byte)(progress * startBrightness);
-    serialPrint("GoodNight Calc: Start=" + String(startBrightness) + " Elapsed=" + String((unsigned long)elapsed) + " Prog=" + String(progress) + " Res=" + String(result));
+    LOG_D("GoodNight Calc: Start=%u Elapsed=%lu Prog=%.2f Res=%u", startBrightness, (unsigned long)elapsed, progress,
+          result);
     return result;
 }
 
@@ -0,0 +1,178 @@
+#include "group_sync.h"
+
+#define BEACON_MAGIC_0 'L'
+#define BEACON_MAGIC_1 'G'
+#define BEACON_VERSION 1
+#define BEACON_FLAG_SYNCED 0x01
+#define BEACON_FLAG_LEADER 0x02
+
+size_t encodeGroupBeacon(const GroupBeacon& beacon, uint8_t* buf, size_t size) {
+    if(size < GROUP_BEACON_SIZE) {
+        return 0;
+    }
+    buf[0] = BEACON_MAGIC_0;
+    buf[1] = BEACON_MAGIC_1;
+    buf[2] = BEACON_VERSION;
+    buf[3] = (beacon.clockSynced ? BEACON_FLAG_SYNCED : 0) | (beacon.leader ? BEACON_FLAG_LEADER : 0);
+    for(int i = 0; i < 4; i++) {
+        buf[4 + i] = beacon.nodeId >> (24 - 8 * i);
+    }
+    uint64_t groupMs = (uint64_t)beacon.groupMs;
+    for(int i = 0; i < 8; i++) {
+        buf[8 + i] = groupMs >> (56 - 8 * i);
+    }
+    return GROUP_BEACON_SIZE;
+}
+
+bool decodeGroupBeacon(const uint8_t* data, size_t len, GroupBeacon& beacon) {
+    if(len < GROUP_BEACON_SIZE || data[0] != BEACON_MAGIC_0 || data[1] != BEACON_MAGIC_1
+       || data[2] != BEACON_VERSION) {
+        return false;
+    }
+    beacon.clockSynced = data[3] & BEACON_FLAG_SYNCED;
+    beacon.leader = data[3] & BEACON_FLAG_LEADER;
+    beacon.nodeId = 0;
+    for(int i = 0; i < 4; i++) {
+        beacon.nodeId = (beacon.nodeId << 8) | data[4 + i];
+    }
+    uint64_t groupMs = 0;
+    for(int i = 0; i < 8; i++) {
+        groupMs = (groupMs << 8) | data[8 + i];
+    }
+    beacon.groupMs = (int64_t)groupMs;
+    return true;
+}
+
+GroupSync::GroupSync(uint32_t nodeId) : _nodeId(nodeId), _clockSynced(false), _offsetMs(0) {
+    reset();
+}
+
+void GroupSync::reset() {
+    _peerCount = 0;
+    _leaderId = _nodeId;
+    _lastErrorMs = 0;
+    _elections = 0;
+    _steps = 0;
+    clearFilter();
+}
+
+void GroupSync::clearFilter() {
+    _filterCount = 0;
+    _filterNext = 0;
+}
+
+void GroupSync::onClockStep() {
+    _offsetMs = 0;
+    clearFilter();
+}
+
+void GroupSync::notePeer(const GroupBeacon& beacon, uint32_t nowMs) {
+    Peer* peer = nullptr;
+    for(uint8_t i = 0; i < _peerCount; i++) {
+        if(_peers[i].nodeId == beacon.nodeId) {
+            peer = &_peers[i];
+            break;
+        }
+    }
+    if(!peer) {
+        if(_peerCount == GROUP_MAX_PEERS) {
+            return; // a crowded group still agrees on the leader as long as it is among the first heard
+        }
+        peer = &_peers[_peerCount++];
+        peer->nodeId = beacon.nodeId;
+    }
+    peer->clockSynced = beacon.clockSynced;
+    peer->heardMs = nowMs;
+}
+
+void GroupSync::expirePeers(uint32_t nowMs) {
+    uint8_t kept = 0;
+    for(uint8_t i = 0; i < _peerCount; i++) {
+        if(nowMs - _peers[i].heardMs < GROUP_PEER_TIMEOUT_MS) {
+            _peers[kept++] = _peers[i];
+        }
+    }
+    _peerCount = kept;
+}
+
+// Every lamp applies the same ranking to what it hears, so they agree without a handshake
+void GroupSync::elect() {
+    uint32_t bestId = _nodeId;
+    bool bestSynced = _clockSynced;
+    for(uint8_t i = 0; i < _peerCount; i++) {
+        const Peer& peer = _peers[i];
+        if((peer.clockSynced && !bestSynced) || (peer.clockSynced == bestSynced && peer.nodeId < bestId)) {
+            bestId = peer.nodeId;
+            bestSynced = peer.clockSynced;
+        }
+    }
+    if(bestId != _leaderId) {
+        // The new leader took over the group time from the old one, the offset carries on
+        _leaderId = bestId;
+        _elections++;
+        clearFilter();
+    }
+}
+
+void GroupSync::onBeacon(const GroupBeacon& beacon, int64_t localMs, uint32_t nowMs) {
+    if(beacon.nodeId == _nodeId) {
+        return;
+    }
+    notePeer(beacon, nowMs);
+    elect();
+    if(beacon.nodeId != _leaderId) {
+        return;
+    }
+
+    // Leader minus own clock, less however long the beacon was under way
+    int64_t sample = beacon.groupMs - localMs;
+    _filter[_filterNext] = sample;
+    _filterNext = (_filterNext + 1) % GROUP_FILTER_SAMPLES;
+    if(_filterCount < GROUP_FILTER_SAMPLES) {
+        _filterCount++;
+    }
+    int64_t best = _filter[0];
+    for(uint8_t i = 1; i < _filterCount; i++) {
+        if(_filter[i] > best) {
+            best = _filter[i];
+        }
+    }
+
+    int64_t errorMs = best - _offsetMs;
+    if(errorMs > GROUP_STEP_MS || errorMs < -GROUP_STEP_MS) {
+        _offsetMs = sample;
+        _filter[0] = sample;
+        _filterCount = 1;
+        _filterNext = 1;
+        _lastErrorMs = 0;
+        _steps++;
+        return;
+    }
+    _offsetMs += errorMs / GROUP_SLEW_DIVISOR;
+    _lastErrorMs = (int32_t)errorMs;
+}
+
+void GroupSync::tick(uint32_t nowMs) {
+    expirePeers(nowMs);
+    elect();
+    if(!isLeader() || !_clockSynced) {
+        return; // an unsynced leader keeps the time it took over
+    }
+    // Slow enough for the followers to track within a frame
+    if(_offsetMs > GROUP_LEADER_SLEW_MS) {
+        _offsetMs -= GROUP_LEADER_SLEW_MS;
+    } else if(_offsetMs < -GROUP_LEADER_SLEW_MS) {
+        _offsetMs += GROUP_LEADER_SLEW_MS;
+    } else {
+        _offsetMs = 0;
+    }
+}
+
+GroupBeacon GroupSync::makeBeacon(int64_t localMs) const {
+    GroupBeacon beacon;
+    beacon.nodeId = _nodeId;
+    beacon.clockSynced = _clockSynced;
+    beacon.leader = isLeader();
+    beacon.groupMs = localMs + _offsetMs;
+    return beacon;
+}
@@ -0,0 +1,62 @@
+// The json_utils.h documents that need nothing but ArduinoJson, apart from json_utils.cpp so the
+// native benchmarks build them as well
+#include "json_utils.h"
+#include "config_decoder.h"
+#include "clock_service.h" // for timeSourceName
+
+void writeSystemConfigJson(JsonObject doc, const SystemSettings& systemSettings) {
+    doc["internalSSID"] = systemSettings.internalSSID;
+    doc["internalPW"] = strlen(systemSettings.internalPW) > 0 ? PASSWORD_MASK : "";
+    doc["externalSSID"] = systemSettings.externalSSID;
+    doc["externalPW"] = strlen(systemSettings.externalPW) > 0 ? PASSWORD_MASK : "";
+}
+
+String createSystemConfigJson(const SystemSettings& systemSettings) {
+    StaticJsonDocument<512> doc;
+    writeSystemConfigJson(doc.to<JsonObject>(), systemSettings);
+
+    String jsonResponse;
+    serializeJson(doc, jsonResponse);
+    return jsonResponse;
+}
+
+bool parseSystemConfigJson(const String& jsonString, SystemSettings& systemSettings, uint8_t& fields) {
+    return decodeSystemConfigJson(jsonString.c_str(), jsonString.length(), systemSettings, fields);
+}
+
+void writeWiFiStatusJson(JsonObject doc, const WiFiStatus& status) {
+    if(status.currentTime.length() == 0) {
+        doc["currentTime"] = nullptr;
+    } else {
+        doc["currentTime"] = status.currentTime;
+    }
+
+    doc["lastTestResult"] = (int)status.lastTestResult;
+    doc["timeSinceLastTestMs"] = status.timeSinceLastTestMs;
+    doc["timeSinceLastSucceededTestMs"] = status.timeSinceLastSucceededTestMs;
+    doc["lastStaConnectionTime"] = status.lastStaConnectionTime;
+    doc["systemTime"] = status.systemTime;
+    doc["clockSynced"] = status.clockSynced;
+    doc["staConfigValid"] = status.staConfigValid;
+    if(status.clockErrorMs < 0) {
+        doc["clockErrorMs"] = nullptr;
+    } else {
+        doc["clockErrorMs"] = status.clockErrorMs;
+    }
+    doc["clockDriftPpb"] = status.clockDriftPpb;
+    if(status.timeSource == TIME_SOURCE_NONE) {
+        doc["timeSource"] = nullptr;
+    } else {
+        doc["timeSource"] = timeSourceName(status.timeSource);
+        doc["timeAccuracyMs"] = status.timeAccuracyMs;
+    }
+}
+
+String createWiFiStatusJson(const WiFiStatus& status) {
+    StaticJsonDocument<512> doc;
+    writeWiFiStatusJson(doc.to<JsonObject>(), status);
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
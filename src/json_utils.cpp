@@ -1,172 +1,319 @@
 #include "json_utils.h"
+#include "captive_portal.h"
+#include "web_admission.h"
+#include "captive_dns.h"
+#include "radio_scheduler.h"
+#include "realtime_udp.h"
+#include "lamp_group.h"
+#include "link_power.h"
+#include "ota_update.h"
+#include "stall_watchdog.h"
+#include "trace.h"
+#include "wifi_scan.h"
 
 String createConfigJson(const FullConfig& config) {
-    StaticJsonDocument<2048> doc; // Adjust size if more data or complex structures are added
-
-    // Add RGB override color
-    JsonObject colorObj = doc.createNestedObject("override_color");
-    colorObj["r"] = config.color.r;
-    colorObj["g"] = config.color.g;
-    colorObj["b"] = config.color.b;
-
-    // Add color mode
-    // doc["selectedColorMode"] = 1; // Always active for frontend compatibility
-    doc["colorMode"] = config.colorMode;
-    doc["animationMode"] = config.animationMode;
-    doc["goodNightDuration"] = config.goodNightDuration;
-    doc["alarmDuration"] = config.alarmDuration;
-    doc["animationSpeed"] = config.animationSpeed;
-
-    // Add alarms array
-    JsonArray alarmsArray = doc.createNestedArray("alarms");
-    for(int i = 0; i < MAX_ALARMS; ++i) {
-        JsonObject alarmObj = alarmsArray.createNestedObject();
-        alarmObj["day"] = config.alarms[i].day;
-        alarmObj["hour"] = config.alarms[i].hour;
-        alarmObj["minute"] = config.alarms[i].minute;
-        alarmObj["active"] = config.alarms[i].active;
-    }
-
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    return jsonResponse;
+    char json[FULL_CONFIG_JSON_MAX];
+    encodeFullConfigJson(config, json, sizeof(json));
+    return String(json);
 }
 
 bool parseConfigJson(const String& jsonString, FullConfig& config) {
-    StaticJsonDocument<2048> doc; // Adjust size if more data or complex structures are added
+    // Generated single pass decoder, see config_schema.json
+    return decodeFullConfigJson(jsonString.c_str(), jsonString.length(), config);
+}
 
-    DeserializationError error = deserializeJson(doc, jsonString);
-    if(error) {
-        // Handle deserialization error (e.g., print to serial)
-        // For now, just return false. Consider adding a serialPrint if needed
-        // and accessible.
-        return false;
-    }
+bool parseConfigPatchJson(const String& jsonString, FullConfig& config, uint8_t& changedFields,
+                          FullConfigPatchMask& mask) {
+    return decodeFullConfigPatchJson(jsonString.c_str(), jsonString.length(), config, changedFields, mask);
+}
 
-    // Parse RGB override color
-    JsonObject colorObj = doc["override_color"];
-    if(!colorObj.isNull()) {
-        config.color.r = colorObj["r"] | 0; // Use | 0 for default if key missing
-        config.color.g = colorObj["g"] | 0;
-        config.color.b = colorObj["b"] | 0;
-    } else {
-        config.color.r = 0; // Use | 0 for default if key missing
-        config.color.g = 0;
-        config.color.b = 0;
+String createProbeStatsJson() {
+    StaticJsonDocument<512> doc;
+
+    for(int i = 0; i < PROBE_COUNT; i++) {
+        CaptiveProbe probe = static_cast<CaptiveProbe>(i);
+        doc[getCaptiveProbeName(probe)] = getCaptiveProbeCount(probe);
     }
 
-    // Parse color mode
-    if(doc.containsKey("colorMode")) {
-        config.colorMode = doc["colorMode"];
-    } else {
-        config.colorMode = 1; // Default to Neutral White if not present
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createAdmissionStatsJson() {
+    StaticJsonDocument<512> doc;
+    AdmissionStats stats = getAdmissionStats();
+
+    doc["admitted"] = stats.admitted;
+    doc["rejectedLowHeap"] = stats.rejectedLowHeap;
+    doc["rejectedBusy"] = stats.rejectedBusy;
+    doc["rejectedRateLimited"] = stats.rejectedRateLimited;
+    doc["inFlight"] = stats.inFlight;
+    doc["peakInFlight"] = stats.peakInFlight;
+    doc["maxInFlight"] = stats.maxInFlight;
+    doc["freeHeap"] = stats.freeHeap;
+    doc["minFreeHeap"] = stats.minFreeHeap;
+    doc["largestFreeBlock"] = stats.largestFreeBlock;
+    doc["minLargestFreeBlock"] = stats.minLargestFreeBlock;
+    doc["lowHeapThreshold"] = stats.lowHeapThreshold;
+    doc["heapHeadroom"] = (long)stats.largestFreeBlock - (long)stats.lowHeapThreshold;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createDnsStatsJson() {
+    StaticJsonDocument<256> doc;
+    DnsStats stats = getDnsStats();
+
+    doc["running"] = stats.running;
+    doc["queries"] = stats.queries;
+    doc["dropped"] = stats.dropped;
+    doc["queriesPerSec"] = stats.queriesPerSec;
+    doc["p50LatencyUs"] = stats.p50LatencyUs;
+    doc["p90LatencyUs"] = stats.p90LatencyUs;
+    doc["p99LatencyUs"] = stats.p99LatencyUs;
+    doc["p50WaitUs"] = stats.p50WaitUs;
+    doc["p99WaitUs"] = stats.p99WaitUs;
+    doc["maxBatch"] = stats.maxBatch;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createStallReportJson() {
+    StaticJsonDocument<384> doc;
+    StallReport report = getStallReport();
+
+    doc["resetReason"] = report.resetReason;
+    doc["budgetMs"] = report.budgetMs;
+    doc["resetAfterMs"] = report.resetAfterMs;
+    doc["stalls"] = report.stalls;
+    if(report.stalls > 0) {
+        doc["lastPhase"] = loopPhaseName(report.lastPhase);
+        doc["lastDurationMs"] = report.lastDurationMs;
     }
-    if(doc.containsKey("animationMode")) {
-        config.animationMode = doc["animationMode"];
+    if(report.hasPrevious) {
+        JsonObject previous = doc.createNestedObject("previousBoot");
+        previous["stalls"] = report.previousStalls;
+        previous["phase"] = loopPhaseName(report.previousPhase);
+        previous["durationMs"] = report.previousDurationMs;
+        previous["uptimeS"] = report.previousUptimeS;
+        previous["escalated"] = report.previousEscalated;
     } else {
-        config.animationMode = 1; // Default to Neutral White if not present
+        doc["previousBoot"] = nullptr;
     }
 
-    if(doc.containsKey("goodNightDuration")) {
-        config.goodNightDuration = doc["goodNightDuration"];
-    } else {
-        config.goodNightDuration = 30; // Default 30 min
-    }
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createRadioStatsJson() {
+    StaticJsonDocument<768> doc;
+    RadioStats stats = getRadioStats();
 
-    if(doc.containsKey("alarmDuration")) {
-        config.alarmDuration = doc["alarmDuration"];
+    doc["mode"] = radioModeName(stats.mode);
+    doc["syncIntervalS"] = stats.syncIntervalS;
+    doc["nextWindowInS"] = stats.nextWindowInS;
+    if(stats.hasCorrection) {
+        doc["lastCorrectionMs"] = stats.lastCorrectionMs;
     } else {
-        config.alarmDuration = 30; // Default 30 min
+        doc["lastCorrectionMs"] = nullptr;
+    }
+    doc["windows"] = stats.windows;
+    doc["syncedWindows"] = stats.syncedWindows;
+    doc["onTodayS"] = stats.onTodayS;
+    JsonArray days = doc.createNestedArray("onPreviousDaysS"); // most recent first
+    for(uint8_t i = 0; i < stats.days; i++) {
+        days.add(stats.onDayS[i]);
     }
 
-    if(doc.containsKey("animationSpeed")) {
-        config.animationSpeed = doc["animationSpeed"];
+    LinkPowerStats link = getLinkPowerStats();
+    JsonObject power = doc.createNestedObject("link");
+    power["txPowerDbm"] = link.txPowerDbm;
+    if(link.linked) {
+        power["rssiDbm"] = link.rssiDbm;
     } else {
-        config.animationSpeed = 200; // Default speed
+        power["rssiDbm"] = nullptr;
     }
+    power["apClients"] = link.apClients;
+    power["modemSleep"] = link.modemSleep;
+    power["txSavedMa"] = link.txSavedMa;
+    power["sleepSavedMa"] = link.sleepSavedMa;
 
-    // Parse alarms array
-    JsonArray alarmsArray = doc["alarms"].as<JsonArray>();
-    if(!alarmsArray.isNull()) {
-        int i = 0;
-        for(JsonObject alarmObj : alarmsArray) {
-            if(i < MAX_ALARMS) {
-                config.alarms[i].day = alarmObj["day"] | 0;
-                config.alarms[i].hour = alarmObj["hour"] | 0;
-                config.alarms[i].minute = alarmObj["minute"] | 0;
-                config.alarms[i].active = alarmObj["active"] | false;
-                i++;
-            }
-        }
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createWifiScanJson() {
+    StaticJsonDocument<JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(WIFI_SCAN_MAX_RESULTS)
+                       + WIFI_SCAN_MAX_RESULTS * JSON_OBJECT_SIZE(4)>
+        doc;
+    WifiScanResults results = getWifiScanResults();
+
+    doc["scanning"] = results.scanning;
+    if(results.valid) {
+        doc["ageS"] = results.ageMs / 1000;
     } else {
-        // Handle missing alarms array if needed, or assume defaults are fine
+        doc["ageS"] = nullptr;
+    }
+    JsonArray networks = doc.createNestedArray("networks");
+    for(uint8_t i = 0; i < results.count; i++) {
+        const WifiNetwork& network = results.networks[i];
+        JsonObject entry = networks.createNestedObject();
+        entry["ssid"] = (const char*)network.ssid; // stored as a pointer, results outlive the document
+        entry["rssi"] = network.rssi;
+        entry["channel"] = network.channel;
+        entry["auth"] = wifiAuthName(network.auth);
     }
 
-    return true;
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
 }
 
-String createWiFiStatusJson(const WiFiStatus& status) {
-    StaticJsonDocument<512> doc;
+String createOtaStatusJson() {
+    StaticJsonDocument<256> doc;
+    OtaStatus status = getOtaStatus();
 
-    if(status.currentTime.isEmpty()) {
-        doc["currentTime"] = nullptr;
+    doc["state"] = otaStateName(status.state);
+    doc["target"] = otaTargetName(status.target);
+    doc["written"] = status.written;
+    doc["total"] = status.total;
+    doc["rateKBps"] = status.rateKBps;
+    if(status.error != nullptr) {
+        doc["error"] = status.error;
     } else {
-        doc["currentTime"] = status.currentTime;
+        doc["error"] = nullptr;
     }
+    doc["pendingVerify"] = status.pendingVerify;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
+
+String createRealtimeStatsJson(bool reset) {
+    StaticJsonDocument<384> doc;
+    RealtimeStats stats = getRealtimeStats(reset);
 
-    doc["lastTestResult"] = (int)status.lastTestResult;
-    doc["timeSinceLastTestMs"] = status.timeSinceLastTestMs;
-    doc["timeSinceLastSucceededTestMs"] = status.timeSinceLastSucceededTestMs;
-    doc["lastStaConnectionTime"] = status.lastStaConnectionTime;
-    doc["systemTime"] = status.systemTime;
-    doc["clockSynced"] = status.clockSynced;
-    doc["staConfigValid"] = status.staConfigValid;
+    doc["running"] = stats.running;
+    doc["active"] = stats.active;
+    doc["packets"] = stats.packets;
+    doc["frames"] = stats.frames;
+    doc["dropped"] = stats.dropped;
+    doc["lost"] = stats.lost;
+    doc["superseded"] = stats.superseded;
+    doc["timeouts"] = stats.timeouts;
+    doc["p50LatencyUs"] = stats.p50LatencyUs;
+    doc["p99LatencyUs"] = stats.p99LatencyUs;
+    doc["maxLatencyUs"] = stats.maxLatencyUs;
 
     String jsonString;
     serializeJson(doc, jsonString);
     return jsonString;
 }
 
-String createSystemConfigJson(const SystemSettings& systemSettings) {
-    StaticJsonDocument<512> doc;
+String createLampGroupJson() {
+    StaticJsonDocument<384> doc;
+    LampGroupStats stats = getLampGroupStats();
+    char nodeId[9];
+    char leaderId[9];
+    snprintf(nodeId, sizeof(nodeId), "%08x", (unsigned)stats.nodeId);
+    snprintf(leaderId, sizeof(leaderId), "%08x", (unsigned)stats.leaderId);
 
-    doc["internalSSID"] = systemSettings.internalSSID;
-    doc["internalPW"] = strlen(systemSettings.internalPW) > 0 ? PASSWORD_MASK : "";
-    doc["externalSSID"] = systemSettings.externalSSID;
-    doc["externalPW"] = strlen(systemSettings.externalPW) > 0 ? PASSWORD_MASK : "";
+    doc["enabled"] = stats.enabled;
+    doc["running"] = stats.running;
+    doc["nodeId"] = nodeId;
+    if(stats.running) {
+        doc["leaderId"] = leaderId;
+    } else {
+        doc["leaderId"] = nullptr;
+    }
+    doc["leader"] = stats.leader;
+    doc["locked"] = stats.locked;
+    doc["peers"] = stats.peers;
+    doc["offsetMs"] = stats.offsetMs;
+    doc["errorMs"] = stats.lastErrorMs;
+    doc["elections"] = stats.elections;
+    doc["steps"] = stats.steps;
+    doc["sent"] = stats.sent;
+    doc["received"] = stats.received;
+    doc["dropped"] = stats.dropped;
 
-    String jsonResponse;
-    serializeJson(doc, jsonResponse);
-    return jsonResponse;
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
 }
 
-bool parseSystemConfigJson(const String& jsonString, SystemSettings& systemSettings) {
-    StaticJsonDocument<512> doc;
+String createTimeProbeJson(double t1, double t2) {
+    StaticJsonDocument<64> doc;
+    doc["t1"] = t1;
+    doc["t2"] = t2;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
 
-    DeserializationError error = deserializeJson(doc, jsonString);
-    if(error) {
+bool parseTimeSyncJson(const String& jsonString, TimeSyncRequest& request) {
+    StaticJsonDocument<192> doc;
+    if(deserializeJson(doc, jsonString)) {
         return false;
     }
+    if(!doc["t0"].is<double>() || !doc["t1"].is<double>() || !doc["t2"].is<double>() || !doc["t3"].is<double>()) {
+        return false;
+    }
+    request.t0 = doc["t0"];
+    request.t1 = doc["t1"];
+    request.t2 = doc["t2"];
+    request.t3 = doc["t3"];
+    request.hasTzOffset = doc["tzOffset"].is<int>();
+    request.tzOffsetMin = request.hasTzOffset ? doc["tzOffset"].as<int>() : 0;
+    return true;
+}
 
-    strlcpy(systemSettings.internalSSID, doc["internalSSID"] | "", sizeof(systemSettings.internalSSID));
+String createTimeSyncResultJson(bool applied, double offsetMs, double accuracyMs) {
+    StaticJsonDocument<96> doc;
+    doc["applied"] = applied;
+    doc["offsetMs"] = offsetMs; // lamp clock minus browser clock before the exchange
+    doc["accuracyMs"] = accuracyMs;
 
-    if(doc.containsKey("internalPW")) {
-        const char* internalPW = doc["internalPW"] | "";
-        if(strlen(internalPW) > 0 && strcmp(internalPW, PASSWORD_MASK) != 0) {
-            strlcpy(systemSettings.internalPW, internalPW, sizeof(systemSettings.internalPW));
-        }
-    }
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
 
-    if(doc.containsKey("externalSSID")) {
-        strlcpy(systemSettings.externalSSID, doc["externalSSID"] | "", sizeof(systemSettings.externalSSID));
-    }
+String createTraceStatusJson() {
+    StaticJsonDocument<96> doc;
+    doc["enabled"] = traceEnabled.load();
+    doc["events"] = getTraceEventCount();
+    doc["capacity"] = TRACE_RING_SIZE * portNUM_PROCESSORS;
 
-    if(doc.containsKey("externalPW")) {
-        const char* externalPW = doc["externalPW"] | "";
-        if(strlen(externalPW) > 0 && strcmp(externalPW, PASSWORD_MASK) != 0) {
-            strlcpy(systemSettings.externalPW, externalPW, sizeof(systemSettings.externalPW));
-        }
-    }
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
 
+bool parseTraceControlJson(const String& jsonString, bool& enabled) {
+    StaticJsonDocument<64> doc;
+    if(deserializeJson(doc, jsonString) || !doc["enabled"].is<bool>()) {
+        return false;
+    }
+    enabled = doc["enabled"];
     return true;
 }
+
+String createCommandStatusJson(uint32_t id, CommandState state) {
+    StaticJsonDocument<64> doc;
+    doc["commandId"] = id;
+    doc["state"] = commandStateName(state);
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    return jsonString;
+}
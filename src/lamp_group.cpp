@@ -0,0 +1,236 @@
+#include "lamp_group.h"
+#include <WiFi.h>
+#include <atomic>
+#include <lwip/sockets.h>
+#include <sys/time.h>
+#include "alarm.h"
+#include "clock_service.h"
+#include "debug_utils.h"
+#include "group_sync.h"
+#include "metrics.h"
+#include "system_utils.h"
+
+#define LAMP_GROUP_SELECT_TIMEOUT_MS 100
+#define LAMP_GROUP_TASK_STACK 3072
+#define LAMP_GROUP_TASK_PRIORITY 2 // above the loop, beacons are stamped as soon as they arrive
+#define LAMP_GROUP_PACKET_SIZE 64  // room for later protocol versions, which are dropped
+
+// The last four bytes of the factory MAC, unique per chip
+static uint32_t readNodeId() {
+    uint64_t mac = ESP.getEfuseMac();
+    return (uint32_t)(mac >> 16);
+}
+
+// Owned by the beacon task while it is alive, by the loop task otherwise
+static GroupSync groupSync(readNodeId());
+static uint32_t seenSyncCount = 0;
+static uint32_t seenElections = 0;
+static uint8_t packet[LAMP_GROUP_PACKET_SIZE];
+
+static volatile bool enabled = false;
+static volatile bool groupRunning = false;
+static volatile bool groupTaskAlive = false; // cleared by the task right before it deletes itself
+
+// Written by the owner of group, read by any task; guarded by statusMux
+static portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t publishedOffsetMs = 0;
+static LampGroupStats status = {};
+
+static std::atomic<uint32_t> sent(0);
+static std::atomic<uint32_t> received(0);
+static std::atomic<uint32_t> dropped(0);
+
+static int64_t localClockMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void publishStatus() {
+    uint32_t elections = groupSync.elections();
+    if(elections != seenElections) {
+        addMetric(METRIC_GROUP_ELECTIONS, elections - seenElections);
+        LOG_I("Lamp group leader is now %08x", (unsigned)groupSync.leaderId());
+    }
+    int32_t errorMs = groupSync.isLeader() ? 0 : groupSync.lastErrorMs();
+    setMetric(METRIC_GROUP_ERROR, errorMs);
+
+    portENTER_CRITICAL(&statusMux);
+    publishedOffsetMs = groupSync.offsetMs();
+    status.nodeId = groupSync.nodeId();
+    status.leaderId = groupSync.leaderId();
+    status.leader = groupSync.isLeader();
+    status.locked = groupSync.isLocked();
+    status.peers = groupSync.peerCount();
+    status.offsetMs = (int32_t)groupSync.offsetMs();
+    status.lastErrorMs = errorMs;
+    status.elections += elections - seenElections;
+    status.steps = groupSync.steps();
+    portEXIT_CRITICAL(&statusMux);
+    seenElections = elections;
+}
+
+// A stepped clock makes the offset meaningless; a follower takes it anew from the next beacon
+static void checkClockStep() {
+    uint32_t syncCount = getClockSyncCount();
+    if(syncCount != seenSyncCount) {
+        seenSyncCount = syncCount;
+        groupSync.onClockStep();
+        publishStatus();
+    }
+}
+
+static void receiveBeacons(int sock) {
+    while(true) {
+        int len = recvfrom(sock, packet, sizeof(packet), MSG_DONTWAIT, nullptr, nullptr);
+        if(len <= 0) {
+            break;
+        }
+        int64_t receivedMs = localClockMs();
+        GroupBeacon beacon;
+        if(!decodeGroupBeacon(packet, len, beacon)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if(beacon.nodeId == groupSync.nodeId()) {
+            continue; // our own, looped back
+        }
+        received.fetch_add(1, std::memory_order_relaxed);
+        groupSync.onBeacon(beacon, receivedMs, millis());
+    }
+}
+
+static void sendBeacon(int sock, const struct sockaddr_in& to) {
+    groupSync.setClockSynced(isClockSynced());
+    groupSync.tick(millis());
+    size_t len = encodeGroupBeacon(groupSync.makeBeacon(localClockMs()), packet, sizeof(packet));
+    if(sendto(sock, packet, len, 0, (const struct sockaddr*)&to, sizeof(to)) == (int)len) {
+        sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void groupTaskMain(void*) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(LAMP_GROUP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct ip_mreq membership = {};
+    membership.imr_multiaddr.s_addr = inet_addr(LAMP_GROUP_ADDRESS);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    uint8_t ttl = 1;
+    if(sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0
+       || setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0
+       || setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+        LOG_E("Lamp group: socket setup failed");
+        if(sock >= 0) {
+            close(sock);
+        }
+        groupRunning = false;
+        groupTaskAlive = false;
+        vTaskDelete(nullptr);
+        return;
+    }
+    struct sockaddr_in to = addr;
+    to.sin_addr.s_addr = membership.imr_multiaddr.s_addr;
+
+    unsigned long lastBeaconMs = millis() - GROUP_BEACON_INTERVAL_MS; // announce right away
+    while(groupRunning) {
+        checkClockStep();
+        if(isTimeForAction(&lastBeaconMs, GROUP_BEACON_INTERVAL_MS)) {
+            sendBeacon(sock, to);
+            publishStatus();
+        }
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        struct timeval timeout = {0, LAMP_GROUP_SELECT_TIMEOUT_MS * 1000};
+        if(select(sock + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        receiveBeacons(sock);
+        publishStatus();
+    }
+
+    close(sock);
+    groupTaskAlive = false;
+    vTaskDelete(nullptr);
+}
+
+static void startGroupTask() {
+    // A previous task may still be closing its socket
+    while(groupTaskAlive) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    groupSync.reset(); // peers of an earlier session are gone, the offset carries on
+    seenElections = 0;
+    groupRunning = true;
+    groupTaskAlive = true;
+    if(xTaskCreate(groupTaskMain, "lamp_group", LAMP_GROUP_TASK_STACK, nullptr, LAMP_GROUP_TASK_PRIORITY, nullptr)
+       != pdPASS) {
+        LOG_E("Lamp group: task creation failed");
+        groupRunning = false;
+        groupTaskAlive = false;
+        return;
+    }
+    LOG_I("Lamp group: beaconing as %08x", (unsigned)groupSync.nodeId());
+}
+
+void setLampGroupEnabled(bool enable) {
+    enabled = enable;
+}
+
+void lampGroupLoop() {
+    bool wanted = enabled && WiFi.isConnected();
+    if(wanted && !groupRunning) {
+        startGroupTask();
+    } else if(!wanted && groupRunning) {
+        // The task notices within LAMP_GROUP_SELECT_TIMEOUT_MS, closes the socket and deletes itself
+        groupRunning = false;
+    }
+    if(groupTaskAlive) {
+        return;
+    }
+    if(!enabled && groupSync.offsetMs() != 0) {
+        groupSync.onClockStep(); // back to the own clock
+        publishStatus();
+    }
+    checkClockStep();
+}
+
+bool lampGroupWantsRadio() {
+    static unsigned long lastCheckMs = 0;
+    static bool wants = false;
+    if(!enabled) {
+        return false;
+    }
+    if(isTimeForAction(&lastCheckMs, 1000)) {
+        long toAlarmMs = getMillisToNextAlarm();
+        wants = isAlarmActive() || (toAlarmMs >= 0 && toAlarmMs <= LAMP_GROUP_LEAD_MS);
+    }
+    return wants;
+}
+
+bool isLampGroupRunning() {
+    return groupRunning;
+}
+
+int64_t groupTimeMs() {
+    portENTER_CRITICAL(&statusMux);
+    int64_t offsetMs = publishedOffsetMs;
+    portEXIT_CRITICAL(&statusMux);
+    return localClockMs() + offsetMs;
+}
+
+LampGroupStats getLampGroupStats() {
+    portENTER_CRITICAL(&statusMux);
+    LampGroupStats copy = status;
+    portEXIT_CRITICAL(&statusMux);
+    copy.enabled = enabled;
+    copy.running = groupRunning;
+    copy.nodeId = groupSync.nodeId();
+    copy.sent = sent.load(std::memory_order_relaxed);
+    copy.received = received.load(std::memory_order_relaxed);
+    copy.dropped = dropped.load(std::memory_order_relaxed);
+    return copy;
+}
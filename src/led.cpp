@@ -2,6 +2,7 @@
 #include <Arduino.h>
 #include <WS2812FX.h>
 #include "debug_utils.h"
+#include "trace.h"
 
 // Structure to hold LED state
 struct LedState {
@@ -13,6 +14,7 @@ struct LedState {
 static LedState savedLedState;
 static bool isStayActive = false;
 static unsigned long stayEndMillis = 0;
+static bool realtimeActive = false; // a realtime stream owns the pixels
 
 #define LED_PIN 27
 #define LED_COUNT 1
@@ -31,14 +33,17 @@ void ledInit() {
 }
 
 void ledUpdate() {
-    ws2812fx.service();
+    uint32_t startUs = micros();
+    if(!realtimeActive && ws2812fx.service()) {
+        traceComplete(TRACE_LED_RENDER, startUs);
+    }
     if(isStayActive && millis() >= stayEndMillis) {
         restoreLedState();
     }
 }
 
 void setBrightness(uint8_t brightness) {
-    Serial.println("Setting brightness to " + String(brightness));
+    LOG_D("Setting brightness to %u", brightness);
     ws2812fx.setBrightness(brightness);
 }
 
@@ -61,21 +66,40 @@ void setAnimationMode(uint8_t mode) {
 }
 
 void setAnimationSpeed(uint16_t speed) {
-    Serial.println("Setting animation speed to " + String(speed));
+    LOG_D("Setting animation speed to %u", speed);
     ws2812fx.setSpeed(speed);
 }
 
 void nextEffect() {
     uint8_t mode = (ws2812fx.getMode() + 1) % ws2812fx.getModeCount();
     ws2812fx.setMode(mode);
-    Serial.println("Set effect to mode " + String(mode) + ": " + String(ws2812fx.getModeName(mode)));
+    LOG_D("Set effect to mode %u: %s", mode, (const char*)ws2812fx.getModeName(mode));
 }
 
 void previousEffect() {
     uint8_t mode = (ws2812fx.getMode() - 1 + ws2812fx.getModeCount()) % ws2812fx.getModeCount();
 
     ws2812fx.setMode(mode);
-    Serial.println("Set effect to mode " + String(mode) + ": " + String(ws2812fx.getModeName(mode)));
+    LOG_D("Set effect to mode %u: %s", mode, (const char*)ws2812fx.getModeName(mode));
+}
+
+void ledShowRealtime(const uint8_t* rgb, uint16_t pixels) {
+    uint32_t startUs = micros();
+    realtimeActive = true;
+    for(uint16_t i = 0; i < LED_COUNT; i++) {
+        if(i < pixels) {
+            ws2812fx.setPixelColor(i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+        } else {
+            ws2812fx.setPixelColor(i, 0);
+        }
+    }
+    ws2812fx.show();
+    traceComplete(TRACE_LED_RENDER, startUs);
+}
+
+void ledEndRealtime() {
+    realtimeActive = false;
+    ws2812fx.trigger(); // redraw at once instead of when the effect's timer runs out
 }
 
 /**
@@ -85,20 +109,19 @@ void previousEffect() {
 void setBrightnessLevel(uint8_t level) {
     if(level == 0) {
         if(ws2812fx.isRunning()) {
-            Serial.println("Stopping WS2812FX (brightness 0)");
+            LOG_D("Stopping WS2812FX (brightness 0)");
             ws2812fx.stop();
         }
     } else {
         if(!ws2812fx.isRunning()) {
-            Serial.println("Starting WS2812FX (brightness > 0)");
+            LOG_D("Starting WS2812FX (brightness > 0)");
             ws2812fx.start();
         }
     }
     static const uint8_t brightnessMap[8] = {0, 32, 64, 96, 128, 160, 200, 255};
     if(level > 7)
         level = 7;
-    Serial.println("Setting brightness level to " + String(level) + " (mapped to " + String(brightnessMap[level])
-                   + ")");
+    LOG_D("Setting brightness level to %u (mapped to %u)", level, brightnessMap[level]);
     setBrightness(brightnessMap[level]);
 }
 
@@ -110,7 +133,7 @@ uint8_t getEffectCount() {
     return ws2812fx.getModeCount();
 } */
 void restoreLedState() {
-    Serial.println("Restoring LED state after stay mode");
+    LOG_D("Restoring LED state after stay mode");
     ws2812fx.setColor(savedLedState.color);
     ws2812fx.setBrightness(savedLedState.brightness);
     ws2812fx.setMode(savedLedState.mode);
@@ -118,12 +141,13 @@ void restoreLedState() {
 }
 
 void stay(uint8_t r, uint8_t g, uint8_t b, uint8_t level, unsigned long timeMs) {
-    Serial.println("Setting stay mode: R" + String(r) + ",G" + String(g) + ",B" + String(b) + ", level " + String(level)
-                   + " for " + String(timeMs) + " ms");
-    // Save current state
-    savedLedState.color = ws2812fx.getColor();
-    savedLedState.brightness = ws2812fx.getBrightness();
-    savedLedState.mode = ws2812fx.getMode();
+    LOG_D("Setting stay mode: R%u,G%u,B%u, level %u for %lu ms", r, g, b, level, timeMs);
+    // Save current state, unless it is already another stay color
+    if(!isStayActive) {
+        savedLedState.color = ws2812fx.getColor();
+        savedLedState.brightness = ws2812fx.getBrightness();
+        savedLedState.mode = ws2812fx.getMode();
+    }
     isStayActive = true;
     stayEndMillis = millis() + timeMs;
 
@@ -0,0 +1,121 @@
+#include "link_power.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include "debug_utils.h"
+#include "lamp_group.h"
+#include "metrics.h"
+#include "system_utils.h"
+#include "tx_power_controller.h"
+
+// Loop task only
+static TxPowerController controller;
+static wifi_mode_t lastMode = WIFI_MODE_NULL;
+static int8_t appliedDbm = 0; // 0 forces the next apply
+static bool modemSleepOn = false;
+
+// Written by the loop task, read by the web task; guarded by statsMux
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static LinkPowerStats stats = {false, TX_POWER_MAX_DBM, 0, 0, false, 0, 0};
+
+// Weakest peer as heard here: the joined access point and every client of our AP
+static bool sampleWeakestRssi(int8_t& rssiDbm, uint8_t& apClients) {
+    bool found = false;
+    rssiDbm = 0;
+    if(WiFi.isConnected()) {
+        rssiDbm = WiFi.RSSI();
+        found = rssiDbm != 0;
+    }
+    apClients = 0;
+    wifi_sta_list_t list;
+    if((lastMode & WIFI_MODE_AP) && esp_wifi_ap_get_sta_list(&list) == ESP_OK) {
+        apClients = list.num;
+        for(int i = 0; i < list.num; i++) {
+            if(!found || list.sta[i].rssi < rssiDbm) {
+                rssiDbm = list.sta[i].rssi;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+static void applyTxPower(int8_t powerDbm) {
+    if(powerDbm == appliedDbm) {
+        return;
+    }
+    // In units of 0.25 dBm
+    if(esp_wifi_set_max_tx_power(powerDbm * 4) == ESP_OK) {
+        LOG_D("TX power %d dBm", (int)powerDbm);
+        appliedDbm = powerDbm;
+        setMetric(METRIC_TX_POWER, powerDbm);
+    }
+}
+
+static bool wantsModemSleep(wifi_mode_t mode) {
+    return modemSleepAllowed(mode == WIFI_MODE_STA, isLampGroupRunning());
+}
+
+static void applySleep(bool sleep) {
+    modemSleepOn = sleep;
+    WiFi.setSleep(sleep ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+}
+
+static void applyMode(wifi_mode_t mode) {
+    lastMode = mode;
+    controller.reset();
+    appliedDbm = 0;
+
+    portENTER_CRITICAL(&statsMux);
+    stats.linked = false;
+    stats.txPowerDbm = TX_POWER_MAX_DBM;
+    stats.apClients = 0;
+    stats.modemSleep = wantsModemSleep(mode);
+    stats.txSavedMa = 0;
+    stats.sleepSavedMa = stats.modemSleep ? MODEM_SLEEP_SAVED_MA : 0;
+    portEXIT_CRITICAL(&statsMux);
+    if(mode == WIFI_MODE_NULL) {
+        return;
+    }
+    applySleep(wantsModemSleep(mode));
+}
+
+void linkPowerLoop() {
+    static unsigned long lastRunMs = 0;
+    wifi_mode_t mode = WiFi.getMode();
+    if(mode != lastMode) {
+        applyMode(mode);
+    } else if(mode != WIFI_MODE_NULL && wantsModemSleep(mode) != modemSleepOn) {
+        applySleep(!modemSleepOn);
+    }
+    if(mode == WIFI_MODE_NULL || !isTimeForAction(&lastRunMs, LINK_POWER_INTERVAL_MS)) {
+        return;
+    }
+
+    int8_t rssiDbm;
+    uint8_t apClients;
+    bool linked = sampleWeakestRssi(rssiDbm, apClients);
+    if(linked) {
+        controller.update(rssiDbm);
+    } else {
+        // Nobody to measure; phones looking for the AP need to hear it from afar
+        controller.reset();
+    }
+    applyTxPower(controller.powerDbm());
+
+    portENTER_CRITICAL(&statsMux);
+    stats.linked = linked;
+    stats.txPowerDbm = controller.powerDbm();
+    stats.rssiDbm = linked ? controller.rssiDbm() : 0;
+    stats.apClients = apClients;
+    stats.modemSleep = modemSleepOn;
+    stats.txSavedMa = (TX_POWER_MAX_DBM - controller.powerDbm()) * TX_CURRENT_MA_PER_DB;
+    stats.sleepSavedMa = stats.modemSleep ? MODEM_SLEEP_SAVED_MA : 0;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+LinkPowerStats getLinkPowerStats() {
+    portENTER_CRITICAL(&statsMux);
+    LinkPowerStats copy = stats;
+    portEXIT_CRITICAL(&statsMux);
+    return copy;
+}
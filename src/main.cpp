@@ -8,8 +8,20 @@
 #include "button.h"
 #include "debug_utils.h" // For serialPrint
 #include "route_handlers.h"
+#include "config_decoder.h"
+#include "config_snapshot.h"
+#include "clock_service.h"
+#include "command_queue.h"
+#include "diagnostics.h"
+#include "metrics.h"
+#include "ota_update.h"
+#include "radio_scheduler.h"
+#include "realtime_udp.h"
+#include "stall_watchdog.h"
+#include "trace.h"
 /* #include "state.h" */
 #include "good_night.h"
+#include "lamp_group.h"
 #include "led.h"
 #include "store.h"
 #include "types.h"
@@ -20,7 +32,9 @@
 
 static std::vector<Route> apRoutes;
 
+// Loop-task copy of the published config snapshot, refreshed by syncConfig()
 static FullConfig appConfig;
+static uint32_t appliedConfigGeneration = 0;
 static SystemSettings systemSettings;
 static LampState lampState = LAMP_STATE_DEFAULT;
 static WiFiTestTracker wifiTracker;
@@ -32,13 +46,15 @@ void checkAndApplyColorMode(const FullConfig& config);
 void checkLampState();
 void onShortPress();
 void updateLed();
+void syncConfig();
 
 void setup() {
 #ifdef DEBUG
     Serial.begin(115200);
 #endif
+    initLogger();
     if(!LittleFS.begin()) {
-        Serial.println("LittleFS mount failed");
+        Serial.println("LittleFS mount failed, / serves the recovery page");
     }
 
     ensureConfigExistsAndResetIfNot();
@@ -48,10 +64,11 @@ void setup() {
         serialPrint("Using default configuration");
         appConfig = getDefaultFullConfig();
     }
+    appliedConfigGeneration = publishConfig(appConfig);
 
     ledInit();
     setBrightnessLevel(appConfig.brightnessMode);
-    serialPrint("Brightness set to: " + String(appConfig.brightnessMode));
+    LOG_I("Brightness set to: %u", appConfig.brightnessMode);
     initRotaryEncoder(appConfig.brightnessMode, myRotaryEncoderCallback);
     // Apply color mode on startup
     checkAndApplyColorMode(appConfig);
@@ -61,11 +78,19 @@ void setup() {
         serialPrint("Using default system settings");
         systemSettings = getDefaultSystemSettings();
     }
+    publishSystemSettings(systemSettings);
 
+    // Web changes arrive as commands and run on this task from loop()
+    initClockService();
+    initCommandQueue(onStateUpdatedFromWifi);
     // Initialize route handlers with state and get routes
-    apRoutes = initRouteHandlers(&appConfig, &systemSettings, &wifiTracker, onStateUpdatedFromWifi);
+    apRoutes = initRouteHandlers(&wifiTracker, &lampState);
     initWiFiController(systemSettings, apRoutes, wifiTracker);
-    startWifi();
+    initRadioScheduler(); // the access point only comes up on a long click
+    setLampGroupEnabled(appConfig.lampGroup);
+
+    initStallWatchdog();
+    initOtaUpdate();
 
     serialPrint("Initialized");
 }
@@ -75,22 +100,50 @@ void setup() {
  * Runs repeatedly after setup().
  */
 void loop() {
+    unsigned long loopStartUs = micros();
+    // Phase marks let the stall watchdog name the step that hangs
+    enterLoopPhase(LOOP_PHASE_COMMANDS);
+    processCommands();
+    enterLoopPhase(LOOP_PHASE_SYNC_CONFIG);
+    syncConfig();
+    enterLoopPhase(LOOP_PHASE_LED);
+    realtimeLoop();
     ledUpdate();
+    enterLoopPhase(LOOP_PHASE_CLOCK);
+    clockServiceLoop();
+    enterLoopPhase(LOOP_PHASE_WIFI);
     wifiLoop();
+    enterLoopPhase(LOOP_PHASE_ROTARY);
     rotary_loop();
     // performWiFiTest();
     //  checkWifiStop();
+    enterLoopPhase(LOOP_PHASE_ALARMS);
     checkAlarmStates(appConfig.alarmDuration);
+    enterLoopPhase(LOOP_PHASE_LAMP_STATE);
     checkLampState();
+    enterLoopPhase(LOOP_PHASE_LED);
     updateLed();
+    enterLoopPhase(LOOP_PHASE_GOOD_NIGHT);
     checkGoodNightMode(appConfig.goodNightDuration);
+    enterLoopPhase(LOOP_PHASE_SAVE);
     checkToSave();
+    enterLoopPhase(LOOP_PHASE_DIAGNOSTICS);
+    checkDiagnostics();
+    otaLoop();
+    enterLoopPhase(LOOP_PHASE_IDLE);
+    setMetric(METRIC_LAMP_STATE, lampState);
+    setMetric(METRIC_BRIGHTNESS_LEVEL, appConfig.brightnessMode);
+    unsigned long loopUs = micros() - loopStartUs;
+    observeMetric(METRIC_LOOP_TIME, loopUs);
+    if(loopUs >= TRACE_LOOP_MIN_US) {
+        traceComplete(TRACE_LOOP, loopStartUs);
+    }
 }
 
 void checkAndApplyColorMode(const FullConfig& config) {
     // Always apply color mode (color override is always active)
     RGB colorToApply;
-    String modeName;
+    const char* modeName;
 
     // Check colorMode to determine which color to use
     switch(config.colorMode) {
@@ -119,31 +172,79 @@ void checkAndApplyColorMode(const FullConfig& config) {
     setLedColor(colorToApply.r, colorToApply.g, colorToApply.b);
     setAnimationMode(config.animationMode);
     setAnimationSpeed(config.animationSpeed);
-    serialPrint("LED color set to " + modeName + ": R=" + String(colorToApply.r) + " G=" + String(colorToApply.g)
-                + " B=" + String(colorToApply.b));
+    LOG_D("LED color set to %s: R=%u G=%u B=%u", modeName, colorToApply.r, colorToApply.g, colorToApply.b);
+}
+
+// Snapshot updaters, run under the snapshot writer lock
+static void applyWebConfig(FullConfig& config, const void* context) {
+    byte brightnessMode = config.brightnessMode; // owned by the rotary encoder
+    config = *static_cast<const FullConfig*>(context);
+    config.brightnessMode = brightnessMode;
+}
+
+// Only the members the body set, down to single alarms, so patches decoded against the same
+// snapshot and queued back to back do not undo each other
+static void applyWebPatch(FullConfig& config, const void* context) {
+    const ConfigPatch* patch = static_cast<const ConfigPatch*>(context);
+    mergeFullConfigPatch(config, patch->config, patch->mask);
+}
+
+static void applyBrightnessMode(FullConfig& config, const void* context) {
+    config.brightnessMode = *static_cast<const byte*>(context);
+}
+
+/**
+ * @brief Takes over a config snapshot published since the last pass and applies
+ * what changed. Runs on the loop task only, so LEDs, alarms and flash are never
+ * touched from the web task.
+ */
+void syncConfig() {
+    FullConfig previous = appConfig;
+    {
+        ConfigReader published;
+        if(published.generation() == appliedConfigGeneration) {
+            return;
+        }
+        appConfig = *published;
+        appliedConfigGeneration = published.generation();
+    }
+
+    if(memcmp(&previous.color, &appConfig.color, sizeof(appConfig.color)) != 0
+       || previous.colorMode != appConfig.colorMode || previous.animationMode != appConfig.animationMode
+       || previous.animationSpeed != appConfig.animationSpeed) {
+        checkAndApplyColorMode(appConfig);
+    }
+    if(memcmp(previous.alarms, appConfig.alarms, sizeof(appConfig.alarms)) != 0) {
+        setAlarms(appConfig.alarms);
+    }
+    if(previous.lampGroup != appConfig.lampGroup) {
+        setLampGroupEnabled(appConfig.lampGroup);
+    }
+    // Durations are read from appConfig on every loop pass, no notification needed
+    saveFullConfig(appConfig, true);
 }
 
 void onStateUpdatedFromWifi(StateChangeType type, void* data) {
     switch(type) {
     case STATE_CHANGE_CONFIG: {
-        const FullConfig* newConfig = static_cast<const FullConfig*>(data);
-        FullConfig tempConfig = *newConfig;
-        tempConfig.brightnessMode = appConfig.brightnessMode; // Preserve brightness
-        appConfig = tempConfig;
-        checkAndApplyColorMode(appConfig);
-        setAlarms(appConfig.alarms);
-        saveFullConfig(appConfig, true);
-        // stay(0, 255, 0, 7, 2000); // green for 2 seconds
+        // Picked up and applied by syncConfig() on the next loop pass
+        updateConfig(applyWebConfig, data);
         serialPrint("Full configuration updated via WiFi controller generic callback.");
         break;
     }
+    case STATE_CHANGE_CONFIG_PATCH: {
+        updateConfig(applyWebPatch, data);
+        serialPrint("Configuration patched via WiFi controller generic callback.");
+        break;
+    }
     case STATE_CHANGE_SYSTEM_CONFIG: {
-        const SystemSettings* newSettings = static_cast<const SystemSettings*>(data);
-        systemSettings = *newSettings;
+        // Only what the body replaced, so two posts queued back to back do not undo each other
+        const SystemSettingsPatch* patch = static_cast<const SystemSettingsPatch*>(data);
+        mergeSystemSettings(systemSettings, patch->settings, patch->fields);
+        publishSystemSettings(systemSettings);
         saveSystemSettings(systemSettings);
         stay(0, 255, 0, 7, 2000); // green for 2 seconds
-        stopWifi();
-        startWifi();
+        restartWifiSoon(); // picks up the new settings
         //  performWiFiTest(true);
         serialPrint("System settings updated via WiFi controller generic callback.");
         break;
@@ -153,6 +254,7 @@ void onStateUpdatedFromWifi(StateChangeType type, void* data) {
 
 // Callback function to handle rotary encoder events
 void myRotaryEncoderCallback(RotaryEncoderEventType eventType, int16_t value) {
+    countMetric(METRIC_ENCODER_EVENTS);
     switch(eventType) {
     case RotaryEncoderEventType::ShortClick:
         serialPrint("ShortClick Event!");
@@ -172,10 +274,10 @@ void myRotaryEncoderCallback(RotaryEncoderEventType eventType, int16_t value) {
             v = 0;
         if(v > 7)
             v = 7;
-        appConfig.brightnessMode = (byte)v;
-        serialPrint("Brightness mode set to: " + String(appConfig.brightnessMode) + String(" (from ") + String(value)
-                    + String(")"));
-        saveFullConfig(appConfig, true);
+        byte brightnessMode = (byte)v;
+        updateConfig(applyBrightnessMode, &brightnessMode);
+        syncConfig(); // takes the new level into appConfig and schedules the save
+        LOG_D("Brightness mode set to: %u (from %d)", appConfig.brightnessMode, value);
         setBrightnessLevel(appConfig.brightnessMode);
         if(lampState == LAMP_STATE_GOOD_NIGHT) {
             lampState = LAMP_STATE_DEFAULT;
@@ -268,6 +370,7 @@ void checkLampState() {
 void updateLed() {
     static LampState lastLampState;
     static unsigned long lastCheck = 0;
+    static byte alarmLevel = 0;
     unsigned long currentTime = millis();
 
     // State changes
@@ -290,22 +393,30 @@ void updateLed() {
     } */
     if(lampState == LAMP_STATE_ALARM && lastLampState != LAMP_STATE_ALARM) {
         checkAndApplyColorMode(appConfig);
+        alarmLevel = 0;
     }
     if(lampState == LAMP_STATE_SLEEP && lastLampState != LAMP_STATE_SLEEP) {
         setBrightnessLevel(0);
     }
     lastLampState = lampState;
 
+    // Every pass, so the lamps of a group step up together rather than up to a check apart
+    if(lampState == LAMP_STATE_ALARM) {
+        byte level = getAlarmBrightness(appConfig.alarmDuration);
+        if(level != alarmLevel) {
+            LOG_D("Alarm brightness level %u", level);
+            setBrightnessLevel(level);
+            alarmLevel = level;
+        }
+    }
+
     // Stay same
     if(currentTime - lastCheck < 5000) {
         return;
     }
     lastCheck = currentTime;
-    Serial.println("Lamp state check: " + String(lampState));
+    LOG_D("Lamp state check: %d", (int)lampState);
 
-    if(lampState == LAMP_STATE_ALARM) {
-        setBrightnessLevel(getAlarmBrightness(appConfig.alarmDuration));
-    }
     if(lampState == LAMP_STATE_GOOD_NIGHT) {
         setBrightnessLevel(getGoodNightBrightness(appConfig.brightnessMode, appConfig.goodNightDuration));
     }
@@ -0,0 +1,96 @@
+#include "metrics.h"
+#include <ESPAsyncWebServer.h> // For the HTTP method constants
+
+std::atomic<uint32_t> metricCounters[METRIC_COUNTER_COUNT];
+std::atomic<int32_t> metricGauges[METRIC_GAUGE_COUNT];
+HistogramValues metricHistograms[METRIC_HISTOGRAM_COUNT];
+std::atomic<uint32_t> httpRequestCounts[METRIC_MAX_ROUTES];
+
+struct MetricInfo {
+    const char* name;
+    const char* help;
+};
+
+#define METRIC_INFO(id, name, help, ...) {name, help},
+static const MetricInfo counterInfo[] = {METRIC_COUNTERS(METRIC_INFO)};
+static const MetricInfo gaugeInfo[] = {METRIC_GAUGES(METRIC_INFO)};
+static const MetricInfo histogramInfo[] = {METRIC_HISTOGRAMS(METRIC_INFO)};
+#undef METRIC_INFO
+
+#define METRIC_BOUNDS(id, name, help, bounds) bounds,
+static const uint32_t histogramBounds[METRIC_HISTOGRAM_COUNT][METRIC_HISTOGRAM_BUCKETS] = {
+    METRIC_HISTOGRAMS(METRIC_BOUNDS)};
+#undef METRIC_BOUNDS
+
+static const Route* metricRoutes = nullptr;
+static size_t metricRouteCount = 0;
+
+void observeMetric(MetricHistogram histogram, uint32_t valueUs) {
+    const uint32_t* bounds = histogramBounds[histogram];
+    size_t bucket = 0;
+    while(bucket < METRIC_HISTOGRAM_BUCKETS && valueUs > bounds[bucket]) {
+        bucket++;
+    }
+    // Buckets are stored non-cumulative and summed up on export
+    metricHistograms[histogram].buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    metricHistograms[histogram].sumUs.fetch_add(valueUs, std::memory_order_relaxed);
+}
+
+void setMetricRoutes(const Route* routes, size_t count) {
+    metricRoutes = routes;
+    metricRouteCount = count < METRIC_MAX_ROUTES ? count : METRIC_MAX_ROUTES;
+}
+
+static void printHeader(Print& out, const MetricInfo& info, const char* type) {
+    out.printf("# HELP %s %s\n# TYPE %s %s\n", info.name, info.help, info.name, type);
+}
+
+static const char* methodName(int method) {
+    switch(method) {
+    case HTTP_GET:
+        return "GET";
+    case HTTP_POST:
+        return "POST";
+    case HTTP_PATCH:
+        return "PATCH";
+    default:
+        return "ANY";
+    }
+}
+
+void printMetrics(Print& out) {
+    for(size_t i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        printHeader(out, counterInfo[i], "counter");
+        out.printf("%s %u\n", counterInfo[i].name, (unsigned)metricCounters[i].load(std::memory_order_relaxed));
+    }
+
+    static const MetricInfo httpRequests = {"lamp_http_requests_total", "Requests dispatched per route"};
+    printHeader(out, httpRequests, "counter");
+    for(size_t i = 0; i < metricRouteCount; i++) {
+        out.printf("%s{route=\"%s\",method=\"%s\"} %u\n", httpRequests.name, metricRoutes[i].uri,
+                   methodName(metricRoutes[i].method), (unsigned)httpRequestCounts[i].load(std::memory_order_relaxed));
+    }
+
+    for(size_t i = 0; i < METRIC_GAUGE_COUNT; i++) {
+        printHeader(out, gaugeInfo[i], "gauge");
+        out.printf("%s %d\n", gaugeInfo[i].name, (int)metricGauges[i].load(std::memory_order_relaxed));
+    }
+    static const MetricInfo uptime = {"lamp_uptime_seconds", "Seconds since boot"};
+    printHeader(out, uptime, "gauge");
+    out.printf("%s %u\n", uptime.name, (unsigned)(millis() / 1000));
+
+    for(size_t i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        const char* name = histogramInfo[i].name;
+        printHeader(out, histogramInfo[i], "histogram");
+        // Buckets are read one by one, so a scrape racing an observation may be off by one
+        uint32_t cumulative = 0;
+        for(size_t b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++) {
+            cumulative += metricHistograms[i].buckets[b].load(std::memory_order_relaxed);
+            out.printf("%s_bucket{le=\"%g\"} %u\n", name, histogramBounds[i][b] / 1e6, (unsigned)cumulative);
+        }
+        cumulative += metricHistograms[i].buckets[METRIC_HISTOGRAM_BUCKETS].load(std::memory_order_relaxed);
+        out.printf("%s_bucket{le=\"+Inf\"} %u\n", name, (unsigned)cumulative);
+        out.printf("%s_sum %.6f\n", name, metricHistograms[i].sumUs.load(std::memory_order_relaxed) / 1e6);
+        out.printf("%s_count %u\n", name, (unsigned)cumulative);
+    }
+}
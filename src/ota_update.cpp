@@ -0,0 +1,299 @@
+#include "ota_update.h"
+#include <LittleFS.h>
+#include <Update.h>
+#include <atomic>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "debug_utils.h"
+#include "metrics.h"
+#include "stall_watchdog.h"
+#include "web_admission.h"
+
+// Upload state, web task only: body chunks and request callbacks all run on it
+static OtaStatus status = {OTA_IDLE, OTA_TARGET_FIRMWARE, 0, 0, 0, nullptr, false};
+static AsyncWebServerRequest* owner = nullptr; // request streaming the current upload
+static mbedtls_sha256_context sha;
+static uint8_t expectedSha[32];
+static unsigned long startMs = 0;
+static bool writing = false;      // Update and sha are in use
+static bool fsUnmounted = false; // LittleFS was unmounted for a filesystem upload
+
+// Status copy for readers on other tasks; guarded by statusMux
+static portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
+static OtaStatus published = status;
+
+// Served from flash while LittleFS is unusable, e.g. after a failed filesystem upload.
+// crypto.subtle needs https, so the hash is pasted from sha256sum.
+static const char recoveryPage[] PROGMEM = R"(<!DOCTYPE html>
+<html><head><meta name="viewport" content="width=device-width,initial-scale=1"><title>Lamp recovery</title></head>
+<body style="font-family:sans-serif;max-width:30em;margin:2em auto">
+<h1>Lamp recovery</h1>
+<p>The web pages on the filesystem are missing or damaged. Upload littlefs.bin again to restore them.</p>
+<form id="f">
+<p><select id="t">
+<option value="filesystem">littlefs.bin</option>
+<option value="firmware">firmware.bin</option>
+</select></p>
+<p><input type="file" id="i" required></p>
+<p><input id="h" placeholder="SHA-256 (sha256sum)" size="64" pattern="[0-9a-fA-F]{64}" required></p>
+<p><button>Upload</button> <span id="s"></span></p>
+</form>
+<script>
+f.onsubmit = async e => {
+  e.preventDefault();
+  s.textContent = 'Uploading...';
+  try {
+    const r = await fetch('/ota/' + t.value, {method: 'POST', headers: {'X-Sha256': h.value.trim()}, body: i.files[0]});
+    s.textContent = await r.text();
+  } catch(err) {
+    s.textContent = 'Upload failed: ' + err;
+  }
+};
+</script>
+</body></html>
+)";
+
+static std::atomic<bool> restartRequested(false);
+static bool pendingVerify = false; // loop task only after setup
+
+// Arduino core hook: leaves confirming a new image to otaLoop() instead of doing it at boot
+bool verifyRollbackLater() {
+    return true;
+}
+
+const char* otaStateName(OtaState state) {
+    switch(state) {
+    case OTA_RECEIVING:
+        return "receiving";
+    case OTA_DONE:
+        return "done";
+    case OTA_FAILED:
+        return "failed";
+    default:
+        return "idle";
+    }
+}
+
+const char* otaTargetName(OtaTarget target) {
+    return target == OTA_TARGET_FILESYSTEM ? "filesystem" : "firmware";
+}
+
+static void publishStatus() {
+    uint32_t elapsedMs = millis() - startMs;
+    status.rateKBps = elapsedMs > 0 ? (uint64_t)status.written * 1000 / 1024 / elapsedMs : 0;
+    portENTER_CRITICAL(&statusMux);
+    bool verify = published.pendingVerify; // owned by the loop task
+    published = status;
+    published.pendingVerify = verify;
+    portEXIT_CRITICAL(&statusMux);
+    setMetric(METRIC_OTA_PROGRESS, status.total > 0 ? (uint64_t)status.written * 100 / status.total : 0);
+    setMetric(METRIC_OTA_RATE, status.rateKBps);
+}
+
+static bool parseSha256(const String& hex, uint8_t* out) {
+    if(hex.length() != 64) {
+        return false;
+    }
+    for(uint8_t i = 0; i < 32; i++) {
+        char pair[3] = {hex[i * 2], hex[i * 2 + 1], 0};
+        char* end;
+        out[i] = strtoul(pair, &end, 16);
+        if(end != pair + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// From the X-Sha256 header or the sha256 query parameter
+static bool readExpectedSha256(AsyncWebServerRequest* request, uint8_t* out) {
+    if(request->hasHeader("X-Sha256")) {
+        return parseSha256(request->getHeader("X-Sha256")->value(), out);
+    }
+    return request->hasParam("sha256") && parseSha256(request->getParam("sha256")->value(), out);
+}
+
+static void failOta(const char* error) {
+    if(writing) {
+        Update.abort();
+        mbedtls_sha256_free(&sha);
+        writing = false;
+    }
+    if(fsUnmounted) {
+        LittleFS.begin(); // may fail now, / then serves the recovery page
+        fsUnmounted = false;
+    }
+    status.state = OTA_FAILED;
+    status.error = error;
+    publishStatus();
+    LOG_E("OTA update failed: %s", error);
+}
+
+static bool beginOta(AsyncWebServerRequest* request, OtaTarget target, size_t total) {
+    if(status.state == OTA_RECEIVING) {
+        return false; // another upload owns the partition
+    }
+    // Refused without touching the status of the last update; handleOtaRequest answers 400
+    if(!readExpectedSha256(request, expectedSha)) {
+        return false;
+    }
+    owner = request;
+    onAdmittedDisconnect(request, [request]() {
+        if(owner == request) {
+            if(status.state == OTA_RECEIVING) {
+                failOta("client disconnected");
+            }
+            owner = nullptr;
+        }
+    });
+    status.target = target;
+    status.written = 0;
+    status.total = total;
+    status.error = nullptr;
+    status.state = OTA_RECEIVING;
+    startMs = millis();
+
+    if(target == OTA_TARGET_FILESYSTEM) {
+        LittleFS.end(); // nothing may write to the partition while it is replaced
+        fsUnmounted = true;
+    }
+    if(!Update.begin(total, target == OTA_TARGET_FILESYSTEM ? U_SPIFFS : U_FLASH)) {
+        failOta("image does not fit the partition");
+        return true;
+    }
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    writing = true;
+    LOG_I("OTA update of %s started, %u bytes", otaTargetName(target), (unsigned)total);
+    publishStatus();
+    return true;
+}
+
+static void finishOta() {
+    uint8_t actual[32];
+    mbedtls_sha256_finish(&sha, actual);
+    if(memcmp(actual, expectedSha, sizeof(actual)) != 0) {
+        // The filesystem partition is already overwritten at this point, see ota_update.h
+        failOta(status.target == OTA_TARGET_FILESYSTEM ? "SHA-256 mismatch, filesystem needs a new upload"
+                                                       : "SHA-256 mismatch");
+        return;
+    }
+    // For firmware this also checks the image and makes it the boot partition
+    if(!Update.end(true)) {
+        failOta("image rejected");
+        return;
+    }
+    mbedtls_sha256_free(&sha);
+    writing = false;
+    fsUnmounted = false; // the restart mounts the new filesystem
+    status.state = OTA_DONE;
+    publishStatus();
+    LOG_I("OTA update of %s done, %u KB/s", otaTargetName(status.target), (unsigned)status.rateKBps);
+    restartRequested.store(true);
+}
+
+static void handleOtaBody(AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total,
+                          OtaTarget target) {
+    if(index == 0 && !beginOta(request, target, total)) {
+        return;
+    }
+    if(owner != request || !writing) {
+        return;
+    }
+    mbedtls_sha256_update(&sha, data, len);
+    if(Update.write(data, len) != len) {
+        failOta("flash write failed");
+        return;
+    }
+    status.written += len;
+    if(index + len == total) {
+        finishOta();
+    } else if((status.written & 0xFFFF) < len) {
+        publishStatus(); // every 64 KB
+    }
+}
+
+// Runs once the whole body went through handleOtaBody
+static void handleOtaRequest(AsyncWebServerRequest* request) {
+    uint8_t sha[32];
+    if(owner != request && !readExpectedSha256(request, sha)) {
+        request->send(400, "text/plain", "Missing or malformed X-Sha256");
+        return;
+    }
+    if(owner != request) {
+        request->send(request->contentLength() == 0 ? 411 : 409, "text/plain",
+                      request->contentLength() == 0 ? "Content-Length required" : "Another update is running");
+        return;
+    }
+    owner = nullptr;
+    if(status.state == OTA_DONE) {
+        request->send(200, "text/plain", "Update done, restarting");
+    } else {
+        request->send(400, "text/plain", status.error != nullptr ? status.error : "Update failed");
+    }
+}
+
+void setUpOtaRoutes(AsyncWebServer& server) {
+    server.on("/ota/firmware", HTTP_POST, handleOtaRequest, NULL,
+              [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+                  handleOtaBody(request, data, len, index, total, OTA_TARGET_FIRMWARE);
+              });
+    server.on("/ota/filesystem", HTTP_POST, handleOtaRequest, NULL,
+              [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+                  handleOtaBody(request, data, len, index, total, OTA_TARGET_FILESYSTEM);
+              });
+}
+
+void sendOtaRecoveryPage(AsyncWebServerRequest* request) {
+    AsyncWebServerResponse* response = request->beginResponse_P(200, "text/html", recoveryPage);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+void initOtaUpdate() {
+    esp_ota_img_states_t state;
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if(esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+        pendingVerify = true;
+        LOG_I("Running a new image, confirming it after %u s", (unsigned)(OTA_SELF_CHECK_MS / 1000));
+    }
+    portENTER_CRITICAL(&statusMux);
+    published.pendingVerify = pendingVerify;
+    portEXIT_CRITICAL(&statusMux);
+}
+
+void otaLoop() {
+    static unsigned long restartSeenMs = 0;
+    if(restartRequested.load()) {
+        if(restartSeenMs == 0) {
+            restartSeenMs = millis() | 1;
+        } else if(millis() - restartSeenMs >= OTA_RESTART_DELAY_MS) {
+            LOG_I("Restarting into the update");
+            ESP.restart();
+        }
+    }
+
+    // Crashes and watchdog resets before this point leave the image unconfirmed, and
+    // the bootloader goes back to the previous one on the next boot
+    if(!pendingVerify || millis() < OTA_SELF_CHECK_MS) {
+        return;
+    }
+    pendingVerify = false;
+    portENTER_CRITICAL(&statusMux);
+    published.pendingVerify = false;
+    portEXIT_CRITICAL(&statusMux);
+    if(getStallReport().stalls > 0) {
+        LOG_E("New image stalled the loop, rolling back");
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+        return;
+    }
+    esp_ota_mark_app_valid_cancel_rollback();
+    LOG_I("New image confirmed");
+}
+
+OtaStatus getOtaStatus() {
+    portENTER_CRITICAL(&statusMux);
+    OtaStatus copy = published;
+    portEXIT_CRITICAL(&statusMux);
+    return copy;
+}
@@ -0,0 +1,187 @@
+#include "radio_scheduler.h"
+#include <esp_timer.h>
+#include "clock_service.h"
+#include "debug_utils.h"
+#include "lamp_group.h"
+#include "metrics.h"
+#include "wifi_controller.h"
+
+#define RADIO_DAY_US (24 * 60 * 60 * 1000000LL)
+
+// Loop task only
+static uint32_t handledSyncCount = 0;
+static unsigned long syncIntervalMs = RADIO_SYNC_INTERVAL_MIN_MS;
+static unsigned long windowBaseMs = 0;  // last sync or failed window
+static unsigned long windowDelayMs = 0; // due at windowBaseMs + windowDelayMs
+static bool windowOpen = false;
+static bool openFailed = false; // the last window had nothing to join, so even a group hold waits
+static unsigned long windowOpenedMs = 0;
+static bool hasCorrection = false;
+static int32_t lastCorrectionMs = 0;
+static uint32_t windows = 0;
+static uint32_t syncedWindows = 0;
+
+// Radio-on time per uptime day, loop task only; stats are copied under statsMux
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+static bool radioWasOn = false;
+static unsigned long lastAccountMs = 0;
+static uint32_t onTodayMs = 0;
+static uint32_t uptimeDay = 0;
+static uint32_t onDayS[RADIO_DAY_HISTORY];
+static uint8_t dayCount = 0;
+static uint32_t unreportedOnMs = 0; // not yet added to METRIC_RADIO_ON_SECONDS
+
+const char* radioModeName(RadioMode mode) {
+    switch(mode) {
+    case RADIO_SYNC_WINDOW:
+        return "sync_window";
+    case RADIO_SESSION:
+        return "session";
+    default:
+        return "off";
+    }
+}
+
+static RadioMode currentMode() {
+    if(isWiFiActive()) {
+        return RADIO_SESSION;
+    }
+    return windowOpen ? RADIO_SYNC_WINDOW : RADIO_OFF;
+}
+
+static void accountRadioTime() {
+    unsigned long now = millis();
+    uint32_t elapsedMs = now - lastAccountMs;
+    lastAccountMs = now;
+    uint32_t day = esp_timer_get_time() / RADIO_DAY_US;
+
+    portENTER_CRITICAL(&statsMux);
+    if(radioWasOn) {
+        onTodayMs += elapsedMs;
+        unreportedOnMs += elapsedMs;
+    }
+    if(day != uptimeDay) {
+        memmove(&onDayS[1], &onDayS[0], sizeof(onDayS) - sizeof(onDayS[0]));
+        onDayS[0] = onTodayMs / 1000;
+        dayCount = dayCount < RADIO_DAY_HISTORY ? dayCount + 1 : RADIO_DAY_HISTORY;
+        onTodayMs = 0;
+        uptimeDay = day;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if(unreportedOnMs >= 1000) {
+        addMetric(METRIC_RADIO_ON_SECONDS, unreportedOnMs / 1000);
+        unreportedOnMs %= 1000;
+    }
+    radioWasOn = isRadioOn();
+}
+
+// Adapts the interval to the correction the last sync had to apply on top of the
+// clock service's drift compensation
+static void handleTimeSync() {
+    uint32_t count = getClockSyncCount();
+    if(count == handledSyncCount) {
+        return;
+    }
+    handledSyncCount = count;
+    windowBaseMs = millis();
+
+    int32_t correctionMs;
+    if(getLastSyncResidualMs(correctionMs)) {
+        hasCorrection = true;
+        lastCorrectionMs = correctionMs;
+        uint32_t absCorrectionMs = lastCorrectionMs < 0 ? -lastCorrectionMs : lastCorrectionMs;
+        if(absCorrectionMs < RADIO_DRIFT_TARGET_MS / 2) {
+            syncIntervalMs = min(syncIntervalMs * 2, RADIO_SYNC_INTERVAL_MAX_MS);
+        } else if(absCorrectionMs > RADIO_DRIFT_TARGET_MS) {
+            syncIntervalMs = max(syncIntervalMs / 2, RADIO_SYNC_INTERVAL_MIN_MS);
+        }
+        LOG_I("NTP corrected the clock by %d ms, next sync in %u min", (int)lastCorrectionMs,
+              (unsigned)(syncIntervalMs / 60000));
+    }
+    windowDelayMs = syncIntervalMs;
+    setMetric(METRIC_RADIO_SYNC_INTERVAL, syncIntervalMs / 1000);
+}
+
+static void openSyncWindow() {
+    if(!startSyncWindow()) {
+        // Nothing to join; check again after the shortest interval
+        windowBaseMs = millis();
+        windowDelayMs = RADIO_SYNC_INTERVAL_MIN_MS;
+        openFailed = true;
+        return;
+    }
+    openFailed = false;
+    windowOpen = true;
+    windowOpenedMs = millis();
+    windows++;
+    countMetric(METRIC_RADIO_SYNC_WINDOWS);
+}
+
+static void closeSyncWindow(bool synced) {
+    stopSyncWindow();
+    windowOpen = false;
+    if(synced) {
+        syncedWindows++;
+    } else {
+        LOG_W("No NTP sync within %u s, closing the window", (unsigned)(RADIO_SYNC_WINDOW_MS / 1000));
+        windowBaseMs = millis();
+        windowDelayMs = RADIO_SYNC_INTERVAL_MIN_MS;
+    }
+}
+
+void initRadioScheduler() {
+    lastAccountMs = millis();
+    windowBaseMs = millis();
+    windowDelayMs = 0; // first window right away
+    setMetric(METRIC_RADIO_SYNC_INTERVAL, syncIntervalMs / 1000);
+}
+
+void radioSchedulerLoop() {
+    accountRadioTime();
+    uint32_t syncsBefore = handledSyncCount;
+    handleTimeSync();
+    bool synced = handledSyncCount != syncsBefore;
+
+    if(isWiFiActive()) {
+        // A user session took over the radio; it syncs the clock the same way
+        windowOpen = false;
+        return;
+    }
+    bool groupHold = lampGroupWantsRadio();
+    if(windowOpen) {
+        if(groupHold) {
+            // Around a sunrise the lamp group keeps the window; it gets its full time to sync afterwards
+            windowOpenedMs = millis();
+            return;
+        }
+        if(synced || millis() - windowOpenedMs >= RADIO_SYNC_WINDOW_MS) {
+            closeSyncWindow(synced);
+        }
+        return;
+    }
+    if((groupHold && !openFailed) || millis() - windowBaseMs >= windowDelayMs) {
+        openSyncWindow();
+    }
+}
+
+RadioStats getRadioStats() {
+    RadioStats stats;
+    stats.mode = currentMode();
+    stats.syncIntervalS = syncIntervalMs / 1000;
+    unsigned long sinceBaseMs = millis() - windowBaseMs;
+    stats.nextWindowInS = stats.mode != RADIO_OFF || sinceBaseMs >= windowDelayMs
+                              ? 0
+                              : (windowDelayMs - sinceBaseMs) / 1000;
+    stats.hasCorrection = hasCorrection;
+    stats.lastCorrectionMs = lastCorrectionMs;
+    stats.windows = windows;
+    stats.syncedWindows = syncedWindows;
+
+    portENTER_CRITICAL(&statsMux);
+    stats.onTodayS = onTodayMs / 1000;
+    stats.days = dayCount;
+    memcpy(stats.onDayS, onDayS, sizeof(onDayS));
+    portEXIT_CRITICAL(&statsMux);
+    return stats;
+}
@@ -0,0 +1,296 @@
+#include "realtime_udp.h"
+#include <atomic>
+#include <lwip/sockets.h>
+#include "debug_utils.h"
+#include "led.h"
+#include "metrics.h"
+
+#define DDP_HEADER_SIZE 10
+#define DDP_TIMECODE_SIZE 4
+#define DDP_PACKET_SIZE 1500 // one Ethernet MTU, DDP senders split frames into packets below it
+#define DDP_VERSION_MASK 0xC0
+#define DDP_VERSION_1 0x40
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_QUERY 0x02
+#define DDP_FLAG_PUSH 0x01
+#define DDP_ID_DISPLAY 1
+#define DDP_SEQUENCE_MASK 0x0F // 1..15, 0 when the sender does not number packets
+#define DDP_SEQUENCE_WINDOW 7  // further ahead than this counts as a late packet
+#define REALTIME_SELECT_TIMEOUT_MS 200
+#define REALTIME_TASK_STACK 3072
+#define REALTIME_TASK_PRIORITY 3 // above the loop, a frame is parsed as soon as it arrives
+
+static const uint32_t latencyBucketUs[REALTIME_LATENCY_BUCKETS]
+    = {500, 1000, 2000, 5000, 10000, 20000, 50000, UINT32_MAX};
+
+static uint8_t packet[DDP_PACKET_SIZE];
+static volatile bool rtRunning = false;
+static volatile bool rtTaskAlive = false; // cleared by the task right before it deletes itself
+
+// Listener task only
+static uint8_t lastSequence = 0;
+static bool seenPush = false;
+
+// Filled by the listener task, shown by the loop task; guarded by frameMux
+static portMUX_TYPE frameMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t pendingRgb[REALTIME_MAX_PIXELS * 3];
+static uint16_t pendingPixels = 0;
+static bool framePending = false;
+static uint32_t pendingRecvUs = 0;
+
+// Written by the loop task only
+static volatile bool active = false;
+
+static std::atomic<uint32_t> lastPacketMs(0);
+static std::atomic<uint32_t> packets(0);
+static std::atomic<uint32_t> frames(0);
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<uint32_t> lost(0);
+static std::atomic<uint32_t> superseded(0);
+static std::atomic<uint32_t> timeouts(0);
+static std::atomic<uint32_t> maxLatencyUs(0);
+static std::atomic<uint32_t> latencyHistogram[REALTIME_LATENCY_BUCKETS];
+
+static inline uint32_t readU32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline uint16_t readU16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+// Duplicates and packets from behind the last one are dropped, skipped numbers counted as lost
+static bool checkSequence(uint8_t sequence) {
+    if(sequence == 0 || lastSequence == 0) {
+        lastSequence = sequence;
+        return true;
+    }
+    uint8_t ahead = (sequence + 15 - lastSequence) % 15;
+    if(ahead == 0 || ahead > DDP_SEQUENCE_WINDOW) {
+        return false;
+    }
+    lost.fetch_add(ahead - 1, std::memory_order_relaxed);
+    lastSequence = sequence;
+    return true;
+}
+
+static void handlePacket(size_t len, uint32_t recvUs) {
+    if(len < DDP_HEADER_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint8_t flags = packet[0];
+    size_t headerSize = DDP_HEADER_SIZE + (flags & DDP_FLAG_TIMECODE ? DDP_TIMECODE_SIZE : 0);
+    uint8_t id = packet[3];
+    if((flags & DDP_VERSION_MASK) != DDP_VERSION_1 || (flags & DDP_FLAG_QUERY)
+       || (id != DDP_ID_DISPLAY && id != 0) || len < headerSize) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if(millis() - lastPacketMs.load(std::memory_order_relaxed) >= REALTIME_TIMEOUT_MS) {
+        lastSequence = 0; // a new stream numbers from anywhere
+    }
+    if(!checkSequence(packet[1] & DDP_SEQUENCE_MASK)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t offset = readU32(&packet[4]);
+    size_t dataLen = readU16(&packet[8]);
+    if(dataLen > len - headerSize) {
+        dataLen = len - headerSize; // truncated packet, use what arrived
+    }
+    lastPacketMs.store(millis(), std::memory_order_relaxed);
+
+    // Senders that never push want every packet shown
+    bool push = flags & DDP_FLAG_PUSH;
+    seenPush |= push;
+    portENTER_CRITICAL(&frameMux);
+    if(offset < sizeof(pendingRgb)) {
+        size_t copyLen = min(dataLen, sizeof(pendingRgb) - offset);
+        memcpy(&pendingRgb[offset], &packet[headerSize], copyLen);
+        uint16_t pixels = (offset + copyLen + 2) / 3;
+        if(pixels > pendingPixels) {
+            pendingPixels = pixels;
+        }
+    }
+    bool replaced = false;
+    if(push || !seenPush) {
+        replaced = framePending;
+        framePending = true;
+        pendingRecvUs = recvUs;
+    }
+    portEXIT_CRITICAL(&frameMux);
+    if(replaced) {
+        superseded.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void realtimeTaskMain(void*) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(DDP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        LOG_E("Realtime: socket setup failed");
+        if(sock >= 0) {
+            close(sock);
+        }
+        rtRunning = false;
+        rtTaskAlive = false;
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    while(rtRunning) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(sock, &readSet);
+        struct timeval timeout = {0, REALTIME_SELECT_TIMEOUT_MS * 1000};
+        if(select(sock + 1, &readSet, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        // Drain the queue, only the newest frame matters
+        while(true) {
+            int len = recvfrom(sock, packet, sizeof(packet), MSG_DONTWAIT, nullptr, nullptr);
+            if(len <= 0) {
+                break;
+            }
+            packets.fetch_add(1, std::memory_order_relaxed);
+            handlePacket(len, micros());
+        }
+    }
+
+    close(sock);
+    rtTaskAlive = false;
+    vTaskDelete(nullptr);
+}
+
+void startRealtime() {
+    if(rtRunning) {
+        return;
+    }
+    // A previous task may still be closing its socket after stopRealtime()
+    while(rtTaskAlive) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    lastSequence = 0;
+    seenPush = false;
+    rtRunning = true;
+    rtTaskAlive = true;
+    if(xTaskCreate(realtimeTaskMain, "realtime_ddp", REALTIME_TASK_STACK, nullptr, REALTIME_TASK_PRIORITY, nullptr)
+       != pdPASS) {
+        LOG_E("Realtime: task creation failed");
+        rtRunning = false;
+        rtTaskAlive = false;
+    }
+}
+
+static void endRealtime() {
+    active = false;
+    portENTER_CRITICAL(&frameMux);
+    framePending = false;
+    pendingPixels = 0;
+    portEXIT_CRITICAL(&frameMux);
+    ledEndRealtime();
+}
+
+void stopRealtime() {
+    // The task notices within REALTIME_SELECT_TIMEOUT_MS, closes the socket and deletes itself
+    rtRunning = false;
+    if(active) {
+        endRealtime();
+    }
+}
+
+static void recordLatency(uint32_t us) {
+    for(int i = 0; i < REALTIME_LATENCY_BUCKETS; i++) {
+        if(us <= latencyBucketUs[i]) {
+            latencyHistogram[i].fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+    if(us > maxLatencyUs.load(std::memory_order_relaxed)) {
+        maxLatencyUs.store(us, std::memory_order_relaxed);
+    }
+}
+
+void realtimeLoop() {
+    uint8_t rgb[REALTIME_MAX_PIXELS * 3];
+    uint16_t pixels = 0;
+    uint32_t recvUs = 0;
+    portENTER_CRITICAL(&frameMux);
+    bool show = framePending;
+    if(show) {
+        pixels = pendingPixels;
+        memcpy(rgb, pendingRgb, pixels * 3);
+        recvUs = pendingRecvUs;
+        framePending = false;
+    }
+    portEXIT_CRITICAL(&frameMux);
+
+    if(show) {
+        if(!active) {
+            LOG_I("Realtime stream started");
+            active = true;
+        }
+        ledShowRealtime(rgb, pixels);
+        recordLatency(micros() - recvUs);
+        frames.fetch_add(1, std::memory_order_relaxed);
+        countMetric(METRIC_REALTIME_FRAMES);
+        return;
+    }
+    if(active && millis() - lastPacketMs.load(std::memory_order_relaxed) >= REALTIME_TIMEOUT_MS) {
+        LOG_I("Realtime stream timed out, back to the lamp state");
+        timeouts.fetch_add(1, std::memory_order_relaxed);
+        endRealtime();
+    }
+}
+
+bool isRealtimeActive() {
+    return active;
+}
+
+static uint32_t latencyPercentile(const uint32_t* histogram, uint32_t percent) {
+    uint32_t total = 0;
+    for(int i = 0; i < REALTIME_LATENCY_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if(total == 0) {
+        return 0;
+    }
+    uint32_t rank = (total * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(int i = 0; i < REALTIME_LATENCY_BUCKETS; i++) {
+        seen += histogram[i];
+        if(seen >= rank) {
+            return latencyBucketUs[i];
+        }
+    }
+    return latencyBucketUs[REALTIME_LATENCY_BUCKETS - 1];
+}
+
+// Reset races with counting at worst by an event, good enough between benchmark runs
+static uint32_t take(std::atomic<uint32_t>& counter, bool reset) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed) : counter.load(std::memory_order_relaxed);
+}
+
+RealtimeStats getRealtimeStats(bool reset) {
+    RealtimeStats stats;
+    stats.running = rtRunning;
+    stats.active = isRealtimeActive();
+    stats.packets = take(packets, reset);
+    stats.frames = take(frames, reset);
+    stats.dropped = take(dropped, reset);
+    stats.lost = take(lost, reset);
+    stats.superseded = take(superseded, reset);
+    stats.timeouts = take(timeouts, reset);
+    stats.maxLatencyUs = take(maxLatencyUs, reset);
+    uint32_t histogram[REALTIME_LATENCY_BUCKETS];
+    for(int i = 0; i < REALTIME_LATENCY_BUCKETS; i++) {
+        histogram[i] = take(latencyHistogram[i], reset);
+    }
+    stats.p50LatencyUs = latencyPercentile(histogram, 50);
+    stats.p99LatencyUs = latencyPercentile(histogram, 99);
+    return stats;
+}
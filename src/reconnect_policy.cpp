@@ -0,0 +1,143 @@
+#include "reconnect_policy.h"
+
+// wifi_err_reason_t values, repeated here to keep this file free of IDF headers
+#define REASON_AUTH_EXPIRE 2
+#define REASON_ASSOC_LEAVE 8
+#define REASON_MIC_FAILURE 14
+#define REASON_4WAY_HANDSHAKE_TIMEOUT 15
+#define REASON_802_1X_AUTH_FAILED 23
+#define REASON_BEACON_TIMEOUT 200
+#define REASON_NO_AP_FOUND 201
+#define REASON_AUTH_FAIL 202
+#define REASON_ASSOC_FAIL 203
+#define REASON_HANDSHAKE_TIMEOUT 204
+#define REASON_CONNECTION_FAIL 205
+#define REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY 210
+#define REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD 211
+#define REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD 212
+
+#define RECONNECT_MAX_SHIFT 16 // keeps base << failures from overflowing
+
+struct BackoffParams {
+    uint32_t baseMs;
+    uint32_t capMs;
+};
+
+static const BackoffParams backoffParams[DISCONNECT_CLASS_COUNT] = {
+    {0, 0},
+    {RECONNECT_TRANSIENT_BASE_MS, RECONNECT_TRANSIENT_CAP_MS},
+    {RECONNECT_AP_GONE_BASE_MS, RECONNECT_AP_GONE_CAP_MS},
+    {RECONNECT_AUTH_BASE_MS, RECONNECT_AUTH_CAP_MS}};
+
+DisconnectClass classifyDisconnect(uint16_t reason) {
+    switch(reason) {
+    case REASON_ASSOC_LEAVE:
+        return DISCONNECT_IGNORED;
+    case REASON_AUTH_EXPIRE:
+    case REASON_MIC_FAILURE:
+    case REASON_4WAY_HANDSHAKE_TIMEOUT: // what a wrong WPA2 password usually ends in
+    case REASON_802_1X_AUTH_FAILED:
+    case REASON_AUTH_FAIL:
+    case REASON_HANDSHAKE_TIMEOUT:
+        return DISCONNECT_AUTH;
+    case REASON_BEACON_TIMEOUT:
+    case REASON_NO_AP_FOUND:
+    case REASON_ASSOC_FAIL:
+    case REASON_CONNECTION_FAIL:
+    case REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY:
+    case REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD:
+    case REASON_NO_AP_FOUND_IN_RSSI_THRESHOLD:
+        return DISCONNECT_AP_GONE;
+    default:
+        return DISCONNECT_TRANSIENT;
+    }
+}
+
+const char* disconnectClassName(DisconnectClass cls) {
+    switch(cls) {
+    case DISCONNECT_TRANSIENT:
+        return "transient";
+    case DISCONNECT_AP_GONE:
+        return "ap_gone";
+    case DISCONNECT_AUTH:
+        return "auth";
+    default:
+        return "ignored";
+    }
+}
+
+ReconnectPolicy::ReconnectPolicy(RandomFn random)
+    : _random(random), _state(STATE_IDLE), _lastClass(DISCONNECT_IGNORED), _failures(0), _since(0), _delayMs(0),
+      _attempts(0), _successes(0) {
+    for(uint8_t i = 0; i < DISCONNECT_CLASS_COUNT; i++) {
+        _disconnects[i] = 0;
+    }
+}
+
+void ReconnectPolicy::reset() {
+    _state = STATE_IDLE;
+    _failures = 0;
+}
+
+void ReconnectPolicy::onConnected() {
+    _state = STATE_IDLE;
+    _failures = 0;
+    _successes++;
+}
+
+// Capped exponential delay; half of it is fixed, the other half random so lamps
+// that lost the same router do not come back in lockstep
+uint32_t ReconnectPolicy::schedule(uint32_t nowMs) {
+    const BackoffParams& params = backoffParams[_lastClass];
+    uint32_t shift = _failures > 0 ? _failures - 1 : 0;
+    if(shift > RECONNECT_MAX_SHIFT) {
+        shift = RECONNECT_MAX_SHIFT;
+    }
+    uint64_t delay = (uint64_t)params.baseMs << shift;
+    if(delay > params.capMs) {
+        delay = params.capMs;
+    }
+    uint32_t half = delay / 2;
+    _delayMs = half + (half > 0 ? _random() % (half + 1) : 0);
+    _since = nowMs;
+    _state = STATE_WAITING;
+    return _delayMs;
+}
+
+uint32_t ReconnectPolicy::onDisconnect(uint16_t reason, uint32_t nowMs) {
+    DisconnectClass cls = classifyDisconnect(reason);
+    if(cls == DISCONNECT_IGNORED) {
+        return 0;
+    }
+    _disconnects[cls]++;
+    _lastClass = cls;
+    _failures++;
+    return schedule(nowMs);
+}
+
+bool ReconnectPolicy::shouldAttempt(uint32_t nowMs) {
+    if(_state == STATE_ATTEMPTING && nowMs - _since >= RECONNECT_ATTEMPT_TIMEOUT_MS) {
+        // No event at all, count it like a transient failure of the last kind
+        if(_lastClass == DISCONNECT_IGNORED) {
+            _lastClass = DISCONNECT_TRANSIENT;
+        }
+        _failures++;
+        schedule(nowMs);
+        return false;
+    }
+    if(_state != STATE_WAITING || nowMs - _since < _delayMs) {
+        return false;
+    }
+    _state = STATE_ATTEMPTING;
+    _since = nowMs;
+    _attempts++;
+    return true;
+}
+
+uint32_t ReconnectPolicy::nextAttemptInMs(uint32_t nowMs) const {
+    if(_state != STATE_WAITING) {
+        return 0;
+    }
+    uint32_t waited = nowMs - _since;
+    return waited >= _delayMs ? 0 : _delayMs - waited;
+}
@@ -1,19 +1,31 @@
 
 #include "route_handlers.h"
 #include <LittleFS.h>
+#include <esp_timer.h>
 #include <ESPAsyncWebServer.h>
 #include "debug_utils.h"
 #include "json_utils.h"
+#include "cbor_utils.h"
+#include "config_decoder.h"
+#include "config_snapshot.h"
+#include "command_queue.h"
+#include "diagnostics.h"
+#include "metrics.h"
+#include "trace.h"
+#include "clock_service.h"
+#include "wifi_scan.h"
+#include "web_admission.h"
 #include "types.h"
+#include "alarm.h"
+#include "good_night.h"
+#include "ota_update.h"
 #include <vector>
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
-// Global state pointers for handlers
-static const FullConfig* g_config = nullptr;
-static const SystemSettings* g_systemSettings = nullptr;
+// Global state pointers for handlers; FullConfig and SystemSettings are read through config_snapshot.h
 static const WiFiTestTracker* g_wifiTracker = nullptr;
-static GenericStateUpdateCallback g_stateCallback = nullptr;
+static const LampState* g_lampState = nullptr;
 
 // Root handler moved here from main.cpp to group route implementations.
 void handlePing(AsyncWebServerRequest* request, const String&) {
@@ -21,13 +33,11 @@ void handlePing(AsyncWebServerRequest* request, const String&) {
 }
 
 void handleRoot(AsyncWebServerRequest* request, const String&) {
-    Serial.print("handleRoot: ");
-    Serial.println(request->url());
-
     const char* indexPath = "/index.html.gzip";
     if(!LittleFS.exists(indexPath)) {
-        Serial.println("index.html.gz not found");
-        request->send(404, "text/plain", "index.html.gz not found");
+        // Also what an unmounted or corrupt filesystem looks like, e.g. after a failed upload
+        Serial.println("index.html.gz not found, serving the recovery page");
+        sendOtaRecoveryPage(request);
         return;
     }
 
@@ -102,87 +112,135 @@ void handleAppCSS(AsyncWebServerRequest* request, const String&) {
     }
 }
 
+// Content negotiation: CBOR only when the client asks for it, JSON otherwise
+static bool acceptsCbor(AsyncWebServerRequest* request) {
+    AsyncWebHeader* accept = request->getHeader("Accept");
+    return accept != nullptr && accept->value().indexOf("application/cbor") >= 0;
+}
+
+static bool hasCborBody(AsyncWebServerRequest* request) {
+    return request->contentType().equalsIgnoreCase("application/cbor");
+}
+
+static const uint8_t* bodyBytes(const String& body) {
+    return reinterpret_cast<const uint8_t*>(body.c_str());
+}
+
+static void sendCbor(AsyncWebServerRequest* request, const uint8_t* data, size_t len) {
+    if(len == 0) {
+        request->send(500, "text/plain", "Encoding failed");
+        return;
+    }
+    AsyncResponseStream* response = request->beginResponseStream("application/cbor", len);
+    response->addHeader("Vary", "Accept");
+    response->write(data, len);
+    request->send(response);
+}
+
 void handleGetConfig(AsyncWebServerRequest* request, const String&) {
-    serialPrint(String("handleGetConfig: ") + request->url());
-    if(g_config == nullptr) {
-        request->send(500, "text/plain", "Configuration not initialized");
+    ConfigReader config;
+    if(acceptsCbor(request)) {
+        uint8_t cbor[FULL_CONFIG_CBOR_MAX];
+        sendCbor(request, cbor, encodeFullConfigCbor(*config, cbor, sizeof(cbor)));
         return;
     }
-    String jsonResponse = createConfigJson(*g_config);
-    request->send(200, "application/json", jsonResponse);
-    serialPrint("Sent /get_config response: " + jsonResponse);
+    request->send(200, "application/json", createConfigJson(*config));
 }
 
-void handleSetConfig(AsyncWebServerRequest* request, const String& body) {
-    serialPrint(String("handleSetConfig: ") + request->url());
-    if(g_stateCallback == nullptr) {
-        request->send(500, "text/plain", "No callback registered for state changes");
+// 202 with the id to poll at /command, or 503 when the loop task is behind
+static void sendQueued(AsyncWebServerRequest* request, uint32_t commandId, const char* message) {
+    if(commandId == 0) {
+        AsyncWebServerResponse* response = request->beginResponse(503, "text/plain", "Busy, try again.");
+        response->addHeader("Retry-After", "1");
+        request->send(response);
         return;
     }
+    char json[96];
+    snprintf(json, sizeof(json), "{\"status\":\"queued\",\"message\":\"%s\",\"commandId\":%u}", message,
+             (unsigned)commandId);
+    request->send(202, "application/json", json);
+}
 
+void handleSetConfig(AsyncWebServerRequest* request, const String& body) {
     if(body.isEmpty()) {
         request->send(400, "text/plain", "Bad Request: Missing JSON body.");
         return;
     }
-    serialPrint("Received /set_config body: " + body);
+    LOG_D("Received /set_config body, %u bytes", body.length());
 
-    FullConfig newConfig = *g_config;
+    FullConfig newConfig = *ConfigReader(); // copy of the current snapshot
 
-    if(!parseConfigJson(body, newConfig)) {
-        request->send(400, "text/plain", "Invalid JSON or parsing failed.");
+    bool parsed = hasCborBody(request) ? decodeFullConfigCbor(bodyBytes(body), body.length(), newConfig)
+                                       : parseConfigJson(body, newConfig);
+    if(!parsed) {
+        request->send(400, "text/plain", "Invalid body or parsing failed.");
         serialPrint("Failed to parse /set_config JSON.");
         return;
     }
 
-    g_stateCallback(STATE_CHANGE_CONFIG, static_cast<void*>(&newConfig));
-    request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Configuration updated\"}");
-    serialPrint("Configuration updated via WiFi. Notifying main application.");
+    sendQueued(request, enqueueCommand(STATE_CHANGE_CONFIG, &newConfig, sizeof(newConfig)),
+               "Configuration update queued");
 }
 
-void handleGetSystemConfig(AsyncWebServerRequest* request, const String&) {
-    serialPrint(String("handleGetSystemConfig: ") + request->url());
-    if(g_systemSettings == nullptr) {
-        request->send(500, "text/plain", "System settings not initialized");
+void handlePatchConfig(AsyncWebServerRequest* request, const String& body) {
+    if(body.isEmpty()) {
+        request->send(400, "text/plain", "Bad Request: Missing JSON body.");
         return;
     }
-    String jsonResponse = createSystemConfigJson(*g_systemSettings);
-    request->send(200, "application/json", jsonResponse);
-    serialPrint("Sent /get_system_config response: " + jsonResponse);
+
+    ConfigPatch patch;
+    patch.config = *ConfigReader();
+    patch.changedFields = 0;
+
+    if(!parseConfigPatchJson(body, patch.config, patch.changedFields, patch.mask)) {
+        request->send(400, "text/plain", "Invalid JSON or value out of range.");
+        LOG_W("Rejected /patch_config body, %u bytes", body.length());
+        return;
+    }
+
+    if(patch.changedFields == 0) {
+        request->send(200, "application/json", "{\"status\":\"success\",\"message\":\"Nothing to change\"}");
+        return;
+    }
+    sendQueued(request, enqueueCommand(STATE_CHANGE_CONFIG_PATCH, &patch, sizeof(patch)), "Configuration patch queued");
 }
 
-void handleSetSystemConfig(AsyncWebServerRequest* request, const String& body) {
-    serialPrint(String("handleSetSystemConfig: ") + request->url());
-    if(g_stateCallback == nullptr) {
-        request->send(500, "text/plain", "No callback registered for state changes");
+void handleGetSystemConfig(AsyncWebServerRequest* request, const String&) {
+    SystemSettings settings = readSystemSettings();
+    if(acceptsCbor(request)) {
+        uint8_t cbor[SYSTEM_CONFIG_CBOR_MAX];
+        sendCbor(request, cbor, createSystemConfigCbor(settings, cbor, sizeof(cbor)));
         return;
     }
+    request->send(200, "application/json", createSystemConfigJson(settings));
+}
+
+void handleSetSystemConfig(AsyncWebServerRequest* request, const String& body) {
     if(body.isEmpty()) {
         request->send(400, "text/plain", "Bad Request: Missing JSON body.");
         return;
     }
-    serialPrint("Received /set_system_config body: " + body);
 
-    SystemSettings newSystemSettings = *g_systemSettings;
+    SystemSettingsPatch patch;
+    patch.settings = readSystemSettings();
+    patch.fields = 0;
 
-    if(!parseSystemConfigJson(body, newSystemSettings)) {
-        request->send(400, "text/plain", "Invalid JSON or parsing failed.");
+    bool parsed = hasCborBody(request)
+                      ? decodeSystemConfigCbor(bodyBytes(body), body.length(), patch.settings, patch.fields)
+                      : parseSystemConfigJson(body, patch.settings, patch.fields);
+    if(!parsed) {
+        request->send(400, "text/plain", "Invalid body or parsing failed.");
         serialPrint("Failed to parse /set_system_config JSON.");
         return;
     }
 
-    g_stateCallback(STATE_CHANGE_SYSTEM_CONFIG, static_cast<void*>(&newSystemSettings));
-    request->send(200, "application/json",
-                  "{\"status\":\"success\",\"message\":\"System configuration "
-                  "updated\"}");
-    serialPrint("System configuration updated via WiFi. Notifying main application.");
+    // Merged and saved on the loop task; Wi-Fi restarts a second later so this response gets out first
+    sendQueued(request, enqueueCommand(STATE_CHANGE_SYSTEM_CONFIG, &patch, sizeof(patch)),
+               "System configuration update queued");
 }
 
-void handleGetStatus(AsyncWebServerRequest* request, const String&) {
-    if(g_wifiTracker == nullptr) {
-        request->send(500, "text/plain", "WiFi tracker not initialized");
-        return;
-    }
-
+// Snapshot of the Wi-Fi/NTP tracker as reported to the UI
+static WiFiStatus buildWiFiStatus() {
     WiFiStatus status;
     status.lastTestResult = g_wifiTracker->lastDateResult;
     status.timeSinceLastTestMs = millis() - g_wifiTracker->lastTestTime;
@@ -191,6 +249,11 @@ void handleGetStatus(AsyncWebServerRequest* request, const String&) {
     status.lastStaConnectionTime = g_wifiTracker->lastStaConnectionTime;
     status.staConfigValid = g_wifiTracker->staConfigValid;
     status.systemTime = time(NULL);
+    ClockStatus clock = getClockStatus();
+    status.clockErrorMs = clock.isSet ? (long)clock.errorBoundMs : -1;
+    status.clockDriftPpb = clock.driftPpm * 1000;
+    status.timeSource = g_wifiTracker->timeSource;
+    status.timeAccuracyMs = g_wifiTracker->timeAccuracyMs;
 
     if(g_wifiTracker->clockSynced) {
         struct tm timeinfo;
@@ -200,18 +263,216 @@ void handleGetStatus(AsyncWebServerRequest* request, const String&) {
             status.currentTime = String(buf);
         }
     }
-    serialPrint("send status " + status.clockSynced);
+    return status;
+}
+
+void handleGetStatus(AsyncWebServerRequest* request, const String&) {
+    if(g_wifiTracker == nullptr) {
+        request->send(500, "text/plain", "WiFi tracker not initialized");
+        return;
+    }
+
+    if(acceptsCbor(request)) {
+        uint8_t cbor[WIFI_STATUS_CBOR_MAX];
+        sendCbor(request, cbor, createWiFiStatusCbor(buildWiFiStatus(), cbor, sizeof(cbor)));
+        return;
+    }
+    request->send(200, "application/json", createWiFiStatusJson(buildWiFiStatus()));
+}
+
+// Section names are distinct, so a substring match on the comma separated list is enough
+static bool wantsSection(const String& fields, const char* section) {
+    return fields.isEmpty() || fields.indexOf(section) >= 0;
+}
+
+// Everything the UI needs on open in one response. ?fields=config,system,status,lamp selects sections.
+void handleGetState(AsyncWebServerRequest* request, const String&) {
+    if(g_wifiTracker == nullptr || g_lampState == nullptr) {
+        request->send(500, "text/plain", "State not initialized");
+        return;
+    }
+
+    String fields = request->hasParam("fields") ? request->getParam("fields")->value() : String("");
+    DynamicJsonDocument doc(2048); // system, status and lamp sections; config is linked pre-encoded
+    char configJson[FULL_CONFIG_JSON_MAX];
+    ConfigReader config; // config and lamp sections come from the same snapshot
+
+    if(wantsSection(fields, "config")) {
+        size_t len = encodeFullConfigJson(*config, configJson, sizeof(configJson));
+        doc["config"] = serialized((const char*)configJson, len);
+    }
+    if(wantsSection(fields, "system")) {
+        writeSystemConfigJson(doc.createNestedObject("system"), readSystemSettings());
+    }
+    if(wantsSection(fields, "status")) {
+        writeWiFiStatusJson(doc.createNestedObject("status"), buildWiFiStatus());
+    }
+    if(wantsSection(fields, "lamp")) {
+        JsonObject lamp = doc.createNestedObject("lamp");
+        lamp["state"] = (int)*g_lampState;
+        lamp["brightnessMode"] = config->brightnessMode;
+        lamp["activeAlarm"] = getActiveAlarmIndex();
+        lamp["goodNightActive"] = isGoodNightModeActive();
+        lamp["uptimeMs"] = millis();
+    }
+
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->addHeader("Cache-Control", "no-store");
+    serializeJson(doc, *response);
+    request->send(response);
+}
+
+void handleGetProbeStats(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createProbeStatsJson());
+}
+
+void handleGetAdmissionStats(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createAdmissionStatsJson());
+}
+
+void handleGetDnsStats(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createDnsStatsJson());
+}
+
+// Heap and per-task stack watermarks with their recent history
+void handleGetMemoryStats(AsyncWebServerRequest* request, const String&) {
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->addHeader("Cache-Control", "no-store");
+    printMemoryStatsJson(*response);
+    request->send(response);
+}
+
+void handleGetStallReport(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createStallReportJson());
+}
+
+// First half of the browser time exchange: lamp receive and send times on the esp_timer
+// scale, so a clock change between probe and /set_time does not matter
+void handleTimeProbe(AsyncWebServerRequest* request, const String&) {
+    double t1 = esp_timer_get_time() / 1000.0;
+    AsyncWebServerResponse* response
+        = request->beginResponse(200, "application/json", createTimeProbeJson(t1, esp_timer_get_time() / 1000.0));
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// Second half: the browser returns the probe times with its own, NTP style
+void handleSetTime(AsyncWebServerRequest* request, const String& body) {
+    TimeSyncRequest exchange;
+    if(!parseTimeSyncJson(body, exchange)) {
+        request->send(400, "text/plain", "Bad Request: expected t0, t1, t2 and t3.");
+        return;
+    }
+    double nowMs = esp_timer_get_time() / 1000.0;
+    double delayMs = (exchange.t3 - exchange.t0) - (exchange.t2 - exchange.t1);
+    if(exchange.t1 > exchange.t2 || exchange.t2 > nowMs || nowMs - exchange.t2 > CLOCK_CLIENT_MAX_AGE_MS
+       || delayMs < 0) {
+        request->send(400, "text/plain", "Bad Request: stale or inconsistent timestamps.");
+        return;
+    }
+
+    // Lamp timer minus browser epoch, from the midpoints of the round trip
+    double thetaMs = ((exchange.t1 - exchange.t0) + (exchange.t2 - exchange.t3)) / 2;
+    bool applied = noteClientTime((int64_t)(-thetaMs * 1000), (uint32_t)(delayMs * 500));
+    if(exchange.hasTzOffset) {
+        setClockTimeZone(exchange.tzOffsetMin);
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    double lampOffsetMs = (tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0) - (nowMs - thetaMs);
+    request->send(200, "application/json", createTimeSyncResultJson(applied, lampOffsetMs, delayMs / 2));
+}
+
+void handleGetRadioStats(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createRadioStatsJson());
+}
+
+// ?reset=1 starts the counters over, e.g. between benchmark steps
+void handleGetRealtimeStats(AsyncWebServerRequest* request, const String&) {
+    bool reset = request->hasParam("reset") && request->getParam("reset")->value() == "1";
+    request->send(200, "application/json", createRealtimeStatsJson(reset));
+}
+
+void handleGetLampGroup(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createLampGroupJson());
+}
+
+void handleGetOtaStatus(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createOtaStatusJson());
+}
+
+// Answers from the cache right away; a stale cache is refreshed by the loop task in the background
+void handleGetWifiNetworks(AsyncWebServerRequest* request, const String&) {
+    requestWifiScan();
+    request->send(200, "application/json", createWifiScanJson());
+}
+
+// Chrome Trace Event JSON of the trace rings, generated chunk by chunk while recording is paused
+void handleGetTrace(AsyncWebServerRequest* request, const String&) {
+    size_t len = beginTraceDump();
+    if(len == 0) {
+        request->send(409, "text/plain", "A trace download is already running.");
+        return;
+    }
+    AsyncWebServerResponse* response
+        = request->beginResponse("application/json", len, [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+              return readTraceDump(buffer, maxLen, index);
+          });
+    response->addHeader("Content-Disposition", "attachment; filename=\"lamp-trace.json\"");
+    response->addHeader("Cache-Control", "no-store");
+    onAdmittedDisconnect(request, []() { endTraceDump(); });
+    request->send(response);
+}
+
+void handleGetTraceStatus(AsyncWebServerRequest* request, const String&) {
+    request->send(200, "application/json", createTraceStatusJson());
+}
+
+// Turns recording on or off: {"enabled":true}
+void handleSetTrace(AsyncWebServerRequest* request, const String& body) {
+    bool enabled;
+    if(!parseTraceControlJson(body, enabled)) {
+        request->send(400, "text/plain", "Bad Request: expected {\"enabled\":true|false}.");
+        return;
+    }
+    setTraceEnabled(enabled);
+    request->send(200, "application/json", createTraceStatusJson());
+}
+
+// Prometheus scrape target
+void handleGetMetrics(AsyncWebServerRequest* request, const String&) {
+    AsyncResponseStream* response = request->beginResponseStream("text/plain; version=0.0.4");
+    response->addHeader("Cache-Control", "no-store");
+    printMetrics(*response);
+    request->send(response);
+}
+
+// State of a command returned by a set/patch route: /command?id=N
+void handleGetCommand(AsyncWebServerRequest* request, const String&) {
+    if(!request->hasParam("id")) {
+        request->send(400, "text/plain", "Bad Request: Missing id.");
+        return;
+    }
+    uint32_t id = strtoul(request->getParam("id")->value().c_str(), nullptr, 10);
+    AsyncWebServerResponse* response
+        = request->beginResponse(200, "application/json", createCommandStatusJson(id, getCommandState(id)));
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
 
-    request->send(200, "application/json", createWiFiStatusJson(status));
+// Recent log records formatted from the logger history, oldest first
+void handleGetLogs(AsyncWebServerRequest* request, const String&) {
+    AsyncResponseStream* response = request->beginResponseStream("text/plain");
+    response->addHeader("Cache-Control", "no-store");
+    printLogHistory(*response);
+    request->send(response);
 }
 
 // Initialization functions to set global state and return routes
-std::vector<Route> initRouteHandlers(const FullConfig* config, const SystemSettings* systemSettings,
-                                     const WiFiTestTracker* wifiTracker, GenericStateUpdateCallback stateCallback) {
-    g_config = config;
-    g_systemSettings = systemSettings;
+std::vector<Route> initRouteHandlers(const WiFiTestTracker* wifiTracker, const LampState* lampState) {
     g_wifiTracker = wifiTracker;
-    g_stateCallback = stateCallback;
+    g_lampState = lampState;
 
     return {{"/", HTTP_ANY, handleRoot},
             {"/pico.min.css", HTTP_GET, handlePicoCSS},
@@ -219,8 +480,28 @@ std::vector<Route> initRouteHandlers(const FullConfig* config, const SystemSetti
             {"/app.css", HTTP_GET, handleAppCSS},
             {"/get_config", HTTP_GET, handleGetConfig},
             {"/set_config", HTTP_POST, handleSetConfig},
+            {"/patch_config", HTTP_PATCH, handlePatchConfig},
             {"/get_system_config", HTTP_GET, handleGetSystemConfig},
             {"/set_system_config", HTTP_POST, handleSetSystemConfig},
             {"/get_status", HTTP_GET, handleGetStatus},
+            {"/state", HTTP_GET, handleGetState},
+            {"/get_probe_stats", HTTP_GET, handleGetProbeStats},
+            {"/get_admission_stats", HTTP_GET, handleGetAdmissionStats},
+            {"/get_dns_stats", HTTP_GET, handleGetDnsStats},
+            {"/get_memory_stats", HTTP_GET, handleGetMemoryStats},
+            {"/command", HTTP_GET, handleGetCommand},
+            {"/metrics", HTTP_GET, handleGetMetrics},
+            {"/get_stall_report", HTTP_GET, handleGetStallReport},
+            {"/get_radio_stats", HTTP_GET, handleGetRadioStats},
+            {"/get_wifi_networks", HTTP_GET, handleGetWifiNetworks},
+            {"/get_ota_status", HTTP_GET, handleGetOtaStatus},
+            {"/get_realtime_stats", HTTP_GET, handleGetRealtimeStats},
+            {"/get_lamp_group", HTTP_GET, handleGetLampGroup},
+            {"/time_probe", HTTP_GET, handleTimeProbe},
+            {"/set_time", HTTP_POST, handleSetTime},
+            {"/trace", HTTP_GET, handleGetTrace},
+            {"/get_trace_status", HTTP_GET, handleGetTraceStatus},
+            {"/set_trace", HTTP_POST, handleSetTrace},
+            {"/logs", HTTP_GET, handleGetLogs},
             {"/ping", HTTP_GET, handlePing}};
 }
\ No newline at end of file
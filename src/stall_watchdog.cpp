@@ -0,0 +1,175 @@
+#include "stall_watchdog.h"
+#include <esp_attr.h>
+#include <esp_idf_version.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include "debug_utils.h"
+#include "metrics.h"
+
+#define STALL_CHECK_INTERVAL_MS 100
+#define STALL_TASK_STACK 2048
+#define STALL_TASK_PRIORITY 10 // above loopTask (1) and async_tcp (3)
+#define STALL_RECORD_MAGIC 0x57A11ED5u
+
+// Kept in RTC slow memory, which a watchdog or software reset leaves untouched
+struct StallRecord {
+    uint32_t magic;
+    uint32_t stalls;
+    uint32_t durationMs; // of the most recent stall, updated while it lasts
+    uint32_t uptimeS;    // when the most recent stall began
+    uint8_t phase;
+    uint8_t escalated;
+    uint16_t reserved;
+    uint32_t check; // guards against the random contents left by a power-on
+};
+
+std::atomic<uint32_t> loopPhaseSlot(0);
+
+static RTC_NOINIT_ATTR StallRecord rtcRecord;
+static StallRecord previousRecord;
+static bool hasPreviousRecord = false;
+static bool watchdogConfigured = false;
+static portMUX_TYPE recordMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char* const phaseNames[LOOP_PHASE_COUNT] = {
+    "idle", "commands", "sync_config", "led", "clock", "wifi", "rotary", "alarms", "lamp_state", "good_night", "save",
+    "diagnostics"};
+
+const char* loopPhaseName(uint8_t phase) {
+    return phase < LOOP_PHASE_COUNT ? phaseNames[phase] : "unknown";
+}
+
+static uint32_t recordCheck(const StallRecord& record) {
+    return record.magic ^ record.stalls ^ record.durationMs ^ record.uptimeS
+           ^ ((uint32_t)record.phase | (uint32_t)record.escalated << 8) ^ 0xA5A5A5A5u;
+}
+
+static bool isRecordValid(const StallRecord& record) {
+    return record.magic == STALL_RECORD_MAGIC && record.check == recordCheck(record) && record.stalls > 0;
+}
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+    switch(reason) {
+    case ESP_RST_POWERON:
+        return "power_on";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+        return "interrupt_watchdog";
+    case ESP_RST_TASK_WDT:
+        return "task_watchdog";
+    case ESP_RST_WDT:
+        return "other_watchdog";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    case ESP_RST_DEEPSLEEP:
+        return "deep_sleep";
+    default:
+        return "other";
+    }
+}
+
+// Panic, and with it a reset, once a subscribed task stops feeding the watchdog
+static bool configureTaskWatchdog() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_task_wdt_config_t config = {STALL_WDT_TIMEOUT_S * 1000, 1 << 0, true}; // keep watching idle on core 0
+    esp_err_t err = esp_task_wdt_reconfigure(&config);
+    if(err == ESP_ERR_INVALID_STATE) {
+        err = esp_task_wdt_init(&config);
+    }
+#else
+    esp_err_t err = esp_task_wdt_init(STALL_WDT_TIMEOUT_S, true); // reconfigures if already running
+#endif
+    return err == ESP_OK;
+}
+
+static void monitorTaskMain(void*) {
+    bool feeding = watchdogConfigured && esp_task_wdt_add(nullptr) == ESP_OK;
+    if(!feeding) {
+        LOG_E("Stall watchdog: task watchdog unavailable, stalls are only recorded");
+    }
+    uint32_t reportedSlot = 0;  // slot value of the stall already counted
+    uint32_t escalatedSlot = 0; // and of the one already left to the watchdog
+
+    for(;;) {
+        uint32_t slot = loopPhaseSlot.load(std::memory_order_relaxed);
+        uint32_t elapsed = (millis() - slot) & LOOP_PHASE_STAMP_MASK;
+        bool hung = false;
+
+        if(elapsed > STALL_BUDGET_MS) {
+            uint8_t phase = slot >> 24;
+            hung = elapsed > STALL_RESET_MS;
+            bool isNew = slot != reportedSlot;
+
+            portENTER_CRITICAL(&recordMux);
+            if(isNew) {
+                rtcRecord.stalls++;
+                rtcRecord.phase = phase;
+                rtcRecord.uptimeS = (millis() - elapsed) / 1000;
+            }
+            rtcRecord.durationMs = elapsed;
+            rtcRecord.escalated = hung;
+            rtcRecord.check = recordCheck(rtcRecord);
+            portEXIT_CRITICAL(&recordMux);
+
+            if(isNew) {
+                reportedSlot = slot;
+                countMetric(METRIC_LOOP_STALLS);
+                LOG_W("Loop stalled in phase %s for over %u ms", loopPhaseName(phase), (unsigned)STALL_BUDGET_MS);
+            }
+            if(hung && feeding && slot != escalatedSlot) {
+                escalatedSlot = slot;
+                LOG_E("Loop stuck in phase %s for %u ms, leaving it to the task watchdog", loopPhaseName(phase),
+                      (unsigned)elapsed);
+            }
+        }
+
+        if(feeding && !hung) {
+            esp_task_wdt_reset();
+        }
+        vTaskDelay(pdMS_TO_TICKS(STALL_CHECK_INTERVAL_MS));
+    }
+}
+
+void initStallWatchdog() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    if(reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && isRecordValid(rtcRecord)) {
+        previousRecord = rtcRecord;
+        hasPreviousRecord = true;
+        LOG_W("Previous boot: %u loop stall(s), last in phase %s for %u ms%s, reset reason %s",
+              (unsigned)previousRecord.stalls, loopPhaseName(previousRecord.phase),
+              (unsigned)previousRecord.durationMs, previousRecord.escalated ? " (escalated)" : "",
+              resetReasonName(reason));
+    }
+
+    memset(&rtcRecord, 0, sizeof(rtcRecord));
+    rtcRecord.magic = STALL_RECORD_MAGIC;
+    rtcRecord.check = recordCheck(rtcRecord);
+
+    enterLoopPhase(LOOP_PHASE_IDLE);
+    watchdogConfigured = configureTaskWatchdog();
+    xTaskCreate(monitorTaskMain, "stall_watch", STALL_TASK_STACK, nullptr, STALL_TASK_PRIORITY, nullptr);
+}
+
+StallReport getStallReport() {
+    StallReport report;
+    report.hasPrevious = hasPreviousRecord;
+    report.previousEscalated = previousRecord.escalated;
+    report.previousPhase = previousRecord.phase;
+    report.previousDurationMs = previousRecord.durationMs;
+    report.previousUptimeS = previousRecord.uptimeS;
+    report.previousStalls = previousRecord.stalls;
+    report.resetReason = resetReasonName(esp_reset_reason());
+
+    portENTER_CRITICAL(&recordMux);
+    report.stalls = rtcRecord.stalls;
+    report.lastPhase = rtcRecord.phase;
+    report.lastDurationMs = rtcRecord.durationMs;
+    portEXIT_CRITICAL(&recordMux);
+
+    report.budgetMs = STALL_BUDGET_MS;
+    report.resetAfterMs = STALL_RESET_MS;
+    return report;
+}
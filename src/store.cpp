@@ -3,6 +3,8 @@
 #include <Preferences.h>
 
 #include "debug_utils.h"
+#include "metrics.h"
+#include "trace.h"
 
 #include "types.h"
 #include <Arduino.h>
@@ -11,7 +13,20 @@ static Preferences preferences;
 
 // Define a namespace for preferences to avoid conflicts
 const char* PREF_NAMESPACE = "lisas_lamp_cfg";
-const char* CONFIG_KEY = "fullConfig";
+const char* CONFIG_KEY = "fullConfigTlv"; // records from encodeFullConfigStorage
+const char* LEGACY_CONFIG_KEY = "fullConfig"; // raw struct written by earlier firmware
+
+// Layout of the raw struct stored under LEGACY_CONFIG_KEY, kept only for the one-time import
+struct LegacyFullConfig {
+    RGB color;
+    byte brightnessMode;
+    byte colorMode;
+    byte animationMode;
+    Alarm alarms[MAX_ALARMS];
+    uint16_t goodNightDuration;
+    uint16_t alarmDuration;
+    uint16_t animationSpeed;
+};
 
 // Debounced save support
 static FullConfig pendingConfig;
@@ -28,23 +43,32 @@ bool saveFullConfig(const FullConfig& config, bool debounce) {
     }
     lastSaveRequestTime = 0; // Reset debounce timer
 
+    if(!isValidFullConfig(config)) {
+        serialPrint("Refusing to save FullConfig outside the schema ranges");
+        return false;
+    }
+    uint8_t record[FULL_CONFIG_STORAGE_MAX];
+    size_t recordLen = encodeFullConfigStorage(config, record, sizeof(record));
+
     if(!preferences.begin(PREF_NAMESPACE,
                           false)) { // Open preferences in R/W mode
         serialPrint("Failed to open preferences for writing");
         return false;
     }
 
-    // Use putBytes to save the entire struct
-    size_t bytesWritten = preferences.putBytes(CONFIG_KEY, &config, sizeof(FullConfig));
+    traceBegin(TRACE_NVS_WRITE);
+    size_t bytesWritten = preferences.putBytes(CONFIG_KEY, record, recordLen);
+    traceEnd(TRACE_NVS_WRITE);
     preferences.end(); // Close preferences
 
-    if(bytesWritten == sizeof(FullConfig)) {
+    if(bytesWritten == recordLen) {
+        countMetric(METRIC_FLASH_WRITES);
         serialPrint("FullConfig saved successfully!");
         // lastSavedTime = millis();
         // savePending = false;
         return true;
     } else {
-        serialPrint("Failed to save FullConfig. Bytes written: " + String(bytesWritten));
+        LOG_E("Failed to save FullConfig. Bytes written: %u", bytesWritten);
         return false;
     }
 }
@@ -67,37 +91,59 @@ bool loadFullConfig(FullConfig& config) {
         return false;
     }
 
-    // Use getBytes to load the entire struct
-    size_t bytesRead = preferences.getBytes(CONFIG_KEY, &config, sizeof(FullConfig));
+    // Records may be shorter or longer than FULL_CONFIG_STORAGE_MAX when written by another schema version
+    uint8_t record[256];
+    size_t bytesRead = preferences.getBytes(CONFIG_KEY, record, sizeof(record));
     preferences.end(); // Close preferences
 
-    if(bytesRead == sizeof(FullConfig)) {
+    if(bytesRead > 0 && decodeFullConfigStorage(record, bytesRead, config)) {
         serialPrint("FullConfig loaded successfully!");
         return true;
     } else {
-        serialPrint("Failed to load FullConfig. Bytes read: " + String(bytesRead));
+        LOG_E("Failed to load FullConfig. Bytes read: %u", bytesRead);
         return false;
     }
 }
 
-FullConfig getDefaultFullConfig() {
-    FullConfig defaultConfig;
-
-    // Default RGB color (e.g., white)
-    defaultConfig.color = {255, 255, 255};
-    defaultConfig.colorMode = 1;      // Default to Neutral White
-    defaultConfig.animationMode = 1;  // Default to Breathing
-    defaultConfig.brightnessMode = 7; // Default to maximum brightness
+// Converts a config saved by firmware predating the schema and removes the old key
+static bool importLegacyFullConfig() {
+    LegacyFullConfig legacy;
+    if(!preferences.begin(PREF_NAMESPACE, false)) {
+        return false;
+    }
+    size_t bytesRead = preferences.getBytes(LEGACY_CONFIG_KEY, &legacy, sizeof(legacy));
+    preferences.end();
+    if(bytesRead != sizeof(legacy)) {
+        return false;
+    }
 
-    // Default alarms (all inactive)
-    for(int i = 0; i < MAX_ALARMS; ++i) {
-        defaultConfig.alarms[i] = {0, 0, 0, false}; // day=0 (not set), hour=0, minute=0, active=false
+    FullConfig config = getDefaultFullConfig();
+    config.color = legacy.color;
+    config.brightnessMode = legacy.brightnessMode;
+    config.colorMode = legacy.colorMode;
+    config.animationMode = legacy.animationMode;
+    memcpy(config.alarms, legacy.alarms, sizeof(config.alarms));
+    config.goodNightDuration = legacy.goodNightDuration;
+    config.alarmDuration = legacy.alarmDuration;
+    config.animationSpeed = legacy.animationSpeed;
+
+    // Round trip through the record format so out of range values fall back to their defaults
+    uint8_t record[FULL_CONFIG_STORAGE_MAX];
+    size_t recordLen = encodeFullConfigStorage(config, record, sizeof(record));
+    if(!decodeFullConfigStorage(record, recordLen, config) || !saveFullConfig(config, false)) {
+        return false;
     }
-    defaultConfig.goodNightDuration = 30;
-    defaultConfig.alarmDuration = 30;
-    defaultConfig.animationSpeed = 200;
+    if(preferences.begin(PREF_NAMESPACE, false)) {
+        preferences.remove(LEGACY_CONFIG_KEY);
+        preferences.end();
+    }
+    serialPrint("Imported FullConfig from the legacy format.");
+    return true;
+}
 
-    return defaultConfig;
+FullConfig getDefaultFullConfig() {
+    // Defaults live in config_schema.json
+    return defaultFullConfig();
 }
 
 bool resetFullConfig() {
@@ -126,30 +172,16 @@ bool resetFullConfig() {
 bool ensureConfigExistsAndResetIfNot() {
     serialPrint("Checking if FullConfig exists...");
 
-    if(!preferences.begin(PREF_NAMESPACE,
-                          true)) { // Open preferences in Read-only mode
-        serialPrint("Failed to open preferences to check config existence.");
-        // If we can't even open preferences, we can't check, so attempt to
-        // reset
-        serialPrint("Attempting to reset FullConfig due to preferences "
-                    "open failure.");
-        return resetFullConfig();
-    }
-
-    size_t storedSize = preferences.getBytesLength(CONFIG_KEY);
-    preferences.end(); // Close preferences
-
-    if(storedSize == 0) {
-        serialPrint("No FullConfig found. Resetting to defaults.");
-        return resetFullConfig();
-
-    } else if(storedSize != sizeof(FullConfig)) {
-        serialPrint("Stored FullConfig size mismatch. Resetting to defaults.");
-        return resetFullConfig();
-    } else {
+    FullConfig config;
+    if(loadFullConfig(config)) {
         serialPrint("FullConfig exists and is valid.");
         return true;
     }
+    if(importLegacyFullConfig()) {
+        return true;
+    }
+    serialPrint("No valid FullConfig found. Resetting to defaults.");
+    return resetFullConfig();
 }
 
 const char* SYSTEM_SETTINGS_KEY = "systemSettings";
@@ -174,14 +206,17 @@ bool saveSystemSettings(const SystemSettings& settings) {
         return false;
     }
 
+    traceBegin(TRACE_NVS_WRITE);
     size_t bytesWritten = preferences.putBytes(SYSTEM_SETTINGS_KEY, &settings, sizeof(SystemSettings));
+    traceEnd(TRACE_NVS_WRITE);
     preferences.end();
 
     if(bytesWritten == sizeof(SystemSettings)) {
+        countMetric(METRIC_FLASH_WRITES);
         serialPrint("SystemSettings saved successfully!");
         return true;
     } else {
-        serialPrint("Failed to save SystemSettings. Bytes written: " + String(bytesWritten));
+        LOG_E("Failed to save SystemSettings. Bytes written: %u", bytesWritten);
         return false;
     }
 }
@@ -199,7 +234,7 @@ bool loadSystemSettings(SystemSettings& settings) {
         serialPrint("SystemSettings loaded successfully!");
         return true;
     } else {
-        serialPrint("Failed to load SystemSettings. Bytes read: " + String(bytesRead));
+        LOG_E("Failed to load SystemSettings. Bytes read: %u", bytesRead);
         // If loading fails, initialize with default values
         memset(&settings, 0, sizeof(SystemSettings)); // Zero out the struct
         return false;
@@ -247,3 +282,75 @@ bool ensureSystemSettingsExistsAndResetIfNot() {
         return true;
     }
 }
+
+const char* STA_CACHE_KEY = "staCache";
+
+bool saveStaCache(const StaCache& cache) {
+    if(!preferences.begin(PREF_NAMESPACE, false)) {
+        serialPrint("Failed to open preferences for writing");
+        return false;
+    }
+
+    traceBegin(TRACE_NVS_WRITE);
+    size_t bytesWritten = preferences.putBytes(STA_CACHE_KEY, &cache, sizeof(StaCache));
+    traceEnd(TRACE_NVS_WRITE);
+    preferences.end();
+
+    if(bytesWritten == sizeof(StaCache)) {
+        countMetric(METRIC_FLASH_WRITES);
+        return true;
+    }
+    LOG_E("Failed to save StaCache. Bytes written: %u", bytesWritten);
+    return false;
+}
+
+bool loadStaCache(StaCache& cache) {
+    memset(&cache, 0, sizeof(StaCache));
+    if(!preferences.begin(PREF_NAMESPACE, true)) {
+        return false;
+    }
+    size_t bytesRead = preferences.getBytes(STA_CACHE_KEY, &cache, sizeof(StaCache));
+    preferences.end();
+
+    if(bytesRead != sizeof(StaCache)) {
+        memset(&cache, 0, sizeof(StaCache));
+        return false;
+    }
+    return true;
+}
+
+const char* CLOCK_DRIFT_KEY = "clockDrift";
+
+bool saveClockDrift(const ClockDrift& drift) {
+    if(!preferences.begin(PREF_NAMESPACE, false)) {
+        serialPrint("Failed to open preferences for writing");
+        return false;
+    }
+
+    traceBegin(TRACE_NVS_WRITE);
+    size_t bytesWritten = preferences.putBytes(CLOCK_DRIFT_KEY, &drift, sizeof(ClockDrift));
+    traceEnd(TRACE_NVS_WRITE);
+    preferences.end();
+
+    if(bytesWritten == sizeof(ClockDrift)) {
+        countMetric(METRIC_FLASH_WRITES);
+        return true;
+    }
+    LOG_E("Failed to save ClockDrift. Bytes written: %u", bytesWritten);
+    return false;
+}
+
+bool loadClockDrift(ClockDrift& drift) {
+    if(!preferences.begin(PREF_NAMESPACE, true)) {
+        return false;
+    }
+    ClockDrift stored;
+    size_t bytesRead = preferences.getBytes(CLOCK_DRIFT_KEY, &stored, sizeof(ClockDrift));
+    preferences.end();
+
+    if(bytesRead != sizeof(ClockDrift) || isnan(stored.ppm) || isnan(stored.uncertaintyPpm)) {
+        return false;
+    }
+    drift = stored;
+    return true;
+}
@@ -0,0 +1,167 @@
+#include "trace.h"
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#define TRACE_ITEM_WIDTH 128 // bytes per JSON event in a dump, padded with spaces
+
+struct TraceRecord {
+    uint32_t timestampUs; // micros(), wraps after 71 minutes
+    uint16_t arg;
+    uint8_t id;
+    uint8_t phase;
+};
+
+struct TraceRing {
+    std::atomic<uint32_t> head; // total records claimed, the slot is head % TRACE_RING_SIZE
+    TraceRecord records[TRACE_RING_SIZE];
+};
+
+// Events selected by beginTraceDump, read while recording is paused
+struct TraceDump {
+    uint64_t nowUs;
+    uint32_t first[portNUM_PROCESSORS];
+    uint32_t count[portNUM_PROCESSORS];
+    uint32_t items; // metadata plus events
+    bool wasEnabled;
+};
+
+std::atomic<bool> traceEnabled(false);
+static TraceRing rings[portNUM_PROCESSORS];
+static TraceDump dump;
+static std::atomic<bool> dumpActive(false);
+
+static const char* const traceNames[TRACE_ID_COUNT] = {"loop", "led_render", "http_handler", "dns_query",
+                                                       "nvs_write", "wifi_event", "command"};
+static const char dumpHeader[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+static const char dumpFooter[] = "]}\n";
+static const uint32_t metadataPerCore = 1 + TRACE_ID_COUNT; // process name, then one name per track
+
+// In IRAM so ISRs can record while the flash cache is disabled
+void IRAM_ATTR traceWrite(TraceId id, TracePhase phase, uint16_t arg, uint32_t timestampUs) {
+    // An ISR preempting a task on the same core claims its own slot
+    TraceRing& ring = rings[xPortGetCoreID()];
+    TraceRecord& record = ring.records[ring.head.fetch_add(1, std::memory_order_relaxed) & (TRACE_RING_SIZE - 1)];
+    record.timestampUs = timestampUs;
+    record.arg = arg;
+    record.id = id;
+    record.phase = phase;
+}
+
+void setTraceEnabled(bool enabled) {
+    if(enabled && !traceEnabled.load()) {
+        for(int core = 0; core < portNUM_PROCESSORS; core++) {
+            rings[core].head.store(0);
+        }
+    }
+    if(dumpActive.load()) {
+        dump.wasEnabled = enabled; // applied when the dump ends
+        return;
+    }
+    traceEnabled.store(enabled);
+}
+
+uint32_t getTraceEventCount() {
+    uint32_t count = 0;
+    for(int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = rings[core].head.load();
+        count += head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+    }
+    return count;
+}
+
+size_t beginTraceDump() {
+    if(dumpActive.exchange(true)) {
+        return 0;
+    }
+    dump.wasEnabled = traceEnabled.exchange(false);
+    dump.nowUs = esp_timer_get_time();
+    dump.items = 0;
+    for(int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = rings[core].head.load();
+        dump.count[core] = head < TRACE_RING_SIZE ? head : TRACE_RING_SIZE;
+        dump.first[core] = head - dump.count[core];
+        dump.items += metadataPerCore + dump.count[core];
+    }
+    return sizeof(dumpHeader) - 1 + dump.items * TRACE_ITEM_WIDTH + sizeof(dumpFooter) - 1;
+}
+
+void endTraceDump() {
+    if(dumpActive.load()) {
+        traceEnabled.store(dump.wasEnabled);
+        dumpActive.store(false);
+    }
+}
+
+// Writes item k of the dump, padded to TRACE_ITEM_WIDTH including its separator
+static void formatItem(uint32_t item, char* line) {
+    bool last = item + 1 == dump.items;
+    int len = 0;
+    for(int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t items = metadataPerCore + dump.count[core];
+        if(item >= items) {
+            item -= items;
+            continue;
+        }
+        if(item == 0) {
+            len = snprintf(line, TRACE_ITEM_WIDTH,
+                           "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"core %d\"}}", core,
+                           core);
+        } else if(item < metadataPerCore) {
+            len = snprintf(line, TRACE_ITEM_WIDTH,
+                           "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                           core, (unsigned)(item - 1), traceNames[item - 1]);
+        } else {
+            uint32_t slot = (dump.first[core] + item - metadataPerCore) & (TRACE_RING_SIZE - 1);
+            const TraceRecord& record = rings[core].records[slot];
+            // Unwrap the 32 bit timestamp against the 64 bit time of the dump
+            uint64_t ts = dump.nowUs - (uint32_t)((uint32_t)dump.nowUs - record.timestampUs);
+            const char* name = record.id < TRACE_ID_COUNT ? traceNames[record.id] : "unknown";
+            len = snprintf(line, TRACE_ITEM_WIDTH, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%u,",
+                           name, record.phase, (unsigned long long)ts, core, (unsigned)record.id);
+            if(record.phase == TRACE_COMPLETE) {
+                len += snprintf(line + len, TRACE_ITEM_WIDTH - len, "\"dur\":%u}", (unsigned)record.arg);
+            } else {
+                len += snprintf(line + len, TRACE_ITEM_WIDTH - len, "%s\"args\":{\"arg\":%u}}",
+                                record.phase == TRACE_INSTANT ? "\"s\":\"t\"," : "", (unsigned)record.arg);
+            }
+        }
+        break;
+    }
+    if(len > TRACE_ITEM_WIDTH - 2) {
+        len = TRACE_ITEM_WIDTH - 2; // cannot happen with the formats above
+    }
+    memset(line + len, ' ', TRACE_ITEM_WIDTH - 2 - len);
+    line[TRACE_ITEM_WIDTH - 2] = last ? ' ' : ',';
+    line[TRACE_ITEM_WIDTH - 1] = '\n';
+}
+
+size_t readTraceDump(uint8_t* buf, size_t maxLen, size_t index) {
+    const size_t headerLen = sizeof(dumpHeader) - 1;
+    const size_t itemsEnd = headerLen + dump.items * TRACE_ITEM_WIDTH;
+    const size_t total = itemsEnd + sizeof(dumpFooter) - 1;
+    char line[TRACE_ITEM_WIDTH];
+    size_t written = 0;
+
+    while(written < maxLen && index < total) {
+        const char* src;
+        size_t available;
+        if(index < headerLen) {
+            src = dumpHeader + index;
+            available = headerLen - index;
+        } else if(index < itemsEnd) {
+            size_t offset = (index - headerLen) % TRACE_ITEM_WIDTH;
+            formatItem((index - headerLen) / TRACE_ITEM_WIDTH, line);
+            src = line + offset;
+            available = TRACE_ITEM_WIDTH - offset;
+        } else {
+            src = dumpFooter + (index - itemsEnd);
+            available = total - index;
+        }
+        size_t n = available < maxLen - written ? available : maxLen - written;
+        memcpy(buf + written, src, n);
+        written += n;
+        index += n;
+    }
+    return written;
+}
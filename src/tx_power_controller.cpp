@@ -0,0 +1,48 @@
+#include "tx_power_controller.h"
+
+TxPowerController::TxPowerController() {
+    reset();
+}
+
+void TxPowerController::reset() {
+    _powerDbm = TX_POWER_MAX_DBM;
+    _rssiQ2 = 0;
+    _hasRssi = false;
+    _roomSamples = 0;
+}
+
+int16_t TxPowerController::peerHearsDbm(int16_t rssiDbm) const {
+    return rssiDbm - (LINK_PEER_TX_DBM - _powerDbm);
+}
+
+int8_t TxPowerController::update(int8_t sampleDbm) {
+    if(_hasRssi) {
+        _rssiQ2 += (sampleDbm * 4 - _rssiQ2) / 4;
+    } else {
+        _rssiQ2 = sampleDbm * 4;
+        _hasRssi = true;
+    }
+    const int16_t needDbm = LINK_RSSI_FLOOR_DBM + LINK_MARGIN_DB;
+
+    // A single weak sample is enough to go up, by as many steps as the deficit needs
+    int16_t deficitDb = needDbm - peerHearsDbm(sampleDbm);
+    if(deficitDb > 0) {
+        int16_t steps = (deficitDb + TX_POWER_STEP_DBM - 1) / TX_POWER_STEP_DBM;
+        int16_t powerDbm = _powerDbm + steps * TX_POWER_STEP_DBM;
+        _powerDbm = powerDbm > TX_POWER_MAX_DBM ? TX_POWER_MAX_DBM : powerDbm;
+        _roomSamples = 0;
+        return _powerDbm;
+    }
+
+    int16_t roomDb = peerHearsDbm(_rssiQ2 / 4) - needDbm;
+    if(roomDb < TX_POWER_STEP_DBM + LINK_HYSTERESIS_DB || _powerDbm <= TX_POWER_MIN_DBM) {
+        _roomSamples = 0;
+        return _powerDbm;
+    }
+    if(++_roomSamples >= LINK_STEP_DOWN_SAMPLES) {
+        int16_t powerDbm = _powerDbm - TX_POWER_STEP_DBM;
+        _powerDbm = powerDbm < TX_POWER_MIN_DBM ? TX_POWER_MIN_DBM : powerDbm;
+        _roomSamples = 0;
+    }
+    return _powerDbm;
+}
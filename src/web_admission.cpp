@@ -0,0 +1,148 @@
+#include "web_admission.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+// Tune with the numbers from /get_admission_stats
+#define MAX_IN_FLIGHT_REQUESTS 6
+#define LOW_HEAP_LARGEST_BLOCK (12 * 1024) // shed load below this contiguous heap
+#define RATE_LIMIT_CLIENTS 8               // tracked client addresses, least recently seen is evicted
+#define RATE_LIMIT_BURST 20                // requests a client may fire at once (portal page load + probes)
+#define RATE_LIMIT_REFILL_MS 200           // one request token per 200 ms = 5 req/s sustained
+
+struct ClientBucket {
+    uint32_t ip;
+    uint16_t tokens;
+    unsigned long lastRefillMs;
+    unsigned long lastSeenMs;
+};
+
+// Only touched from the async_tcp task (canHandle and onDisconnect both run there)
+static ClientBucket buckets[RATE_LIMIT_CLIENTS];
+static AdmissionStats stats;
+
+static bool takeClientToken(uint32_t ip, unsigned long now) {
+    ClientBucket* bucket = nullptr;
+    ClientBucket* oldest = &buckets[0];
+    for(int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+        if(buckets[i].ip == ip) {
+            bucket = &buckets[i];
+            break;
+        }
+        if(buckets[i].lastSeenMs < oldest->lastSeenMs) {
+            oldest = &buckets[i];
+        }
+    }
+
+    if(bucket == nullptr) {
+        bucket = oldest;
+        bucket->ip = ip;
+        bucket->tokens = RATE_LIMIT_BURST;
+        bucket->lastRefillMs = now;
+    }
+    bucket->lastSeenMs = now;
+
+    unsigned long refill = (now - bucket->lastRefillMs) / RATE_LIMIT_REFILL_MS;
+    if(refill > 0) {
+        unsigned long tokens = bucket->tokens + refill;
+        bucket->tokens = tokens > RATE_LIMIT_BURST ? RATE_LIMIT_BURST : tokens;
+        bucket->lastRefillMs += refill * RATE_LIMIT_REFILL_MS;
+    }
+
+    if(bucket->tokens == 0) {
+        return false;
+    }
+    bucket->tokens--;
+    return true;
+}
+
+static void releaseSlot() {
+    if(stats.inFlight > 0) {
+        stats.inFlight--;
+    }
+}
+
+enum AdmissionVerdict {
+    ADMIT,
+    REJECT_LOW_HEAP,
+    REJECT_BUSY,
+    REJECT_RATE_LIMITED
+};
+
+// Claims every request first; admitted ones are passed on by returning false from canHandle.
+class AdmissionGate : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest* request) override {
+        AdmissionVerdict verdict = admit(request);
+        if(verdict == ADMIT) {
+            stats.inFlight++;
+            if(stats.inFlight > stats.peakInFlight) {
+                stats.peakInFlight = stats.inFlight;
+            }
+            stats.admitted++;
+            request->onDisconnect(releaseSlot); // handlers chain onto it with onAdmittedDisconnect()
+            return false;
+        }
+        _lastVerdict = verdict;
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest* request) override {
+        AsyncWebServerResponse* response;
+        if(_lastVerdict == REJECT_RATE_LIMITED) {
+            response = request->beginResponse(429);
+        } else {
+            response = request->beginResponse(503);
+        }
+        response->addHeader("Retry-After", "2");
+        response->addHeader("Connection", "close");
+        request->send(response);
+    }
+
+private:
+    // canHandle and handleRequest run back to back on the async_tcp task
+    AdmissionVerdict _lastVerdict = ADMIT;
+
+    AdmissionVerdict admit(AsyncWebServerRequest* request) {
+        size_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        if(largestBlock < stats.minLargestFreeBlock) {
+            stats.minLargestFreeBlock = largestBlock;
+        }
+        if(largestBlock < LOW_HEAP_LARGEST_BLOCK) {
+            stats.rejectedLowHeap++;
+            return REJECT_LOW_HEAP;
+        }
+        if(stats.inFlight >= MAX_IN_FLIGHT_REQUESTS) {
+            stats.rejectedBusy++;
+            return REJECT_BUSY;
+        }
+        if(!takeClientToken((uint32_t)request->client()->remoteIP(), millis())) {
+            stats.rejectedRateLimited++;
+            return REJECT_RATE_LIMITED;
+        }
+        return ADMIT;
+    }
+};
+
+void setUpAdmissionControl(AsyncWebServer& server) {
+    memset(buckets, 0, sizeof(buckets));
+    memset(&stats, 0, sizeof(stats));
+    stats.minLargestFreeBlock = UINT32_MAX;
+    stats.lowHeapThreshold = LOW_HEAP_LARGEST_BLOCK;
+    stats.maxInFlight = MAX_IN_FLIGHT_REQUESTS;
+    server.addHandler(new AdmissionGate());
+}
+
+void onAdmittedDisconnect(AsyncWebServerRequest* request, ArDisconnectHandler handler) {
+    request->onDisconnect([handler]() {
+        handler();
+        releaseSlot();
+    });
+}
+
+AdmissionStats getAdmissionStats() {
+    AdmissionStats snapshot = stats;
+    snapshot.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    snapshot.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    snapshot.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    return snapshot;
+}
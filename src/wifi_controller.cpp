@@ -1,33 +1,84 @@
 #include <Arduino.h>
 #include <AsyncTCP.h>
-#include <DNSServer.h>
 #include <ESPAsyncWebServer.h>
 #include <WiFi.h>
 #include <esp_wifi.h>
 #include <time.h>
-#include <esp_task_wdt.h>
 #include "wifi_controller.h"
 #include "types.h"
 #include "system_utils.h"
+#include "debug_utils.h"
+#include "captive_portal.h"
+#include "web_admission.h"
+#include "captive_dns.h"
 #include "esp_sntp.h"
+#include "clock_service.h"
+#include "key_hash.h"
+#include "radio_scheduler.h"
+#include "reconnect_policy.h"
+#include "store.h"
+#include "metrics.h"
+#include "trace.h"
+#include "wifi_scan.h"
+#include "link_power.h"
+#include "ota_update.h"
+#include "realtime_udp.h"
+#include "lamp_group.h"
 
 #define MAX_CLIENTS 4 // ESP32 supports up to 10 but I have not tested it yet
 #define WIFI_CHANNEL 6
-#define DNS_INTERVAL 30
+#define STA_FAST_CONNECT_TIMEOUT_MS 1500 // unassociated after this, the cached access point is dropped
+#define WIFI_RESTART_DELAY_MS 1000 // lets the response to /set_system_config go out first
+#ifndef STA_LEASE_REUSE_MS
+#define STA_LEASE_REUSE_MS (60 * 60 * 1000UL) // how long a DHCP lease is applied as static configuration
+#endif
 
 static const unsigned long nextTestIntervalOnSuccess = 12 * 60 * 60 * 1000; // 12 hours
 static const unsigned long nextTestIntervalOnFailure = 2 * 60 * 1000;       // 2 minutes
 static const unsigned long WIFI_IDLE_TIMEOUT = 100 * 30 * 1000;             // 60 seconds
-static const unsigned long WIFI_IDLE_TIME = 1 * 60 * 1000;                  // 5 minutes max
 static const IPAddress localIP(4, 3, 2, 1);                                 // Samsung need to be in public space
 static const IPAddress subnetMask(255, 255, 255, 0);
 static const SystemSettings* g_systemSettings = nullptr;
 static std::vector<Route> g_routes;
 static WiFiTestTracker* g_wifiTracker = nullptr;
 
-DNSServer dnsServer;
 AsyncWebServer server(80);
 
+enum StaAttempt : uint8_t { STA_ATTEMPT_NONE, STA_ATTEMPT_FAST, STA_ATTEMPT_FULL };
+
+// Addresses DHCP handed out on the last full connect. Kept in RAM only: after a reboot the
+// lease may have run out, so a cold start still asks DHCP, just without the scan.
+struct StaLease {
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns1;
+    uint32_t dns2;
+    unsigned long obtainedMs;
+    bool valid;
+};
+
+static StaCache staCache;
+static StaLease staLease;
+static bool staCacheFailed = false; // skip the cache until a full connect has refreshed it
+static StaAttempt staAttempt = STA_ATTEMPT_NONE;
+static unsigned long restartRequestedMs = 0; // 0 when no restart is pending
+static bool staStaticIp = false;
+static unsigned long staAttemptStartMs = 0;
+static uint32_t staAttemptStartUs = 0;
+// Written by the WiFi event task, consumed by checkStaConnect in the loop task
+static std::atomic<uint32_t> staGotIpUs(0); // micros() at GOT_IP, 0 when nothing is pending
+static std::atomic<bool> staAssociated(false);
+static std::atomic<uint16_t> staDisconnectReason(0); // wifi_err_reason_t, 0 when nothing is pending
+// Loop task only
+static ReconnectPolicy staPolicy(esp_random);
+
+// Called by the SNTP client each time the clock was set
+static void onTimeSynced(struct timeval* tv) {
+    countMetric(METRIC_NTP_SYNCS);
+    noteTimeSync(tv);
+}
+
 void initWiFiController(const SystemSettings& settings, const std::vector<Route>& routes, WiFiTestTracker& tracker) {
     Serial.println("Initializing WiFi controller");
     Serial.printf("Internal SSID: %s\n", settings.internalSSID);
@@ -36,41 +87,48 @@ void initWiFiController(const SystemSettings& settings, const std::vector<Route>
     g_systemSettings = &settings;
     g_routes = routes;
     g_wifiTracker = &tracker;
+    loadStaCache(staCache);
 
     configTime(3600, 3600, "pool.ntp.org", "time.nist.gov");
     WiFi.onEvent(WiFiEvent);
+    WiFi.setAutoReconnect(false); // staPolicy decides when to retry
+    sntp_set_time_sync_notification_cb(onTimeSynced);
     WiFi.softAPConfig(localIP, localIP, subnetMask); // will change the mode
     WiFi.mode(WIFI_MODE_NULL);
 
-    setUpDNSServer(dnsServer, localIP);
     setUpWebserver(server, localIP, g_routes);
 
     Serial.println("WiFi controller initialized");
 }
 
 void wifiLoop() {
-    handleClientRequests();
-    checkWifiStart();
+    checkWifiRestart();
+    radioSchedulerLoop();
     checkWifiStop();
+    checkStaConnect();
+    wifiScanLoop();
+    lampGroupLoop();
+    linkPowerLoop();
     updateTelemetryWiFiStatus();
     tryReconnectSta();
 }
 
-void handleClientRequests() {
-    static unsigned long lastDnsProcessMs = 0;
-    if(!isTimeForAction(&lastDnsProcessMs, DNS_INTERVAL))
-        return;
+void restartWifiSoon() {
+    restartRequestedMs = millis() | 1;
+}
 
-    // Process DNS requests if we're in AP or APSTA mode
-    wifi_mode_t currentMode = WiFi.getMode();
-    if(currentMode == WIFI_MODE_AP || currentMode == WIFI_MODE_APSTA) {
-        dnsServer.processNextRequest();
+void checkWifiRestart() {
+    if(restartRequestedMs == 0 || millis() - restartRequestedMs < WIFI_RESTART_DELAY_MS) {
+        return;
     }
+    restartRequestedMs = 0;
+    stopWifi();
+    startWifi();
 }
 
 void checkWifiStop() {
     static unsigned long lastRunMs = 0;
-    if(!isWiFiActive() || WiFi.softAPgetStationNum() > 0) {
+    if(!isWiFiActive() || WiFi.softAPgetStationNum() > 0 || isRealtimeActive()) {
         lastRunMs = millis();
         return;
     }
@@ -81,64 +139,168 @@ void checkWifiStop() {
     }
 }
 
-void checkWifiStart() {
-    static unsigned long lastRunMs = 0;
-    if(isWiFiActive()) {
-        lastRunMs = millis();
-        return;
-    }
-
-    if(isTimeForAction(&lastRunMs, WIFI_IDLE_TIME)) {
-        startWifi();
-        lastRunMs = 0;
-    }
-}
-
 void updateTelemetryWiFiStatus() {
     static unsigned long lastRunMs = 0;
-    if(!isTimeForAction(&lastRunMs, 1 * 60 * 1000)) // every 1 minute
+    static uint32_t seenSyncCount = 0;
+    uint32_t syncCount = getClockSyncCount(); // a browser can set the clock at any time
+    if(!isTimeForAction(&lastRunMs, 1 * 60 * 1000) && syncCount == seenSyncCount) // every 1 minute
         return;
+    seenSyncCount = syncCount;
 
+    ClockStatus clock = getClockStatus();
+    g_wifiTracker->timeSource = clock.source;
+    g_wifiTracker->timeAccuracyMs = clock.syncUncertaintyMs;
     g_wifiTracker->clockSynced = isTimeSyncedWithNTP();
     g_wifiTracker->lastTestTime = millis();
     if(g_wifiTracker->clockSynced) {
         g_wifiTracker->lastSucceededTestTime = millis();
     }
-    Serial.println("Updated telemetry " + String(g_wifiTracker->clockSynced ? "synced" : "not synced"));
+    LOG_D("Updated telemetry %s", g_wifiTracker->clockSynced ? "synced" : "not synced");
 }
 
+// Retries whenever staPolicy says so; the policy never gives up, a rebooted router is
+// picked up again once it is back
 void tryReconnectSta() {
-    if(g_wifiTracker->staConfigValid || WiFi.getMode() != WIFI_MODE_APSTA) {
+    wifi_mode_t mode = WiFi.getMode();
+    if(mode != WIFI_MODE_APSTA && mode != WIFI_MODE_STA) {
         return;
     }
+    if(!staPolicy.shouldAttempt(millis())) {
+        return;
+    }
+    LOG_I("Reconnecting STA after %u failures", (unsigned)staPolicy.failures());
+    countMetric(METRIC_STA_RECONNECTS);
+    WiFi.reconnect();
+}
 
-    static unsigned long lastRunMs = 0;
-    if(!isTimeForAction(&lastRunMs, 10 * 1000)) // every 10 seconds
+static void noteStaDisconnect(uint16_t reason) {
+    uint32_t delayMs = staPolicy.onDisconnect(reason, millis());
+    DisconnectClass cls = classifyDisconnect(reason);
+    if(cls == DISCONNECT_AUTH) {
+        countMetric(METRIC_STA_AUTH_FAILURES);
+    } else if(cls == DISCONNECT_AP_GONE) {
+        countMetric(METRIC_STA_AP_LOST);
+    }
+    setMetric(METRIC_STA_BACKOFF, delayMs / 1000);
+    LOG_W("STA disconnected, reason %u (%s), retry in %u ms", (unsigned)reason, disconnectClassName(cls),
+          (unsigned)delayMs);
+}
+
+// Joins the external network. With a cached access point the channel scan is skipped, and
+// with a fresh lease DHCP as well; checkStaConnect falls back to a full connect on failure.
+static void beginSta() {
+    const SystemSettings* s = g_systemSettings;
+    bool cached = !staCacheFailed && staCache.channel != 0
+                  && staCache.ssidHash == keyHashN(s->externalSSID, strlen(s->externalSSID));
+    staStaticIp = cached && staLease.valid && millis() - staLease.obtainedMs < STA_LEASE_REUSE_MS;
+    if(staStaticIp) {
+        WiFi.config(IPAddress(staLease.ip), IPAddress(staLease.gateway), IPAddress(staLease.subnet),
+                    IPAddress(staLease.dns1), IPAddress(staLease.dns2));
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // back to DHCP
+    }
+
+    staGotIpUs.store(0);
+    staAssociated.store(false);
+    staDisconnectReason.store(0);
+    staPolicy.reset();
+    staAttemptStartMs = millis();
+    staAttemptStartUs = micros();
+    if(cached) {
+        LOG_I("STA fast connect on channel %u%s", staCache.channel, staStaticIp ? " with cached lease" : "");
+        staAttempt = STA_ATTEMPT_FAST;
+        WiFi.begin(s->externalSSID, s->externalPW, staCache.channel, staCache.bssid);
+    } else {
+        staAttempt = STA_ATTEMPT_FULL;
+        WiFi.begin(s->externalSSID, s->externalPW);
+    }
+}
+
+// Remembers the access point and lease of a connect that went through DHCP
+static void learnStaCache() {
+    StaCache learned;
+    memset(&learned, 0, sizeof(learned));
+    learned.ssidHash = keyHashN(g_systemSettings->externalSSID, strlen(g_systemSettings->externalSSID));
+    const uint8_t* bssid = WiFi.BSSID();
+    if(bssid == nullptr) {
         return;
+    }
+    memcpy(learned.bssid, bssid, sizeof(learned.bssid));
+    learned.channel = WiFi.channel();
+
+    staLease.ip = WiFi.localIP();
+    staLease.gateway = WiFi.gatewayIP();
+    staLease.subnet = WiFi.subnetMask();
+    staLease.dns1 = WiFi.dnsIP(0);
+    staLease.dns2 = WiFi.dnsIP(1);
+    staLease.obtainedMs = millis();
+    staLease.valid = true;
+    staCacheFailed = false;
+
+    // Written only when the access point changed, not on every connect
+    if(memcmp(&learned, &staCache, sizeof(learned)) != 0) {
+        staCache = learned;
+        saveStaCache(staCache);
+    }
+}
 
-    Serial.println("Attempting to reconnect STA...");
-    WiFi.reconnect();
-    // syncTimeWithNTP();
+void checkStaConnect() {
+    uint32_t gotIpUs = staGotIpUs.exchange(0);
+    if(gotIpUs != 0) {
+        if(staAttempt != STA_ATTEMPT_NONE) {
+            uint32_t durationUs = gotIpUs - staAttemptStartUs;
+            bool fast = staAttempt == STA_ATTEMPT_FAST;
+            observeMetric(fast ? METRIC_STA_CONNECT_FAST_TIME : METRIC_STA_CONNECT_FULL_TIME, durationUs);
+            LOG_I("STA got IP after %u ms (%s)", (unsigned)(durationUs / 1000), fast ? "cached" : "scan");
+            staAttempt = STA_ATTEMPT_NONE;
+        }
+        staPolicy.onConnected();
+        countMetric(METRIC_STA_CONNECTS);
+        setMetric(METRIC_STA_BACKOFF, 0);
+        if(!staStaticIp) {
+            learnStaCache();
+        }
+        return;
+    }
+
+    uint16_t reason = staDisconnectReason.exchange(0);
+    bool disconnected = reason != 0 && classifyDisconnect(reason) != DISCONNECT_IGNORED;
+    if(staAttempt == STA_ATTEMPT_FAST
+       && (disconnected || (!staAssociated.load() && millis() - staAttemptStartMs > STA_FAST_CONNECT_TIMEOUT_MS))) {
+        LOG_W("Cached access point did not answer, falling back to a full connect");
+        countMetric(METRIC_STA_FAST_FALLBACKS);
+        staCacheFailed = true;
+        staLease.valid = false;
+        beginSta();
+        return;
+    }
+    if(disconnected) {
+        staAttempt = STA_ATTEMPT_NONE;
+        noteStaDisconnect(reason);
+    }
 }
 
 void startWifi() {
     if(isWiFiActive()) {
-        Serial.println("Wifi is already connected.");
+        LOG_I("Wifi is already connected.");
         return;
     }
     const SystemSettings* s = g_systemSettings;
 
     if(strlen(s->externalSSID) > 0) {
-        Serial.println("Start APSta: " + String(s->externalSSID));
-        WiFi.begin(s->externalSSID, s->externalPW);
+        LOG_I("Start APSta"); // the SSID is not static, LOG_* only records pointers
+        if(WiFi.getMode() != WIFI_MODE_STA) {
+            beginSta(); // unless a sync window is already joining
+        }
         WiFi.softAP(s->internalSSID, s->internalPW, WIFI_CHANNEL, 0, MAX_CLIENTS);
         WiFi.mode(WIFI_MODE_APSTA);
     } else {
-        Serial.println("Start AP");
+        LOG_I("Start AP");
         WiFi.mode(WIFI_MODE_AP);
     }
     server.begin();
-    dnsServer.start(53, "*", localIP);
+    startCaptiveDns(localIP);
+    startRealtime();
 }
 
 void stopWifi() {
@@ -148,8 +310,11 @@ void stopWifi() {
         return;
     }
 
-    dnsServer.stop();
+    stopCaptiveDns();
+    stopRealtime();
     server.end();
+    staAttempt = STA_ATTEMPT_NONE;
+    staPolicy.reset();
     // WiFi.disconnect(true);
     // WiFi.softAPdisconnect(true);
     WiFi.mode(WIFI_MODE_NULL);
@@ -157,6 +322,31 @@ void stopWifi() {
     Serial.println("stopWifi: All WiFi services stopped");
 }
 
+// STA only, no web server: just long enough for SNTP to set the clock
+bool startSyncWindow() {
+    const SystemSettings* s = g_systemSettings;
+    if(WiFi.getMode() != WIFI_MODE_NULL || strlen(s->externalSSID) == 0) {
+        return false;
+    }
+    LOG_I("Opening NTP sync window");
+    WiFi.mode(WIFI_MODE_STA);
+    beginSta();
+    return true;
+}
+
+void stopSyncWindow() {
+    if(WiFi.getMode() != WIFI_MODE_STA) {
+        return; // a user session took over
+    }
+    staAttempt = STA_ATTEMPT_NONE;
+    staPolicy.reset();
+    WiFi.mode(WIFI_MODE_NULL);
+}
+
+bool isRadioOn() {
+    return WiFi.getMode() != WIFI_MODE_NULL;
+}
+
 bool isWiFiActive() {
     wifi_mode_t currentMode = WiFi.getMode();
     return currentMode == WIFI_MODE_AP || currentMode == WIFI_MODE_APSTA;
@@ -181,122 +371,62 @@ void syncTimeWithNTP() {
     sntp_restart(); // sntp_init();
 }
 
+// The SNTP status only reports COMPLETED once per sync; the clock service also
+// knows how far the clock may have drifted since
 bool isTimeSyncedWithNTP() {
-    return (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED);
+    return isClockSynced();
 }
 
 void WiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
-    static int retryCount = 0;
+    traceInstant(TRACE_WIFI_EVENT, event);
     switch(event) {
     case ARDUINO_EVENT_WIFI_STA_STOP:
         Serial.println("STA Stop");
         break;
     case ARDUINO_EVENT_WIFI_STA_START:
         Serial.println("STA Start");
-        retryCount = 0;
         break;
     case ARDUINO_EVENT_WIFI_STA_CONNECTED:
         Serial.println("STA Connected");
+        staAssociated.store(true);
         break;
     case ARDUINO_EVENT_WIFI_STA_GOT_IP:
         Serial.println("STA Got IP");
         g_wifiTracker->staConfigValid = true;
         g_wifiTracker->lastStaConnectionTime = millis();
+        staGotIpUs.store(micros() | 1); // never 0
         syncTimeWithNTP();
         updateTelemetryWiFiStatus();
         break;
     case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
         updateTelemetryWiFiStatus();
         Serial.println("STA Disconnected");
-
+        // Classified and retried by the loop task, see checkStaConnect
+        staDisconnectReason.store(info.wifi_sta_disconnected.reason);
         if(WiFi.getMode() == WIFI_MODE_APSTA) {
             g_wifiTracker->staConfigValid = false;
-            if(retryCount < 10) {
-                // delay(200);
-                Serial.println("Retrying STA connection, attempt " + String(retryCount + 1));
-                retryCount++;
-                return;
-            } else {
-                WiFi.mode(WIFI_MODE_AP);
-                // g_wifiTracker->staConfigValid = false;
-                Serial.println("Max retry attempts reached. Switching to AP mode only.");
-            }
         }
         break;
     }
     }
 }
 
-void setUpDNSServer(DNSServer& dnsServer, const IPAddress& localIP) {
-    // Set the TTL for DNS response and start the DNS server
-    dnsServer.setTTL(3600);
-    // Ensure the DNS reply code is NoError so client OSes treat DNS replies
-    // like valid responses
-    dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
-}
-
 void setUpWebserver(AsyncWebServer& server, const IPAddress& localIP, const std::vector<Route>& routes) {
-    // https://github.com/CDFER/Captive-Portal-ESP32/blob/main/src/main.cpp
-    //  Captive Portal
-    // Pre reading on the fundamentals of captive portals
-    // https://textslashplain.com/2022/06/24/captive-portals/
-    // Initialize the runtime URL used by redirect handlers so it's always
-    // correct
-    const String localIPURL = String("http://") + localIP.toString();
-
-    //======================== Webserver ========================
-    // WARNING IOS (and maybe macos) WILL NOT POP UP IF IT CONTAINS THE WORD
-    // "Success" https://www.esp8266.com/viewtopic.php?f=34&t=4398 SAFARI (IOS)
-    // IS STUPID, G-ZIPPED FILES CAN'T END IN .GZ
-    // https://github.com/homieiot/homie-esp8266/issues/476 this is fixed by the
-    // webserver serve static function. SAFARI (IOS) there is a 128KB limit to
-    // the size of the HTML. The HTML can reference external resources/images
-    // that bring the total over 128KB SAFARI (IOS) popup browser has some
-    // severe limitations (javascript disabled, cookies disabled)
-
-    // Required
-    server.on("/connecttest.txt", [](AsyncWebServerRequest* request) {
-        request->redirect("http://logout.net");
-    }); // windows 11 captive portal workaround
-    server.on("/wpad.dat", [](AsyncWebServerRequest* request) {
-        request->send(404);
-    }); // Honestly don't understand what this is but a 404 stops win 10 keep
-        // calling this repeatedly and panicking the esp32 :)
-
-    // Background responses: Probably not all are Required, but some are. Others
-    // might speed things up? A Tier (commonly used by modern systems)
-    server.on("/generate_204", [localIPURL](AsyncWebServerRequest* request) {
-        request->redirect(localIPURL);
-    }); // android captive portal redirect
-    server.on("/redirect",
-              [localIPURL](AsyncWebServerRequest* request) { request->redirect(localIPURL); }); // microsoft redirect
-    server.on("/hotspot-detect.html",
-              [localIPURL](AsyncWebServerRequest* request) { request->redirect(localIPURL); }); // apple call home
-    server.on("/canonical.html", [localIPURL](AsyncWebServerRequest* request) {
-        request->redirect(localIPURL);
-    }); // firefox captive portal call home
-    server.on("/success.txt",
-              [localIPURL](AsyncWebServerRequest* request) { request->send(200); }); // firefox captive portal call home
-    server.on("/ncsi.txt",
-              [localIPURL](AsyncWebServerRequest* request) { request->redirect(localIPURL); }); // windows call home
-
-    // B Tier (uncommon)
-    //  server.on("/chrome-variations/seed",[](AsyncWebServerRequest
-    //  *request){request->send(200);}); //chrome captive portal call home
-    //  server.on("/service/update2/json",[](AsyncWebServerRequest
-    //  *request){request->send(200);});
-    //  //firefox? server.on("/chat",[](AsyncWebServerRequest
-    //  *request){request->send(404);}); //No stop asking Whatsapp, there is no
-    //  internet connection server.on("/startpage",[](AsyncWebServerRequest
-    //  *request){request->redirect(localIPURL);});
-
-    // return 404 to webpage icon
-    server.on("/favicon.ico", [](AsyncWebServerRequest* request) { request->send(404); }); // webpage icon
-
-    // Register provided application routes
-    for(const auto& r : routes) {
-        if(r.method == HTTP_POST) {
-            // For POST routes, capture body and pass to handler
+    // Must be the first handler so rejected requests never reach the others
+    setUpAdmissionControl(server);
+
+    // OS connectivity probes and the catch-all redirect
+    setUpCaptivePortal(server, localIP);
+
+    // Streamed uploads, their bodies never go through the route table's buffering
+    setUpOtaRoutes(server);
+
+    // Register provided application routes; the index labels the request counter
+    setMetricRoutes(routes.data(), routes.size());
+    for(size_t i = 0; i < routes.size(); i++) {
+        const Route& r = routes[i];
+        if(r.method == HTTP_POST || r.method == HTTP_PATCH) {
+            // For POST/PATCH routes, capture body and pass to handler
             server.on(
                 r.uri, r.method,
                 [](AsyncWebServerRequest* request) {
@@ -304,7 +434,7 @@ void setUpWebserver(AsyncWebServer& server, const IPAddress& localIP, const std:
                     // The body handler will trigger the actual logic
                 },
                 NULL,
-                [r](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+                [r, i](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
                     if(index == 0) {
                         // Start of body, initialize buffer
                         request->_tempObject = new String("");
@@ -325,7 +455,12 @@ void setUpWebserver(AsyncWebServer& server, const IPAddress& localIP, const std:
                     if(index + len == total) {
                         // Full body received
                         if(body) {
+                            countHttpRequest(i);
+                            unsigned long start = micros();
+                            traceBegin(TRACE_HTTP_HANDLER, i);
                             r.handler(request, *body);
+                            traceEnd(TRACE_HTTP_HANDLER, i);
+                            observeMetric(METRIC_HTTP_HANDLER_TIME, micros() - start);
                             delete body;
                             request->_tempObject = nullptr;
                         } else {
@@ -335,18 +470,14 @@ void setUpWebserver(AsyncWebServer& server, const IPAddress& localIP, const std:
                 });
         } else {
             // For GET routes, pass empty body
-            server.on(r.uri, r.method, [r](AsyncWebServerRequest* request) { r.handler(request, String("")); });
+            server.on(r.uri, r.method, [r, i](AsyncWebServerRequest* request) {
+                countHttpRequest(i);
+                unsigned long start = micros();
+                traceBegin(TRACE_HTTP_HANDLER, i);
+                r.handler(request, String(""));
+                traceEnd(TRACE_HTTP_HANDLER, i);
+                observeMetric(METRIC_HTTP_HANDLER_TIME, micros() - start);
+            });
         }
     }
-
-    // the catch all
-    server.onNotFound([localIPURL](AsyncWebServerRequest* request) {
-        request->redirect(localIPURL);
-        Serial.print("onnotfound ");
-        Serial.print(request->host()); // This gives some insight into whatever was being
-                                       // requested on the serial monitor
-        Serial.print(" ");
-        Serial.print(request->url());
-        Serial.print(" sent redirect to " + localIPURL + "\n");
-    });
-}
\ No newline at end of file
+}
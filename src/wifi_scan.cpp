@@ -0,0 +1,162 @@
+#include "wifi_scan.h"
+#include <WiFi.h>
+#include <atomic>
+#include "debug_utils.h"
+#include "wifi_controller.h"
+
+static std::atomic<bool> scanRequested(false);
+static std::atomic<bool> scanning(false);
+
+// Loop task only
+static unsigned long scanStartMs = 0;
+static bool restoreApOnly = false; // scanNetworks() turns the STA interface on
+
+// Written by the loop task, read by the web task; guarded by cacheMux
+static portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+static WifiNetwork cache[WIFI_SCAN_MAX_RESULTS];
+static uint8_t cacheCount = 0;
+static bool cacheValid = false;
+static unsigned long cacheTimeMs = 0;
+
+const char* wifiAuthName(uint8_t auth) {
+    switch(auth) {
+    case WIFI_AUTH_OPEN:
+        return "open";
+    case WIFI_AUTH_WEP:
+        return "wep";
+    case WIFI_AUTH_WPA_PSK:
+        return "wpa";
+    case WIFI_AUTH_WPA2_PSK:
+        return "wpa2";
+    case WIFI_AUTH_WPA_WPA2_PSK:
+        return "wpa/wpa2";
+    case WIFI_AUTH_WPA2_ENTERPRISE:
+        return "wpa2-enterprise";
+    case WIFI_AUTH_WPA3_PSK:
+        return "wpa3";
+    case WIFI_AUTH_WPA2_WPA3_PSK:
+        return "wpa2/wpa3";
+    default:
+        return "other";
+    }
+}
+
+void requestWifiScan() {
+    if(scanning.load()) {
+        return;
+    }
+    portENTER_CRITICAL(&cacheMux);
+    bool fresh = cacheValid && millis() - cacheTimeMs < WIFI_SCAN_FRESH_MS;
+    portEXIT_CRITICAL(&cacheMux);
+    if(!fresh) {
+        scanRequested.store(true);
+    }
+}
+
+// Keeps one entry per SSID, the strongest, in descending RSSI order. Hidden networks are skipped.
+static uint8_t insertNetwork(WifiNetwork* networks, uint8_t count, const WifiNetwork& network) {
+    for(uint8_t i = 0; i < count; i++) {
+        if(strcmp(networks[i].ssid, network.ssid) == 0) {
+            if(networks[i].rssi >= network.rssi) {
+                return count;
+            }
+            memmove(&networks[i], &networks[i + 1], (count - i - 1) * sizeof(WifiNetwork));
+            count--;
+            break;
+        }
+    }
+    uint8_t pos = 0;
+    while(pos < count && networks[pos].rssi >= network.rssi) {
+        pos++;
+    }
+    if(pos == WIFI_SCAN_MAX_RESULTS) {
+        return count; // weaker than everything kept
+    }
+    if(count == WIFI_SCAN_MAX_RESULTS) {
+        count--; // drop the weakest
+    }
+    memmove(&networks[pos + 1], &networks[pos], (count - pos) * sizeof(WifiNetwork));
+    networks[pos] = network;
+    return count + 1;
+}
+
+static void collectResults(int16_t found) {
+    WifiNetwork networks[WIFI_SCAN_MAX_RESULTS];
+    uint8_t count = 0;
+    for(int16_t i = 0; i < found; i++) {
+        WifiNetwork network;
+        String ssid = WiFi.SSID(i);
+        if(ssid.isEmpty()) {
+            continue;
+        }
+        strlcpy(network.ssid, ssid.c_str(), sizeof(network.ssid));
+        network.rssi = WiFi.RSSI(i);
+        network.channel = WiFi.channel(i);
+        network.auth = WiFi.encryptionType(i);
+        count = insertNetwork(networks, count, network);
+    }
+
+    portENTER_CRITICAL(&cacheMux);
+    memcpy(cache, networks, count * sizeof(WifiNetwork));
+    cacheCount = count;
+    cacheValid = true;
+    cacheTimeMs = millis();
+    portEXIT_CRITICAL(&cacheMux);
+    LOG_I("WiFi scan found %d networks, %u kept", (int)found, (unsigned)count);
+}
+
+static void finishScan() {
+    WiFi.scanDelete();
+    if(restoreApOnly && WiFi.getMode() == WIFI_MODE_APSTA) {
+        WiFi.enableSTA(false);
+    }
+    scanning.store(false);
+}
+
+void wifiScanLoop() {
+    if(scanning.load()) {
+        int16_t found = WiFi.scanComplete();
+        if(found == WIFI_SCAN_RUNNING) {
+            if(millis() - scanStartMs > WIFI_SCAN_TIMEOUT_MS) {
+                LOG_W("WiFi scan timed out");
+                finishScan();
+            }
+            return;
+        }
+        if(found >= 0) {
+            collectResults(found);
+        } else {
+            LOG_W("WiFi scan failed");
+        }
+        finishScan();
+        return;
+    }
+
+    if(!scanRequested.exchange(false)) {
+        return;
+    }
+    // Only for the settings dialog, which needs a user session; a sync window must not be disturbed
+    if(!isWiFiActive()) {
+        return;
+    }
+    restoreApOnly = WiFi.getMode() == WIFI_MODE_AP;
+    scanStartMs = millis();
+    scanning.store(true);
+    if(WiFi.scanNetworks(true, false, false, WIFI_SCAN_DWELL_MS) != WIFI_SCAN_RUNNING) {
+        // E.g. while the station is connecting; the next request tries again
+        LOG_W("WiFi scan could not start");
+        finishScan();
+    }
+}
+
+WifiScanResults getWifiScanResults() {
+    WifiScanResults results;
+    results.scanning = scanning.load() || scanRequested.load();
+    portENTER_CRITICAL(&cacheMux);
+    results.valid = cacheValid;
+    results.ageMs = cacheValid ? millis() - cacheTimeMs : 0;
+    results.count = cacheCount;
+    memcpy(results.networks, cache, cacheCount * sizeof(WifiNetwork));
+    portEXIT_CRITICAL(&cacheMux);
+    return results;
+}
@@ -0,0 +1,37 @@
+// Generated by scripts/generate_config.py from config_schema.json. Do not edit.
+
+export const CONFIG_SCHEMA_VERSION = 1;
+export const MAX_ALARMS = 10;
+
+// Inclusive value ranges enforced by the firmware, keyed like the JSON document
+export const configRanges = {
+  override_color: {
+    r: { min: 0, max: 255 },
+    g: { min: 0, max: 255 },
+    b: { min: 0, max: 255 },
+  },
+  colorMode: { min: 0, max: 3 },
+  animationMode: { min: 0, max: 1 },
+  alarms: {
+    day: { min: 0, max: 7 },
+    hour: { min: 0, max: 23 },
+    minute: { min: 0, max: 59 },
+  },
+  goodNightDuration: { min: 1, max: 1440 },
+  alarmDuration: { min: 1, max: 1440 },
+  animationSpeed: { min: 10, max: 5000 },
+};
+
+// Returns a fresh default config so callers may mutate it
+export function createDefaultConfig() {
+  return {
+    override_color: { r: 255, g: 255, b: 255 },
+    colorMode: 1,
+    animationMode: 1,
+    alarms: Array.from({ length: MAX_ALARMS }, () => ({ day: 0, hour: 0, minute: 0, active: false })),
+    goodNightDuration: 30,
+    alarmDuration: 30,
+    animationSpeed: 200,
+    lampGroup: false,
+  };
+}
@@ -19,6 +19,7 @@ export const mockConfig = {
   goodNightDuration: 30,
   alarmDuration: 30,
   animationSpeed: 200,
+  lampGroup: false,
 };
 
 export const mockSystemSettings = {
@@ -43,7 +44,18 @@ export const mockFetch = (url, options) => {
 
   return new Promise((resolve) => {
     setTimeout(() => {
-      if (url.includes("/get_config")) {
+      if (url.includes("/state")) {
+        resolve({
+          ok: true,
+          json: () =>
+            Promise.resolve({
+              config: mockConfig,
+              system: mockSystemSettings,
+              status: { clockSynced: false, staConfigValid: false },
+              lamp: { state: 0, brightnessMode: 7, activeAlarm: -1 },
+            }),
+        });
+      } else if (url.includes("/get_config")) {
         resolve({
           ok: true,
           json: () => Promise.resolve(mockConfig),
@@ -55,12 +67,57 @@ export const mockFetch = (url, options) => {
         });
       } else if (
         url.includes("/set_config") ||
+        url.includes("/patch_config") ||
         url.includes("/set_system_config")
       ) {
         resolve({
           ok: true,
+          status: 202,
+          json: () => Promise.resolve({ status: "queued", commandId: 1 }),
           text: () => Promise.resolve("Mock save successful"),
         });
+      } else if (
+        url.includes("/get_trace_status") ||
+        url.includes("/set_trace")
+      ) {
+        const enabled = options && options.body
+          ? JSON.parse(options.body).enabled
+          : false;
+        resolve({
+          ok: true,
+          json: () => Promise.resolve({ enabled, events: 0, capacity: 1024 }),
+        });
+      } else if (url.includes("/get_wifi_networks")) {
+        resolve({
+          ok: true,
+          json: () =>
+            Promise.resolve({
+              scanning: false,
+              ageS: 3,
+              networks: [
+                { ssid: "HomeNetwork", rssi: -48, channel: 6, auth: "wpa2" },
+                { ssid: "Neighbor", rssi: -71, channel: 11, auth: "wpa2/wpa3" },
+                { ssid: "Cafe Guest", rssi: -83, channel: 1, auth: "open" },
+              ],
+            }),
+        });
+      } else if (url.includes("/time_probe")) {
+        const lampMs = performance.now();
+        resolve({
+          ok: true,
+          json: () => Promise.resolve({ t1: lampMs, t2: lampMs }),
+        });
+      } else if (url.includes("/set_time")) {
+        resolve({
+          ok: true,
+          json: () =>
+            Promise.resolve({ applied: true, offsetMs: 0, accuracyMs: 100 }),
+        });
+      } else if (url.includes("/command")) {
+        resolve({
+          ok: true,
+          json: () => Promise.resolve({ commandId: 1, state: "done" }),
+        });
       } else {
         resolve({
           ok: false,
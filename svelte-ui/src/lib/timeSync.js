@@ -0,0 +1,53 @@
+import { isMockEnabled, mockFetch } from "./mockData.js";
+
+const PROBES = 4;
+
+// Browser epoch time in milliseconds with sub-millisecond resolution
+const nowMs = () => performance.timeOrigin + performance.now();
+
+// Sets the lamp clock from this browser, NTP style: a few /time_probe round trips,
+// the fastest one is sent back to /set_time together with the local time zone.
+// The lamp ignores it when its own clock is already more accurate.
+export async function syncLampClock() {
+  const fetchFn = isMockEnabled() ? mockFetch : fetch;
+  let best = null;
+  try {
+    for (let i = 0; i < PROBES; i++) {
+      const t0 = nowMs();
+      const response = await fetchFn("/time_probe", { cache: "no-store" });
+      const t3 = nowMs();
+      if (!response.ok) {
+        return null;
+      }
+      const { t1, t2 } = await response.json();
+      const delay = t3 - t0 - (t2 - t1);
+      if (!best || delay < best.delay) {
+        best = { t0, t1, t2, t3, delay };
+      }
+    }
+
+    const response = await fetchFn("/set_time", {
+      method: "POST",
+      headers: { "Content-Type": "application/json" },
+      body: JSON.stringify({
+        t0: best.t0,
+        t1: best.t1,
+        t2: best.t2,
+        t3: best.t3,
+        tzOffset: new Date().getTimezoneOffset(),
+      }),
+    });
+    if (!response.ok) {
+      return null;
+    }
+    const result = await response.json();
+    console.info(
+      `Lamp clock ${result.applied ? "set" : "kept"}, off by ${Math.round(result.offsetMs)} ms, ` +
+        `accuracy ${result.accuracyMs.toFixed(1)} ms`
+    );
+    return result;
+  } catch (error) {
+    console.warn("Clock sync with the lamp failed:", error);
+    return null;
+  }
+}
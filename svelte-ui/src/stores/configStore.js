@@ -1,26 +1,10 @@
 import { get, writable } from "svelte/store";
 import { isMockEnabled, mockFetch } from "../lib/mockData.js";
 import { messageStore } from "./messageStore.js";
+import { createDefaultConfig } from "../lib/configDefaults.js";
 
-const MAX_ALARMS = 10;
-
-// Default config matching the original structure
-const defaultConfig = {
-  override_color: { r: 255, g: 255, b: 255 },
-  colorMode: 1, // Default to Neutral White
-  animationMode: 1,
-  alarms: Array(MAX_ALARMS)
-    .fill(null)
-    .map(() => ({
-      day: 0,
-      hour: 0,
-      minute: 0,
-      active: false,
-    })),
-  goodNightDuration: 30,
-  alarmDuration: 30,
-  animationSpeed: 200,
-};
+// Generated from config_schema.json, shared with the firmware
+const defaultConfig = createDefaultConfig();
 
 function createConfigStore() {
   const configStoreData = writable(defaultConfig);
@@ -54,6 +38,12 @@ function createConfigStore() {
       }
     },
 
+    // Takes a config that arrived with the aggregated /state document
+    apply(config) {
+      originalConfig = JSON.parse(JSON.stringify(config));
+      set(config);
+    },
+
     async post() {
       try {
         const currentConfig = get(configStoreData);
@@ -85,12 +75,39 @@ function createConfigStore() {
       }
     },
 
+    // Sends only the changed fields; the lamp validates and applies them in place
+    async patch(fields) {
+      try {
+        const fetchFn = isMockEnabled() ? mockFetch : fetch;
+        const response = await fetchFn("/patch_config", {
+          method: "PATCH",
+          headers: { "Content-Type": "application/json" },
+          body: JSON.stringify(fields),
+        });
+
+        if (response.ok) {
+          originalConfig = JSON.parse(JSON.stringify(get(configStoreData)));
+        } else {
+          const errorText = await response.text();
+          messageStore.show(
+            "error",
+            `Error saving configuration: ${errorText}`
+          );
+          // Resync with the lamp after a rejected patch
+          this.load();
+        }
+      } catch (error) {
+        messageStore.show("error", `Network error: ${error.message}`);
+        this.load();
+      }
+    },
+
     updateColor(r, g, b) {
       update((config) => ({
         ...config,
         override_color: { r, g, b },
       }));
-      this.post();
+      this.patch({ override_color: { r, g, b } });
     },
 
     /*  toggleColorOverride(active) {
@@ -106,7 +123,7 @@ function createConfigStore() {
         ...config,
         colorMode: modeId,
       }));
-      this.post();
+      this.patch({ colorMode: modeId });
     },
 
     setAnimationMode(modeId) {
@@ -114,7 +131,7 @@ function createConfigStore() {
         ...config,
         animationMode: modeId,
       }));
-      this.post();
+      this.patch({ animationMode: modeId });
     },
 
     setAnimationSpeed(speed) {
@@ -122,7 +139,7 @@ function createConfigStore() {
         ...config,
         animationSpeed: speed,
       }));
-      this.post();
+      this.patch({ animationSpeed: speed });
     },
     
     updateDuration(type, value) {
@@ -130,22 +147,25 @@ function createConfigStore() {
         ...config,
         [type]: value,
       }));
-      this.post();
+      this.patch({ [type]: value });
+    },
+
+    setLampGroup(enabled) {
+      update((config) => ({
+        ...config,
+        lampGroup: enabled,
+      }));
+      this.patch({ lampGroup: enabled });
     },
 
     addAlarm() {
-      update((config) => {
-        const alarms = [...config.alarms];
-        for (let i = 0; i < MAX_ALARMS; i++) {
-          if (alarms[i].day === 0) {
-            alarms[i] = { day: 1, hour: 7, minute: 0, active: true };
-            return { ...config, alarms };
-          }
-        }
+      const alarms = get(configStoreData).alarms;
+      const index = alarms.findIndex((alarm) => alarm.day === 0);
+      if (index === -1) {
         messageStore.show("error", "Maximum alarms reached");
-        return config;
-      });
-      this.post();
+        return;
+      }
+      this.updateAlarm(index, { day: 1, hour: 7, minute: 0, active: true });
     },
 
     updateAlarm(index, alarm) {
@@ -154,16 +174,11 @@ function createConfigStore() {
         alarms[index] = alarm;
         return { ...config, alarms };
       });
-      this.post();
+      this.patch({ alarm: { index, ...alarm } });
     },
 
     removeAlarm(index) {
-      update((config) => {
-        const alarms = [...config.alarms];
-        alarms[index] = { day: 0, hour: 0, minute: 0, active: false };
-        return { ...config, alarms };
-      });
-      this.post();
+      this.updateAlarm(index, { day: 0, hour: 0, minute: 0, active: false });
     },
 
     hasChanges() {
@@ -0,0 +1,39 @@
+import { writable } from "svelte/store";
+import { isMockEnabled, mockFetch } from "../lib/mockData.js";
+import { configStore } from "./configStore.js";
+import { systemStore } from "./systemStore.js";
+
+function createLampStore() {
+  const { subscribe, set } = writable({ status: null, lamp: null, loadMs: null });
+
+  return {
+    subscribe,
+
+    // Loads config, system settings, status and lamp state with one request
+    async load() {
+      const started = performance.now();
+      try {
+        const fetchFn = isMockEnabled() ? mockFetch : fetch;
+        const response = await fetchFn("/state");
+        if (!response.ok) {
+          throw new Error(response.statusText);
+        }
+        const state = await response.json();
+        configStore.apply(state.config);
+        systemStore.apply(state.system);
+
+        const loadMs = Math.round(performance.now() - started);
+        set({ status: state.status, lamp: state.lamp, loadMs });
+        console.info(
+          `State loaded in ${loadMs} ms, interactive ${Math.round(performance.now())} ms after navigation`
+        );
+      } catch (error) {
+        // Older firmware without /state: fall back to the separate endpoints
+        console.warn("Aggregated /state failed, loading separately:", error);
+        await Promise.all([configStore.load(), systemStore.load()]);
+      }
+    },
+  };
+}
+
+export const lampStore = createLampStore();
@@ -34,6 +34,12 @@ function createSystemStore() {
       }
     },
 
+    // Takes settings that arrived with the aggregated /state document
+    apply(settings) {
+      originalSystemSettings = JSON.parse(JSON.stringify(settings));
+      systemStoreData.set(settings);
+    },
+
     async post() {
       try {
         const currentSettings = get(systemStoreData);
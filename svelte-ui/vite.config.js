@@ -27,8 +27,10 @@ export default defineConfig({
   },
   server: {
     proxy: {
+      '/state': 'http://192.168.4.1',
       '/get_config': 'http://192.168.4.1',
       '/set_config': 'http://192.168.4.1',
+      '/patch_config': 'http://192.168.4.1',
       '/get_system_config': 'http://192.168.4.1',
       '/set_system_config': 'http://192.168.4.1'
     }
@@ -0,0 +1,115 @@
+#ifndef NATIVE_BENCH_H
+#define NATIVE_BENCH_H
+
+// Timing and memory probes for the test_bench_* suites. Host numbers only rank
+// variants against each other; the ESP32 runs the same code 10-50x slower.
+// Include from the suite's test_main.cpp only: it replaces operator new.
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <new>
+#include <unity.h>
+#include "Arduino.h"
+
+#define BENCH_STACK_SIZE (128 * 1024)
+#define BENCH_STACK_PAINT 0xA5
+
+static size_t benchHeapBytes = 0;
+static size_t benchHeapCalls = 0;
+
+void* operator new(size_t size) {
+    benchHeapBytes += size;
+    benchHeapCalls++;
+    void* p = malloc(size ? size : 1);
+    if(p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Prints one result line through Unity so it shows up in `pio test -v`
+inline void benchReport(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void benchReport(const char* fmt, ...) {
+    char line[160];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    TEST_MESSAGE(line);
+}
+
+/**
+ * @brief Mean wall time of one call, after a warm-up of a tenth of the iterations.
+ */
+template<typename Fn>
+double benchNs(uint32_t iterations, Fn fn) {
+    for(uint32_t i = 0; i < iterations / 10; i++) {
+        fn();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+}
+
+/**
+ * @brief Operator new bytes requested by one call of fn.
+ */
+template<typename Fn>
+size_t heapBytes(Fn fn) {
+    size_t before = benchHeapBytes;
+    fn();
+    return benchHeapBytes - before;
+}
+
+template<typename Fn>
+static void* benchThreadMain(void* arg) {
+    (*static_cast<Fn*>(arg))();
+    return nullptr;
+}
+
+template<typename Fn>
+static size_t touchedStackBytes(Fn& fn) {
+    static uint8_t stack[BENCH_STACK_SIZE] __attribute__((aligned(64)));
+    memset(stack, BENCH_STACK_PAINT, sizeof(stack));
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, sizeof(stack));
+    pthread_t thread;
+    if(pthread_create(&thread, &attr, benchThreadMain<Fn>, &fn) != 0) {
+        pthread_attr_destroy(&attr);
+        return 0;
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+    // The stack grows down, so paint left at the low end was never reached
+    size_t untouched = 0;
+    while(untouched < sizeof(stack) && stack[untouched] == BENCH_STACK_PAINT) {
+        untouched++;
+    }
+    return sizeof(stack) - untouched;
+}
+
+/**
+ * @brief Peak stack of one call of fn, like uxTaskGetStackHighWaterMark() on the device:
+ * runs it on a painted thread stack and subtracts what an empty thread touches.
+ */
+template<typename Fn>
+size_t peakStackBytes(Fn fn) {
+    auto idle = []() {};
+    size_t base = touchedStackBytes(idle);
+    size_t used = touchedStackBytes(fn);
+    return used > base ? used - base : 0;
+}
+
+#endif // NATIVE_BENCH_H
@@ -0,0 +1,22 @@
+#ifndef NATIVE_BENCH_CONFIG_H
+#define NATIVE_BENCH_CONFIG_H
+
+// FullConfig fixture shared by the test_bench_* suites
+
+#include "config_schema.h"
+
+// Every alarm and non-default scalar set, so no array element or member is skipped
+inline FullConfig busyConfig() {
+    FullConfig config = defaultFullConfig();
+    config.color = {12, 200, 255};
+    config.colorMode = 3;
+    for(int i = 0; i < MAX_ALARMS; i++) {
+        config.alarms[i] = {(uint8_t)(i % 7 + 1), (uint8_t)(i + 5), (uint8_t)(i * 5), i % 2 == 0};
+    }
+    config.alarmDuration = 45;
+    config.animationSpeed = 1500;
+    config.lampGroup = true;
+    return config;
+}
+
+#endif // NATIVE_BENCH_CONFIG_H
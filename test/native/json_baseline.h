@@ -0,0 +1,135 @@
+#ifndef NATIVE_JSON_BASELINE_H
+#define NATIVE_JSON_BASELINE_H
+
+// The ArduinoJson encoder and parsers json_utils.cpp used before the generated codecs, kept
+// unchanged apart from parsing from a buffer, as the baseline the test_bench_* suites rank against.
+
+#include <ArduinoJson.h>
+#include "json_utils.h" // for PASSWORD_MASK
+
+// The firmware sized the documents for 16 byte slots; a 64-bit host needs twice that for the
+// same document, so the capacities scale with the pointer size and stay 2048 and 512 on the ESP32
+#define BASELINE_DOC_SCALE (sizeof(void*) / 4)
+
+inline String baselineCreateConfigJson(const FullConfig& config) {
+    StaticJsonDocument<2048 * BASELINE_DOC_SCALE> doc;
+
+    JsonObject colorObj = doc.createNestedObject("override_color");
+    colorObj["r"] = config.color.r;
+    colorObj["g"] = config.color.g;
+    colorObj["b"] = config.color.b;
+
+    doc["colorMode"] = config.colorMode;
+    doc["animationMode"] = config.animationMode;
+    doc["goodNightDuration"] = config.goodNightDuration;
+    doc["alarmDuration"] = config.alarmDuration;
+    doc["animationSpeed"] = config.animationSpeed;
+
+    JsonArray alarmsArray = doc.createNestedArray("alarms");
+    for(int i = 0; i < MAX_ALARMS; ++i) {
+        JsonObject alarmObj = alarmsArray.createNestedObject();
+        alarmObj["day"] = config.alarms[i].day;
+        alarmObj["hour"] = config.alarms[i].hour;
+        alarmObj["minute"] = config.alarms[i].minute;
+        alarmObj["active"] = config.alarms[i].active;
+    }
+
+    String jsonResponse;
+    serializeJson(doc, jsonResponse);
+    return jsonResponse;
+}
+
+inline bool baselineParseConfigJson(const char* json, size_t len, FullConfig& config) {
+    StaticJsonDocument<2048 * BASELINE_DOC_SCALE> doc;
+
+    DeserializationError error = deserializeJson(doc, json, len);
+    if(error) {
+        return false;
+    }
+
+    JsonObject colorObj = doc["override_color"];
+    if(!colorObj.isNull()) {
+        config.color.r = colorObj["r"] | 0;
+        config.color.g = colorObj["g"] | 0;
+        config.color.b = colorObj["b"] | 0;
+    } else {
+        config.color.r = 0;
+        config.color.g = 0;
+        config.color.b = 0;
+    }
+
+    if(doc.containsKey("colorMode")) {
+        config.colorMode = doc["colorMode"];
+    } else {
+        config.colorMode = 1;
+    }
+    if(doc.containsKey("animationMode")) {
+        config.animationMode = doc["animationMode"];
+    } else {
+        config.animationMode = 1;
+    }
+    if(doc.containsKey("goodNightDuration")) {
+        config.goodNightDuration = doc["goodNightDuration"];
+    } else {
+        config.goodNightDuration = 30;
+    }
+    if(doc.containsKey("alarmDuration")) {
+        config.alarmDuration = doc["alarmDuration"];
+    } else {
+        config.alarmDuration = 30;
+    }
+    if(doc.containsKey("animationSpeed")) {
+        config.animationSpeed = doc["animationSpeed"];
+    } else {
+        config.animationSpeed = 200;
+    }
+
+    JsonArray alarmsArray = doc["alarms"].as<JsonArray>();
+    if(!alarmsArray.isNull()) {
+        int i = 0;
+        for(JsonObject alarmObj : alarmsArray) {
+            if(i < MAX_ALARMS) {
+                config.alarms[i].day = alarmObj["day"] | 0;
+                config.alarms[i].hour = alarmObj["hour"] | 0;
+                config.alarms[i].minute = alarmObj["minute"] | 0;
+                config.alarms[i].active = alarmObj["active"] | false;
+                i++;
+            }
+        }
+    }
+
+    return true;
+}
+
+inline bool baselineParseSystemConfigJson(const char* json, size_t len, SystemSettings& systemSettings) {
+    StaticJsonDocument<512 * BASELINE_DOC_SCALE> doc;
+
+    DeserializationError error = deserializeJson(doc, json, len);
+    if(error) {
+        return false;
+    }
+
+    strlcpy(systemSettings.internalSSID, doc["internalSSID"] | "", sizeof(systemSettings.internalSSID));
+
+    if(doc.containsKey("internalPW")) {
+        const char* internalPW = doc["internalPW"] | "";
+        if(strlen(internalPW) > 0 && strcmp(internalPW, PASSWORD_MASK) != 0) {
+            strlcpy(systemSettings.internalPW, internalPW, sizeof(systemSettings.internalPW));
+        }
+    }
+
+    if(doc.containsKey("externalSSID")) {
+        strlcpy(systemSettings.externalSSID, doc["externalSSID"] | "", sizeof(systemSettings.externalSSID));
+    }
+
+    if(doc.containsKey("externalPW")) {
+        const char* externalPW = doc["externalPW"] | "";
+        if(strlen(externalPW) > 0 && strcmp(externalPW, PASSWORD_MASK) != 0) {
+            strlcpy(systemSettings.externalPW, externalPW, sizeof(systemSettings.externalPW));
+        }
+    }
+
+    return true;
+}
+
+#endif // NATIVE_JSON_BASELINE_H
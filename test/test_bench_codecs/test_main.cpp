@@ -0,0 +1,118 @@
+// Throughput of the generated FullConfig codecs: JSON for the web (against ArduinoJson), CBOR for clients that ask
+// for it, records for flash
+#include <unity.h>
+#include "bench.h"
+#include "bench_config.h"
+#include "json_baseline.h"
+#include "config_schema.h"
+
+#define CODEC_ITERATIONS 50000
+
+static FullConfig config;
+
+void setUp() {
+    config = busyConfig();
+}
+
+void tearDown() {
+}
+
+static void reportThroughput(const char* codec, size_t len, double encodeNs, double decodeNs) {
+    benchReport("%s: %u bytes, encode %.0f ns (%.1f MB/s), decode %.0f ns (%.1f MB/s)", codec, (unsigned)len, encodeNs,
+                len * 1000.0 / encodeNs, decodeNs, len * 1000.0 / decodeNs);
+}
+
+static void test_json_codec() {
+    char buf[FULL_CONFIG_JSON_MAX];
+    size_t len = encodeFullConfigJson(config, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    FullConfig decoded = defaultFullConfig();
+    TEST_ASSERT_TRUE(decodeFullConfigJson(buf, len, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &decoded, sizeof(config));
+
+    double encodeNs = benchNs(CODEC_ITERATIONS, [&]() { encodeFullConfigJson(config, buf, sizeof(buf)); });
+    double decodeNs = benchNs(CODEC_ITERATIONS, [&]() { decodeFullConfigJson(buf, len, decoded); });
+    reportThroughput("JSON", len, encodeNs, decodeNs);
+}
+
+// The generated JSON codec against the StaticJsonDocument one it replaced, on the same FullConfig
+static void test_json_codec_against_arduinojson() {
+    char buf[FULL_CONFIG_JSON_MAX];
+    size_t len = encodeFullConfigJson(config, buf, sizeof(buf));
+    String baselineJson = baselineCreateConfigJson(config);
+    TEST_ASSERT_GREATER_THAN(0, baselineJson.length());
+    FullConfig decoded = defaultFullConfig();
+    TEST_ASSERT_TRUE(baselineParseConfigJson(buf, len, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(&config.alarms, &decoded.alarms, sizeof(config.alarms));
+    decoded = defaultFullConfig();
+    TEST_ASSERT_TRUE(decodeFullConfigJson(baselineJson.c_str(), baselineJson.length(), decoded));
+    TEST_ASSERT_EQUAL_MEMORY(&config.alarms, &decoded.alarms, sizeof(config.alarms));
+
+    double encodeNs = benchNs(CODEC_ITERATIONS, [&]() { encodeFullConfigJson(config, buf, sizeof(buf)); });
+    double decodeNs = benchNs(CODEC_ITERATIONS, [&]() { decodeFullConfigJson(buf, len, decoded); });
+    double baselineEncodeNs = benchNs(CODEC_ITERATIONS, [&]() { baselineCreateConfigJson(config); });
+    double baselineDecodeNs = benchNs(CODEC_ITERATIONS, [&]() { baselineParseConfigJson(buf, len, decoded); });
+    size_t heap = heapBytes([&]() {
+        decodeFullConfigJson(buf, encodeFullConfigJson(config, buf, sizeof(buf)), decoded);
+    });
+    size_t baselineHeap = heapBytes([&]() {
+        String json = baselineCreateConfigJson(config);
+        baselineParseConfigJson(json.c_str(), json.length(), decoded);
+    });
+    reportThroughput("JSON", len, encodeNs, decodeNs);
+    reportThroughput("ArduinoJson", baselineJson.length(), baselineEncodeNs, baselineDecodeNs);
+    benchReport("heap per round trip: %u B vs %u B ArduinoJson", (unsigned)heap, (unsigned)baselineHeap);
+    TEST_ASSERT_LESS_THAN(baselineEncodeNs, encodeNs);
+    TEST_ASSERT_LESS_THAN(baselineDecodeNs, decodeNs);
+    TEST_ASSERT_LESS_THAN(baselineHeap, heap); // the baseline String alone allocates
+}
+
+static void test_cbor_codec() {
+    uint8_t buf[FULL_CONFIG_CBOR_MAX];
+    size_t len = encodeFullConfigCbor(config, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    FullConfig decoded = defaultFullConfig();
+    TEST_ASSERT_TRUE(decodeFullConfigCbor(buf, len, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &decoded, sizeof(config));
+
+    double encodeNs = benchNs(CODEC_ITERATIONS, [&]() { encodeFullConfigCbor(config, buf, sizeof(buf)); });
+    double decodeNs = benchNs(CODEC_ITERATIONS, [&]() { decodeFullConfigCbor(buf, len, decoded); });
+    reportThroughput("CBOR", len, encodeNs, decodeNs);
+}
+
+static void test_storage_codec() {
+    uint8_t buf[FULL_CONFIG_STORAGE_MAX];
+    size_t len = encodeFullConfigStorage(config, buf, sizeof(buf));
+    TEST_ASSERT_GREATER_THAN(0, len);
+    FullConfig decoded = defaultFullConfig();
+    TEST_ASSERT_TRUE(decodeFullConfigStorage(buf, len, decoded));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &decoded, sizeof(config));
+
+    double encodeNs = benchNs(CODEC_ITERATIONS, [&]() { encodeFullConfigStorage(config, buf, sizeof(buf)); });
+    double decodeNs = benchNs(CODEC_ITERATIONS, [&]() { decodeFullConfigStorage(buf, len, decoded); });
+    reportThroughput("storage", len, encodeNs, decodeNs);
+}
+
+// The encoders write into caller buffers and the decoders into the caller's config
+static void test_codecs_do_not_allocate() {
+    char json[FULL_CONFIG_JSON_MAX];
+    uint8_t cbor[FULL_CONFIG_CBOR_MAX];
+    uint8_t storage[FULL_CONFIG_STORAGE_MAX];
+    FullConfig decoded = defaultFullConfig();
+    size_t heap = heapBytes([&]() {
+        decodeFullConfigJson(json, encodeFullConfigJson(config, json, sizeof(json)), decoded);
+        decodeFullConfigCbor(cbor, encodeFullConfigCbor(config, cbor, sizeof(cbor)), decoded);
+        decodeFullConfigStorage(storage, encodeFullConfigStorage(config, storage, sizeof(storage)), decoded);
+    });
+    TEST_ASSERT_EQUAL(0, heap);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_json_codec);
+    RUN_TEST(test_json_codec_against_arduinojson);
+    RUN_TEST(test_cbor_codec);
+    RUN_TEST(test_storage_codec);
+    RUN_TEST(test_codecs_do_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,136 @@
+// Parse time and peak memory of the one-pass /set_config, /patch_config and /set_system_config decoders,
+// against the StaticJsonDocument parsers they replaced
+#include <unity.h>
+#include "bench.h"
+#include "bench_config.h"
+#include "json_baseline.h"
+#include "config_schema.h"
+#include "config_decoder.h"
+
+#define DECODE_ITERATIONS 20000
+#define DECODE_STACK_BUDGET 2048 // bytes; the async_tcp task these run on has 8 KB in all
+
+static char body[FULL_CONFIG_JSON_MAX];
+static size_t bodyLen = 0;
+
+static const char systemBody[] =
+    "{\"internalSSID\":\"Lamp-4F2A\",\"internalPW\":\"******\",\"externalSSID\":\"Home Network 5G\","
+    "\"externalPW\":\"correct horse battery staple\"}";
+
+static const char patchBody[] = "{\"alarm\":{\"index\":3,\"day\":5,\"hour\":6,\"minute\":45,\"active\":true}}";
+
+void setUp() {
+    bodyLen = encodeFullConfigJson(busyConfig(), body, sizeof(body));
+}
+
+void tearDown() {
+}
+
+static void test_full_decode() {
+    FullConfig config = defaultFullConfig();
+    TEST_ASSERT_TRUE(decodeFullConfigJson(body, bodyLen, config));
+    FullConfig expected = busyConfig();
+    TEST_ASSERT_EQUAL_MEMORY(&expected, &config, sizeof(config));
+
+    double ns = benchNs(DECODE_ITERATIONS, [&]() { decodeFullConfigJson(body, bodyLen, config); });
+    size_t heap = heapBytes([&]() { decodeFullConfigJson(body, bodyLen, config); });
+    size_t stack = peakStackBytes([&]() { decodeFullConfigJson(body, bodyLen, config); });
+    benchReport("set_config: %u bytes in %.0f ns (%.1f MB/s), heap %u B, peak stack %u B", (unsigned)bodyLen, ns,
+                bodyLen * 1000.0 / ns, (unsigned)heap, (unsigned)stack);
+    TEST_ASSERT_EQUAL(0, heap);
+    TEST_ASSERT_LESS_THAN(DECODE_STACK_BUDGET, stack);
+}
+
+static void test_patch_decode() {
+    FullConfig config = defaultFullConfig();
+    uint8_t changed = 0;
+    FullConfigPatchMask mask;
+    size_t len = sizeof(patchBody) - 1;
+    TEST_ASSERT_TRUE(decodeFullConfigPatchJson(patchBody, len, config, changed, mask));
+    TEST_ASSERT_EQUAL(CONFIG_FIELD_ALARMS, changed);
+    TEST_ASSERT_EQUAL(45, config.alarms[3].minute);
+
+    double ns = benchNs(DECODE_ITERATIONS, [&]() { decodeFullConfigPatchJson(patchBody, len, config, changed, mask); });
+    size_t heap = heapBytes([&]() { decodeFullConfigPatchJson(patchBody, len, config, changed, mask); });
+    size_t stack = peakStackBytes([&]() { decodeFullConfigPatchJson(patchBody, len, config, changed, mask); });
+    benchReport("patch_config: %u bytes in %.0f ns, heap %u B, peak stack %u B", (unsigned)len, ns, (unsigned)heap,
+                (unsigned)stack);
+    TEST_ASSERT_EQUAL(0, heap);
+    TEST_ASSERT_LESS_THAN(DECODE_STACK_BUDGET, stack);
+}
+
+struct DecodeCost {
+    double ns;
+    size_t heap;
+    size_t stack;
+};
+
+template<typename Fn>
+static DecodeCost measureDecode(Fn fn) {
+    return {benchNs(DECODE_ITERATIONS, fn), heapBytes(fn), peakStackBytes(fn)};
+}
+
+// Generated decoder first, ArduinoJson second
+static void reportAgainstBaseline(const char* route, size_t len, const DecodeCost& generated,
+                                  const DecodeCost& baseline) {
+    benchReport("%s, %u bytes: %.0f ns vs %.0f ns ArduinoJson (x%.1f)", route, (unsigned)len, generated.ns,
+                baseline.ns, baseline.ns / generated.ns);
+    benchReport("%s: heap %u B vs %u B, peak stack %u B vs %u B", route, (unsigned)generated.heap,
+                (unsigned)baseline.heap, (unsigned)generated.stack, (unsigned)baseline.stack);
+}
+
+static void test_full_decode_against_arduinojson() {
+    FullConfig config = defaultFullConfig();
+    TEST_ASSERT_TRUE(baselineParseConfigJson(body, bodyLen, config));
+    FullConfig expected = busyConfig();
+    TEST_ASSERT_EQUAL_MEMORY(&expected.alarms, &config.alarms, sizeof(config.alarms));
+    TEST_ASSERT_EQUAL(expected.alarmDuration, config.alarmDuration);
+
+    DecodeCost generated = measureDecode([&]() { decodeFullConfigJson(body, bodyLen, config); });
+    DecodeCost baseline = measureDecode([&]() { baselineParseConfigJson(body, bodyLen, config); });
+    reportAgainstBaseline("set_config", bodyLen, generated, baseline);
+    TEST_ASSERT_LESS_OR_EQUAL(baseline.heap, generated.heap);
+    TEST_ASSERT_LESS_THAN(baseline.stack, generated.stack); // the baseline document alone is 2 KB on the ESP32
+}
+
+static void test_system_decode_against_arduinojson() {
+    size_t len = sizeof(systemBody) - 1;
+    SystemSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    strlcpy(settings.internalPW, "kept", sizeof(settings.internalPW));
+    SystemSettings reference = settings;
+    uint8_t fields = 0;
+    TEST_ASSERT_TRUE(decodeSystemConfigJson(systemBody, len, settings, fields));
+    TEST_ASSERT_TRUE(baselineParseSystemConfigJson(systemBody, len, reference));
+    TEST_ASSERT_EQUAL_STRING(reference.internalSSID, settings.internalSSID);
+    TEST_ASSERT_EQUAL_STRING(reference.externalSSID, settings.externalSSID);
+    TEST_ASSERT_EQUAL_STRING(reference.externalPW, settings.externalPW);
+    TEST_ASSERT_EQUAL_STRING("kept", reference.internalPW); // the mask leaves the password alone
+    TEST_ASSERT_EQUAL_STRING("kept", settings.internalPW);
+
+    DecodeCost generated = measureDecode([&]() { decodeSystemConfigJson(systemBody, len, settings, fields); });
+    DecodeCost baseline = measureDecode([&]() { baselineParseSystemConfigJson(systemBody, len, settings); });
+    reportAgainstBaseline("set_system_config", len, generated, baseline);
+    TEST_ASSERT_LESS_OR_EQUAL(baseline.heap, generated.heap);
+    TEST_ASSERT_LESS_THAN(DECODE_STACK_BUDGET, generated.stack);
+}
+
+// A body cut short anywhere must fail cleanly
+static void test_truncated_decode() {
+    FullConfig config = defaultFullConfig();
+    for(size_t len = 0; len < bodyLen; len++) {
+        TEST_ASSERT_FALSE(decodeFullConfigJson(body, len, config));
+    }
+    double ns = benchNs(DECODE_ITERATIONS, [&]() { decodeFullConfigJson(body, bodyLen - 1, config); });
+    benchReport("set_config cut one byte short: rejected in %.0f ns", ns);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_full_decode);
+    RUN_TEST(test_patch_decode);
+    RUN_TEST(test_truncated_decode);
+    RUN_TEST(test_full_decode_against_arduinojson);
+    RUN_TEST(test_system_decode_against_arduinojson);
+    return UNITY_END();
+}
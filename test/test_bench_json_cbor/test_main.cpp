@@ -0,0 +1,165 @@
+// Payload size and encode/decode time of the /get_config, /set_config, /get_system_config and /get_status
+// bodies, JSON against CBOR
+#include <unity.h>
+#include "bench.h"
+#include "config_schema.h"
+#include "config_decoder.h"
+#include "cbor_utils.h"
+#include "json_utils.h"
+
+#define PAYLOAD_ITERATIONS 50000
+
+struct Payload {
+    const char* name;
+    FullConfig config;
+};
+
+static Payload payloads[3];
+static SystemSettings settings;
+static WiFiStatus status;
+
+void setUp() {
+    payloads[0] = {"defaults", defaultFullConfig()};
+
+    FullConfig typical = defaultFullConfig();
+    typical.alarms[0] = {1, 6, 30, true};
+    typical.alarms[1] = {2, 6, 30, true};
+    typical.alarms[5] = {6, 9, 0, false};
+    payloads[1] = {"typical", typical};
+
+    // Every number at its widest and every flag false: the longest document the schema ranges allow
+    FullConfig widest = defaultFullConfig();
+    widest.color = {255, 255, 255};
+    widest.colorMode = 3;
+    for(int i = 0; i < MAX_ALARMS; i++) {
+        widest.alarms[i] = {7, 23, 59, false};
+    }
+    widest.goodNightDuration = 1440;
+    widest.alarmDuration = 1440;
+    widest.animationSpeed = 5000;
+    widest.lampGroup = false;
+    payloads[2] = {"widest", widest};
+
+    // Full length SSIDs; the passwords go out masked either way
+    memset(&settings, 0, sizeof(settings));
+    memset(settings.internalSSID, 'L', SSID_MAX_LEN);
+    strlcpy(settings.internalPW, "lamp-password", sizeof(settings.internalPW));
+    memset(settings.externalSSID, 'H', SSID_MAX_LEN);
+    strlcpy(settings.externalPW, "correct horse battery staple", sizeof(settings.externalPW));
+
+    // A synced lamp a day after boot, so no member is null
+    status = WiFiStatus();
+    status.currentTime = "2024-03-17 06:30:12";
+    status.lastTestResult = WIFI_TEST_SUCCESS;
+    status.timeSinceLastTestMs = 1234567;
+    status.timeSinceLastSucceededTestMs = 1234567;
+    status.lastStaConnectionTime = 86000000;
+    status.systemTime = 86400000;
+    status.clockSynced = true;
+    status.staConfigValid = true;
+    status.clockErrorMs = 250;
+    status.clockDriftPpb = -12500;
+    status.timeSource = TIME_SOURCE_NTP;
+    status.timeAccuracyMs = 50;
+}
+
+void tearDown() {
+}
+
+static void test_payload_sizes() {
+    for(const Payload& p : payloads) {
+        char json[FULL_CONFIG_JSON_MAX];
+        uint8_t cbor[FULL_CONFIG_CBOR_MAX];
+        size_t jsonLen = encodeFullConfigJson(p.config, json, sizeof(json));
+        size_t cborLen = encodeFullConfigCbor(p.config, cbor, sizeof(cbor));
+        TEST_ASSERT_GREATER_THAN(0, jsonLen);
+        TEST_ASSERT_GREATER_THAN(0, cborLen);
+        TEST_ASSERT_LESS_THAN(jsonLen, cborLen);
+        benchReport("%s: JSON %u bytes, CBOR %u bytes (%.0f%%)", p.name, (unsigned)jsonLen, (unsigned)cborLen,
+                    cborLen * 100.0 / jsonLen);
+    }
+}
+
+static void test_encode_time() {
+    for(const Payload& p : payloads) {
+        char json[FULL_CONFIG_JSON_MAX];
+        uint8_t cbor[FULL_CONFIG_CBOR_MAX];
+        double jsonNs = benchNs(PAYLOAD_ITERATIONS, [&]() { encodeFullConfigJson(p.config, json, sizeof(json)); });
+        double cborNs = benchNs(PAYLOAD_ITERATIONS, [&]() { encodeFullConfigCbor(p.config, cbor, sizeof(cbor)); });
+        benchReport("%s: encode JSON %.0f ns, CBOR %.0f ns", p.name, jsonNs, cborNs);
+    }
+}
+
+static void test_decode_time() {
+    for(const Payload& p : payloads) {
+        char json[FULL_CONFIG_JSON_MAX];
+        uint8_t cbor[FULL_CONFIG_CBOR_MAX];
+        size_t jsonLen = encodeFullConfigJson(p.config, json, sizeof(json));
+        size_t cborLen = encodeFullConfigCbor(p.config, cbor, sizeof(cbor));
+        FullConfig fromJson = defaultFullConfig();
+        FullConfig fromCbor = defaultFullConfig();
+        TEST_ASSERT_TRUE(decodeFullConfigJson(json, jsonLen, fromJson));
+        TEST_ASSERT_TRUE(decodeFullConfigCbor(cbor, cborLen, fromCbor));
+        TEST_ASSERT_EQUAL_MEMORY(&p.config, &fromJson, sizeof(FullConfig));
+        TEST_ASSERT_EQUAL_MEMORY(&p.config, &fromCbor, sizeof(FullConfig));
+
+        double jsonNs = benchNs(PAYLOAD_ITERATIONS, [&]() { decodeFullConfigJson(json, jsonLen, fromJson); });
+        double cborNs = benchNs(PAYLOAD_ITERATIONS, [&]() { decodeFullConfigCbor(cbor, cborLen, fromCbor); });
+        benchReport("%s: decode JSON %.0f ns, CBOR %.0f ns", p.name, jsonNs, cborNs);
+    }
+}
+
+static void test_system_config() {
+    uint8_t cbor[SYSTEM_CONFIG_CBOR_MAX];
+    String json = createSystemConfigJson(settings);
+    size_t cborLen = createSystemConfigCbor(settings, cbor, sizeof(cbor));
+    TEST_ASSERT_GREATER_THAN(0, json.length());
+    TEST_ASSERT_GREATER_THAN(0, cborLen);
+    TEST_ASSERT_LESS_THAN(json.length(), cborLen);
+
+    // Both masked documents decode to the same settings, passwords unchanged
+    SystemSettings fromJson = settings;
+    SystemSettings fromCbor = settings;
+    uint8_t fields = 0;
+    TEST_ASSERT_TRUE(decodeSystemConfigJson(json.c_str(), json.length(), fromJson, fields));
+    TEST_ASSERT_TRUE(decodeSystemConfigCbor(cbor, cborLen, fromCbor, fields));
+    TEST_ASSERT_EQUAL_MEMORY(&settings, &fromJson, sizeof(settings));
+    TEST_ASSERT_EQUAL_MEMORY(&settings, &fromCbor, sizeof(settings));
+
+    double jsonEncodeNs = benchNs(PAYLOAD_ITERATIONS, [&]() { createSystemConfigJson(settings); });
+    double cborEncodeNs = benchNs(PAYLOAD_ITERATIONS, [&]() { createSystemConfigCbor(settings, cbor, sizeof(cbor)); });
+    double jsonDecodeNs =
+        benchNs(PAYLOAD_ITERATIONS, [&]() { decodeSystemConfigJson(json.c_str(), json.length(), fromJson, fields); });
+    double cborDecodeNs =
+        benchNs(PAYLOAD_ITERATIONS, [&]() { decodeSystemConfigCbor(cbor, cborLen, fromCbor, fields); });
+    benchReport("system config: JSON %u bytes, CBOR %u bytes (%.0f%%)", (unsigned)json.length(), (unsigned)cborLen,
+                cborLen * 100.0 / json.length());
+    benchReport("system config: encode JSON %.0f ns, CBOR %.0f ns; decode JSON %.0f ns, CBOR %.0f ns", jsonEncodeNs,
+                cborEncodeNs, jsonDecodeNs, cborDecodeNs);
+}
+
+// /get_status is polled while the page is open; nothing decodes it on the lamp
+static void test_wifi_status() {
+    uint8_t cbor[WIFI_STATUS_CBOR_MAX];
+    String json = createWiFiStatusJson(status);
+    size_t cborLen = createWiFiStatusCbor(status, cbor, sizeof(cbor));
+    TEST_ASSERT_GREATER_THAN(0, json.length());
+    TEST_ASSERT_GREATER_THAN(0, cborLen);
+    TEST_ASSERT_LESS_THAN(json.length(), cborLen);
+
+    double jsonNs = benchNs(PAYLOAD_ITERATIONS, [&]() { createWiFiStatusJson(status); });
+    double cborNs = benchNs(PAYLOAD_ITERATIONS, [&]() { createWiFiStatusCbor(status, cbor, sizeof(cbor)); });
+    benchReport("status: JSON %u bytes, CBOR %u bytes (%.0f%%)", (unsigned)json.length(), (unsigned)cborLen,
+                cborLen * 100.0 / json.length());
+    benchReport("status: encode JSON %.0f ns, CBOR %.0f ns", jsonNs, cborNs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_payload_sizes);
+    RUN_TEST(test_encode_time);
+    RUN_TEST(test_decode_time);
+    RUN_TEST(test_system_config);
+    RUN_TEST(test_wifi_status);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+// Value and key strictness of the generated FullConfig decoders
+#include <unity.h>
+#include "config_schema.h"
+
+static FullConfig config;
+
+void setUp() {
+    config = defaultFullConfig();
+}
+
+void tearDown() {
+}
+
+static bool decode(const char* json) {
+    return decodeFullConfigJson(json, strlen(json), config);
+}
+
+static FullConfigPatchMask mask;
+
+static bool patch(const char* json, uint8_t& changed) {
+    return decodeFullConfigPatchJson(json, strlen(json), config, changed, mask);
+}
+
+static void test_accepts_integers() {
+    TEST_ASSERT_TRUE(decode("{\"colorMode\":2,\"animationSpeed\":1000}"));
+    TEST_ASSERT_EQUAL(2, config.colorMode);
+    TEST_ASSERT_EQUAL(1000, config.animationSpeed);
+    TEST_ASSERT_TRUE(decode("{\"colorMode\":0}"));
+    TEST_ASSERT_TRUE(decode("{\"colorMode\":-0}"));
+    TEST_ASSERT_EQUAL(0, config.colorMode);
+}
+
+static void test_rejects_fractions() {
+    TEST_ASSERT_FALSE(decode("{\"colorMode\":2.5}"));
+    TEST_ASSERT_FALSE(decode("{\"colorMode\":2.0}"));
+    TEST_ASSERT_EQUAL(1, config.colorMode); // untouched
+}
+
+static void test_rejects_leading_zeros() {
+    TEST_ASSERT_FALSE(decode("{\"colorMode\":01}"));
+    TEST_ASSERT_FALSE(decode("{\"animationSpeed\":0200}"));
+}
+
+// Both spellings of an integral value are treated alike: refused, as CBOR refuses floats
+static void test_exponent_and_decimal_forms_agree() {
+    TEST_ASSERT_FALSE(decode("{\"animationSpeed\":1e3}"));
+    TEST_ASSERT_FALSE(decode("{\"animationSpeed\":1000.0}"));
+    TEST_ASSERT_FALSE(decode("{\"animationSpeed\":1E3}"));
+}
+
+static void test_rejects_out_of_range() {
+    TEST_ASSERT_FALSE(decode("{\"colorMode\":4}"));
+    TEST_ASSERT_FALSE(decode("{\"animationSpeed\":9}"));
+    TEST_ASSERT_FALSE(decode("{\"goodNightDuration\":1234567890}"));
+}
+
+static void test_full_decode_skips_unknown_keys() {
+    TEST_ASSERT_TRUE(decode("{\"future\":{\"a\":[1,2]},\"colorMode\":3}"));
+    TEST_ASSERT_EQUAL(3, config.colorMode);
+}
+
+static void test_patch_applies_known_keys() {
+    uint8_t changed = 0;
+    TEST_ASSERT_TRUE(patch("{\"alarm\":{\"index\":2,\"hour\":7},\"lampGroup\":true}", changed));
+    TEST_ASSERT_EQUAL(CONFIG_FIELD_ALARMS | CONFIG_FIELD_LAMP_GROUP, changed);
+    TEST_ASSERT_EQUAL(7, config.alarms[2].hour);
+    TEST_ASSERT_TRUE(config.lampGroup);
+}
+
+static void test_patch_rejects_unpatchable_keys() {
+    uint8_t changed = 0xFF;
+    TEST_ASSERT_FALSE(patch("{\"alarms\":[{\"hour\":3}]}", changed));
+    TEST_ASSERT_FALSE(patch("{\"colorMode\":2,\"brightnessMode\":3}", changed));
+    TEST_ASSERT_FALSE(patch("{\"bogus\":1}", changed));
+    TEST_ASSERT_EQUAL(0xFF, changed);
+    TEST_ASSERT_EQUAL(1, config.colorMode); // nothing applied
+}
+
+static void test_patch_rejects_fractions() {
+    uint8_t changed = 0;
+    TEST_ASSERT_FALSE(patch("{\"colorMode\":2.5}", changed));
+    TEST_ASSERT_FALSE(patch("{\"alarm\":{\"index\":1.0,\"hour\":7}}", changed));
+}
+
+// Decodes both bodies against the current config, as when they wait in the command queue
+// together, and merges them onto it in order
+static FullConfig mergeQueued(const char* first, const char* second) {
+    const FullConfig snapshot = config;
+    FullConfig live = snapshot;
+    const char* bodies[] = {first, second};
+    for(const char* body : bodies) {
+        config = snapshot;
+        uint8_t changed = 0;
+        TEST_ASSERT_TRUE(patch(body, changed));
+        mergeFullConfigPatch(live, config, mask);
+    }
+    config = snapshot;
+    return live;
+}
+
+static void test_queued_patches_merge_member_wise() {
+    FullConfig live = mergeQueued("{\"colorMode\":3}", "{\"override_color\":{\"r\":1,\"g\":2,\"b\":3}}");
+    TEST_ASSERT_EQUAL(3, live.colorMode);
+    TEST_ASSERT_EQUAL(2, live.color.g);
+
+    live = mergeQueued("{\"alarm\":{\"index\":1,\"hour\":6}}", "{\"alarm\":{\"index\":4,\"hour\":9}}");
+    TEST_ASSERT_EQUAL(6, live.alarms[1].hour);
+    TEST_ASSERT_EQUAL(9, live.alarms[4].hour);
+
+    live = mergeQueued("{\"alarm\":{\"index\":2,\"hour\":6}}", "{\"alarm\":{\"index\":2,\"minute\":30}}");
+    TEST_ASSERT_EQUAL(6, live.alarms[2].hour);
+    TEST_ASSERT_EQUAL(30, live.alarms[2].minute);
+}
+
+// Members the body did not name keep the newer value even within a touched nested value
+static void test_merge_leaves_unset_members() {
+    uint8_t changed = 0;
+    TEST_ASSERT_TRUE(patch("{\"override_color\":{\"r\":10}}", changed));
+    FullConfig live = defaultFullConfig();
+    live.color.g = 77;
+    live.animationSpeed = 999;
+    mergeFullConfigPatch(live, config, mask);
+    TEST_ASSERT_EQUAL(10, live.color.r);
+    TEST_ASSERT_EQUAL(77, live.color.g);
+    TEST_ASSERT_EQUAL(999, live.animationSpeed);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_accepts_integers);
+    RUN_TEST(test_rejects_fractions);
+    RUN_TEST(test_rejects_leading_zeros);
+    RUN_TEST(test_exponent_and_decimal_forms_agree);
+    RUN_TEST(test_rejects_out_of_range);
+    RUN_TEST(test_full_decode_skips_unknown_keys);
+    RUN_TEST(test_patch_applies_known_keys);
+    RUN_TEST(test_patch_rejects_unpatchable_keys);
+    RUN_TEST(test_patch_rejects_fractions);
+    RUN_TEST(test_queued_patches_merge_member_wise);
+    RUN_TEST(test_merge_leaves_unset_members);
+    return UNITY_END();
+}
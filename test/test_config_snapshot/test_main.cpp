@@ -0,0 +1,203 @@
+// Host stress test of the RCU config snapshots: readers pin and recheck while writers publish
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include "config_snapshot.h"
+
+#define STRESS_READERS 4
+#define STRESS_WRITERS 2
+#define STRESS_MIN_UPDATES 5000 // per writer
+#define STRESS_MIN_READS 20000   // over all readers; writers keep going until both are reached
+
+// Every field is derived from one stamp, so a torn or recycled snapshot shows up as a mismatch
+static void stampConfig(FullConfig& config, uint16_t stamp) {
+    config.color = {(uint8_t)stamp, (uint8_t)(stamp >> 8), (uint8_t)(stamp * 7)};
+    config.colorMode = stamp % 4;
+    config.animationMode = stamp % 2;
+    for(int i = 0; i < MAX_ALARMS; i++) {
+        config.alarms[i] = {(uint8_t)((stamp + i) % 8), (uint8_t)((stamp + i) % 24), (uint8_t)((stamp + i) % 60),
+                            (stamp + i) % 2 == 0};
+    }
+    config.goodNightDuration = stamp;
+    config.alarmDuration = stamp ^ 0x5A5A;
+    config.animationSpeed = stamp * 3;
+    config.lampGroup = stamp % 3 == 0;
+}
+
+static bool isConsistent(const FullConfig& config) {
+    FullConfig expected;
+    memset(&expected, 0, sizeof(expected));
+    stampConfig(expected, config.goodNightDuration);
+    expected.brightnessMode = config.brightnessMode; // not stamped
+    return memcmp(&expected, &config, sizeof(config)) == 0;
+}
+
+static void bumpStamp(FullConfig& config, const void*) {
+    stampConfig(config, config.goodNightDuration + 1);
+}
+
+void setUp() {
+    FullConfig config;
+    memset(&config, 0, sizeof(config));
+    stampConfig(config, 0);
+    publishConfig(config);
+}
+
+void tearDown() {
+}
+
+static void test_reader_keeps_its_snapshot_across_publishes() {
+    ConfigReader before;
+    uint32_t generation = before.generation();
+    uint16_t stamp = before->goodNightDuration;
+    uint32_t published = updateConfig(bumpStamp, nullptr);
+    TEST_ASSERT_EQUAL(generation + 1, published);
+    TEST_ASSERT_EQUAL(stamp, before->goodNightDuration);
+    TEST_ASSERT_EQUAL(generation, before.generation());
+
+    ConfigReader after;
+    TEST_ASSERT_EQUAL(published, after.generation());
+    TEST_ASSERT_EQUAL(stamp + 1, after->goodNightDuration);
+}
+
+// With every slot pinned a writer has nowhere to write and must wait for a reader to leave
+static void test_writer_waits_while_every_slot_is_pinned() {
+    ConfigReader* first = new ConfigReader();
+    updateConfig(bumpStamp, nullptr);
+    ConfigReader second;
+    updateConfig(bumpStamp, nullptr);
+    ConfigReader third;
+    TEST_ASSERT_EQUAL(CONFIG_SNAPSHOT_SLOTS, 3);
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        updateConfig(bumpStamp, nullptr);
+        done.store(true);
+    });
+    delay(20);
+    TEST_ASSERT_FALSE(done.load());
+    uint16_t firstStamp = (**first).goodNightDuration;
+    TEST_ASSERT_TRUE(isConsistent(**first));
+    delete first;
+    writer.join();
+    TEST_ASSERT_TRUE(done.load());
+    ConfigReader latest;
+    TEST_ASSERT_EQUAL(firstStamp + 3, latest->goodNightDuration);
+}
+
+static void test_concurrent_readers_and_writers() {
+    uint32_t startGeneration = ConfigReader().generation();
+    uint16_t startStamp = ConfigReader()->goodNightDuration;
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> unstable(0);
+    std::atomic<uint32_t> backwards(0);
+    std::atomic<uint32_t> reads(0);
+    std::atomic<uint32_t> updates(0);
+
+    std::vector<std::thread> readers;
+    for(int r = 0; r < STRESS_READERS; r++) {
+        readers.emplace_back([&]() {
+            uint32_t lastGeneration = 0;
+            while(writing.load()) {
+                ConfigReader config;
+                if(config.generation() < lastGeneration) {
+                    backwards++;
+                }
+                lastGeneration = config.generation();
+                if(!isConsistent(*config)) {
+                    torn++;
+                }
+                // A pinned snapshot must not be rewritten while we hold it
+                FullConfig copy = *config;
+                std::this_thread::yield();
+                if(memcmp(&copy, &*config, sizeof(copy)) != 0) {
+                    unstable++;
+                }
+                reads++;
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for(int w = 0; w < STRESS_WRITERS; w++) {
+        writers.emplace_back([&]() {
+            for(uint32_t i = 0; i < STRESS_MIN_UPDATES || reads.load() < STRESS_MIN_READS; i++) {
+                updateConfig(bumpStamp, nullptr);
+                updates++;
+                std::this_thread::yield(); // lets readers in on a single core too
+            }
+        });
+    }
+    for(std::thread& t : writers) {
+        t.join();
+    }
+    writing.store(false);
+    for(std::thread& t : readers) {
+        t.join();
+    }
+
+    char line[96];
+    snprintf(line, sizeof(line), "%u pinned reads against %u updates", (unsigned)reads.load(),
+             (unsigned)updates.load());
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL(0, torn.load());
+    TEST_ASSERT_EQUAL(0, unstable.load());
+    TEST_ASSERT_EQUAL(0, backwards.load());
+    // The writer lock serializes updates, none is lost
+    ConfigReader last;
+    TEST_ASSERT_EQUAL(startGeneration + updates.load(), last.generation());
+    TEST_ASSERT_EQUAL((uint16_t)(startStamp + updates.load()), last->goodNightDuration);
+    TEST_ASSERT_TRUE(isConsistent(*last));
+}
+
+// Every member carries the same number, so a copy taken halfway through a publish shows up
+static void stampSettings(SystemSettings& settings, uint32_t stamp) {
+    snprintf(settings.internalSSID, sizeof(settings.internalSSID), "lamp-%u", (unsigned)stamp);
+    snprintf(settings.internalPW, sizeof(settings.internalPW), "pw-%u", (unsigned)stamp);
+    snprintf(settings.externalSSID, sizeof(settings.externalSSID), "home-%u", (unsigned)stamp);
+    snprintf(settings.externalPW, sizeof(settings.externalPW), "secret-%u", (unsigned)stamp);
+}
+
+static void test_system_settings_are_never_read_torn() {
+    SystemSettings settings;
+    memset(&settings, 0, sizeof(settings));
+    stampSettings(settings, 0);
+    publishSystemSettings(settings);
+    std::atomic<bool> writing(true);
+    std::atomic<uint32_t> torn(0);
+
+    std::thread reader([&]() {
+        while(writing.load()) {
+            SystemSettings copy = readSystemSettings();
+            unsigned stamp = 0;
+            sscanf(copy.internalSSID, "lamp-%u", &stamp);
+            SystemSettings expected;
+            memset(&expected, 0, sizeof(expected));
+            stampSettings(expected, stamp);
+            if(strcmp(copy.internalPW, expected.internalPW) != 0
+               || strcmp(copy.externalSSID, expected.externalSSID) != 0
+               || strcmp(copy.externalPW, expected.externalPW) != 0) {
+                torn++;
+            }
+        }
+    });
+    for(uint32_t i = 1; i <= STRESS_MIN_UPDATES; i++) {
+        stampSettings(settings, i);
+        publishSystemSettings(settings);
+        std::this_thread::yield();
+    }
+    writing.store(false);
+    reader.join();
+
+    TEST_ASSERT_EQUAL(0, torn.load());
+    TEST_ASSERT_EQUAL_STRING("home-5000", readSystemSettings().externalSSID);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reader_keeps_its_snapshot_across_publishes);
+    RUN_TEST(test_writer_waits_while_every_slot_is_pinned);
+    RUN_TEST(test_concurrent_readers_and_writers);
+    RUN_TEST(test_system_settings_are_never_read_torn);
+    return UNITY_END();
+}
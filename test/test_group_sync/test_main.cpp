@@ -0,0 +1,248 @@
+// GroupSync lamps exchanging encoded beacons over a simulated network with jitter
+#include <unity.h>
+#include <vector>
+#include "group_sync.h"
+
+#define SIM_NODES 4
+#define SIM_EPOCH_MS 1700000000000LL
+#define SIM_MIN_DELAY_MS 2
+#define SIM_JITTER_MS 30 // uniform, on top of SIM_MIN_DELAY_MS
+#define SIM_SETTLE_MS 30000
+#define SIM_AGREE_MS (SIM_MIN_DELAY_MS + GROUP_LOCK_MS) // followers trail by about the shortest delay
+
+struct SimLamp {
+    GroupSync sync;
+    int64_t clockOffsetMs; // own clock minus true time
+    uint32_t phaseMs;      // when in the second this lamp beacons
+    bool online;
+
+    SimLamp(uint32_t nodeId, int64_t offsetMs, uint32_t phase)
+        : sync(nodeId), clockOffsetMs(offsetMs), phaseMs(phase), online(true) {
+    }
+};
+
+struct SimPacket {
+    size_t to;
+    uint32_t atMs;
+    uint8_t data[GROUP_BEACON_SIZE];
+};
+
+static std::vector<SimLamp> lamps;
+static std::vector<SimPacket> inFlight;
+static uint32_t simMs = 0;
+static uint32_t lcgState = 1;
+static uint32_t jitterMs = SIM_JITTER_MS;
+
+static uint32_t lcgRandom() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState >> 8;
+}
+
+void setUp() {
+    lamps.clear();
+    inFlight.clear();
+    simMs = 0;
+    lcgState = 1;
+    jitterMs = SIM_JITTER_MS;
+}
+
+void tearDown() {
+}
+
+static int64_t localMs(const SimLamp& lamp) {
+    return SIM_EPOCH_MS + simMs + lamp.clockOffsetMs;
+}
+
+static int64_t groupMs(const SimLamp& lamp) {
+    return localMs(lamp) + lamp.sync.offsetMs();
+}
+
+static void broadcast(size_t from) {
+    uint8_t data[GROUP_BEACON_SIZE];
+    TEST_ASSERT_EQUAL(GROUP_BEACON_SIZE, encodeGroupBeacon(lamps[from].sync.makeBeacon(localMs(lamps[from])), data,
+                                                           sizeof(data)));
+    for(size_t to = 0; to < lamps.size(); to++) {
+        if(to == from) {
+            continue;
+        }
+        SimPacket packet;
+        packet.to = to;
+        packet.atMs = simMs + SIM_MIN_DELAY_MS + (jitterMs > 0 ? lcgRandom() % (jitterMs + 1) : 0);
+        memcpy(packet.data, data, sizeof(data));
+        inFlight.push_back(packet);
+    }
+}
+
+static void deliverDue() {
+    size_t kept = 0;
+    for(size_t i = 0; i < inFlight.size(); i++) {
+        const SimPacket& packet = inFlight[i];
+        if(packet.atMs > simMs) {
+            inFlight[kept++] = packet;
+            continue;
+        }
+        SimLamp& lamp = lamps[packet.to];
+        GroupBeacon beacon;
+        TEST_ASSERT_TRUE(decodeGroupBeacon(packet.data, sizeof(packet.data), beacon));
+        if(lamp.online) {
+            lamp.sync.onBeacon(beacon, localMs(lamp), simMs);
+        }
+    }
+    inFlight.resize(kept);
+}
+
+static SimLamp& leaderOf(const SimLamp& lamp) {
+    for(size_t i = 0; i < lamps.size(); i++) {
+        if(lamps[i].sync.nodeId() == lamp.sync.leaderId()) {
+            return lamps[i];
+        }
+    }
+    TEST_FAIL_MESSAGE("leader is not a lamp");
+    return lamps[0];
+}
+
+// Largest distance of an online follower's group time from its leader's, worst case over the run
+static int64_t run(uint32_t durationMs) {
+    int64_t worstMs = 0;
+    for(uint32_t end = simMs + durationMs; simMs < end; simMs++) {
+        for(size_t i = 0; i < lamps.size(); i++) {
+            if(lamps[i].online && simMs % GROUP_BEACON_INTERVAL_MS == lamps[i].phaseMs) {
+                lamps[i].sync.tick(simMs);
+                broadcast(i);
+            }
+        }
+        deliverDue();
+        for(size_t i = 0; i < lamps.size(); i++) {
+            if(!lamps[i].online) {
+                continue;
+            }
+            int64_t errorMs = groupMs(lamps[i]) - groupMs(leaderOf(lamps[i]));
+            errorMs = errorMs < 0 ? -errorMs : errorMs;
+            worstMs = errorMs > worstMs ? errorMs : worstMs;
+        }
+    }
+    return worstMs;
+}
+
+static void addLamps(const uint32_t* ids, const int64_t* offsetsMs, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        lamps.push_back(SimLamp(ids[i], offsetsMs[i], (uint32_t)(i * GROUP_BEACON_INTERVAL_MS / count)));
+    }
+}
+
+static void assertOneLeader(uint32_t leaderId) {
+    for(size_t i = 0; i < lamps.size(); i++) {
+        if(lamps[i].online) {
+            TEST_ASSERT_EQUAL_UINT32(leaderId, lamps[i].sync.leaderId());
+        }
+    }
+}
+
+static void test_beacon_round_trip() {
+    GroupBeacon beacon = {0xA1B2C3D4, true, false, SIM_EPOCH_MS + 123};
+    uint8_t data[GROUP_BEACON_SIZE];
+    TEST_ASSERT_EQUAL(0, encodeGroupBeacon(beacon, data, sizeof(data) - 1));
+    TEST_ASSERT_EQUAL(GROUP_BEACON_SIZE, encodeGroupBeacon(beacon, data, sizeof(data)));
+    GroupBeacon decoded;
+    TEST_ASSERT_TRUE(decodeGroupBeacon(data, sizeof(data), decoded));
+    TEST_ASSERT_EQUAL_UINT32(beacon.nodeId, decoded.nodeId);
+    TEST_ASSERT_TRUE(decoded.clockSynced);
+    TEST_ASSERT_FALSE(decoded.leader);
+    TEST_ASSERT_TRUE(decoded.groupMs == beacon.groupMs);
+    TEST_ASSERT_FALSE(decodeGroupBeacon(data, sizeof(data) - 1, decoded));
+    data[2]++;
+    TEST_ASSERT_FALSE(decodeGroupBeacon(data, sizeof(data), decoded));
+}
+
+static void test_lowest_id_leads_unsynced_group() {
+    const uint32_t ids[SIM_NODES] = {40, 20, 30, 50};
+    const int64_t offsetsMs[SIM_NODES] = {0, 100, -200, 300};
+    addLamps(ids, offsetsMs, SIM_NODES);
+    run(SIM_SETTLE_MS);
+    assertOneLeader(20);
+    TEST_ASSERT_TRUE(lamps[1].sync.isLeader());
+    for(size_t i = 0; i < lamps.size(); i++) {
+        TEST_ASSERT_EQUAL(SIM_NODES - 1, lamps[i].sync.peerCount());
+        TEST_ASSERT_TRUE(lamps[i].sync.isLocked());
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_AGREE_MS, run(SIM_SETTLE_MS));
+}
+
+static void test_synced_clock_beats_lower_id() {
+    const uint32_t ids[SIM_NODES] = {40, 20, 30, 50};
+    const int64_t offsetsMs[SIM_NODES] = {0, 100, -200, 300};
+    addLamps(ids, offsetsMs, SIM_NODES);
+    lamps[3].sync.setClockSynced(true);
+    run(SIM_SETTLE_MS);
+    assertOneLeader(50);
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_AGREE_MS, run(SIM_SETTLE_MS));
+}
+
+// Errors within GROUP_STEP_MS are slewed in, larger ones stepped at once
+static void test_steps_large_errors_slews_small_ones() {
+    const uint32_t ids[3] = {1, 2, 3};
+    const int64_t offsetsMs[3] = {0, GROUP_STEP_MS / 2, 20 * GROUP_STEP_MS};
+    addLamps(ids, offsetsMs, 3);
+    run(SIM_SETTLE_MS);
+    assertOneLeader(1);
+    TEST_ASSERT_EQUAL_UINT32(0, lamps[1].sync.steps());
+    TEST_ASSERT_EQUAL_UINT32(1, lamps[2].sync.steps());
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_AGREE_MS, run(SIM_SETTLE_MS));
+}
+
+// A new synced leader returns the group to its own clock slowly enough for the followers to keep up
+static void test_followers_track_leader_slew() {
+    const uint32_t ids[SIM_NODES] = {10, 20, 30, 40};
+    const int64_t offsetsMs[SIM_NODES] = {0, -300, 150, 250};
+    addLamps(ids, offsetsMs, SIM_NODES);
+    run(SIM_SETTLE_MS);
+    assertOneLeader(10);
+    lamps[1].sync.setClockSynced(true);
+    run(2 * GROUP_BEACON_INTERVAL_MS);
+    assertOneLeader(20);
+    TEST_ASSERT_TRUE(lamps[1].sync.offsetMs() != 0);
+    int64_t worstMs = run(400 * GROUP_BEACON_INTERVAL_MS);
+    TEST_ASSERT_TRUE(lamps[1].sync.offsetMs() == 0);
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_AGREE_MS, worstMs);
+}
+
+static void test_reelects_when_leader_goes_silent() {
+    const uint32_t ids[SIM_NODES] = {40, 20, 30, 50};
+    const int64_t offsetsMs[SIM_NODES] = {0, 100, -200, 300};
+    addLamps(ids, offsetsMs, SIM_NODES);
+    run(SIM_SETTLE_MS);
+    assertOneLeader(20);
+    uint32_t electionsBefore = lamps[0].sync.elections();
+    lamps[1].online = false;
+    run(GROUP_PEER_TIMEOUT_MS + 2 * GROUP_BEACON_INTERVAL_MS);
+    assertOneLeader(30);
+    TEST_ASSERT_EQUAL_UINT32(electionsBefore + 1, lamps[0].sync.elections());
+    TEST_ASSERT_EQUAL(SIM_NODES - 2, lamps[0].sync.peerCount());
+    TEST_ASSERT_LESS_OR_EQUAL(SIM_AGREE_MS, run(SIM_SETTLE_MS));
+}
+
+// Eight lamps and four times the jitter: followers lose the lock now and then but stay well within a step
+static void test_agrees_under_heavy_jitter() {
+    const uint32_t ids[GROUP_MAX_PEERS] = {8, 7, 6, 5, 4, 3, 2, 1};
+    const int64_t offsetsMs[GROUP_MAX_PEERS] = {0, 40, -80, 120, -160, 200, -240, 280};
+    addLamps(ids, offsetsMs, GROUP_MAX_PEERS);
+    jitterMs = 4 * SIM_JITTER_MS;
+    run(SIM_SETTLE_MS);
+    assertOneLeader(1);
+    TEST_ASSERT_LESS_THAN(GROUP_STEP_MS / 4, run(SIM_SETTLE_MS));
+    for(size_t i = 0; i < lamps.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(0, lamps[i].sync.steps());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_beacon_round_trip);
+    RUN_TEST(test_lowest_id_leads_unsynced_group);
+    RUN_TEST(test_synced_clock_beats_lower_id);
+    RUN_TEST(test_steps_large_errors_slews_small_ones);
+    RUN_TEST(test_followers_track_leader_slew);
+    RUN_TEST(test_reelects_when_leader_goes_silent);
+    RUN_TEST(test_agrees_under_heavy_jitter);
+    return UNITY_END();
+}
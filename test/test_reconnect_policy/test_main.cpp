@@ -0,0 +1,230 @@
+// ReconnectPolicy driven by simulated disconnect and attempt sequences
+#include <unity.h>
+#include "reconnect_policy.h"
+
+#define REASON_UNSPECIFIED 1
+#define REASON_ASSOC_LEAVE 8
+#define REASON_4WAY_HANDSHAKE_TIMEOUT 15
+#define REASON_BEACON_TIMEOUT 200
+#define REASON_NO_AP_FOUND 201
+#define REASON_AUTH_FAIL 202
+
+#define SIM_STEP_MS 100
+#define SIM_ATTEMPT_MS 3000 // how long a failing attempt takes to report back
+
+static uint32_t randomValue = 0;
+static uint32_t lcgState = 1;
+
+static uint32_t fixedRandom() {
+    return randomValue;
+}
+
+static uint32_t lcgRandom() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState;
+}
+
+// From the top of the random range, the modulo still keeps the jitter within half the backoff
+static uint32_t maxRandom() {
+    return UINT32_MAX;
+}
+
+void setUp() {
+    randomValue = 0;
+    lcgState = 1;
+}
+
+void tearDown() {
+}
+
+// Steps the clock until an attempt is due; returns false if none came within limitMs
+static bool waitForAttempt(ReconnectPolicy& policy, uint32_t& nowMs, uint32_t limitMs) {
+    for(uint32_t waited = 0; waited <= limitMs; waited += SIM_STEP_MS) {
+        if(policy.shouldAttempt(nowMs)) {
+            return true;
+        }
+        nowMs += SIM_STEP_MS;
+    }
+    return false;
+}
+
+static void test_classifies_reasons() {
+    TEST_ASSERT_EQUAL(DISCONNECT_IGNORED, classifyDisconnect(REASON_ASSOC_LEAVE));
+    TEST_ASSERT_EQUAL(DISCONNECT_AUTH, classifyDisconnect(REASON_4WAY_HANDSHAKE_TIMEOUT));
+    TEST_ASSERT_EQUAL(DISCONNECT_AUTH, classifyDisconnect(REASON_AUTH_FAIL));
+    TEST_ASSERT_EQUAL(DISCONNECT_AP_GONE, classifyDisconnect(REASON_BEACON_TIMEOUT));
+    TEST_ASSERT_EQUAL(DISCONNECT_AP_GONE, classifyDisconnect(REASON_NO_AP_FOUND));
+    TEST_ASSERT_EQUAL(DISCONNECT_TRANSIENT, classifyDisconnect(REASON_UNSPECIFIED));
+    TEST_ASSERT_EQUAL(DISCONNECT_TRANSIENT, classifyDisconnect(9999));
+}
+
+static void test_own_disconnect_is_ignored() {
+    ReconnectPolicy policy(fixedRandom);
+    TEST_ASSERT_EQUAL(0, policy.onDisconnect(REASON_ASSOC_LEAVE, 1000));
+    TEST_ASSERT_FALSE(policy.isWaiting());
+    TEST_ASSERT_EQUAL(0, policy.failures());
+    TEST_ASSERT_FALSE(policy.shouldAttempt(100000));
+}
+
+// With no jitter every delay is half the exponential one, until the cap stops the growth
+static void test_backoff_doubles_up_to_the_cap() {
+    ReconnectPolicy policy(fixedRandom);
+    uint32_t expected = RECONNECT_TRANSIENT_BASE_MS / 2;
+    for(int i = 0; i < 20; i++) {
+        uint32_t delayMs = policy.onDisconnect(REASON_UNSPECIFIED, 0);
+        TEST_ASSERT_EQUAL(expected, delayMs);
+        expected = expected * 2 > RECONNECT_TRANSIENT_CAP_MS / 2 ? RECONNECT_TRANSIENT_CAP_MS / 2 : expected * 2;
+    }
+    TEST_ASSERT_EQUAL(20, policy.failures());
+    TEST_ASSERT_EQUAL(20, policy.disconnects(DISCONNECT_TRANSIENT));
+}
+
+static void test_full_jitter_never_exceeds_the_cap() {
+    ReconnectPolicy policy(maxRandom);
+    for(int i = 0; i < 40; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(RECONNECT_AUTH_CAP_MS, policy.onDisconnect(REASON_AUTH_FAIL, 0));
+    }
+}
+
+// Equal jitter: each delay lies between half the backoff and the whole of it
+static void test_jitter_stays_within_half_and_full() {
+    ReconnectPolicy policy(lcgRandom);
+    uint32_t backoff = RECONNECT_AP_GONE_BASE_MS;
+    uint32_t spread = 0;
+    uint32_t first = 0;
+    for(int i = 0; i < 12; i++) {
+        uint32_t delayMs = policy.onDisconnect(REASON_NO_AP_FOUND, 0);
+        TEST_ASSERT_GREATER_OR_EQUAL(backoff / 2, delayMs);
+        TEST_ASSERT_LESS_OR_EQUAL(backoff, delayMs);
+        backoff = backoff * 2 > RECONNECT_AP_GONE_CAP_MS ? RECONNECT_AP_GONE_CAP_MS : backoff * 2;
+        if(i == 0) {
+            first = delayMs;
+        }
+        spread |= delayMs ^ first;
+    }
+    TEST_ASSERT_NOT_EQUAL(0, spread);
+}
+
+static void test_classes_use_their_own_base() {
+    ReconnectPolicy transient(fixedRandom);
+    ReconnectPolicy apGone(fixedRandom);
+    ReconnectPolicy auth(fixedRandom);
+    TEST_ASSERT_EQUAL(RECONNECT_TRANSIENT_BASE_MS / 2, transient.onDisconnect(REASON_UNSPECIFIED, 0));
+    TEST_ASSERT_EQUAL(RECONNECT_AP_GONE_BASE_MS / 2, apGone.onDisconnect(REASON_BEACON_TIMEOUT, 0));
+    TEST_ASSERT_EQUAL(RECONNECT_AUTH_BASE_MS / 2, auth.onDisconnect(REASON_4WAY_HANDSHAKE_TIMEOUT, 0));
+    TEST_ASSERT_EQUAL(DISCONNECT_AUTH, auth.lastClass());
+}
+
+static void test_attempt_is_due_once_after_the_delay() {
+    ReconnectPolicy policy(fixedRandom);
+    uint32_t delayMs = policy.onDisconnect(REASON_UNSPECIFIED, 5000);
+    TEST_ASSERT_EQUAL(delayMs, policy.nextAttemptInMs(5000));
+    TEST_ASSERT_FALSE(policy.shouldAttempt(5000 + delayMs - 1));
+    TEST_ASSERT_EQUAL(1, policy.nextAttemptInMs(5000 + delayMs - 1));
+    TEST_ASSERT_TRUE(policy.shouldAttempt(5000 + delayMs));
+    TEST_ASSERT_FALSE(policy.shouldAttempt(5000 + delayMs));
+    TEST_ASSERT_FALSE(policy.shouldAttempt(5000 + delayMs + 1000));
+    TEST_ASSERT_EQUAL(1, policy.attempts());
+    TEST_ASSERT_EQUAL(0, policy.nextAttemptInMs(5000 + delayMs));
+}
+
+// An attempt the driver never reports on counts as another failure and is retried
+static void test_silent_attempt_times_out() {
+    ReconnectPolicy policy(fixedRandom);
+    uint32_t nowMs = 0;
+    policy.onDisconnect(REASON_UNSPECIFIED, nowMs);
+    TEST_ASSERT_TRUE(waitForAttempt(policy, nowMs, 10000));
+    uint32_t attemptMs = nowMs;
+    TEST_ASSERT_FALSE(policy.shouldAttempt(attemptMs + RECONNECT_ATTEMPT_TIMEOUT_MS - 1));
+    TEST_ASSERT_FALSE(policy.shouldAttempt(attemptMs + RECONNECT_ATTEMPT_TIMEOUT_MS));
+    TEST_ASSERT_TRUE(policy.isWaiting());
+    TEST_ASSERT_EQUAL(2, policy.failures());
+    nowMs = attemptMs + RECONNECT_ATTEMPT_TIMEOUT_MS;
+    TEST_ASSERT_TRUE(waitForAttempt(policy, nowMs, RECONNECT_TRANSIENT_BASE_MS));
+    TEST_ASSERT_EQUAL(2, policy.attempts());
+}
+
+static void test_connect_resets_the_backoff() {
+    ReconnectPolicy policy(fixedRandom);
+    for(int i = 0; i < 6; i++) {
+        policy.onDisconnect(REASON_NO_AP_FOUND, 0);
+    }
+    policy.onConnected();
+    TEST_ASSERT_EQUAL(0, policy.failures());
+    TEST_ASSERT_EQUAL(1, policy.successes());
+    TEST_ASSERT_FALSE(policy.isWaiting());
+    TEST_ASSERT_EQUAL(RECONNECT_TRANSIENT_BASE_MS / 2, policy.onDisconnect(REASON_UNSPECIFIED, 0));
+}
+
+// Timers run on millis(), which wraps after 49 days
+static void test_waits_across_the_millis_wrap() {
+    ReconnectPolicy policy(fixedRandom);
+    uint32_t nowMs = UINT32_MAX - 200;
+    uint32_t delayMs = policy.onDisconnect(REASON_UNSPECIFIED, nowMs);
+    TEST_ASSERT_FALSE(policy.shouldAttempt(nowMs + 100));
+    TEST_ASSERT_TRUE(policy.shouldAttempt(nowMs + delayMs));
+}
+
+// A router reboots: the beacon is lost, then every attempt finds no AP until it is back
+static void test_router_reboot_sequence() {
+    ReconnectPolicy policy(lcgRandom);
+    const uint32_t routerBackMs = 90 * 1000;
+    uint32_t nowMs = 0;
+    policy.onDisconnect(REASON_BEACON_TIMEOUT, nowMs);
+    uint32_t lastAttemptMs = 0;
+    while(true) {
+        TEST_ASSERT_TRUE(waitForAttempt(policy, nowMs, RECONNECT_AP_GONE_CAP_MS));
+        lastAttemptMs = nowMs;
+        nowMs += SIM_ATTEMPT_MS;
+        if(nowMs >= routerBackMs) {
+            policy.onConnected();
+            break;
+        }
+        policy.onDisconnect(REASON_NO_AP_FOUND, nowMs);
+    }
+    // Backed off, so only a handful of attempts, but back within one capped wait of the router
+    TEST_ASSERT_LESS_OR_EQUAL(8, policy.attempts());
+    TEST_ASSERT_GREATER_OR_EQUAL(3, policy.attempts());
+    TEST_ASSERT_LESS_OR_EQUAL(routerBackMs + RECONNECT_AP_GONE_CAP_MS, lastAttemptMs + SIM_ATTEMPT_MS);
+    TEST_ASSERT_EQUAL(1, policy.successes());
+    TEST_ASSERT_FALSE(policy.isWaiting());
+}
+
+// A wrong password: attempts slow down to the auth cap but never stop for good
+static void test_wrong_password_keeps_trying_rarely() {
+    ReconnectPolicy policy(lcgRandom);
+    uint32_t nowMs = 0;
+    policy.onDisconnect(REASON_4WAY_HANDSHAKE_TIMEOUT, nowMs);
+    const uint32_t dayMs = 24UL * 60 * 60 * 1000;
+    uint32_t previousMs = 0;
+    uint32_t longestGapMs = 0;
+    while(nowMs < dayMs) {
+        TEST_ASSERT_TRUE(waitForAttempt(policy, nowMs, RECONNECT_AUTH_CAP_MS));
+        if(policy.attempts() > 1 && nowMs - previousMs > longestGapMs) {
+            longestGapMs = nowMs - previousMs;
+        }
+        previousMs = nowMs;
+        nowMs += SIM_ATTEMPT_MS;
+        policy.onDisconnect(REASON_4WAY_HANDSHAKE_TIMEOUT, nowMs);
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(RECONNECT_AUTH_CAP_MS + SIM_ATTEMPT_MS + SIM_STEP_MS, longestGapMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(24, policy.attempts());   // at least hourly
+    TEST_ASSERT_LESS_OR_EQUAL(24 * 3, policy.attempts()); // but not much more
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_classifies_reasons);
+    RUN_TEST(test_own_disconnect_is_ignored);
+    RUN_TEST(test_backoff_doubles_up_to_the_cap);
+    RUN_TEST(test_full_jitter_never_exceeds_the_cap);
+    RUN_TEST(test_jitter_stays_within_half_and_full);
+    RUN_TEST(test_classes_use_their_own_base);
+    RUN_TEST(test_attempt_is_due_once_after_the_delay);
+    RUN_TEST(test_silent_attempt_times_out);
+    RUN_TEST(test_connect_resets_the_backoff);
+    RUN_TEST(test_waits_across_the_millis_wrap);
+    RUN_TEST(test_router_reboot_sequence);
+    RUN_TEST(test_wrong_password_keeps_trying_rarely);
+    return UNITY_END();
+}
@@ -0,0 +1,155 @@
+// TxPowerController fed with replayed RSSI traces
+#include <unity.h>
+#include "tx_power_controller.h"
+
+#define NEED_DBM (LINK_RSSI_FLOOR_DBM + LINK_MARGIN_DB)
+#define TRACE_SAMPLES 2000
+
+static uint32_t lcgState = 1;
+
+static uint32_t lcgRandom() {
+    lcgState = lcgState * 1664525u + 1013904223u;
+    return lcgState >> 8;
+}
+
+void setUp() {
+    lcgState = 1;
+}
+
+void tearDown() {
+}
+
+static void feed(TxPowerController& controller, int8_t sampleDbm, int count) {
+    for(int i = 0; i < count; i++) {
+        controller.update(sampleDbm);
+    }
+}
+
+static void test_starts_at_full_power() {
+    TxPowerController controller;
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+}
+
+static void test_steps_down_after_consecutive_room() {
+    TxPowerController controller;
+    feed(controller, -40, LINK_STEP_DOWN_SAMPLES - 1);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+    controller.update(-40);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM - TX_POWER_STEP_DBM, controller.powerDbm());
+    feed(controller, -40, LINK_STEP_DOWN_SAMPLES - 1);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM - TX_POWER_STEP_DBM, controller.powerDbm());
+}
+
+static void test_weak_sample_restarts_the_count() {
+    TxPowerController controller;
+    feed(controller, -40, LINK_STEP_DOWN_SAMPLES - 1);
+    controller.update(-80);
+    feed(controller, -40, LINK_STEP_DOWN_SAMPLES - 1);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+}
+
+static void test_clamps_at_min() {
+    TxPowerController controller;
+    int steps = (TX_POWER_MAX_DBM - TX_POWER_MIN_DBM) / TX_POWER_STEP_DBM;
+    feed(controller, -30, steps * LINK_STEP_DOWN_SAMPLES);
+    TEST_ASSERT_EQUAL(TX_POWER_MIN_DBM, controller.powerDbm());
+    feed(controller, -30, 10 * LINK_STEP_DOWN_SAMPLES);
+    TEST_ASSERT_EQUAL(TX_POWER_MIN_DBM, controller.powerDbm());
+}
+
+static void test_steps_up_at_once_as_far_as_needed() {
+    TxPowerController controller;
+    feed(controller, -30, 100);
+    TEST_ASSERT_EQUAL(TX_POWER_MIN_DBM, controller.powerDbm());
+    // At 2 dBm the peer hears -50 - 18 = -68, 4 dB short of the need: two steps in one sample
+    controller.update(-50);
+    TEST_ASSERT_EQUAL(TX_POWER_MIN_DBM + 2 * TX_POWER_STEP_DBM, controller.powerDbm());
+}
+
+static void test_clamps_at_max() {
+    TxPowerController controller;
+    feed(controller, -30, 100);
+    controller.update(-90);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+    feed(controller, -90, 10);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+}
+
+// Settles where one more step would leave less than the step plus the hysteresis above the need
+static void test_hysteresis_keeps_headroom() {
+    TxPowerController controller;
+    feed(controller, -56, 100);
+    int8_t powerDbm = controller.powerDbm();
+    int peerHearsDbm = -56 - (LINK_PEER_TX_DBM - powerDbm);
+    TEST_ASSERT_GREATER_OR_EQUAL(NEED_DBM, peerHearsDbm);
+    TEST_ASSERT_LESS_THAN(NEED_DBM + TX_POWER_STEP_DBM + LINK_HYSTERESIS_DB, peerHearsDbm);
+    feed(controller, -56, 100);
+    TEST_ASSERT_EQUAL(powerDbm, controller.powerDbm());
+}
+
+static void test_reset_restores_full_power() {
+    TxPowerController controller;
+    feed(controller, -30, 100);
+    controller.reset();
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, controller.powerDbm());
+}
+
+static void test_smooths_rssi() {
+    TxPowerController controller;
+    controller.update(-40);
+    TEST_ASSERT_EQUAL(-40, controller.rssiDbm());
+    controller.update(-80);
+    TEST_ASSERT_EQUAL(-50, controller.rssiDbm());
+}
+
+// Walks away from the peer and back with +-6 dB fading. The power stays in range, a sample that
+// leaves the peer short at the old power raises it at once, and no step down leaves it short by more
+// than that step.
+static void test_walk_trace_keeps_the_link() {
+    TxPowerController controller;
+    int minPowerDbm = TX_POWER_MAX_DBM;
+    int maxPowerDbm = TX_POWER_MIN_DBM;
+    for(int i = 0; i < TRACE_SAMPLES; i++) {
+        int distance = i < TRACE_SAMPLES / 2 ? i : TRACE_SAMPLES - i;
+        int sampleDbm = -35 - distance * 50 / (TRACE_SAMPLES / 2) + (int)(lcgRandom() % 13) - 6;
+        int8_t lastDbm = controller.powerDbm();
+        int8_t powerDbm = controller.update(sampleDbm);
+        TEST_ASSERT_GREATER_OR_EQUAL(TX_POWER_MIN_DBM, powerDbm);
+        TEST_ASSERT_LESS_OR_EQUAL(TX_POWER_MAX_DBM, powerDbm);
+        if(sampleDbm - (LINK_PEER_TX_DBM - lastDbm) < NEED_DBM) {
+            TEST_ASSERT_TRUE(powerDbm > lastDbm || powerDbm == TX_POWER_MAX_DBM);
+        }
+        if(powerDbm < TX_POWER_MAX_DBM) {
+            int peerHearsDbm = sampleDbm - (LINK_PEER_TX_DBM - powerDbm);
+            TEST_ASSERT_GREATER_OR_EQUAL(NEED_DBM - TX_POWER_STEP_DBM, peerHearsDbm);
+        }
+        minPowerDbm = powerDbm < minPowerDbm ? powerDbm : minPowerDbm;
+        maxPowerDbm = powerDbm > maxPowerDbm ? powerDbm : maxPowerDbm;
+    }
+    TEST_ASSERT_EQUAL(TX_POWER_MIN_DBM, minPowerDbm);
+    TEST_ASSERT_EQUAL(TX_POWER_MAX_DBM, maxPowerDbm);
+    TEST_ASSERT_LESS_THAN(TX_POWER_MAX_DBM, controller.powerDbm());
+}
+
+static void test_modem_sleep_sta_only() {
+    TEST_ASSERT_TRUE(modemSleepAllowed(true, false));
+    TEST_ASSERT_FALSE(modemSleepAllowed(false, false)); // AP or APSTA
+    TEST_ASSERT_FALSE(modemSleepAllowed(true, true));   // lamp group beacons
+    TEST_ASSERT_FALSE(modemSleepAllowed(false, true));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_at_full_power);
+    RUN_TEST(test_steps_down_after_consecutive_room);
+    RUN_TEST(test_weak_sample_restarts_the_count);
+    RUN_TEST(test_clamps_at_min);
+    RUN_TEST(test_steps_up_at_once_as_far_as_needed);
+    RUN_TEST(test_clamps_at_max);
+    RUN_TEST(test_hysteresis_keeps_headroom);
+    RUN_TEST(test_reset_restores_full_power);
+    RUN_TEST(test_smooths_rssi);
+    RUN_TEST(test_walk_trace_keeps_the_link);
+    RUN_TEST(test_modem_sleep_sta_only);
+    return UNITY_END();
+}